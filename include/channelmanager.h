@@ -29,6 +29,12 @@ private:
 	/** A map of channel names to the channel object. */
 	ChannelMap channels;
 
+	/** The most recently allocated ban serial. */
+	uint64_t lastbanserial = 0;
+
+	/** The ban serial at which the cached ban state of all channel members was last invalidated. */
+	uint64_t banserial = 0;
+
 public:
 	/** Determines whether an channel name is valid. */
 	std::function<bool(const std::string_view&)> IsChannel = DefaultIsChannel;
@@ -55,4 +61,18 @@ public:
 	 * @return True if the character is a channel prefix; otherwise, false.
 	 */
 	bool IsPrefix(unsigned char prefix) const;
+
+	/** Retrieves the ban serial at which the cached ban state of all channel members was last
+	 * invalidated. Cached ban state which was computed at or before this serial is stale.
+	 */
+	uint64_t GetBanSerial() const { return banserial; }
+
+	/** Invalidates the cached ban state of all members of all channels. Modules which change how
+	 * users match ban list entries (e.g. by implementing the OnCheckBan event) should call this
+	 * when the state that the match depends on changes in a way which the core does not know about.
+	 */
+	void InvalidateBans() { banserial = NextBanSerial(); }
+
+	/** Allocates a new ban serial which is greater than all previously allocated ban serials. */
+	uint64_t NextBanSerial() { return ++lastbanserial; }
 };
@@ -46,7 +46,99 @@ public:
 	 */
 	typedef std::unordered_map<User*, insp::aligned_storage<Membership>> MemberMap;
 
+	/** An entry in the local member list of a channel. */
+	struct LocalMember final
+	{
+		/** The rank of the member when it was last indexed. */
+		ModeHandler::Rank rank;
+
+		/** The membership of the local user. */
+		Membership* memb;
+
+		/** Retrieves the local user this entry is for. */
+		LocalUser* GetUser() const { return static_cast<LocalUser*>(memb->user); }
+	};
+
+	/** A list of the local members of a channel ordered by descending rank. */
+	typedef std::vector<LocalMember> LocalMemberList;
+
+	/** The number of members of a channel with a specific rank ordered by descending rank. */
+	typedef insp::flat_map<ModeHandler::Rank, size_t, std::greater<ModeHandler::Rank>> RankCounts;
+
+	/** The number of remote members of a channel keyed by the server they are connected to. */
+	typedef insp::flat_map<Server*, RankCounts> ServerCounts;
+
 private:
+	/** An entry from the ban list of a channel which has been preprocessed for matching. */
+	struct CompiledBan final
+	{
+		/** The ways in which the host part of a ban can be matched. */
+		enum class HostType
+			: uint8_t
+		{
+			/** The ban has no host part and can only be matched by modules. */
+			NONE,
+
+			/** The host part contains no wildcards and is compared literally. */
+			EXACT,
+
+			/** The host part is an IP address or CIDR range. */
+			CIDR,
+
+			/** The host part contains wildcards. */
+			WILDCARD,
+
+			/** The host part has to be matched with InspIRCd::MatchCIDR. */
+			COMPLEX,
+		};
+
+		/** The ban mask exactly as it appears in the ban list. */
+		std::string mask;
+
+		/** The nick!user part of the ban mask. */
+		std::string prefix;
+
+		/** The host part of the ban mask. */
+		std::string host;
+
+		/** If type is CIDR then the parsed CIDR range. */
+		irc::sockets::cidr_mask cidr;
+
+		/** How the host part of the ban mask is matched. */
+		HostType type = HostType::NONE;
+
+		/** Creates a compiled ban from the specified ban mask.
+		 * @param banmask The ban mask to compile.
+		 */
+		CompiledBan(const std::string& banmask);
+	};
+
+	/** The value of ChannelManager::NextBanSerial() when the ban list of this channel was last changed. */
+	uint64_t banserial = 0;
+
+	/** The value of banserial when compiledbans and extbans were last built. */
+	uint64_t compiledserial = 0;
+
+	/** The entries from the ban list of this channel which are not extbans. */
+	std::vector<CompiledBan> compiledbans;
+
+	/** The entries from the ban list of this channel which are formatted like extbans. As these
+	 * can depend on state that is not tracked by the core they are always checked and never cached.
+	 */
+	std::vector<std::string> extbans;
+
+	/** Rebuilds compiledbans and extbans from the ban list of this channel if it has changed. */
+	void CompileBans();
+
+	/** Checks whether a user matches an entry from the ban list of this channel.
+	 * @param user The user to check.
+	 * @param entry The compiled ban list entry to check against.
+	 * @param nickduser The nick!duser of the user.
+	 * @param nickruser The nick!ruser of the user.
+	 * @return True if the user matches the ban; otherwise, false.
+	 */
+	bool CheckBan(User* user, const CompiledBan& entry, const std::string& nickduser, const std::string& nickruser);
+
 	/** Set default modes for the channel on creation
 	 */
 	void SetDefaultModes();
@@ -57,14 +149,44 @@ private:
 	 */
 	ModeParser::ModeStatus modes;
 
+	/** The memberships of local users on this channel ordered by descending rank. Members with the
+	 * same rank are stored contiguously which allows a status message to be sent by only visiting
+	 * the members that will receive it.
+	 */
+	LocalMemberList localusers;
+
+	/** Adds a local membership to the local member list at the position for the specified rank.
+	 * @param memb The membership to add.
+	 * @param rank The rank of the membership.
+	 */
+	void AddLocalUser(Membership* memb, ModeHandler::Rank rank);
+
+	/** Removes a local membership from the local member list.
+	 * @param memb The membership to remove.
+	 */
+	void DelLocalUser(Membership* memb);
+
+	/** The number of remote members of this channel with each rank keyed by their server. This
+	 * allows protocol modules to route messages without visiting every member of the channel.
+	 */
+	ServerCounts remoteusers;
+
+	/** Adjusts the count of remote members of this channel.
+	 * @param server The server the remote member is connected to.
+	 * @param rank The rank of the remote member.
+	 * @param adding True if the member is being added; otherwise, false.
+	 */
+	void CountRemoteUser(Server* server, ModeHandler::Rank rank, bool adding);
+
 	/** Remove the given membership from the channel's internal map of
 	 * memberships and destroy the Membership object.
 	 * This function does not remove the channel from User::chanlist.
 	 * Since the parameter is an iterator to the target, the complexity
 	 * of this function is constant.
 	 * @param membiter The MemberMap iterator to remove, must be valid
+	 * @param checkdestroy Whether to check if the channel should be destroyed afterwards.
 	 */
-	void DelUser(const MemberMap::iterator& membiter);
+	void DelUser(const MemberMap::iterator& membiter, bool checkdestroy = true);
 
 public:
 	/** Creates a channel record and initialises it with default values
@@ -164,6 +286,12 @@ public:
 	 */
 	void DelUser(User* user);
 
+	/** Deletes multiple users from the internal reference list. This only checks whether the
+	 * channel should be destroyed once all of the users have been removed.
+	 * @param users The users to delete.
+	 */
+	void DelUsers(const std::vector<User*>& users);
+
 	/** Obtain the internal reference list
 	 * The internal reference list contains a list of User*.
 	 * These are used for rapid comparison to determine
@@ -175,6 +303,26 @@ public:
 	 */
 	const MemberMap& GetUsers() const { return userlist; }
 
+	/** Retrieves the memberships of local users on this channel ordered by descending rank. */
+	const LocalMemberList& GetLocalUsers() const { return localusers; }
+
+	/** Retrieves the number of remote members of this channel with each rank keyed by the server
+	 * they are connected to.
+	 */
+	const ServerCounts& GetRemoteUsers() const { return remoteusers; }
+
+	/** Updates the member indices of this channel after the rank of a member has changed. Only the
+	 * core should call this method.
+	 * @param memb The membership that has changed rank.
+	 * @param oldrank The rank of the membership before it changed.
+	 */
+	void UpdateUserRank(Membership* memb, ModeHandler::Rank oldrank);
+
+	/** Rebuilds the member indices of this channel from scratch. This should be called if the rank
+	 * of a prefix mode has changed. Only the core should call this method.
+	 */
+	void RebuildUserRanks();
+
 	/** Returns true if the user given is on the given channel.
 	 * @param user The user to look for
 	 * @return True if the user is on this channel
@@ -290,6 +438,11 @@ public:
 	 */
 	bool IsBanned(User* user);
 
+	/** Invalidates the cached ban state of all members of this channel. This is called when a
+	 * list mode entry is added or removed.
+	 */
+	void InvalidateBans();
+
 	/** Check a single ban for match
 	 */
 	bool CheckBan(User* user, const std::string& banmask);
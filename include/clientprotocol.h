@@ -88,6 +88,15 @@ public:
 	{
 		return (this->selection == other.selection);
 	}
+
+	/** Select all of the tags which are selected in another TagSelection.
+	 * @param other Other TagSelection object to merge into this one. This must refer to the same TagMap.
+	 */
+	TagSelection& operator|=(const TagSelection& other)
+	{
+		selection |= other.selection;
+		return *this;
+	}
 };
 
 class CoreExport ClientProtocol::MessageSource
@@ -305,6 +314,31 @@ public:
 private:
 	typedef std::vector<std::pair<SerializedInfo, SerializedMessage>> SerializedList;
 
+	/** Tags which were selected for users with a specific capability fingerprint. */
+	struct CachedWhitelist final
+	{
+		/** The serializer the tags were selected for. */
+		const Serializer* serializer;
+
+		/** The capability fingerprint of the users the tags were selected for. */
+		intptr_t fingerprint;
+
+		/** The tags which were selected by tag providers that only depend on capabilities. */
+		TagSelection tagwl;
+
+		/** If the message has no tags which depend on more than capabilities then the index of
+		 * the serialized message in serlist; otherwise, SIZE_MAX.
+		 */
+		size_t serindex = SIZE_MAX;
+
+		CachedWhitelist(const Serializer* Ser, intptr_t Fingerprint, const TagSelection& Tagwl)
+			: serializer(Ser)
+			, fingerprint(Fingerprint)
+			, tagwl(Tagwl)
+		{
+		}
+	};
+
 	ParamList params;
 	TagMap tags;
 	std::string command;
@@ -312,6 +346,31 @@ private:
 	mutable SerializedList serlist;
 	bool sideeffect = false;
 
+	/** Whether any tags on this message are provided by a tag provider which depends on more than
+	 * capabilities. Only valid if wlcache is not empty.
+	 */
+	bool hasusertags = false;
+
+	/** The tag whitelists which have been selected for this message. There are usually only a
+	 * handful of distinct capability fingerprints so this is small.
+	 */
+	std::vector<CachedWhitelist> wlcache;
+
+	/** The index in wlcache of the most recently used whitelist. */
+	size_t lastwl = 0;
+
+	/** Find the tags which have been selected for users with a specific capability fingerprint.
+	 * @param serializer The serializer the tags were selected for.
+	 * @param fingerprint The capability fingerprint of the user.
+	 * @return The cached whitelist or nullptr if one has not been created yet.
+	 */
+	CachedWhitelist* FindWhitelist(const Serializer* serializer, intptr_t fingerprint);
+
+	/** Retrieves the index of a serialized form of this message in serlist, generating it if needed.
+	 * @param serializeinfo Information about which exact serialized form of the message is needed.
+	 */
+	size_t GetSerializedIndex(const SerializedInfo& serializeinfo) const;
+
 protected:
 	/** Set command string.
 	 * @param cmd Command string to set.
@@ -426,6 +485,16 @@ public:
 	void AddTag(const std::string& tagname, MessageTagProvider* tagprov, const std::string& val, void* tagdata = nullptr)
 	{
 		tags.emplace(tagname, MessageTagData(tagprov, val, tagdata));
+		wlcache.clear();
+	}
+
+	/** Remove a tag.
+	 * @param tagname Raw name of the tag to remove.
+	 */
+	void RemoveTag(const std::string& tagname)
+	{
+		if (tags.erase(tagname))
+			InvalidateCache();
 	}
 
 	/** Add all tags in a TagMap to the tags in this message. Existing tags will not be overwritten.
@@ -434,6 +503,7 @@ public:
 	void AddTags(const ClientProtocol::TagMap& newtags)
 	{
 		tags.insert(newtags.begin(), newtags.end());
+		wlcache.clear();
 	}
 
 	/** Get the message in a serialized form.
@@ -461,6 +531,7 @@ public:
 	void InvalidateCache()
 	{
 		serlist.clear();
+		wlcache.clear();
 	}
 
 	void CopyAll()
@@ -609,6 +680,12 @@ public:
 	 * @return True if the tag should be sent to the user, false otherwise.
 	 */
 	virtual bool ShouldSendTag(LocalUser* user, const MessageTagData& tagdata) = 0;
+
+	/** Determines whether ShouldSendTag() only depends on the client capabilities that the user has
+	 * enabled. If this returns true then the result will be reused for other users with the same
+	 * capabilities. The default implementation returns false.
+	 */
+	virtual bool OnlyDependsOnCaps() const { return false; }
 };
 
 /** Base class for client protocol event hooks.
@@ -730,12 +807,15 @@ class CoreExport ClientProtocol::Serializer
 private:
 	ClientProtocol::MessageTagEvent evprov;
 
-	/** Make a white list containing which tags a user should get.
+	/** Add the tags a user should get to a white list.
 	 * @param user User in question.
 	 * @param tagmap Tag map that contains all possible tags.
-	 * @return Whitelist of tags to send to the user.
+	 * @param caponly If true then only check tags from providers which only depend on capabilities;
+	 * otherwise, only check tags from providers which depend on more than capabilities.
+	 * @param tagwl Whitelist to add the tags to.
+	 * @return True if any tags were skipped because of the caponly parameter; otherwise, false.
 	 */
-	static TagSelection MakeTagWhitelist(LocalUser* user, const TagMap& tagmap);
+	static bool MakeTagWhitelist(LocalUser* user, const TagMap& tagmap, bool caponly, TagSelection& tagwl);
 
 public:
 	/** Constructor.
@@ -776,7 +856,7 @@ public:
 	 * @param parseoutput Output of the parser.
 	 * @return True if the message was parsed successfully into parseoutput and should be processed, false to drop the message.
 	 */
-	virtual bool Parse(LocalUser* user, const std::string& line, ParseOutput& parseoutput) = 0;
+	virtual bool Parse(LocalUser* user, const std::string_view& line, ParseOutput& parseoutput) = 0;
 };
 
 inline ClientProtocol::MessageTagData::MessageTagData(MessageTagProvider* prov, const std::string& val, void* data)
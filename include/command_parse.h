@@ -109,7 +109,7 @@ public:
 	 * @param buffer The buffer line to process
 	 * @param user The user to whom this line belongs
 	 */
-	void ProcessBuffer(LocalUser* user, const std::string& buffer);
+	void ProcessBuffer(LocalUser* user, const std::string_view& buffer);
 
 	/** Process a command from a user.
 	 * @param user The user to parse the command for.
@@ -118,6 +118,16 @@ public:
 	 */
 	void ProcessCommand(LocalUser* user, std::string& command, CommandBase::Params& parameters);
 
+	/** Finishes processing a command which suspended the user that issued it. This runs the
+	 * OnCommandResumed hook, calls the continuation, and then runs the post-command hooks with
+	 * the result it returned.
+	 * @param handler The command which was suspended.
+	 * @param parameters The parameters to the command.
+	 * @param user The user who issued the command. The caller must have already called Resume().
+	 * @param continuation The remainder of the command which returns its result.
+	 */
+	static void ResumeCommand(Command* handler, const CommandBase::Params& parameters, LocalUser* user, const std::function<CmdResult()>& continuation);
+
 	/** Add a new command to the commands hash
 	 * @param f The new Command to add to the list
 	 * @return True if the command was added
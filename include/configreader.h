@@ -490,9 +490,15 @@ public:
 	/** The maximum amount of data to read from a socket in one go. */
 	size_t NetBufferSize;
 
+	/** The maximum number of worker threads to use for expensive jobs like password hashing. */
+	size_t WorkerThreads;
+
 	/** The maximum number of local connections that can be made to the IRC server. */
 	size_t SoftLimit;
 
+	/** Whether to collect latency statistics for module events and command handlers. */
+	bool LatencyStats;
+
 	/** Whether to store the full nick!duser\@dhost as a list mode setter instead of just their nick. */
 	bool MaskInList;
 
@@ -209,6 +209,7 @@ inline void Events::ModuleEventProvider::Call(void (Class::*function)(FunArgs...
 			continue;
 
 		Class* klass = static_cast<Class*>(subscriber);
+		Latency::HookTimer timer(mod, reinterpret_cast<uintptr_t>(this), name, GetModule());
 		(klass->*function)(std::forward<FwdArgs>(args)...);
 	}
 }
@@ -227,6 +228,7 @@ inline ModResult Events::ModuleEventProvider::FirstResult(ModResult (Class::*fun
 			continue;
 
 		Class* klass = static_cast<Class*>(subscriber);
+		Latency::HookTimer timer(mod, reinterpret_cast<uintptr_t>(this), name, GetModule());
 		result = (klass->*function)(std::forward<FwdArgs>(args)...);
 		if (result != MOD_RES_PASSTHRU)
 			break;
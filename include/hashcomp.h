@@ -206,7 +206,7 @@ namespace irc
 
 	public:
 		/** Create a tokenstream and fill it with the provided data. */
-		tokenstream(const std::string& msg, size_t start = 0, size_t end = std::string::npos);
+		tokenstream(const std::string_view& msg, size_t start = 0, size_t end = std::string_view::npos);
 
 		/** Retrieves the underlying message. */
 		std::string& GetMessage() { return message; }
@@ -38,6 +38,7 @@
 #include <array>
 #include <atomic>
 #include <bitset>
+#include <chrono>
 #include <deque>
 #include <functional>
 #include <memory>
@@ -55,7 +56,9 @@
 #endif
 
 #include "utility/aligned_storage.h"
+#include "utility/cidr_tree.h"
 #include "utility/iterator_range.h"
+#include "utility/shared_buffer.h"
 
 #include "intrusive_list.h"
 #include "flat_map.h"
@@ -76,9 +79,10 @@ CoreExport extern InspIRCd* ServerInstance;
 #include "uid.h"
 #include "server.h"
 #include "token_list.h"
+#include "timer.h"
+#include "latency.h"
 #include "users.h"
 #include "channels.h"
-#include "timer.h"
 #include "hashcomp.h"
 #include "channelmanager.h"
 #include "usermanager.h"
@@ -92,6 +96,7 @@ CoreExport extern InspIRCd* ServerInstance;
 #include "moduledefs.h"
 #include "clientprotocol.h"
 #include "thread.h"
+#include "threadpool.h"
 #include "configreader.h"
 #include "protocol.h"
 #include "bancache.h"
@@ -194,6 +199,9 @@ public:
 	/** Objects that should be culled outside of the current call stack. */
 	CullList GlobalCulls;
 
+	/** Collects latency statistics for module events and command handlers. */
+	Latency::Tracker Latency;
+
 	/** Manager for the logging system. */
 	Log::Manager Logs;
 
@@ -221,6 +229,9 @@ public:
 	/** Manager for state relating to users. */
 	UserManager Users;
 
+	/** Pool of threads for running expensive jobs off the main thread. */
+	ThreadPool Workers;
+
 	/** The server configuration. */
 	ServerConfig* Config = nullptr;
 
@@ -283,6 +294,15 @@ public:
 	 */
 	static bool CheckPassword(const std::string& password, const std::string& passwordhash, const std::string& value);
 
+	/** Compares a password to a hashed password without blocking the main thread.
+	 * @param password The hashed password.
+	 * @param passwordhash If non-empty then the algorithm the password is hashed with.
+	 * @param value The value to check to see if the password is valid.
+	 * @param callback The function to call with whether the password is correct. This may be
+	 *                 called before this method returns.
+	 */
+	static void CheckPassword(const std::string& password, const std::string& passwordhash, const std::string& value, const PasswordCallback& callback);
+
 	/** Generates a random integer.
 	 * @param max The maximum value for the integer.
 	 * @return A random integer between 0 and \p max.
@@ -445,6 +465,11 @@ public:
 	 */
 	inline auto Time_ns() const { return ts.tv_nsec; }
 
+	/** Retrieves the time, updated once per main loop iteration, as the number of milliseconds
+	 * since the UNIX epoch. This is faster than calling time functions manually.
+	 */
+	inline uint64_t Time_ms() const { return static_cast<uint64_t>(ts.tv_sec) * 1000 + static_cast<uint64_t>(ts.tv_nsec) / 1'000'000; }
+
 	/** Compares two strings in a timing-safe way. If the lengths of the strings differ the
 	 * function returns false immediately (leaking information about the length). Otherwise, it
 	 * compares each character and only returns after all characters have been compared.
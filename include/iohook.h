@@ -34,7 +34,8 @@ public:
 	enum Type
 	{
 		IOH_UNKNOWN,
-		IOH_SSL
+		IOH_SSL,
+		IOH_COMPRESS
 	};
 
 	const Type type;
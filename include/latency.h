@@ -0,0 +1,241 @@
+/*
+ * InspIRCd -- Internet Relay Chat Daemon
+ *
+ * This file is part of InspIRCd.  InspIRCd is free software: you can
+ * redistribute it and/or modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation, version 2.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#pragma once
+
+#if defined __x86_64__ || defined __i386__ || defined _M_X64 || defined _M_IX86
+# ifdef _WIN32
+#  include <intrin.h>
+# else
+#  include <x86intrin.h>
+# endif
+# define INSPIRCD_LATENCY_TSC
+#endif
+
+namespace Latency
+{
+	class Histogram;
+	class HookTimer;
+	class Tracker;
+
+	/** Whether latency statistics are currently being collected. This is checked before reading
+	 * the clock so that hooks and commands cost a single branch when collection is disabled.
+	 */
+	CoreExport extern bool enabled;
+
+	/** Reads the current value of the cycle counter. On platforms which do not have one this falls
+	 * back to a monotonic clock in nanoseconds. The values are only meaningful when compared with
+	 * each other and must be converted using Tracker::TicksToMicroseconds.
+	 */
+	inline uint64_t Now()
+	{
+#ifdef INSPIRCD_LATENCY_TSC
+		return __rdtsc();
+#else
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+	}
+
+	/** Records the time a module took to handle an event.
+	 * @param mod The module which handled the event.
+	 * @param key A value which uniquely identifies the event.
+	 * @param event The name of the event.
+	 * @param owner The module which provides the event or nullptr if it is provided by the core.
+	 * @param ticks The number of ticks the module took to handle the event.
+	 */
+	CoreExport void RecordHook(const Module* mod, uintptr_t key, std::string_view event, const Module* owner, uint64_t ticks);
+}
+
+/** A histogram with buckets whose size grows logarithmically. Each power of two is divided into
+ * several linear sub-buckets so values are recorded with a bounded relative error whilst still
+ * covering the whole range of a 64-bit integer in a small fixed amount of memory.
+ */
+class CoreExport Latency::Histogram final
+{
+public:
+	/** The number of bits used to select the linear sub-bucket within a power of two. */
+	static constexpr unsigned int SUB_BITS = 2;
+
+	/** The number of linear sub-buckets within a power of two. */
+	static constexpr unsigned int SUB_BUCKETS = 1U << SUB_BITS;
+
+	/** The total number of buckets. */
+	static constexpr unsigned int BUCKETS = (64 - SUB_BITS + 1) * SUB_BUCKETS;
+
+private:
+	/** The number of values which fell in each bucket. */
+	std::array<uint32_t, BUCKETS> buckets = { };
+
+	/** The number of values which have been recorded. */
+	uint64_t count = 0;
+
+	/** The largest value which has been recorded. */
+	uint64_t max = 0;
+
+	/** The sum of all values which have been recorded. */
+	uint64_t total = 0;
+
+	/** Retrieves the index of the bucket that a value belongs in. */
+	static unsigned int GetBucket(uint64_t value);
+
+	/** Retrieves the largest value that belongs in a bucket. */
+	static uint64_t GetUpperBound(unsigned int bucket);
+
+public:
+	/** Records a value in the histogram.
+	 * @param value The value to record.
+	 */
+	void Add(uint64_t value);
+
+	/** Retrieves the number of values which have been recorded. */
+	uint64_t GetCount() const { return count; }
+
+	/** Retrieves the largest value which has been recorded. */
+	uint64_t GetMax() const { return max; }
+
+	/** Retrieves the sum of all values which have been recorded. */
+	uint64_t GetTotal() const { return total; }
+
+	/** Estimates the value below which a certain percentage of the recorded values fall.
+	 * @param percentile The percentile to estimate between 0 and 100.
+	 * @return The upper bound of the bucket which contains the percentile.
+	 */
+	uint64_t GetPercentile(double percentile) const;
+};
+
+/** Measures the time a module takes to handle an event for the lifetime of the object. */
+class Latency::HookTimer final
+{
+private:
+	/** The module which is handling the event. */
+	const Module* const mod;
+
+	/** A value which uniquely identifies the event. */
+	const uintptr_t key;
+
+	/** The name of the event. */
+	const std::string_view event;
+
+	/** The module which provides the event or nullptr if it is provided by the core. */
+	const Module* const owner;
+
+	/** The tick at which the module started handling the event or 0 if not measuring. */
+	const uint64_t start;
+
+public:
+	HookTimer(const Module* m, uintptr_t k, std::string_view e, const Module* o = nullptr)
+		: mod(m)
+		, key(k)
+		, event(e)
+		, owner(o)
+		, start(enabled ? Now() : 0)
+	{
+	}
+
+	~HookTimer()
+	{
+		if (start)
+			RecordHook(mod, key, event, owner, Now() - start);
+	}
+};
+
+/** Collects latency statistics for module events and command handlers. */
+class CoreExport Latency::Tracker final
+{
+public:
+	/** Latency statistics for a module handling an event. */
+	struct HookStats final
+	{
+		/** The name of the module which handled the event. */
+		std::string module;
+
+		/** The name of the event. */
+		std::string event;
+
+		/** The module which provides the event or nullptr if it is provided by the core. */
+		const Module* owner;
+
+		/** The time taken to handle the event in ticks. */
+		Histogram histogram;
+	};
+
+	/** Uniquely identifies a module handling an event. */
+	typedef std::pair<const Module*, uintptr_t> HookKey;
+
+	/** Hashes a HookKey. */
+	struct HookKeyHash final
+	{
+		size_t operator()(const HookKey& key) const
+		{
+			return std::hash<const void*>()(key.first) ^ (std::hash<uintptr_t>()(key.second) * 31);
+		}
+	};
+
+	/** A map of module events to their statistics. */
+	typedef std::unordered_map<HookKey, HookStats, HookKeyHash> HookMap;
+
+	/** A map of command names to their statistics. */
+	typedef std::unordered_map<std::string, Histogram> CommandMap;
+
+private:
+	/** Statistics about command handlers. */
+	CommandMap commands;
+
+	/** Statistics about module events. */
+	HookMap hooks;
+
+	/** The value of the cycle counter when collection was last started. */
+	uint64_t startticks = 0;
+
+	/** The value of the monotonic clock when collection was last started. */
+	std::chrono::steady_clock::time_point starttime;
+
+public:
+	/** Retrieves the statistics about command handlers. */
+	const CommandMap& GetCommands() const { return commands; }
+
+	/** Retrieves the statistics about module events. */
+	const HookMap& GetHooks() const { return hooks; }
+
+	/** Records the time a command handler took to execute.
+	 * @param command The name of the command.
+	 * @param ticks The number of ticks the command handler took to execute.
+	 */
+	void RecordCommand(const std::string& command, uint64_t ticks);
+
+	/** @copydoc Latency::RecordHook */
+	void RecordHook(const Module* mod, uintptr_t key, std::string_view event, const Module* owner, uint64_t ticks);
+
+	/** Removes the statistics about a module which is being unloaded and the events it provides.
+	 * @param mod The module which is being unloaded.
+	 */
+	void RemoveModule(const Module* mod);
+
+	/** Removes all statistics and restarts the cycle counter calibration. */
+	void Reset();
+
+	/** Enables or disables the collection of statistics. Enabling collection when it was
+	 * previously disabled removes any existing statistics.
+	 * @param enable Whether to collect statistics.
+	 */
+	void SetEnabled(bool enable);
+
+	/** Converts a number of ticks to microseconds.
+	 * @param ticks The number of ticks to convert.
+	 */
+	double TicksToMicroseconds(uint64_t ticks) const;
+};
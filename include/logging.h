@@ -22,6 +22,7 @@
 namespace Log
 {
 	class Method;
+	class AsyncMethod;
 	class FileMethod;
 
 	class Engine;
@@ -92,10 +93,55 @@ public:
 	virtual void OnLog(time_t time, Level level, const std::string& type, const std::string& message) = 0;
 };
 
-/** A logger that writes to a file stream. */
-class CoreExport Log::FileMethod final
+/** Base class for logging methods which write messages on the log writer thread. Messages are
+ * formatted on the main thread and then written in batches so that slow sinks never block it.
+ */
+class CoreExport Log::AsyncMethod
 	: public Method
-	, public Timer
+	, public std::enable_shared_from_this<AsyncMethod>
+{
+private:
+	friend class Manager;
+
+	/** Whether writing to this logger has failed. */
+	std::atomic_bool failed = { false };
+
+	/** The error that caused writing to fail. Only valid once failed has been set. */
+	std::string failreason;
+
+protected:
+	AsyncMethod() = default;
+
+	/** Formats a message for writing. This is called on the main thread.
+	 * @param time The time at which the message was logged.
+	 * @param level The level at which the log message was written.
+	 * @param type The component which wrote the log message.
+	 * @param message The message which was written to the log.
+	 * @param out The string to append the formatted message to.
+	 */
+	virtual void Format(time_t time, Level level, const std::string& type, const std::string& message, std::string& out) = 0;
+
+	/** Writes a formatted message. This is called on the log writer thread and MUST NOT access any
+	 * state which is also accessed by the main thread.
+	 * @param level The level at which the log message was written.
+	 * @param entry The formatted message.
+	 * @throw CoreException If the message can not be written.
+	 */
+	virtual void Write(Level level, const std::string& entry) = 0;
+
+	/** Called on the log writer thread after a batch of messages has been written.
+	 * @throw CoreException If the messages can not be written.
+	 */
+	virtual void Flush() { }
+
+public:
+	/** @copydoc Log::Method::OnLog */
+	void OnLog(time_t time, Level level, const std::string& type, const std::string& message) override;
+};
+
+/** A logger that writes to a file stream. */
+class CoreExport Log::FileMethod
+	: public AsyncMethod
 {
 private:
 	/** Whether to autoclose the file on exit. */
@@ -104,27 +150,28 @@ private:
 	/** The file to which the log is written. */
 	FILE* file;
 
-	/** How often the file stream should be flushed. */
-	const unsigned long flush;
-
-	/** The number of lines which have been written since the file stream was created. */
-	unsigned long lines = 0;
+	/** Formatted messages which are waiting to be written. Only accessed on the log writer thread. */
+	std::string buffer;
 
 	/** The name the underlying file. */
 	const std::string name;
 
+protected:
+	/** @copydoc Log::AsyncMethod::Format */
+	void Format(time_t time, Level level, const std::string& type, const std::string& message, std::string& out) override;
+
+	/** @copydoc Log::AsyncMethod::Write */
+	void Write(Level level, const std::string& entry) override;
+
+	/** @copydoc Log::AsyncMethod::Flush */
+	void Flush() override;
+
 public:
-	FileMethod(const std::string& n, FILE* fh, unsigned long fl, bool ac);
+	FileMethod(const std::string& n, FILE* fh, bool ac);
 	~FileMethod() override;
 
 	/** @copydoc Log::Method::AcceptsCachedMessages */
 	bool AcceptsCachedMessages() const override { return false; }
-
-	/** @copydoc Timer::Tick */
-	bool Tick() override;
-
-	/** @copydoc Log::Method::OnLog */
-	void OnLog(time_t time, Level level, const std::string& type, const std::string& message) override;
 };
 
 /** Base class for logging engines. */
@@ -245,9 +292,22 @@ private:
 	/** The highest level that loggers will accept. */
 	Log::Level maxlevel = Level::HIGHEST;
 
+	friend class AsyncMethod;
+	class Writer;
+
+	/** The thread which writes messages for asynchronous loggers. */
+	std::unique_ptr<Writer> writer;
+
 	/** Check for the highest log level and warn about raw logging */
 	void CheckLevel();
 
+	/** Queues a formatted message to be written by the log writer thread.
+	 * @param method The logger to write the message to.
+	 * @param level The level the message was logged at.
+	 * @param entry The formatted message.
+	 */
+	void Queue(std::shared_ptr<AsyncMethod> method, Level level, std::string&& entry);
+
 	/** Writes a message to the server log.
 	 * @param level The level to log at.
 	 * @param type The type of message that is being logged.
@@ -274,6 +334,7 @@ private:
 
 public:
 	Manager();
+	~Manager();
 
 	/** Closes all loggers which were opened from the config. */
 	void CloseLogs();
@@ -281,6 +342,9 @@ public:
 	/** Enables writing rawio logs to the standard output stream. */
 	void EnableDebugMode();
 
+	/** Waits until all queued messages have been written by the log writer thread. */
+	void Flush();
+
 	/** Opens loggers that are specified in the config. */
 	void OpenLogs(bool requiremethods);
 
@@ -58,6 +58,21 @@ public:
 	 */
 	Id id;
 
+	/** The position of this membership in the local member list of the channel, only valid if the
+	 * user is local. Only the core should read or write this field.
+	 */
+	size_t localpos = 0;
+
+	/** The ban serial at which the cached ban state of this member was computed or 0 if it has
+	 * never been computed. Only the core should read or write this field.
+	 */
+	uint64_t banserial = 0;
+
+	/** Whether this member matched an entry in the ban list of the channel when the cached ban
+	 * state was computed. Only the core should read or write this field.
+	 */
+	bool banned = false;
+
 	/** Converts a string to a Membership::Id
 	 * @param str The string to convert
 	 * @return Raw value of type Membership::Id
@@ -150,8 +150,11 @@ enum Implementation
 	I_OnCheckKey,
 	I_OnCheckLimit,
 	I_OnCheckPassword,
+	I_OnCheckPasswordAsync,
 	I_OnCheckReady,
 	I_OnCommandBlocked,
+	I_OnCommandResumed,
+	I_OnCommandSuspended,
 	I_OnDecodeMetadata,
 	I_OnDelLine,
 	I_OnExpireLine,
@@ -736,6 +739,22 @@ public:
 	 */
 	virtual void OnCommandBlocked(const std::string& command, const CommandBase::Params& parameters, LocalUser* user) ATTR_NOT_NULL(4);
 
+	/** Called when a command handler suspends a user to wait for an asynchronous operation. The
+	 * post-command hooks are not run until the command is resumed with its real result.
+	 * @param command The command being executed.
+	 * @param parameters The parameters for the command.
+	 * @param user The user issuing the command.
+	 */
+	virtual void OnCommandSuspended(Command* command, const CommandBase::Params& parameters, LocalUser* user) ATTR_NOT_NULL(2, 4);
+
+	/** Called when a suspended command is resumed, before it writes the rest of its replies. This
+	 * is followed by OnPostCommand with the result of the command.
+	 * @param command The command being executed.
+	 * @param parameters The parameters for the command.
+	 * @param user The user issuing the command.
+	 */
+	virtual void OnCommandResumed(Command* command, const CommandBase::Params& parameters, LocalUser* user) ATTR_NOT_NULL(2, 4);
+
 	/** Called after a user object is initialised and added to the user list.
 	 * When this is called the user has not had their I/O hooks checked or had their initial
 	 * connect class assigned and may not yet have a serializer. You probably want to use
@@ -844,6 +863,17 @@ public:
 	 */
 	virtual ModResult OnCheckPassword(const std::string& password, const std::string& passwordhash, const std::string& value);
 
+	/** Called when checking if a password is valid without blocking the main thread. This allows
+	 * modules to check passwords which are expensive to check (e.g. bcrypt) on a worker thread.
+	 * @param password The hashed password.
+	 * @param passwordhash The name of the algorithm used to hash the password.
+	 * @param value The value to check to see if the password is valid.
+	 * @param callback The function to call on the main thread with the result of the check.
+	 * @return MOD_RES_ALLOW if the module has taken responsibility for calling \p callback or
+	 * MOD_RES_PASSTHRU to check the password synchronously with OnCheckPassword.
+	 */
+	virtual ModResult OnCheckPasswordAsync(const std::string& password, const std::string& passwordhash, const std::string& value, const PasswordCallback& callback);
+
 	/** Called before a topic is changed.
 	 * Return 1 to deny the topic change, 0 to check details on the change, -1 to let it through with no checks
 	 * As with other 'pre' events, you should only ever block a local event.
@@ -1216,7 +1246,10 @@ public:
 			try \
 			{ \
 				if (!_mod->dying) \
+				{ \
+					Latency::HookTimer _timer(_mod, I_ ## EVENT, # EVENT); \
 					_mod->EVENT ARGS; \
+				} \
 			} \
 			catch (const CoreException& _exception_ ## EVENT) \
 			{ \
@@ -1241,6 +1274,7 @@ public:
 			{ \
 				if (_mod->dying) \
 					continue; \
+				Latency::HookTimer _timer(_mod, I_ ## EVENT, # EVENT); \
 				RESULT = _mod->EVENT ARGS; \
 				if (RESULT != MOD_RES_PASSTHRU) \
 					break; \
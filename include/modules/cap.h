@@ -33,6 +33,31 @@ namespace Cap
 	{
 	public:
 		ExtItem(Module* mod);
+
+		/** Sets the capabilities which a user has enabled and updates their capability fingerprint.
+		 * @param user The user to set the capabilities of.
+		 * @param value The capabilities to set.
+		 */
+		void Set(User* user, Ext value)
+		{
+			IntExtItem::Set(user, value);
+			LocalUser* const luser = IS_LOCAL(user);
+			if (luser)
+				luser->capfingerprint = value;
+		}
+
+		/** Removes all capabilities from a user and resets their capability fingerprint.
+		 * @param user The user to remove the capabilities from.
+		 */
+		void Unset(User* user)
+		{
+			IntExtItem::Unset(user);
+			LocalUser* const luser = IS_LOCAL(user);
+			if (luser)
+				luser->capfingerprint = 0;
+		}
+
+		void Delete(Extensible* container, void* item) override;
 		void FromInternal(Extensible* container, const std::string& value) noexcept override;
 		std::string ToHuman(const Extensible* container, void* item) const noexcept override;
 		std::string ToInternal(const Extensible* container, void* item) const noexcept override;
@@ -0,0 +1,145 @@
+/*
+ * InspIRCd -- Internet Relay Chat Daemon
+ *
+ * This file is part of InspIRCd.  InspIRCd is free software: you can
+ * redistribute it and/or modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation, version 2.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#pragma once
+
+#include "iohook.h"
+
+namespace Compress
+{
+	class Hook;
+	class Provider;
+}
+
+/** Base class for I/O hooks which compress the data sent over a stream socket.
+ *
+ * Each direction is enabled separately so that the two ends of a connection can
+ * switch over at a point in the stream which they have agreed upon. Until then
+ * data passes through the hook unchanged.
+ */
+class Compress::Hook
+	: public IOHookMiddle
+{
+protected:
+	/** Whether data sent over the socket is being compressed. */
+	bool compressing;
+
+	/** Whether data received from the socket is being decompressed. */
+	bool decompressing;
+
+public:
+	/** The number of bytes which have been passed to the compressor. */
+	uint64_t raw_out = 0;
+
+	/** The number of bytes which the compressor has produced. */
+	uint64_t wire_out = 0;
+
+	/** The number of bytes which have been passed to the decompressor. */
+	uint64_t wire_in = 0;
+
+	/** The number of bytes which the decompressor has produced. */
+	uint64_t raw_in = 0;
+
+	/** Initializes a new instance of the Compress::Hook class.
+	 * @param hookprov The provider which created this hook.
+	 * @param compress Whether to compress data sent over the socket immediately.
+	 * @param decompress Whether to decompress data received from the socket immediately.
+	 */
+	Hook(const std::shared_ptr<IOHookProvider>& hookprov, bool compress, bool decompress)
+		: IOHookMiddle(hookprov)
+		, compressing(compress)
+		, decompressing(decompress)
+	{
+	}
+
+	/** Determines whether data received from the socket is being decompressed. */
+	bool IsDecompressing() const { return decompressing; }
+
+	/** Starts decompressing data received from the socket.
+	 * @param sock The socket this hook is attached to.
+	 * @param recvq The receive queue of the socket. Everything in it is treated
+	 *              as compressed data and is replaced with its decompressed form.
+	 * @return The result of decompressing any data which was already in the receive queue.
+	 */
+	ssize_t StartDecompression(StreamSocket* sock, std::string& recvq)
+	{
+		decompressing = true;
+		GetRecvQ().append(recvq);
+		recvq.clear();
+		if (GetRecvQ().empty())
+			return 0;
+
+		return OnStreamSocketRead(sock, recvq);
+	}
+
+	/** Retrieves the compression hook attached to the specified socket.
+	 * @param sock The socket to check.
+	 * @return The compression hook or nullptr if the socket is not compressed.
+	 */
+	static Hook* IsCompressed(StreamSocket* sock)
+	{
+		for (IOHook* hook = sock->GetIOHook(); hook; )
+		{
+			if (hook->prov->type == IOHookProvider::IOH_COMPRESS)
+				return static_cast<Hook*>(hook);
+
+			IOHookMiddle* middle = IOHookMiddle::ToMiddleHook(hook);
+			hook = middle ? middle->GetNextHook() : nullptr;
+		}
+		return nullptr;
+	}
+};
+
+/** Base class for providers of compression I/O hooks. */
+class Compress::Provider
+	: public IOHookProvider
+{
+public:
+	/** The name of the compression algorithm. */
+	const std::string algorithm;
+
+	/** Initializes a new instance of the Compress::Provider class.
+	 * @param mod The module which created this instance.
+	 * @param algo The name of the compression algorithm.
+	 */
+	Provider(Module* mod, const std::string& algo)
+		: IOHookProvider(mod, "compress/" + algo, IOHookProvider::IOH_COMPRESS, true)
+		, algorithm(algo)
+	{
+	}
+
+	/** Creates a compression hook and inserts it at the top of the hook chain of the
+	 * specified socket. Data which is already queued for sending is not compressed.
+	 * @param sock The socket to attach the hook to.
+	 * @param compress Whether to compress data sent over the socket.
+	 * @param decompress Whether to decompress data received from the socket.
+	 * @return The newly created hook.
+	 */
+	virtual Hook* Attach(StreamSocket* sock, bool compress, bool decompress) = 0;
+
+	/** @copydoc IOHookProvider::OnAccept */
+	void OnAccept(StreamSocket* sock, const irc::sockets::sockaddrs& client, const irc::sockets::sockaddrs& server) override
+	{
+		Attach(sock, true, true);
+	}
+
+	/** @copydoc IOHookProvider::OnConnect */
+	void OnConnect(StreamSocket* sock) override
+	{
+		Attach(sock, true, true);
+	}
+};
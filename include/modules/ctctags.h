@@ -186,4 +186,10 @@ public:
 	{
 		return ctctagcap.IsEnabled(user);
 	}
+
+	/** @copydoc ClientProtocol::MessageTagProvider::OnlyDependsOnCaps */
+	bool OnlyDependsOnCaps() const override
+	{
+		return true;
+	}
 };
@@ -33,6 +33,8 @@ namespace DNS
 		QUERY_A = 1,
 		/* A CNAME lookup */
 		QUERY_CNAME = 5,
+		/* Start of authority, only used for negative caching */
+		QUERY_SOA = 6,
 		/* Reverse DNS lookup */
 		QUERY_PTR = 12,
 		/* TXT */
@@ -46,6 +46,10 @@ public:
 		return Hex::Encode(raw);
 	}
 
+	/** Compares an input value against a hash. If this is a key derivation function then this may
+	 * be called on a worker thread so it MUST NOT access any state which can change after the
+	 * provider is created.
+	 */
 	virtual bool Compare(const std::string& input, const std::string& hash)
 	{
 		return InspIRCd::TimingSafeCompare(Generate(input), hash);
@@ -78,3 +82,56 @@ public:
 		return (!block_size);
 	}
 };
+
+/** Compares a value against one or more hashes on a worker thread. */
+class HashCompareJob final
+	: public ThreadPool::Job
+{
+private:
+	/** The provider for the algorithm the hashes were generated with. */
+	HashProvider* const provider;
+
+	/** The value to compare against the hashes. */
+	const std::string value;
+
+	/** The hashes to compare against. */
+	const std::vector<std::string> hashes;
+
+	/** The function to call on the main thread with the result. */
+	const PasswordCallback callback;
+
+	/** Whether the value matched any of the hashes. */
+	bool matched = false;
+
+public:
+	/** Creates a new job which compares a value against one or more hashes.
+	 * @param hp The provider for the algorithm the hashes were generated with.
+	 * @param v The value to compare against the hashes.
+	 * @param h The hashes to compare against.
+	 * @param cb The function to call with whether the value matched any of the hashes.
+	 */
+	HashCompareJob(HashProvider* hp, const std::string& v, const std::vector<std::string>& h, const PasswordCallback& cb)
+		: provider(hp)
+		, value(v)
+		, hashes(h)
+		, callback(cb)
+	{
+	}
+
+	void Run() override
+	{
+		for (const auto& hash : hashes)
+		{
+			if (provider->Compare(value, hash))
+			{
+				matched = true;
+				break;
+			}
+		}
+	}
+
+	void Finish() override
+	{
+		callback(matched);
+	}
+};
@@ -83,6 +83,11 @@ protected:
 		return cap.IsEnabled(user);
 	}
 
+	bool OnlyDependsOnCaps() const override
+	{
+		return true;
+	}
+
 	void OnPopulateTags(ClientProtocol::Message& msg) override
 	{
 		T& tag = static_cast<T&>(*this);
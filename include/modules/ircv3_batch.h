@@ -66,6 +66,13 @@ public:
 	 * @param batch Batch to end.
 	 */
 	virtual void End(Batch& batch) = 0;
+
+	/** Send the start of a batch to a user even if they have not been sent any messages from it.
+	 * This is used for batches which are meaningful even when they are empty.
+	 * @param batch Batch to send the start of. No-op if it is not running.
+	 * @param user User to send the start of the batch to.
+	 */
+	virtual void Include(Batch& batch, LocalUser* user) = 0;
 };
 
 /** Represents a batch.
@@ -42,4 +42,19 @@ public:
 	 * excluded from this NAMES list
 	 */
 	virtual ModResult OnNamesListItem(LocalUser* issuer, Membership* memb, std::string& prefixes, std::string& nick) = 0;
+
+	/* Called before the NAMES list of a large channel is sent to determine whether it can be sent from a cache.
+	 * Users with the same variant share a cached NAMES list so listeners which change the NAMES list based on
+	 * the issuer (e.g. because of an enabled capability) must append a unique token to the variant when they
+	 * would do so. Listeners which do not implement this method prevent NAMES lists from being cached.
+	 * @param issuer The user who the NAMES list is being sent to.
+	 * @param chan The channel that the NAMES list is for.
+	 * @param variant A string which identifies the NAMES list which will be sent to the issuer.
+	 * @return Return MOD_RES_PASSTHRU to allow the cached NAMES list to be used or MOD_RES_DENY to build the NAMES
+	 * list by calling OnNamesListItem for every member.
+	 */
+	virtual ModResult OnNamesListVariant(LocalUser* issuer, Channel* chan, std::string& variant)
+	{
+		return MOD_RES_DENY;
+	}
 };
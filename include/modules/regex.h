@@ -28,7 +28,9 @@ namespace Regex
 	class Exception;
 	class MatchCollection;
 	class Pattern;
-	template<typename> class SimpleEngine;
+	class PatternSet;
+	class SimplePatternSet;
+	template<typename PatternClass, typename PatternSetClass = SimplePatternSet> class SimpleEngine;
 
 	/** A list of matches that were captured by index. */
 	typedef std::vector<std::string> Captures;
@@ -39,6 +41,12 @@ namespace Regex
 	/** A shared pointer to a regex pattern. */
 	typedef std::shared_ptr<Pattern> PatternPtr;
 
+	/** A list of regex patterns. */
+	typedef std::vector<PatternPtr> PatternList;
+
+	/** A shared pointer to a regex pattern set. */
+	typedef std::shared_ptr<PatternSet> PatternSetPtr;
+
 	/** The options to use when matching a pattern. */
 	enum PatternOptions
 		: uint8_t
@@ -79,6 +87,14 @@ public:
 	 */
 	PatternPtr CreateHuman(const std::string& pattern) const;
 
+	/** Combines several patterns into a set which can be matched against text together. By default
+	 * this creates a set which matches each pattern individually. Engines which can build a single
+	 * automaton from several patterns should override this.
+	 * @param patterns The patterns to combine. These must have been created by this engine.
+	 * @return A shared pointer to an instance of the Regex::PatternSet class.
+	 */
+	virtual PatternSetPtr CreateSet(const PatternList& patterns) const;
+
 	/** Retrieves the name of this regex engine. */
 	const char* GetName() const
 	{
@@ -87,7 +103,7 @@ public:
 };
 
 /**The base class for simple regular expression engines. */
-template<typename PatternClass>
+template<typename PatternClass, typename PatternSetClass>
 class Regex::SimpleEngine final
 	: public Regex::Engine
 {
@@ -103,6 +119,12 @@ public:
 	{
 		return std::make_shared<PatternClass>(creator, pattern, options);
 	}
+
+	/** @copydoc Regex::Engine::CreateSet */
+	PatternSetPtr CreateSet(const PatternList& patterns) const override
+	{
+		return std::make_shared<PatternSetClass>(creator, patterns);
+	}
 };
 
 /** A dynamic reference to an instance of the Regex::Engine class. */
@@ -246,6 +268,70 @@ public:
 	virtual std::optional<MatchCollection> Matches(const std::string& text) = 0;
 };
 
+/** Represents a set of compiled regular expression patterns which are matched together. */
+class Regex::PatternSet
+{
+private:
+	/** The patterns in this set. */
+	const PatternList patternlist;
+
+protected:
+	/** Initializes a new instance of the PatternSet class.
+	 * @param p The patterns in this set.
+	 */
+	PatternSet(const PatternList& p)
+		: patternlist(p)
+	{
+	}
+
+public:
+	/** Destroys an instance of the PatternSet class. */
+	virtual ~PatternSet() = default;
+
+	/** Retrieves the patterns in this set. */
+	const PatternList& GetPatterns() const { return patternlist; }
+
+	/** Attempts to match the patterns in this set against the specified text.
+	 * @param text The text to match against.
+	 * @param matches The location to store the indices within GetPatterns() of the patterns which
+	 *                matched in ascending order. Any existing contents are removed.
+	 * @return If the text matched at least one pattern then true; otherwise, false.
+	 */
+	virtual bool IsMatch(const std::string& text, std::vector<size_t>& matches) = 0;
+};
+
+/** A pattern set which matches each of its patterns individually. */
+class Regex::SimplePatternSet final
+	: public Regex::PatternSet
+{
+public:
+	/** Initializes a new instance of the SimplePatternSet class.
+	 * @param mod The module which created this instance.
+	 * @param patterns The patterns in this set.
+	 */
+	SimplePatternSet(const Module* mod, const PatternList& patterns)
+		: Regex::PatternSet(patterns)
+	{
+	}
+
+	/** @copydoc Regex::PatternSet::IsMatch */
+	bool IsMatch(const std::string& text, std::vector<size_t>& matches) override
+	{
+		matches.clear();
+		for (size_t idx = 0; idx < GetPatterns().size(); ++idx)
+		{
+			if (GetPatterns()[idx]->IsMatch(text))
+				matches.push_back(idx);
+		}
+		return !matches.empty();
+	}
+};
+
+inline Regex::PatternSetPtr Regex::Engine::CreateSet(const PatternList& patterns) const
+{
+	return std::make_shared<SimplePatternSet>(creator, patterns);
+}
+
 inline Regex::PatternPtr Regex::Engine::CreateHuman(const std::string& pattern) const
 {
 	if (pattern.empty() || pattern[0] != '/')
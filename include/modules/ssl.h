@@ -221,7 +221,7 @@ protected:
 			sendq.pop_front();
 		}
 		while (!sendq.empty() && tmp.length() < targetsize);
-		sendq.push_front(tmp);
+		sendq.push_front(std::move(tmp));
 	}
 
 public:
@@ -267,6 +267,9 @@ public:
 	 */
 	virtual void GetCiphersuite(std::string& out) const = 0;
 
+	/** Determines whether encryption of this connection has been offloaded to the kernel. */
+	virtual bool IsKernelOffloaded() const { return false; }
+
 	/** Retrieves the name of the TLS connection which is sent via SNI.
 	 * @param out String that the server name will be appended to.
 	 * returns True if the server name was retrieved; otherwise, false.
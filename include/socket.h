@@ -133,6 +133,16 @@ namespace irc
 			bool match(const irc::sockets::sockaddrs& addr) const;
 			/** Human-readable string */
 			std::string str() const;
+
+			/** Calculates the hash of a CIDR mask for use in unordered containers. */
+			struct hash final
+			{
+				size_t operator()(const cidr_mask& mask) const
+				{
+					const std::string_view bits(reinterpret_cast<const char*>(mask.bits), sizeof(mask.bits));
+					return std::hash<std::string_view>()(bits) ^ (static_cast<size_t>(mask.type) << 8 | mask.length);
+				}
+			};
 		};
 
 		/** Match CIDR, including an optional username/nickname part.
@@ -228,6 +238,13 @@ public:
 	 */
 	void OnEventHandlerRead() override;
 
+	/** Handles a connection which has been accepted from this socket.
+	 * @param incomingfd The non-blocking file descriptor of the connection or a negative value
+	 *                   (with errno set) if accepting it failed.
+	 * @param client The address of the remote end of the connection.
+	 */
+	void OnAccept(int incomingfd, irc::sockets::sockaddrs& client);
+
 	/** Inspects the bind block belonging to this socket to set the name of the IO hook
 	 * provider which this socket will use for incoming connections.
 	 */
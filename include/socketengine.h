@@ -132,7 +132,13 @@ enum EventMask
 	FD_WRITE_WILL_BLOCK = 0x8000,
 
 	/** Mask for trial read/trial write */
-	FD_TRIAL_NOTE_MASK = 0x5000
+	FD_TRIAL_NOTE_MASK = 0x5000,
+
+	/** The fd is a ListenSocket and read events mean that there are connections to accept.
+	 * Socket engines which can accept connections themselves pass them to
+	 * ListenSocket::OnAccept() instead of calling OnEventHandlerRead().
+	 */
+	FD_ACCEPTS = 0x10000
 };
 
 /** This class is a basic I/O handler class.
@@ -432,6 +438,35 @@ public:
 	 */
 	static ssize_t WriteV(EventHandler* eh, const IOVector* iov, int count) ATTR_NOT_NULL(1, 2);
 
+	/** A vector write which is performed as part of a batch. */
+	struct WriteRequest final
+	{
+		/** The EventHandler to send data with. */
+		EventHandler* eh;
+
+		/** The buffers to send. */
+		const IOVector* iov;
+
+		/** The number of elements in iov. */
+		int count;
+
+		/** The value that writev() would have returned. */
+		ssize_t result;
+
+		/** If result is negative then the error that writev() would have set errno to. */
+		int error;
+	};
+
+	/** Performs several vector writes at once. This never blocks and socket engines which
+	 * support it hand all of the writes to the kernel with a single system call.
+	 * @param requests The writes to perform. The result and error fields are filled in.
+	 * @param count The number of elements in requests. If this is zero then this just checks
+	 * whether the socket engine supports batching writes.
+	 * @return True if the writes were performed or false if the socket engine does not support
+	 * batching writes and the caller should perform them itself.
+	 */
+	static bool WriteVBatch(WriteRequest* requests, size_t count);
+
 #ifdef _WIN32
 	/** Abstraction for vector write function writev() that accepts a POSIX format iovec.
 	 * This function should emulate its namesake system call exactly.
@@ -32,6 +32,7 @@
 #include "timer.h"
 
 class IOHook;
+class IOHookMiddle;
 
 /**
  * States which a socket may be in
@@ -121,9 +122,10 @@ public:
 	class SendQueue final
 	{
 	public:
-		/** One element of the queue, a continuous buffer
+		/** One element of the queue, a continuous buffer which may be shared with the
+		 * send queues of other sockets.
 		 */
-		typedef std::string Element;
+		typedef insp::shared_buffer Element;
 
 		/** Sequence container of buffers in the queue
 		 */
@@ -179,7 +181,7 @@ public:
 		void erase_front(Element::size_type n)
 		{
 			nbytes -= n;
-			data.front().erase(0, n);
+			data.front().remove_prefix(n);
 		}
 
 		/** Insert a new buffer at the beginning of the queue
@@ -239,6 +241,12 @@ private:
 	/** Whether the socket is currently closing or not, used to avoid repeatedly closing a closed socket */
 	bool closing = false;
 
+	/** Whether the socket has joined the current write batch. */
+	bool inwritebatch = false;
+
+	/** Whether the socket has a write in the current batch which has not been performed yet. */
+	bool writepending = false;
+
 	/** The IOHook that handles raw I/O for this socket, or NULL */
 	IOHook* iohook = nullptr;
 
@@ -258,11 +266,28 @@ private:
 	 */
 	void DoRead();
 
+	/** Writes the contents of the send queue to the socket.
+	 * @param batch Whether the write may be deferred to the current write batch.
+	 */
+	void WriteSendQ(bool batch);
+
 	/** Send as much data contained in a SendQueue object as possible.
 	 * All data which successfully sent will be removed from the SendQueue.
 	 * @param sq SendQueue to flush
+	 * @param batch Whether the write may be deferred to the current write batch.
+	 */
+	void FlushSendQ(SendQueue& sq, bool batch);
+
+	/** Removes the data which was written by a vector write from a send queue.
+	 * @param sq The SendQueue which was written.
+	 * @param rv The value returned by the write. If this is negative then errno holds the error.
+	 * @param rv_max The number of bytes which the write tried to send.
+	 * @return The change to make to the event mask of the socket.
 	 */
-	void FlushSendQ(SendQueue& sq);
+	int OnSendQWritten(SendQueue& sq, ssize_t rv, size_t rv_max);
+
+	/** Performs every write which is pending in the current write batch. */
+	static void SubmitWriteBatch();
 
 	/** Read incoming data into a receive queue.
 	 * @param rq Receive queue to put incoming data into
@@ -294,8 +319,23 @@ public:
 	void AddIOHook(IOHook* hook);
 	void DelIOHook();
 
+	/** Inserts a middle hook at the application end of the hook chain. Data which is
+	 * already queued for sending is moved past the new hook and is not processed by it.
+	 * @param hook The hook to insert.
+	 */
+	void AddIOHookFront(IOHookMiddle* hook);
+
 	/** Writes the contents of the send queue to the socket. */
-	void DoWrite();
+	void DoWrite() { WriteSendQ(false); }
+
+	/** Starts collecting the writes of sockets which are not hooked into a batch. Whilst a
+	 * batch is open the writes from OnEventHandlerWrite() are deferred until EndWriteBatch()
+	 * so that the socket engine can perform them all at once.
+	 */
+	static void BeginWriteBatch();
+
+	/** Performs the writes collected since BeginWriteBatch() and finishes handling them. */
+	static void EndWriteBatch();
 
 	/** Called by the socket engine when a read event happens. */
 	void OnEventHandlerRead() override;
@@ -334,7 +374,7 @@ public:
 
 	/** Send the given data out the socket, either now or when writes unblock
 	 */
-	void WriteData(const std::string& data);
+	void WriteData(const SendQueue::Element& data);
 
 	/** Retrieves the current size of the send queue. */
 	size_t GetSendQSize() const;
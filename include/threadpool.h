@@ -0,0 +1,60 @@
+/*
+ * InspIRCd -- Internet Relay Chat Daemon
+ *
+ * This file is part of InspIRCd.  InspIRCd is free software: you can
+ * redistribute it and/or modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation, version 2.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#pragma once
+
+/** Runs expensive jobs such as password hashing on a pool of worker threads. */
+class CoreExport ThreadPool final
+{
+public:
+	/** A unit of work which can be executed by the thread pool. */
+	class CoreExport Job
+	{
+	public:
+		virtual ~Job() = default;
+
+		/** Called on a worker thread to perform the work. This MUST NOT access any state which is
+		 * also accessed by the main thread.
+		 */
+		virtual void Run() = 0;
+
+		/** Called on the main thread once Run has returned to deliver the result. */
+		virtual void Finish() = 0;
+	};
+
+private:
+	class Worker;
+
+	/** The workers which are currently running. */
+	std::vector<Worker*> workers;
+
+public:
+	~ThreadPool();
+
+	/** Waits for all submitted jobs to complete and then calls Finish on them. This is used
+	 * before a module is unloaded to ensure no jobs are still executing its code.
+	 */
+	void Flush();
+
+	/** Stops all of the workers after waiting for any submitted jobs to complete. */
+	void Stop();
+
+	/** Submits a job to be executed by the thread pool.
+	 * @param job The job to execute. This will be deleted after its Finish method is called.
+	 */
+	void Submit(Job* job);
+};
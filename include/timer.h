@@ -27,11 +27,12 @@
 #pragma once
 
 class Module;
+class TimerManager;
 
-/** Timer class for one-second resolution timers
+/** Timer class for millisecond resolution timers
  * Timer provides a facility which allows module
  * developers to create one-shot timers. The timer
- * can be made to trigger at any time up to a one-second
+ * can be made to trigger at any time up to a one-millisecond
  * resolution. To use Timer, inherit a class from
  * Timer, then insert your inherited class into the
  * queue using Server::AddTimer(). The Tick() method of
@@ -39,19 +40,28 @@ class Module;
  * at the given time.
  */
 class CoreExport Timer
+	: public insp::intrusive_list_node<Timer, TimerManager>
 {
-	/** The triggering time
+	friend class TimerManager;
+
+	/** The triggering time in milliseconds since the UNIX epoch or 0 if the timer is not active.
 	 */
-	time_t trigger = 0;
+	uint64_t trigger = 0;
 
-	/** Number of seconds between triggers
+	/** Number of milliseconds between triggers
 	 */
-	unsigned long secs;
+	std::chrono::milliseconds interval;
 
 	/** True if this is a repeating timer
 	 */
 	bool repeat;
 
+	/** The level of the timer wheel this timer is in. Only valid if the timer is active. */
+	uint8_t wheellevel = 0;
+
+	/** The slot of the timer wheel level this timer is in. Only valid if the timer is active. */
+	uint8_t wheelslot = 0;
+
 public:
 	/** Default constructor, initializes the triggering time
 	 * @param secs_from_now The number of seconds from now to trigger the timer
@@ -59,6 +69,12 @@ public:
 	 */
 	Timer(unsigned long secs_from_now, bool repeating);
 
+	/** Initializes the triggering time with millisecond precision.
+	 * @param time_from_now The time from now to trigger the timer.
+	 * @param repeating Repeat this timer every time_from_now if set to true.
+	 */
+	Timer(std::chrono::milliseconds time_from_now, bool repeating);
+
 	/** Default destructor, removes the timer from the timer manager
 	 */
 	virtual ~Timer();
@@ -66,7 +82,7 @@ public:
 	/** Retrieves the time at which this timer will tick next. If the timer is not active then 0 will be returned. */
 	time_t GetTrigger() const
 	{
-		return trigger;
+		return static_cast<time_t>(trigger / 1000);
 	}
 
 	/** Sets the trigger timeout to a new value
@@ -75,12 +91,19 @@ public:
 	 */
 	void SetTrigger(time_t nexttrigger)
 	{
-		trigger = nexttrigger;
+		trigger = static_cast<uint64_t>(nexttrigger) * 1000;
 	}
 
 	/** Sets the interval between two ticks.
 	 */
-	void SetInterval(unsigned long interval, bool restart = true);
+	void SetInterval(unsigned long newinterval, bool restart = true)
+	{
+		SetInterval(std::chrono::seconds(newinterval), restart);
+	}
+
+	/** Sets the interval between two ticks with millisecond precision.
+	 */
+	void SetInterval(std::chrono::milliseconds newinterval, bool restart = true);
 
 	/** Called when the timer ticks.
 	 * You should override this method with some useful code to
@@ -101,7 +124,13 @@ public:
 	 */
 	unsigned long GetInterval() const
 	{
-		return secs;
+		return static_cast<unsigned long>(std::chrono::duration_cast<std::chrono::seconds>(interval).count());
+	}
+
+	/** Returns the interval between ticks of this timer object with millisecond precision. */
+	std::chrono::milliseconds GetPreciseInterval() const
+	{
+		return interval;
 	}
 
 	/** Cancels the repeat state of a repeating timer.
@@ -117,14 +146,53 @@ public:
 /** This class manages sets of Timers, and triggers them at their defined times.
  * This will ensure timers are not missed, as well as removing timers that have
  * expired and allowing the addition of new ones.
+ *
+ * Timers are stored in a hierarchical timing wheel with millisecond resolution so adding,
+ * removing, and checking for due timers does not depend on how many timers exist.
  */
 class CoreExport TimerManager final
 {
-	typedef std::multimap<time_t, Timer*> TimerMap;
+private:
+	typedef insp::intrusive_list_tail<Timer, TimerManager> TimerList;
+
+	/** The number of bits of the trigger time which are used to pick a slot in each level. */
+	static constexpr unsigned int WHEEL_BITS = 6;
 
-	/** A list of all pending timers
+	/** The number of slots in each level of the timer wheel. */
+	static constexpr size_t WHEEL_SIZE = 1 << WHEEL_BITS;
+
+	/** The number of levels in the timer wheel. Timers which are further in the future than the
+	 * last level can represent (about 12 days) are moved down the wheel when they get closer.
+	 */
+	static constexpr size_t WHEEL_LEVELS = 5;
+
+	/** The level that Timer::wheellevel is set to when the timer is due to be ticked. */
+	static constexpr uint8_t DUE_LEVEL = WHEEL_LEVELS;
+
+	/** The slots of each level of the timer wheel. Level N contains timers which are due within
+	 * 64^(N+1) milliseconds and each slot in it represents 64^N milliseconds.
 	 */
-	TimerMap Timers;
+	std::array<std::array<TimerList, WHEEL_SIZE>, WHEEL_LEVELS> wheel;
+
+	/** The number of timers in each level of the timer wheel. */
+	std::array<size_t, WHEEL_LEVELS> levelsize = { };
+
+	/** Timers which are due and are currently being ticked. */
+	TimerList due;
+
+	/** The next millisecond which has not been checked for due timers yet. */
+	uint64_t base = 0;
+
+	/** Inserts an active timer into the timer wheel.
+	 * @param t The timer to insert.
+	 */
+	void Insert(Timer* t);
+
+	/** Moves the timers in a slot to a lower level of the timer wheel.
+	 * @param level The level of the timer wheel to move timers from.
+	 * @return The index of the slot that timers were moved from.
+	 */
+	size_t Cascade(size_t level);
 
 public:
 	/** Tick all pending Timers
@@ -140,4 +208,9 @@ public:
 	 * @param T an Timer derived class to remove
 	 */
 	void DelTimer(Timer* T);
+
+	/** Retrieves the number of milliseconds until the next timer might be due. This is capped at
+	 * one second so that the main loop still runs at least once a second.
+	 */
+	int GetWaitTime() const;
 };
@@ -54,7 +54,7 @@ namespace ClientProtocol
 
 	typedef std::vector<Message*> MessageList;
 	typedef std::vector<std::string> ParamList;
-	typedef std::string SerializedMessage;
+	typedef insp::shared_buffer SerializedMessage;
 
 	struct CoreExport MessageTagData final
 	{
@@ -80,3 +80,6 @@ typedef std::set<User*> CUList;
 
 /** A bitset of characters which are enabled/set. */
 typedef std::bitset<UCHAR_MAX + 1> CharState;
+
+/** A function which is called with the result of an asynchronous password check. */
+typedef std::function<void(bool)> PasswordCallback;
@@ -26,6 +26,8 @@
 
 #include <list>
 
+#include "utility/cidr_counter.h"
+
 /** A mapping of user nicks or uuids to their User object. */
 typedef std::unordered_map<std::string, User*, irc::insensitive, irc::StrHashComp> UserMap;
 
@@ -36,11 +38,18 @@ public:
 	{
 		unsigned int global = 0;
 		unsigned int local = 0;
+
+		CloneCounts& operator+=(const CloneCounts& other)
+		{
+			global += other.global;
+			local += other.local;
+			return *this;
+		}
 	};
 
 	/** Container that maps IP addresses to clone counts
 	 */
-	typedef std::map<irc::sockets::cidr_mask, CloneCounts> CloneMap;
+	typedef insp::cidr_counter<CloneCounts> CloneMap;
 
 	/** Sequence container in which each element is a User*
 	 */
@@ -53,6 +62,9 @@ public:
 	*/
 	typedef insp::intrusive_list<LocalUser> LocalList;
 
+	/** A function which is called with each QUIT message that is about to be sent to the neighbors of a user that is being quit. */
+	typedef std::function<void(ClientProtocol::Message&)> QuitMessageHandler;
+
 private:
 	/** Map of IP addresses for clone counting
 	 */
@@ -71,6 +83,23 @@ private:
 	 */
 	uint64_t already_sent_id = 0;
 
+	/** Begins disconnecting a user gracefully by marking them as quitting and notifying the user.
+	 * @param user The user to remove.
+	 * @param quitreason The quit reason to show to normal users.
+	 * @param operreason The quit reason to show to opers, can be NULL if same as quitreason.
+	 * @param quitmsg The location to store the quit message to show to normal users.
+	 * @param operquitmsg The location to store the quit message to show to opers.
+	 * @return True if the user is quitting or false if the quit was blocked.
+	 */
+	bool BeginQuit(User* user, const std::string& quitreason, const std::string* operreason, std::string& quitmsg, std::string& operquitmsg);
+
+	/** Finishes disconnecting a user by closing their connection and removing them from the user
+	 * lists. This does not remove the user from their channels.
+	 * @param user The user to remove.
+	 * @param operquitmsg The quit message to show to opers.
+	 */
+	void FinishQuit(User* user, const std::string& operquitmsg);
+
 public:
 	/** Constructor, initializes variables
 	 */
@@ -98,11 +127,6 @@ public:
 	/** Number of local unknown (not fully connected) users. */
 	size_t unknown_count = 0;
 
-	/** Perform background user events for all local users such as PING checks, connection timeouts,
-	 * penalty management and recvq processing for users who have data in their recvq due to throttling.
-	 */
-	void DoBackgroundUserStuff();
-
 	/** Handle a client connection.
 	 * Creates a new LocalUser object, inserts it into the appropriate containers,
 	 * initializes it as not fully connected, and adds it to the socket engine.
@@ -124,6 +148,19 @@ public:
 	 */
 	void QuitUser(User* user, const std::string& quitreason, const std::string* operreason = nullptr) ATTR_NOT_NULL(2);
 
+	/** Disconnect multiple users gracefully, e.g. when a server splits from the network.
+	 * This is equivalent to calling QuitUser() on each user but allows the caller to modify
+	 * the QUIT messages before they are sent to neighbors, for example to add them to a batch.
+	 * The neighbors of all of the users are visited in a single pass and each neighbor is sent
+	 * all of its QUIT messages at once. Each neighbor still receives only a single QUIT message
+	 * for each user that quits.
+	 * @param users The users to remove. Users which are already quitting are skipped.
+	 * @param quitreason The quit reason to show to normal users
+	 * @param operreason The quit reason to show to opers, can be NULL if same as quitreason
+	 * @param handler If non-empty then a function to call with each QUIT message before it is sent.
+	 */
+	void QuitUsers(const std::vector<User*>& users, const std::string& quitreason, const std::string* operreason = nullptr, const QuitMessageHandler& handler = nullptr);
+
 	/** Add a user to the clone map
 	 * @param user The user to add
 	 */
@@ -136,7 +173,8 @@ public:
 	 */
 	void RemoveCloneCounts(User* user) ATTR_NOT_NULL(2);
 
-	/** Rebuild clone counts. Required when \<cidr> settings change.
+	/** Update clone counts after the \<cidr> settings change. Users are only counted
+	 * again if the range for their address family got narrower.
 	 */
 	void RehashCloneCounts();
 
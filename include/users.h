@@ -310,6 +310,14 @@ public:
 	 */
 	bool CheckPassword(const std::string& pw) const;
 
+	/** Check the specified password against the one from this oper account's password without
+	 * blocking the main thread.
+	 * @param pw The password to check.
+	 * @param callback The function to call with whether the password is correct. This may be
+	 *                 called before this method returns.
+	 */
+	void CheckPassword(const std::string& pw, const PasswordCallback& callback) const;
+
 	/** Retrieves the name of the underlying oper type. */
 	const auto& GetType() const { return type; }
 };
@@ -341,6 +349,9 @@ private:
 	/** Cached value for GetRealMask. */
 	std::string cached_realmask;
 
+	/** The ban serial at which the cached ban state of this user was last invalidated. */
+	uint64_t banserial = 0;
+
 	/** If set then the hostname which is displayed to users. */
 	std::string displayhost;
 
@@ -571,6 +582,11 @@ public:
 	 */
 	void InvalidateCache();
 
+	/** Retrieves the ban serial at which the cached ban state of this user was last invalidated.
+	 * This is updated whenever InvalidateCache() is called.
+	 */
+	uint64_t GetBanSerial() const { return banserial; }
+
 	/** Returns whether this user is currently away or not. If true,
 	 * further information can be found in away->message and away->time
 	 * @return True if the user is away, false otherwise
@@ -810,7 +826,37 @@ public:
 	 * sendq value, the user will be removed, and further buffer adds will be dropped.
 	 * @param data The data to add to the write buffer
 	 */
-	void AddWriteBuf(const std::string& data);
+	void AddWriteBuf(const SendQueue::Element& data);
+};
+
+/** Checks whether a local user has timed out whilst connecting and pings them once connected. */
+class CoreExport UserTimeoutTimer final
+	: public Timer
+{
+public:
+	LocalUser* const user;
+	UserTimeoutTimer(LocalUser* me)
+		: Timer(1, true)
+		, user(me)
+	{
+	}
+	bool Tick() override;
+};
+
+/** Decays the command flood penalty of a local user and processes any commands from them which
+ * were held back because of it or their sendq being full.
+ */
+class CoreExport UserPenaltyTimer final
+	: public Timer
+{
+public:
+	LocalUser* const user;
+	UserPenaltyTimer(LocalUser* me)
+		: Timer(1, false)
+		, user(me)
+	{
+	}
+	bool Tick() override;
 };
 
 class CoreExport LocalUser final
@@ -843,6 +889,12 @@ public:
 
 	UserIOHandler eh;
 
+	/** Handles connection timeouts and pinging for this user. Only the core should use this. */
+	UserTimeoutTimer timeouttimer;
+
+	/** Handles the command flood penalty of this user. Only the core should use this. */
+	UserPenaltyTimer penaltytimer;
+
 	/** Serializer to use when communicating with the user
 	 */
 	ClientProtocol::Serializer* serializer = nullptr;
@@ -904,6 +956,17 @@ public:
 	 */
 	unsigned int CommandFloodPenalty = 0;
 
+	/** The number of asynchronous operations which are preventing commands from this user from
+	 * being processed. Use Suspend() and Resume() to modify this.
+	 */
+	unsigned int suspended = 0;
+
+	/** A compact fingerprint of the client capabilities which this user has enabled. Users with
+	 * the same fingerprint are sent the same tags by tag providers which only depend on client
+	 * capabilities. This is maintained by the cap module.
+	 */
+	intptr_t capfingerprint = 0;
+
 	uint64_t already_sent = 0;
 
 	/** Check if the user matches a G- or K-line, and disconnect them if they do.
@@ -917,6 +980,16 @@ public:
 	 */
 	void FullConnect();
 
+	/** Stops processing commands from this user until Resume() is called. This is used to make
+	 * a command wait for the result of an asynchronous operation before later commands run.
+	 */
+	void Suspend() { suspended++; }
+
+	/** Resumes processing commands from this user after a call to Suspend(). Any commands which
+	 * were received in the meantime will be processed outside of the current call stack.
+	 */
+	void Resume();
+
 	/** @copydoc User::ChangeRemoteAddress */
 	void ChangeRemoteAddress(const irc::sockets::sockaddrs& sa) override;
 
@@ -0,0 +1,184 @@
+/*
+ * InspIRCd -- Internet Relay Chat Daemon
+ *
+ * This file is part of InspIRCd.  InspIRCd is free software: you can
+ * redistribute it and/or modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation, version 2.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#pragma once
+
+namespace insp
+{
+	template <typename Value>
+	class cidr_counter;
+}
+
+/** A hash table which maps the CIDR range that an address is in to a value such as a connection
+ * count. The length of the ranges can be changed without counting every address again as long as
+ * the ranges are getting wider.
+ *
+ * Value must be default constructible and support the += operator so that the values of ranges
+ * can be merged.
+ */
+template <typename Value>
+class insp::cidr_counter final
+{
+public:
+	typedef std::unordered_map<irc::sockets::cidr_mask, Value, irc::sockets::cidr_mask::hash> map_type;
+
+private:
+	/** The values for each range. */
+	map_type entries;
+
+	/** The length of the ranges that IPv4 addresses are counted in. */
+	unsigned char ipv4range = 32;
+
+	/** The length of the ranges that IPv6 addresses are counted in. */
+	unsigned char ipv6range = 128;
+
+	/** Shortens a CIDR mask, clearing the bits which are no longer part of it.
+	 * @param mask The mask to shorten.
+	 * @param length The new length of the mask in bits.
+	 */
+	static irc::sockets::cidr_mask shorten(irc::sockets::cidr_mask mask, unsigned char length)
+	{
+		const unsigned char bytes = length / 8;
+		if (length % 8)
+			mask.bits[bytes] &= 0xFF00 >> (length % 8);
+		std::fill(mask.bits + bytes + (length % 8 ? 1 : 0), mask.bits + sizeof(mask.bits), 0);
+		mask.length = length;
+		return mask;
+	}
+
+	/** Changes the length of the ranges of a single address family.
+	 * @param family The address family to change the ranges of.
+	 * @param range The current length of the ranges.
+	 * @param newrange The new length of the ranges.
+	 * @return True if the entries for the family were removed; otherwise, false.
+	 */
+	bool set_range(sa_family_t family, unsigned char& range, unsigned char newrange)
+	{
+		if (range == newrange)
+			return false;
+
+		// Wider ranges contain the whole of one or more of the old ranges so their values can be
+		// merged. Narrower ranges would need to split the old values which we can not do.
+		const bool wider = newrange < range;
+		range = newrange;
+
+		map_type merged;
+		for (auto it = entries.begin(); it != entries.end(); )
+		{
+			if (it->first.type != family)
+			{
+				++it;
+				continue;
+			}
+
+			if (wider)
+				merged[shorten(it->first, newrange)] += it->second;
+			it = entries.erase(it);
+		}
+
+		entries.merge(merged);
+		return !wider;
+	}
+
+public:
+	/** Retrieves the range which an address is counted in.
+	 * @param sa The address to retrieve the range of.
+	 */
+	irc::sockets::cidr_mask get_mask(const irc::sockets::sockaddrs& sa) const
+	{
+		switch (sa.family())
+		{
+			case AF_INET:
+				return irc::sockets::cidr_mask(sa, ipv4range);
+
+			case AF_INET6:
+				return irc::sockets::cidr_mask(sa, ipv6range);
+
+			default:
+				// Ranges are not supported for other address families.
+				return irc::sockets::cidr_mask(sa, 0);
+		}
+	}
+
+	/** Retrieves the value for the range an address is in, creating it if it does not exist.
+	 * @param sa The address to retrieve the value for.
+	 */
+	Value& operator[](const irc::sockets::sockaddrs& sa) { return entries[get_mask(sa)]; }
+
+	/** Finds the value for the range an address is in.
+	 * @param sa The address to find the value for.
+	 * @return The value or nullptr if there is no value for the range.
+	 */
+	Value* find(const irc::sockets::sockaddrs& sa)
+	{
+		auto it = entries.find(get_mask(sa));
+		return it == entries.end() ? nullptr : &it->second;
+	}
+
+	/** @copydoc find */
+	const Value* find(const irc::sockets::sockaddrs& sa) const
+	{
+		auto it = entries.find(get_mask(sa));
+		return it == entries.end() ? nullptr : &it->second;
+	}
+
+	/** Removes the value for the range an address is in.
+	 * @param sa The address to remove the value for.
+	 */
+	void erase(const irc::sockets::sockaddrs& sa) { entries.erase(get_mask(sa)); }
+
+	/** Removes every value which matches a predicate.
+	 * @param pred A function which returns true if the specified value should be removed.
+	 */
+	template <typename Predicate>
+	void erase_if(Predicate&& pred)
+	{
+		for (auto it = entries.begin(); it != entries.end(); )
+		{
+			if (pred(it->second))
+				it = entries.erase(it);
+			else
+				++it;
+		}
+	}
+
+	/** Changes the lengths of the ranges that addresses are counted in. The values of ranges which
+	 * have got wider are merged. Ranges which have got narrower can not be split so their values
+	 * are removed and must be counted again by the caller.
+	 * @param ipv4 The new length of the ranges for IPv4 addresses.
+	 * @param ipv6 The new length of the ranges for IPv6 addresses.
+	 * @return The address families which need to be counted again.
+	 */
+	std::vector<sa_family_t> set_ranges(unsigned char ipv4, unsigned char ipv6)
+	{
+		std::vector<sa_family_t> stale;
+		if (set_range(AF_INET, ipv4range, ipv4))
+			stale.push_back(AF_INET);
+		if (set_range(AF_INET6, ipv6range, ipv6))
+			stale.push_back(AF_INET6);
+		return stale;
+	}
+
+	/** Removes all values. */
+	void clear() { entries.clear(); }
+
+	/** Retrieves the values for each range. */
+	const map_type& get() const { return entries; }
+
+	/** Retrieves the number of ranges which have a value. */
+	size_t size() const { return entries.size(); }
+};
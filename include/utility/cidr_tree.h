@@ -0,0 +1,221 @@
+/*
+ * InspIRCd -- Internet Relay Chat Daemon
+ *
+ * This file is part of InspIRCd.  InspIRCd is free software: you can
+ * redistribute it and/or modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation, version 2.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#pragma once
+
+namespace insp
+{
+	template <typename Value>
+	class cidr_tree;
+}
+
+/** A path compressed binary radix tree which maps address prefixes to values. Finding the values
+ * for every prefix which contains an address takes time proportional to the length of the address
+ * rather than the number of prefixes in the tree.
+ *
+ * Prefixes are specified as a big endian bit string and a length in bits. All bits after the end of
+ * a prefix must be zero. Only one address family should be stored in each tree.
+ */
+template <typename Value>
+class insp::cidr_tree final
+{
+public:
+	/** The maximum length of a prefix in bits. */
+	static constexpr unsigned char max_length = 128;
+
+private:
+	/** A node in the tree. */
+	struct node final
+	{
+		/** The prefix represented by this node. */
+		unsigned char bits[max_length / 8] = { };
+
+		/** The length of the prefix represented by this node. */
+		unsigned char length = 0;
+
+		/** The child nodes for prefixes where the next bit is unset and set. */
+		std::unique_ptr<node> children[2];
+
+		/** The values which are stored with exactly this prefix. */
+		std::vector<Value> values;
+
+		node() = default;
+
+		node(const unsigned char* prefix, unsigned char len)
+			: length(len)
+		{
+			const unsigned char bytes = len / 8;
+			std::copy(prefix, prefix + bytes, bits);
+			if (len % 8)
+				bits[bytes] = prefix[bytes] & (0xFF00 >> (len % 8));
+		}
+	};
+
+	/** The root of the tree which represents the zero length prefix. */
+	node root;
+
+	/** The number of values in the tree. */
+	size_t count = 0;
+
+	/** Retrieves the bit at the specified position in a bit string. */
+	static bool getbit(const unsigned char* bits, unsigned char pos)
+	{
+		return bits[pos / 8] & (0x80 >> (pos % 8));
+	}
+
+	/** Retrieves the number of leading bits that two bit strings have in common.
+	 * @param first The first bit string.
+	 * @param second The second bit string.
+	 * @param maxlen The maximum number of bits to compare.
+	 */
+	static unsigned char common(const unsigned char* first, const unsigned char* second, unsigned char maxlen)
+	{
+		unsigned char pos = 0;
+		while (pos + 8 <= maxlen && first[pos / 8] == second[pos / 8])
+			pos += 8;
+		while (pos < maxlen && getbit(first, pos) == getbit(second, pos))
+			pos++;
+		return pos;
+	}
+
+public:
+	/** Inserts a value into the tree.
+	 * @param bits The prefix to insert the value at.
+	 * @param length The length of the prefix in bits.
+	 * @param value The value to insert.
+	 */
+	void insert(const unsigned char* bits, unsigned char length, const Value& value)
+	{
+		node* curr = &root;
+		while (curr->length < length)
+		{
+			std::unique_ptr<node>& child = curr->children[getbit(bits, curr->length)];
+			if (!child)
+			{
+				// There are no prefixes below here so we can insert a leaf directly.
+				child = std::make_unique<node>(bits, length);
+				curr = child.get();
+				break;
+			}
+
+			const unsigned char shared = common(bits, child->bits, std::min(length, child->length));
+			if (shared < child->length)
+			{
+				// The prefix diverges part of the way through the child so we need to split it.
+				auto split = std::make_unique<node>(bits, shared);
+				split->children[getbit(child->bits, shared)] = std::move(child);
+				child = std::move(split);
+			}
+			curr = child.get();
+		}
+
+		curr->values.push_back(value);
+		count++;
+	}
+
+	/** Removes a value from the tree.
+	 * @param bits The prefix the value was inserted at.
+	 * @param length The length of the prefix in bits.
+	 * @param value The value to remove.
+	 * @return True if the value was found and removed; otherwise, false.
+	 */
+	bool erase(const unsigned char* bits, unsigned char length, const Value& value)
+	{
+		std::unique_ptr<node>* path[max_length + 1];
+		size_t depth = 0;
+
+		node* curr = &root;
+		while (curr->length < length)
+		{
+			std::unique_ptr<node>& child = curr->children[getbit(bits, curr->length)];
+			if (!child || child->length > length || common(bits, child->bits, child->length) < child->length)
+				return false; // Not in the tree.
+
+			path[depth++] = &child;
+			curr = child.get();
+		}
+
+		auto it = std::find(curr->values.begin(), curr->values.end(), value);
+		if (it == curr->values.end())
+			return false; // Not in the tree.
+
+		curr->values.erase(it);
+		count--;
+
+		// Remove any nodes which are no longer needed to keep the tree compressed.
+		while (depth)
+		{
+			std::unique_ptr<node>& ptr = *path[--depth];
+			if (!ptr->values.empty() || (ptr->children[0] && ptr->children[1]))
+				break;
+
+			ptr = std::move(ptr->children[0] ? ptr->children[0] : ptr->children[1]);
+		}
+		return true;
+	}
+
+	/** Finds the values for every prefix which contains an address.
+	 * @param bits The address to search for.
+	 * @param length The length of the address in bits.
+	 * @param func A function which is called for each value from the most specific prefix to the
+	 *             least specific prefix. If it returns true then the search is stopped.
+	 * @return True if the search was stopped by \p func; otherwise, false.
+	 */
+	template <typename Func>
+	bool find(const unsigned char* bits, unsigned char length, Func&& func) const
+	{
+		const node* path[max_length + 1];
+		size_t depth = 0;
+
+		const node* curr = &root;
+		while (curr)
+		{
+			path[depth++] = curr;
+			if (curr->length >= length)
+				break;
+
+			curr = curr->children[getbit(bits, curr->length)].get();
+			if (curr && (curr->length > length || common(bits, curr->bits, curr->length) < curr->length))
+				break; // The address is not within this prefix.
+		}
+
+		while (depth)
+		{
+			for (const auto& value : path[--depth]->values)
+			{
+				if (func(value))
+					return true;
+			}
+		}
+		return false;
+	}
+
+	/** Removes all values from the tree. */
+	void clear()
+	{
+		root.children[0].reset();
+		root.children[1].reset();
+		root.values.clear();
+		count = 0;
+	}
+
+	/** Determines whether the tree contains no values. */
+	bool empty() const { return !count; }
+
+	/** Retrieves the number of values in the tree. */
+	size_t size() const { return count; }
+};
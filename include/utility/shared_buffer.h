@@ -0,0 +1,119 @@
+/*
+ * InspIRCd -- Internet Relay Chat Daemon
+ *
+ * This file is part of InspIRCd.  InspIRCd is free software: you can
+ * redistribute it and/or modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation, version 2.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#pragma once
+
+namespace insp
+{
+	class shared_buffer;
+}
+
+/** An immutable reference counted string buffer. Copying a shared buffer only copies a pointer
+ * to the underlying data so the same buffer can be queued for many sockets at once. Each copy
+ * has its own read offset which allows it to be consumed independently of the other copies.
+ */
+class insp::shared_buffer final
+{
+public:
+	/** The type used to represent the size of a buffer. */
+	typedef std::string::size_type size_type;
+
+	/** The type of the iterators returned by begin() and end(). */
+	typedef const char* const_iterator;
+
+private:
+	/** The underlying data or nullptr if the buffer is empty. */
+	std::shared_ptr<const std::string> buffer;
+
+	/** The position within the underlying data that this buffer starts at. */
+	size_type offset = 0;
+
+public:
+	/** Initializes an empty buffer. */
+	shared_buffer() = default;
+
+	/** Initializes a buffer by taking ownership of the specified string.
+	 * @param str The string to take ownership of.
+	 */
+	shared_buffer(std::string&& str)
+		: buffer(str.empty() ? nullptr : std::make_shared<const std::string>(std::move(str)))
+	{
+	}
+
+	/** Initializes a buffer with a copy of the specified string.
+	 * @param str The string to copy.
+	 */
+	shared_buffer(const std::string& str)
+		: buffer(str.empty() ? nullptr : std::make_shared<const std::string>(str))
+	{
+	}
+
+	/** Initializes a buffer with a copy of the specified data.
+	 * @param str The data to copy.
+	 * @param len The length of the data to copy.
+	 */
+	shared_buffer(const char* str, size_type len)
+		: buffer(len ? std::make_shared<const std::string>(str, len) : nullptr)
+	{
+	}
+
+	/** Initializes a buffer with a copy of the specified C string.
+	 * @param str The C string to copy.
+	 */
+	shared_buffer(const char* str)
+		: shared_buffer(str, strlen(str))
+	{
+	}
+
+	/** Retrieves an iterator to the start of the buffer. */
+	const_iterator begin() const { return data(); }
+
+	/** Retrieves an iterator to one past the end of the buffer. */
+	const_iterator end() const { return data() + length(); }
+
+	/** Retrieves a pointer to the unconsumed data in the buffer. */
+	const char* data() const { return buffer ? buffer->data() + offset : ""; }
+
+	/** Determines whether the buffer has no unconsumed data. */
+	bool empty() const { return !length(); }
+
+	/** Retrieves the length of the unconsumed data in the buffer. */
+	size_type length() const { return buffer ? buffer->length() - offset : 0; }
+
+	/** Marks the specified number of bytes at the start of the buffer as consumed. This does not
+	 * affect any other copies of the buffer.
+	 * @param n The number of bytes to consume.
+	 */
+	void remove_prefix(size_type n)
+	{
+		offset += std::min(n, length());
+		if (offset == (buffer ? buffer->length() : 0))
+		{
+			buffer.reset();
+			offset = 0;
+		}
+	}
+
+	/** Retrieves the length of the unconsumed data in the buffer. */
+	size_type size() const { return length(); }
+
+	/** Retrieves a view of the unconsumed data in the buffer. */
+	std::string_view view() const { return std::string_view(data(), length()); }
+
+	/** Retrieves a view of the unconsumed data in the buffer. */
+	operator std::string_view() const { return view(); }
+};
@@ -72,6 +72,13 @@ protected:
 	 */
 	void DefaultApply(User* u, bool bancache);
 
+	/** Parses a host mask which is a literal IP address or CIDR range.
+	 * @param mask The host mask to parse.
+	 * @param range The location to store the address range in.
+	 * @return True if the mask is an IP address or CIDR range; otherwise, false.
+	 */
+	static bool ParseAddressRange(const std::string& mask, irc::sockets::cidr_mask& range);
+
 public:
 
 	/** Create an XLine.
@@ -141,6 +148,15 @@ public:
 	 */
 	virtual const std::string& Displayable() const = 0;
 
+	/** Retrieves the IP address range which a user must be in for this line to match them. The
+	 * X-line manager uses this to index lines so that they are only checked against users which
+	 * they can match. A user is considered to be in the range if either their IP address or their
+	 * real hostname (if it is an IP address) is within it.
+	 * @param range The location to store the address range in.
+	 * @return True if this line can only match users within an address range; otherwise, false.
+	 */
+	virtual bool GetAddressRange(irc::sockets::cidr_mask& range) const { return false; }
+
 	/** Called when the xline has just been added.
 	 */
 	virtual void OnAdd() { }
@@ -207,6 +223,8 @@ public:
 
 	const std::string& Displayable() const override;
 
+	bool GetAddressRange(irc::sockets::cidr_mask& range) const override;
+
 	bool IsBurstable() override;
 
 	/** Username pattern to match. */
@@ -248,6 +266,8 @@ public:
 
 	const std::string& Displayable() const override;
 
+	bool GetAddressRange(irc::sockets::cidr_mask& range) const override;
+
 	/** Username pattern to match. */
 	const std::string usermask;
 
@@ -289,6 +309,8 @@ public:
 
 	const std::string& Displayable() const override;
 
+	bool GetAddressRange(irc::sockets::cidr_mask& range) const override;
+
 	/** Username pattern to match. */
 	const std::string usermask;
 
@@ -325,6 +347,8 @@ public:
 
 	const std::string& Displayable() const override;
 
+	bool GetAddressRange(irc::sockets::cidr_mask& range) const override;
+
 	/** IP mask (no user part)
 	 */
 	const std::string ipaddr;
@@ -428,7 +452,71 @@ protected:
 	 */
 	XLineContainer lookup_lines;
 
+	/** Indexes the lines of a single type so that users can be matched against them without
+	 * checking every line.
+	 */
+	struct LineIndex final
+	{
+		/** Lines which can only match users within an IPv4 address range. */
+		insp::cidr_tree<XLine*> ipv4;
+
+		/** Lines which can only match users within an IPv6 address range. */
+		insp::cidr_tree<XLine*> ipv6;
+
+		/** Lines which can not be indexed by address and have to be checked individually. */
+		XLineLookup other;
+	};
+
+	/** The indices of the lines in lookup_lines keyed by line type. */
+	std::map<std::string, LineIndex> line_index;
+
+	/** A serial which is changed whenever a line is added or removed or the exemption state of
+	 * users is recalculated. Cached matches which were computed at a different serial are stale.
+	 */
+	uint64_t serial = 1;
+
+	/** Adds a line to the index for its type.
+	 * @param line The line to add.
+	 */
+	void IndexLine(XLine* line);
+
+	/** Removes a line from the index for its type.
+	 * @param line The line to remove.
+	 */
+	void UnindexLine(XLine* line);
+
+	/** Finds the lines which can only match users within an address range that contains the
+	 * specified address. Lines with more specific ranges are found first.
+	 * @param index The index to search.
+	 * @param sa The address to search for.
+	 * @param lines The location to store the lines that were found.
+	 */
+	static void FindAddressLines(const LineIndex& index, const irc::sockets::sockaddrs& sa, std::vector<XLine*>& lines);
+
+	/** Checks the lines in an index which could match a user or pattern, expiring any which have
+	 * expired.
+	 * @param container The lines which are being checked.
+	 * @param index The index of the lines which are being checked.
+	 * @param candidates The lines found by address which could match.
+	 * @param matches A function which determines whether a line matches.
+	 * @return The first line which matched or nullptr if no lines matched.
+	 */
+	template <typename Matcher>
+	XLine* MatchesIndex(ContainerIter container, LineIndex& index, const std::vector<XLine*>& candidates, Matcher&& matches);
+
 public:
+	/** Caches the result of matching a user against the lines of a specific type. */
+	struct MatchCache final
+	{
+		/** The value of XLineManager::GetSerial() when the result was cached. */
+		uint64_t lineserial = 0;
+
+		/** The value of User::GetBanSerial() when the result was cached. */
+		uint64_t userserial = 0;
+
+		/** The line which the user matched or nullptr if they did not match a line. */
+		XLine* line = nullptr;
+	};
 
 	/** Constructor
 	 */
@@ -531,6 +619,18 @@ public:
 	 */
 	XLine* MatchesLine(const std::string& type, const std::string& pattern);
 
+	/** Check if a user matches an XLine, reusing a previous result if neither the lines nor the
+	 * user have changed since it was computed.
+	 * @param type The type of line to look up
+	 * @param user The user to match against (what is checked is specific to the xline type)
+	 * @param cache The result of the last check of this user against lines of this type.
+	 * @return The matching XLine if there is a match, or NULL if there is no match
+	 */
+	XLine* MatchesLine(const std::string& type, User* user, MatchCache& cache);
+
+	/** Retrieves the serial at which lines were last added or removed. */
+	uint64_t GetSerial() const { return serial; }
+
 	/** Expire a line given two iterators which identify it in the main map.
 	 * @param container Iterator to the first level of entries the map
 	 * @param item Iterator to the second level of entries in the map
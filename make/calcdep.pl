@@ -29,6 +29,7 @@ use FindBin        qw($RealDir);
 
 use lib dirname $RealDir;
 use make::common;
+use make::directive;
 
 use constant {
 	BUILDPATH  => $ENV{BUILDPATH},
@@ -37,6 +38,7 @@ use constant {
 };
 
 sub find_output;
+sub find_module_objects($);
 sub gendep($);
 sub dep_cpp($$$);
 sub dep_so($);
@@ -51,7 +53,7 @@ exit 0;
 sub run() {
 	create_directory(BUILDPATH, 0770) or die "Could not create build directory: $!";
 	chdir BUILDPATH or die "Could not open build directory: $!";
-	mkdir $_ for qw/bin modules obj/;
+	mkdir $_ for qw/bench bin modules obj obj\/bench/;
 
 	open MAKE, '>real.mk' or die "Could not write real.mk: $!";
 	chdir "${\SOURCEPATH}/src";
@@ -110,9 +112,29 @@ END
 		}
 	}
 
+	# Benchmarks which use the core are linked against everything other than its entry point. They
+	# can also be linked against one module by naming it in a \$LinkModules directive. These are
+	# outside of the source directory so their paths are absolute rather than relative.
+	my @benchlist;
+	my $bench_core = join ' ', grep { $_ ne 'obj/main.o' } @core_deps;
+	for my $file (<${\SOURCEPATH}/tools/bench/*.cpp>) {
+		my $name = basename $file, '.cpp';
+		gendep $file;
+		my $link = $f2dep{$file} =~ m#include/inspircd\.h# ? " $bench_core" : '';
+		for my $module (split /\s+/, get_directive($file, 'LinkModules', '', 0)) {
+			$link .= ' ' . find_module_objects $module;
+		}
+		print MAKE "obj/bench/$name.o: $file $f2dep{$file}\n";
+		print MAKE "\t@\$(SOURCEPATH)/make/unit-cc.pl gen-o \$\@ $file \$>\n";
+		print MAKE "bench/$name: obj/bench/$name.o$link\n";
+		print MAKE "\t@\$(SOURCEPATH)/make/unit-cc.pl core-ld \$\@ \$^ \$>\n";
+		push @benchlist, "bench/$name";
+	}
+
 	my $core_mk = join ' ', @core_deps;
 	my $coremods = join ' ', @coremodlist;
 	my $mods = join ' ', @modlist;
+	my $benches = join ' ', @benchlist;
 	print MAKE <<END;
 
 bin/inspircd: $core_mk
@@ -124,7 +146,9 @@ coremods: $coremods
 
 modules: $mods
 
-.PHONY: all bad-target inspircd coremods modules
+bench: $benches
+
+.PHONY: all bad-target inspircd coremods modules bench
 
 END
 }
@@ -143,6 +167,28 @@ sub find_output {
 	}
 }
 
+my %module_objects;
+sub find_module_objects($) {
+	my $module = shift;
+	return $module_objects{$module} if exists $module_objects{$module};
+
+	for my $directory (qw(coremods modules)) {
+		if (-d "$directory/$module") {
+			# Modules in a directory are already built as objects before being linked.
+			return $module_objects{$module} = join ' ', map { find_output $_ } sort <$directory/$module/*.cpp>;
+		} elsif (-e "$directory/$module.cpp") {
+			# Modules in a single file are built directly into a shared library so they need to
+			# be built as an object as well.
+			my $out = "obj/bench/$module.o";
+			dep_cpp "$directory/$module.cpp", $out, 'gen-o';
+			return $module_objects{$module} = $out;
+		}
+	}
+
+	print "Error: unable to find the $module module which is linked into a benchmark!\n";
+	exit 1;
+}
+
 sub gendep($) {
 	my $f = shift;
 	my $basedir = $f =~ m#(.*)/# ? $1 : '.';
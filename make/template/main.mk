@@ -215,6 +215,15 @@ target: $(HEADER)
 debug:
 	@${MAKE} INSPIRCD_DEBUG=1 all
 
+bench:
+	@${MAKE} INSPIRCD_TARGET=bench target
+	@for BENCH in "$(BUILDPATH)"/bench/*; do \
+		[ "$${BENCH##*/}" = "loadgen" ] && continue; \
+		echo ""; \
+		echo "Running $${BENCH##*/}:"; \
+		"$$BENCH" || exit 1; \
+	done
+
 debug-header:
 	@echo "*************************************"
 	@echo "*    BUILDING WITH DEBUG SYMBOLS    *"
@@ -367,6 +376,7 @@ help:
 	@echo ' all       Complete build of InspIRCd, without installing (default)'
 	@echo ' install   Build and install InspIRCd to the directory chosen in ./configure'
 	@echo ' debug     Compile a debug build. Equivalent to "make D=1 all"'
+	@echo ' bench     Build and run the microbenchmarks and build the load generator in tools/bench'
 	@echo ''
 	@echo ' INSPIRCD_TARGET=target  Builds a user-specified target, such as "inspircd" or "core_dns"'
 	@echo '                         Multiple targets may be separated by a space'
@@ -378,4 +388,4 @@ help:
 
 .NOTPARALLEL:
 
-.PHONY: all target debug debug-header mod-header mod-footer std-header finishmessage install clean deinstall configureclean help
+.PHONY: all bench target debug debug-header mod-header mod-footer std-header finishmessage install clean deinstall configureclean help
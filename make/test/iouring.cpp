@@ -0,0 +1,27 @@
+/*
+ * InspIRCd -- Internet Relay Chat Daemon
+ *
+ * This file is part of InspIRCd.  InspIRCd is free software: you can
+ * redistribute it and/or modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation, version 2.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <linux/io_uring.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+int main() {
+	struct io_uring_params params = { };
+	struct io_uring_getevents_arg arg = { };
+	int fd = static_cast<int>(syscall(__NR_io_uring_setup, 8, &params));
+	return (fd < 0 || !(params.features & IORING_FEAT_EXT_ARG) || arg.pad || !IORING_POLL_ADD_MULTI || !IORING_ACCEPT_MULTISHOT);
+}
@@ -27,6 +27,7 @@
 #include "inspircd.h"
 #include "clientprotocolevent.h"
 #include "listmode.h"
+#include "modules/extban.h"
 
 namespace
 {
@@ -74,9 +75,126 @@ Membership* Channel::AddUser(User* user)
 		return nullptr;
 
 	Membership* memb = new(ret.first->second) Membership(user, this);
+	if (IS_LOCAL(user))
+		AddLocalUser(memb, 0);
+	else
+		CountRemoteUser(user->server, 0, true);
 	return memb;
 }
 
+void Channel::AddLocalUser(Membership* memb, ModeHandler::Rank rank)
+{
+	// Start with a hole at the end of the list. While the bucket before the hole has a lower rank
+	// than the new member we move the first member of that bucket into the hole which moves the
+	// hole to the start of that bucket. This keeps the list ordered whilst only moving one member
+	// per distinct rank.
+	size_t hole = localusers.size();
+	localusers.emplace_back();
+	while (hole && localusers[hole - 1].rank < rank)
+	{
+		const ModeHandler::Rank bucketrank = localusers[hole - 1].rank;
+		auto bucketstart = std::lower_bound(localusers.begin(), localusers.begin() + hole, bucketrank, [](const LocalMember& lm, ModeHandler::Rank r) {
+			return lm.rank > r;
+		});
+
+		const size_t start = bucketstart - localusers.begin();
+		localusers[hole] = localusers[start];
+		localusers[hole].memb->localpos = hole;
+		hole = start;
+	}
+
+	localusers[hole] = { rank, memb };
+	memb->localpos = hole;
+}
+
+void Channel::DelLocalUser(Membership* memb)
+{
+	// This is the reverse of AddLocalUser. Fill the hole with the last member of its bucket which
+	// moves the hole to the end of that bucket until it reaches the end of the list.
+	size_t hole = memb->localpos;
+	ModeHandler::Rank bucketrank = localusers[hole].rank;
+	for (;;)
+	{
+		auto bucketend = std::upper_bound(localusers.begin() + hole, localusers.end(), bucketrank, [](ModeHandler::Rank r, const LocalMember& lm) {
+			return r > lm.rank;
+		});
+
+		const size_t last = bucketend - localusers.begin() - 1;
+		if (last != hole)
+		{
+			localusers[hole] = localusers[last];
+			localusers[hole].memb->localpos = hole;
+			hole = last;
+		}
+
+		if (bucketend == localusers.end())
+			break;
+
+		// The hole is now just before the start of the next bucket.
+		bucketrank = bucketend->rank;
+	}
+	localusers.pop_back();
+}
+
+void Channel::CountRemoteUser(Server* server, ModeHandler::Rank rank, bool adding)
+{
+	if (adding)
+	{
+		remoteusers[server][rank]++;
+		return;
+	}
+
+	auto servercounts = remoteusers.find(server);
+	if (servercounts == remoteusers.end())
+		return; // Should never happen.
+
+	auto rankcount = servercounts->second.find(rank);
+	if (rankcount != servercounts->second.end() && !--rankcount->second)
+	{
+		servercounts->second.erase(rankcount);
+		if (servercounts->second.empty())
+			remoteusers.erase(servercounts);
+	}
+}
+
+void Channel::UpdateUserRank(Membership* memb, ModeHandler::Rank oldrank)
+{
+	const ModeHandler::Rank rank = memb->GetRank();
+	if (rank == oldrank)
+		return; // Nothing to do.
+
+	if (IS_LOCAL(memb->user))
+	{
+		DelLocalUser(memb);
+		AddLocalUser(memb, rank);
+	}
+	else
+	{
+		CountRemoteUser(memb->user->server, oldrank, false);
+		CountRemoteUser(memb->user->server, rank, true);
+	}
+}
+
+void Channel::RebuildUserRanks()
+{
+	for (auto& lm : localusers)
+		lm.rank = lm.memb->GetRank();
+
+	std::stable_sort(localusers.begin(), localusers.end(), [](const LocalMember& lhs, const LocalMember& rhs) {
+		return lhs.rank > rhs.rank;
+	});
+
+	for (size_t pos = 0; pos < localusers.size(); ++pos)
+		localusers[pos].memb->localpos = pos;
+
+	remoteusers.clear();
+	for (const auto& [user, memb] : userlist)
+	{
+		if (!IS_LOCAL(user))
+			CountRemoteUser(user->server, memb->GetRank(), true);
+	}
+}
+
 void Channel::DelUser(User* user)
 {
 	MemberMap::iterator it = userlist.find(user);
@@ -84,6 +202,17 @@ void Channel::DelUser(User* user)
 		DelUser(it);
 }
 
+void Channel::DelUsers(const std::vector<User*>& users)
+{
+	for (auto* user : users)
+	{
+		MemberMap::iterator it = userlist.find(user);
+		if (it != userlist.end())
+			DelUser(it, false);
+	}
+	CheckDestroy();
+}
+
 void Channel::CheckDestroy()
 {
 	if (!userlist.empty())
@@ -104,15 +233,21 @@ void Channel::CheckDestroy()
 	ServerInstance->GlobalCulls.AddItem(this);
 }
 
-void Channel::DelUser(const MemberMap::iterator& membiter)
+void Channel::DelUser(const MemberMap::iterator& membiter, bool checkdestroy)
 {
 	Membership* memb = membiter->second;
+	if (IS_LOCAL(memb->user))
+		DelLocalUser(memb);
+	else
+		CountRemoteUser(memb->user->server, memb->GetRank(), false);
+
 	memb->Cull();
 	memb->~Membership();
 	userlist.erase(membiter);
 
 	// If this channel became empty then it should be removed
-	CheckDestroy();
+	if (checkdestroy)
+		CheckDestroy();
 }
 
 Membership* Channel::GetUser(User* user) const
@@ -254,6 +389,79 @@ Membership* Channel::ForceJoin(User* user, const std::string* privs, bool bursti
 	return memb;
 }
 
+Channel::CompiledBan::CompiledBan(const std::string& banmask)
+	: mask(banmask)
+{
+	std::string::size_type at = mask.find('@');
+	if (at == std::string::npos)
+		return; // Can only be matched by modules.
+
+	prefix.assign(mask, 0, at);
+	host.assign(mask, at + 1);
+
+	if (host.find('@') != std::string::npos)
+	{
+		// InspIRCd::MatchCIDR treats this as a user@host mask.
+		type = HostType::COMPLEX;
+		return;
+	}
+
+	if (host.find_first_of("*?") != std::string::npos)
+	{
+		// If this contains a slash then it might be a CIDR range with a wildcard in the
+		// username which InspIRCd::MatchCIDR handles.
+		type = host.find('/') == std::string::npos ? HostType::WILDCARD : HostType::COMPLEX;
+		return;
+	}
+
+	// This mirrors the validation done by irc::sockets::MatchCIDR.
+	const std::string::size_type per_pos = host.rfind('/');
+	if (per_pos == std::string::npos || (per_pos != host.length() - 1
+		&& host.find_first_not_of("0123456789", per_pos + 1) == std::string::npos
+		&& host.find_first_not_of("0123456789abcdefABCDEF.:") >= per_pos))
+	{
+		cidr = irc::sockets::cidr_mask(host);
+		if (cidr.type == AF_INET || cidr.type == AF_INET6)
+		{
+			type = HostType::CIDR;
+			return;
+		}
+	}
+
+	type = HostType::EXACT;
+}
+
+void Channel::CompileBans()
+{
+	if (compiledserial == banserial)
+		return; // Already up to date.
+
+	compiledbans.clear();
+	extbans.clear();
+	compiledserial = banserial;
+
+	ListModeBase* banlm = static_cast<ListModeBase*>(*ban);
+	const ListModeBase::ModeList* bans = banlm ? banlm->GetList(this) : nullptr;
+	if (!bans)
+		return;
+
+	bool xbinverted;
+	std::string xbname;
+	std::string xbvalue;
+	for (const auto& entry : *bans)
+	{
+		if (ExtBan::Parse(entry.mask, xbname, xbvalue, xbinverted))
+			extbans.push_back(entry.mask);
+		else
+			compiledbans.emplace_back(entry.mask);
+	}
+}
+
+void Channel::InvalidateBans()
+{
+	banserial = ServerInstance->Channels.NextBanSerial();
+}
+
 bool Channel::IsBanned(User* user)
 {
 	ModResult result;
@@ -262,20 +470,83 @@ bool Channel::IsBanned(User* user)
 	if (result != MOD_RES_PASSTHRU)
 		return (result == MOD_RES_DENY);
 
-	ListModeBase* banlm = static_cast<ListModeBase*>(*ban);
-	if (!banlm)
-		return false;
+	CompileBans();
 
-	const ListModeBase::ModeList* bans = banlm->GetList(this);
-	if (bans)
+	// Extbans can depend on anything so they are checked every time.
+	for (const auto& extban : extbans)
 	{
-		for (const auto& entry : *bans)
+		if (CheckBan(user, extban))
+			return true;
+	}
+
+	// If the user is a member and neither the ban list nor the user have changed since we last
+	// checked them then we can use the cached result.
+	Membership* memb = GetUser(user);
+	if (memb && memb->banserial > std::max({ banserial, user->GetBanSerial(), ServerInstance->Channels.GetBanSerial() }))
+		return memb->banned;
+
+	bool banned = false;
+	if (!compiledbans.empty())
+	{
+		const std::string nickduser = user->nick + "!" + user->GetDisplayedUser();
+		const std::string nickruser = user->nick + "!" + user->GetRealUser();
+		for (const auto& entry : compiledbans)
 		{
-			if (CheckBan(user, entry.mask))
-				return true;
+			if (CheckBan(user, entry, nickduser, nickruser))
+			{
+				banned = true;
+				break;
+			}
 		}
 	}
-	return false;
+
+	if (memb)
+	{
+		memb->banserial = ServerInstance->Channels.NextBanSerial();
+		memb->banned = banned;
+	}
+	return banned;
+}
+
+bool Channel::CheckBan(User* user, const CompiledBan& entry, const std::string& nickduser, const std::string& nickruser)
+{
+	ModResult result;
+	FIRST_MOD_RESULT(OnCheckBan, result, (user, this, entry.mask));
+	if (result != MOD_RES_PASSTHRU)
+		return (result == MOD_RES_DENY);
+
+	if (entry.type == CompiledBan::HostType::NONE)
+		return false;
+
+	if (!InspIRCd::Match(nickduser, entry.prefix) && !InspIRCd::Match(nickruser, entry.prefix))
+	{
+		// Neither the nick!user or nick!duser.
+		return false;
+	}
+
+	switch (entry.type)
+	{
+		case CompiledBan::HostType::EXACT:
+			return irc::equals(user->GetRealHost(), entry.host) ||
+				irc::equals(user->GetDisplayedHost(), entry.host) ||
+				irc::equals(user->GetAddress(), entry.host);
+
+		case CompiledBan::HostType::CIDR:
+			return entry.cidr.match(user->client_sa) ||
+				irc::equals(user->GetRealHost(), entry.host) ||
+				irc::equals(user->GetDisplayedHost(), entry.host) ||
+				irc::equals(user->GetAddress(), entry.host);
+
+		case CompiledBan::HostType::WILDCARD:
+			return InspIRCd::Match(user->GetRealHost(), entry.host) ||
+				InspIRCd::Match(user->GetDisplayedHost(), entry.host) ||
+				InspIRCd::Match(user->GetAddress(), entry.host);
+
+		default:
+			return InspIRCd::Match(user->GetRealHost(), entry.host) ||
+				InspIRCd::Match(user->GetDisplayedHost(), entry.host) ||
+				InspIRCd::MatchCIDR(user->GetAddress(), entry.host);
+	}
 }
 
 bool Channel::CheckBan(User* user, const std::string& mask)
@@ -344,17 +615,16 @@ void Channel::Write(ClientProtocol::Event& protoev, char status, const CUList& e
 			minrank = mh->GetPrefixRank();
 	}
 
-	for (const auto& [u, memb] : userlist)
+	// The local member list is ordered by descending rank so once we find a member with a rank
+	// lower than the one we want we know no other members will match.
+	for (const auto& lm : localusers)
 	{
-		LocalUser* user = IS_LOCAL(u);
-		if ((user) && (!except_list.count(user)))
-		{
-			/* User doesn't have the status we're after */
-			if (minrank && memb->GetRank() < minrank)
-				continue;
+		if (lm.rank < minrank)
+			break;
 
+		LocalUser* user = lm.GetUser();
+		if (!except_list.count(user))
 			user->Send(protoev);
-		}
 	}
 }
 
@@ -457,10 +727,17 @@ ModeHandler::Rank Channel::GetPrefixValue(User* user) const
 
 bool Membership::SetPrefix(PrefixMode* delta_mh, bool adding)
 {
+	const ModeHandler::Rank oldrank = GetRank();
+
+	bool changed;
 	if (adding)
-		return modes.insert(delta_mh).second;
+		changed = modes.insert(delta_mh).second;
 	else
-		return modes.erase(delta_mh);
+		changed = modes.erase(delta_mh);
+
+	if (changed)
+		chan->UpdateUserRank(this, oldrank);
+	return changed;
 }
 
 void Membership::WriteNotice(const std::string& text) const
@@ -46,16 +46,22 @@ bool ClientProtocol::Serializer::HandleTag(LocalUser* user, const std::string& t
 	return true;
 }
 
-ClientProtocol::TagSelection ClientProtocol::Serializer::MakeTagWhitelist(LocalUser* user, const TagMap& tagmap)
+bool ClientProtocol::Serializer::MakeTagWhitelist(LocalUser* user, const TagMap& tagmap, bool caponly, TagSelection& tagwl)
 {
-	TagSelection tagwl;
+	bool skipped = false;
 	for (TagMap::const_iterator i = tagmap.begin(); i != tagmap.end(); ++i)
 	{
 		const MessageTagData& tagdata = i->second;
+		if (tagdata.tagprov->OnlyDependsOnCaps() != caponly)
+		{
+			skipped = true;
+			continue;
+		}
+
 		if (tagdata.tagprov->ShouldSendTag(user, tagdata))
 			tagwl.Select(tagmap, i);
 	}
-	return tagwl;
+	return skipped;
 }
 
 const ClientProtocol::SerializedMessage& ClientProtocol::Serializer::SerializeForUser(LocalUser* user, Message& msg)
@@ -65,7 +71,30 @@ const ClientProtocol::SerializedMessage& ClientProtocol::Serializer::SerializeFo
 		msg.msginit_done = true;
 		evprov.Call(&MessageTagProvider::OnPopulateTags, msg);
 	}
-	return msg.GetSerialized(Message::SerializedInfo(this, MakeTagWhitelist(user, msg.GetTags())));
+
+	// Most tags are only sent to users who have a specific set of capabilities enabled so the tags
+	// for a user can be reused for every other recipient with the same capabilities.
+	const TagMap& tags = msg.GetTags();
+	Message::CachedWhitelist* cached = msg.FindWhitelist(this, user->capfingerprint);
+	if (!cached)
+	{
+		TagSelection captags;
+		msg.hasusertags = MakeTagWhitelist(user, tags, true, captags);
+		cached = &msg.wlcache.emplace_back(this, user->capfingerprint, captags);
+		msg.lastwl = msg.wlcache.size() - 1;
+	}
+
+	if (!msg.hasusertags)
+	{
+		if (cached->serindex == SIZE_MAX)
+			cached->serindex = msg.GetSerializedIndex(Message::SerializedInfo(this, cached->tagwl));
+		return msg.serlist[cached->serindex].second;
+	}
+
+	// The message has tags like labels and batches which need to be checked for every user.
+	TagSelection tagwl = cached->tagwl;
+	MakeTagWhitelist(user, tags, false, tagwl);
+	return msg.GetSerialized(Message::SerializedInfo(this, tagwl));
 }
 
 std::string ClientProtocol::Message::EscapeTag(const std::string& value)
@@ -142,18 +171,46 @@ std::string ClientProtocol::Message::UnescapeTag(const std::string& value)
 	return ret;
 }
 
-const ClientProtocol::SerializedMessage& ClientProtocol::Message::GetSerialized(const SerializedInfo& serializeinfo) const
+ClientProtocol::Message::CachedWhitelist* ClientProtocol::Message::FindWhitelist(const Serializer* serializer, intptr_t fingerprint)
+{
+	// Recipients are often grouped by capabilities so check the most recently used whitelist first.
+	if (lastwl < wlcache.size())
+	{
+		CachedWhitelist& last = wlcache[lastwl];
+		if (last.fingerprint == fingerprint && last.serializer == serializer)
+			return &last;
+	}
+
+	for (size_t idx = 0; idx < wlcache.size(); ++idx)
+	{
+		CachedWhitelist& cached = wlcache[idx];
+		if (cached.fingerprint == fingerprint && cached.serializer == serializer)
+		{
+			lastwl = idx;
+			return &cached;
+		}
+	}
+	return nullptr;
+}
+
+size_t ClientProtocol::Message::GetSerializedIndex(const SerializedInfo& serializeinfo) const
 {
 	// First check if the serialized line they're asking for is in the cache
-	for (const auto& [info, msg] : serlist)
+	for (size_t idx = 0; idx < serlist.size(); ++idx)
 	{
-		if (info == serializeinfo)
-			return msg;
+		if (serlist[idx].first == serializeinfo)
+			return idx;
 	}
 
-	// Not cached, generate it and put it in the cache for later use
-	serlist.push_back(std::make_pair(serializeinfo, serializeinfo.serializer->Serialize(*this, serializeinfo.tagwl)));
-	return serlist.back().second;
+	// Not cached, generate it and put it in the cache for later use. The serialized message is
+	// stored in a shared buffer so every recipient's send queue can reference the same data.
+	serlist.emplace_back(serializeinfo, serializeinfo.serializer->Serialize(*this, serializeinfo.tagwl));
+	return serlist.size() - 1;
+}
+
+const ClientProtocol::SerializedMessage& ClientProtocol::Message::GetSerialized(const SerializedInfo& serializeinfo) const
+{
+	return serlist[GetSerializedIndex(serializeinfo)].second;
 }
 
 void ClientProtocol::Event::GetMessagesForUser(LocalUser* user, MessageList& messagelist)
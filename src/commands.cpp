@@ -295,12 +295,31 @@ void CommandParser::ProcessCommand(LocalUser* user, std::string& command, Comman
 		/*
 		 * WARNING: be careful, the user may be deleted soon
 		 */
+		const uint64_t start = Latency::enabled ? Latency::Now() : 0;
+		const unsigned int suspended = user->suspended;
 		CmdResult result = handler->Handle(user, command_p);
+		if (start)
+			ServerInstance->Latency.RecordCommand(handler->name, Latency::Now() - start);
+
+		if (user->suspended > suspended)
+		{
+			// The handler is waiting for an asynchronous operation so the result is not known
+			// yet. The post-command hooks will be run when it calls ResumeCommand.
+			FOREACH_MOD(OnCommandSuspended, (handler, command_p, user));
+			return;
+		}
 
 		FOREACH_MOD(OnPostCommand, (handler, command_p, user, result, false));
 	}
 }
 
+void CommandParser::ResumeCommand(Command* handler, const CommandBase::Params& parameters, LocalUser* user, const std::function<CmdResult()>& continuation)
+{
+	FOREACH_MOD(OnCommandResumed, (handler, parameters, user));
+	CmdResult result = continuation();
+	FOREACH_MOD(OnPostCommand, (handler, parameters, user, result, false));
+}
+
 void CommandParser::RemoveCommand(Command* x)
 {
 	CommandMap::iterator n = cmdlist.find(x->name);
@@ -308,7 +327,7 @@ void CommandParser::RemoveCommand(Command* x)
 		cmdlist.erase(n);
 }
 
-void CommandParser::ProcessBuffer(LocalUser* user, const std::string& buffer)
+void CommandParser::ProcessBuffer(LocalUser* user, const std::string_view& buffer)
 {
 	ClientProtocol::ParseOutput parseoutput;
 	if (!user->serializer->Parse(user, buffer, parseoutput))
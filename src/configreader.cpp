@@ -391,10 +391,12 @@ void ServerConfig::Fill()
 
 	// Read the <performance> config.
 	const auto& performance = ConfValue("performance");
+	LatencyStats = performance->getBool("latencystats");
 	MaxConn = performance->getNum<int>("somaxconn", SOMAXCONN, 1);
 	NetBufferSize = performance->getNum<size_t>("netbuffersize", 10240, 1024, 65534);
 	SoftLimit = performance->getNum<size_t>("softlimit", (SocketEngine::GetMaxFds() > 0 ? SocketEngine::GetMaxFds() : SIZE_MAX), 10);
 	TimeSkipWarn = performance->getDuration("timeskipwarn", 2, 0, 30);
+	WorkerThreads = performance->getNum<size_t>("workerthreads", 2, 1, 64);
 
 	// Read the <security> config.
 	const auto& security = ConfValue("security");
@@ -757,6 +759,7 @@ void ConfigReaderThread::OnStop()
 		 * thoroughly!!!
 		 */
 		ServerInstance->Users.RehashCloneCounts();
+		ServerInstance->Latency.SetEnabled(Config->LatencyStats);
 
 		auto* user = ServerInstance->Users.FindUUID(UUID);
 		ConfigStatus status(user);
@@ -777,6 +780,9 @@ void ConfigReaderThread::OnStop()
 			}
 		}
 
+		// Modules may match bans differently with the new configuration.
+		ServerInstance->Channels.InvalidateBans();
+
 		// The description of this server may have changed - update it for WHOIS etc.
 		ServerInstance->FakeClient->server->description = Config->ServerDesc;
 		ServerInstance->Users.RehashServices();
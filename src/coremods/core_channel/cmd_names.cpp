@@ -36,6 +36,7 @@ CommandNames::CommandNames(Module* parent)
 	, privatemode(parent, "private")
 	, invisiblemode(parent, "invisible")
 	, namesevprov(parent, "event/names")
+	, namescache(parent, "names-cache", ExtensionType::CHANNEL)
 {
 	syntax = { "[<channel>[,<channel>]+]" };
 }
@@ -73,6 +74,24 @@ CmdResult CommandNames::HandleLocal(LocalUser* user, const Params& parameters)
 	return c ? CmdResult::SUCCESS : CmdResult::FAILURE;
 }
 
+bool CommandNames::GetNamesItem(LocalUser* user, Membership* memb, bool show_invisible, std::string& prefixlist, std::string& nick)
+{
+	if ((!show_invisible) && (memb->user->IsModeSet(invisiblemode)))
+	{
+		// Member is invisible and we are not supposed to show them
+		return false;
+	}
+
+	prefixlist.clear();
+	char prefix = memb->GetPrefixChar();
+	if (prefix)
+		prefixlist.push_back(prefix);
+	nick = memb->user->nick;
+
+	ModResult res = namesevprov.FirstResult(&Names::EventListener::OnNamesListItem, user, memb, prefixlist, nick);
+	return res != MOD_RES_DENY;
+}
+
 void CommandNames::SendNames(LocalUser* user, Channel* chan, bool show_invisible)
 {
 	Numeric::Builder<' '> reply(user, RPL_NAMREPLY, false, chan->name.size() + 3);
@@ -87,26 +106,89 @@ void CommandNames::SendNames(LocalUser* user, Channel* chan, bool show_invisible
 	numeric.push(chan->name);
 	numeric.push(std::string());
 
-	std::string prefixlist;
-	std::string nick;
-	for (const auto& [u, memb] : chan->GetUsers())
+	// Large channels have their NAMES list cached if every module which modifies it
+	// can tell us which variant of it this user should receive.
+	if (cachethreshold && chan->GetUsers().size() >= cachethreshold && user->nick.size() <= ServerInstance->Config->Limits.MaxNick)
 	{
-		if ((!show_invisible) && (u->IsModeSet(invisiblemode)))
+		std::string variant(show_invisible ? "invisible;" : "");
+		ModResult res = namesevprov.FirstResult(&Names::EventListener::OnNamesListVariant, user, chan, variant);
+		if (res != MOD_RES_DENY)
 		{
-			// Member is invisible and we are not supposed to show them
-			continue;
+			SendCachedNames(user, chan, numeric, variant, show_invisible);
+			return;
 		}
+	}
 
-		prefixlist.clear();
-		char prefix = memb->GetPrefixChar();
-		if (prefix)
-			prefixlist.push_back(prefix);
-		nick = u->nick;
-
-		ModResult res = namesevprov.FirstResult(&Names::EventListener::OnNamesListItem, user, memb, prefixlist, nick);
-		if (res != MOD_RES_DENY)
+	std::string prefixlist;
+	std::string nick;
+	for (const auto& [_, memb] : chan->GetUsers())
+	{
+		if (GetNamesItem(user, memb, show_invisible, prefixlist, nick))
 			reply.Add(prefixlist, nick);
 	}
 
 	reply.Flush();
 }
+
+void CommandNames::SendCachedNames(LocalUser* user, Channel* chan, Numeric::Numeric& numeric, const std::string& variant, bool show_invisible)
+{
+	NamesCache& cache = namescache.GetRef(chan);
+	auto it = std::find_if(cache.begin(), cache.end(), [&variant](const CachedVariant& cv) {
+		return cv.variant == variant;
+	});
+
+	if (it == cache.end())
+	{
+		// This variant has not been built yet so treat every member as pending.
+		it = cache.emplace(cache.end());
+		it->variant = variant;
+		it->pending.reserve(chan->GetUsers().size());
+		for (const auto& [_, memb] : chan->GetUsers())
+			it->pending.push_back(memb);
+	}
+
+	if (!it->pending.empty())
+	{
+		// The lines are built to fit the longest possible nick so they can be sent to anyone.
+		const size_t maxlength = ServerInstance->Config->Limits.MaxLine - ServerInstance->Config->GetServerName().size()
+			- ServerInstance->Config->Limits.MaxNick - chan->name.size() - 13;
+
+		std::string prefixlist;
+		std::string nick;
+		for (auto* memb : it->pending)
+		{
+			if (!GetNamesItem(user, memb, show_invisible, prefixlist, nick))
+				continue;
+
+			const size_t itemlength = prefixlist.size() + nick.size();
+			if (it->lines.empty() || it->lines.back().size() + itemlength + 1 > maxlength)
+				it->lines.emplace_back().reserve(maxlength);
+			else
+				it->lines.back().push_back(' ');
+			it->lines.back().append(prefixlist).append(nick);
+		}
+		it->pending.clear();
+	}
+
+	for (const auto& line : it->lines)
+	{
+		numeric.GetParams().back() = line;
+		user->WriteNumeric(numeric);
+	}
+}
+
+void CommandNames::AddToNamesCache(Membership* memb)
+{
+	NamesCache* cache = namescache.Get(memb->chan);
+	if (!cache)
+		return;
+
+	for (auto& cv : *cache)
+		cv.pending.push_back(memb);
+}
+
+void CommandNames::InvalidateNamesCache(User* user)
+{
+	for (const auto* memb : user->chans)
+		namescache.Unset(memb->chan);
+}
@@ -128,6 +128,7 @@ class CoreModChannel final
 
 	insp::flat_map<std::string, char> exemptions;
 	ExtBanManager extbanmgr;
+	UserModeReference invisiblemode;
 
 	ModResult IsInvited(User* user, Channel* chan)
 	{
@@ -162,6 +163,7 @@ public:
 		, topiclockmode(this, "topiclock", 't')
 		, voicemode(this)
 		, extbanmgr(this, banmode)
+		, invisiblemode(this, "invisible")
 	{
 	}
 
@@ -209,6 +211,9 @@ public:
 		invapi.announceinvites = newannouncestate;
 		joinhook.modefromuser = optionstag->getBool("cyclehostsfromuser");
 
+		const auto& performancetag = ServerInstance->Config->ConfValue("performance");
+		cmdnames.cachethreshold = performancetag->getNum<size_t>("namescache", 500);
+
 		Implementation events[] = { I_OnCheckKey, I_OnCheckLimit, I_OnCheckChannelBan };
 		if (optionstag->getBool("invitebypassmodes", true))
 			ServerInstance->Modules.Attach(events, this, sizeof(events)/sizeof(Implementation));
@@ -316,6 +321,63 @@ public:
 		return MOD_RES_PASSTHRU;
 	}
 
+	void OnUserJoin(Membership* memb, bool sync, bool created, CUList& except_list) override
+	{
+		cmdnames.AddToNamesCache(memb);
+	}
+
+	void OnUserPart(Membership* memb, std::string& partmessage, CUList& except_list) override
+	{
+		cmdnames.InvalidateNamesCache(memb->chan);
+	}
+
+	void OnUserKick(User* source, Membership* memb, const std::string& reason, CUList& except_list) override
+	{
+		cmdnames.InvalidateNamesCache(memb->chan);
+	}
+
+	void OnUserQuit(User* user, const std::string& message, const std::string& oper_message) override
+	{
+		cmdnames.InvalidateNamesCache(user);
+	}
+
+	void OnUserPostNick(User* user, const std::string& oldnick) override
+	{
+		cmdnames.InvalidateNamesCache(user);
+	}
+
+	void OnChangeHost(User* user, const std::string& newhost) override
+	{
+		// The displayed host is shown by userhost-in-names.
+		cmdnames.InvalidateNamesCache(user);
+	}
+
+	void OnChangeUser(User* user, const std::string& newuser) override
+	{
+		// The displayed username is shown by userhost-in-names.
+		cmdnames.InvalidateNamesCache(user);
+	}
+
+	void OnMode(User* user, User* usertarget, Channel* chantarget, const Modes::ChangeList& changelist, ModeParser::ModeProcessFlag processflags) override
+	{
+		for (const auto& change : changelist.getlist())
+		{
+			if (chantarget && change.mh->IsPrefixMode())
+			{
+				// Prefix changes alter the NAMES entry of the member.
+				cmdnames.InvalidateNamesCache(chantarget);
+				break;
+			}
+
+			if (usertarget && change.mh == *invisiblemode)
+			{
+				// Invisible (+i) users are hidden from some NAMES lists.
+				cmdnames.InvalidateNamesCache(usertarget);
+				break;
+			}
+		}
+	}
+
 	void OnPostJoin(Membership* memb) override
 	{
 		Channel* const chan = memb->chan;
@@ -79,16 +79,70 @@ class CommandNames final
 	: public SplitCommand
 {
 private:
+	/** A NAMES list which is shared by all users who receive the same variant of it. */
+	struct CachedVariant final
+	{
+		/** The variant string which was built by the Names::EventListener::OnNamesListVariant event. */
+		std::string variant;
+
+		/** The member lists which are sent in each RPL_NAMREPLY numeric. */
+		std::vector<std::string> lines;
+
+		/** The members which have joined since the lines were built. */
+		std::vector<Membership*> pending;
+	};
+
+	/** The cached NAMES lists of a channel. */
+	typedef std::vector<CachedVariant> NamesCache;
+
 	ChanModeReference secretmode;
 	ChanModeReference privatemode;
 	UserModeReference invisiblemode;
 	Events::ModuleEventProvider namesevprov;
+	SimpleExtItem<NamesCache> namescache;
+
+	/** Determines how a member should be shown in the NAMES list sent to a user.
+	 * @param user The user who the NAMES list is being sent to.
+	 * @param memb The member to show.
+	 * @param show_invisible Whether to show invisible (+i) members.
+	 * @param prefixlist The prefixes to show before the nick of the member.
+	 * @param nick The nick to show for the member.
+	 * @return True if the member should be shown; otherwise, false.
+	 */
+	bool GetNamesItem(LocalUser* user, Membership* memb, bool show_invisible, std::string& prefixlist, std::string& nick);
+
+	/** Sends the NAMES list of a channel to a user from the cache, updating it first if needed.
+	 * @param user The user to send the NAMES list to.
+	 * @param chan The channel whose NAMES list to send.
+	 * @param numeric A RPL_NAMREPLY numeric with the channel type and name already added.
+	 * @param variant The variant of the NAMES list to send.
+	 * @param show_invisible Whether to show invisible (+i) members.
+	 */
+	void SendCachedNames(LocalUser* user, Channel* chan, Numeric::Numeric& numeric, const std::string& variant, bool show_invisible);
 
 public:
+	/** The minimum number of members a channel must have for its NAMES list to be cached or 0 to disable caching. */
+	size_t cachethreshold;
+
 	CommandNames(Module* parent);
 
 	CmdResult HandleLocal(LocalUser* user, const Params& parameters) override;
 
+	/** Adds a new member to the cached NAMES lists of their channel.
+	 * @param memb The member who joined.
+	 */
+	void AddToNamesCache(Membership* memb);
+
+	/** Discards the cached NAMES lists of a channel.
+	 * @param chan The channel whose NAMES lists have changed.
+	 */
+	void InvalidateNamesCache(Channel* chan) { namescache.Unset(chan); }
+
+	/** Discards the cached NAMES lists of every channel a user is in.
+	 * @param user The user whose NAMES entry has changed.
+	 */
+	void InvalidateNamesCache(User* user);
+
 	/** Spool the NAMES list for a given channel to the given user
 	 * @param user User to spool the NAMES list to
 	 * @param chan Channel whose nicklist to send
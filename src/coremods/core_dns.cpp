@@ -130,6 +130,13 @@ private:
 		return name;
 	}
 
+	/** Determines whether the specified name is in the in-addr.arpa or ip6.arpa domain. */
+	static bool IsReverseName(const std::string_view& name)
+	{
+		static constexpr std::string_view suffix = ".arpa";
+		return name.length() > suffix.length() && irc::equals(name.substr(name.length() - suffix.length()), suffix);
+	}
+
 	DNS::Question UnpackQuestion(const unsigned char* input, unsigned short input_size, unsigned short& pos)
 	{
 		DNS::Question q;
@@ -200,6 +207,21 @@ private:
 
 				break;
 			}
+			case DNS::QUERY_SOA:
+			{
+				if (rdlength < 22 || pos + rdlength > input_size)
+					throw DNS::Exception(creator, "Unable to unpack SOA resource record");
+
+				// A negative response may be cached for the lower of the TTL of the SOA
+				// record and its MINIMUM field which is the last field of the record.
+				const unsigned short endpos = pos + rdlength;
+				const unsigned int minimum = (input[endpos - 4] << 24) | (input[endpos - 3] << 16) | (input[endpos - 2] << 8) | input[endpos - 1];
+				record.ttl = std::min(record.ttl, minimum);
+
+				record.rdata = this->UnpackName(input, input_size, pos);
+				pos = endpos;
+				break;
+			}
 			case DNS::QUERY_TXT:
 			{
 				if (pos + rdlength > input_size)
@@ -264,6 +286,9 @@ public:
 	/* Flags on the packet */
 	unsigned short flags = 0;
 
+	/* How long a negative response can be cached for or 0 if it can not be cached */
+	unsigned int negative_ttl = 0;
+
 	Packet(const Module* mod)
 		: creator(mod)
 	{
@@ -304,6 +329,23 @@ public:
 
 		for (unsigned i = 0; i < ancount; ++i)
 			this->answers.push_back(this->UnpackResourceRecord(input, len, packet_pos));
+
+		// The authority section is only used for caching negative responses (RFC 2308)
+		// so a malformed record in it should not invalidate the rest of the response.
+		try
+		{
+			for (unsigned i = 0; i < nscount; ++i)
+			{
+				const auto record = this->UnpackResourceRecord(input, len, packet_pos);
+				if (record.type == DNS::QUERY_SOA)
+					this->negative_ttl = record.ttl;
+			}
+		}
+		catch (const DNS::Exception& ex)
+		{
+			ServerInstance->Logs.Debug(MODNAME, "Unable to unpack authority section: {}", ex.GetReason());
+			this->negative_ttl = 0;
+		}
 	}
 
 	unsigned short Pack(unsigned char* output, unsigned short output_size)
@@ -329,7 +371,8 @@ public:
 		{
 			auto& q = this->question;
 
-			if (q.type == DNS::QUERY_PTR)
+			// Requests which are refreshing a cached PTR result have already been rewritten.
+			if (q.type == DNS::QUERY_PTR && !IsReverseName(q.name))
 			{
 				irc::sockets::sockaddrs ip(false);
 				if (!ip.from_ip(q.name))
@@ -380,25 +423,109 @@ public:
 	}
 };
 
+/** Refreshes a popular cache entry before it expires. The result is added to the cache
+ * by the manager in the same way as any other response.
+ */
+class PrefetchRequest final
+	: public DNS::Request
+{
+public:
+	PrefetchRequest(DNS::Manager* mgr, Module* mod, const DNS::Question& q)
+		: DNS::Request(mgr, mod, q.name, q.type, false)
+	{
+	}
+
+	void OnLookupComplete(const DNS::Query* req) override
+	{
+	}
+};
+
 class MyManager final
 	: public DNS::Manager
 	, public Timer
 	, public EventHandler
 {
-	typedef std::unordered_map<DNS::Question, DNS::Query, DNS::Question::hash> cache_map;
-	cache_map cache;
+	struct CacheEntry final
+	{
+		/** The cached response. If error is set then this is a negative entry. */
+		DNS::Query query;
+
+		/** The time at which this entry expires. */
+		time_t expires;
+
+		/** The TTL that this entry was cached with. */
+		unsigned long ttl;
+
+		/** The number of times this entry has been used since it was cached. */
+		unsigned long hits = 0;
+
+		/** Whether a request to refresh this entry has been sent. */
+		bool prefetching = false;
+
+		CacheEntry(const DNS::Query& q, unsigned long t)
+			: query(q)
+			, expires(ServerInstance->Time() + static_cast<time_t>(t))
+			, ttl(t)
+		{
+		}
+	};
+
+	/** Cache entries ordered from most to least recently used. */
+	typedef std::list<CacheEntry> cache_list;
+	cache_list cache;
+
+	/** Maps a question to its entry in the cache. */
+	typedef std::unordered_map<DNS::Question, cache_list::iterator, DNS::Question::hash> cache_map;
+	cache_map cachemap;
 
 	irc::sockets::sockaddrs myserver;
 	bool unloading = false;
 
-	/** Maximum number of entries in cache
+	/** The minimum number of times an entry must be used before it is prefetched. */
+	static constexpr unsigned long PREFETCH_HITS = 2;
+
+	static bool IsExpired(const CacheEntry& entry)
+	{
+		return entry.expires <= ServerInstance->Time();
+	}
+
+	/** Removes an entry from the cache.
+	 * @param it The entry to remove.
 	 */
-	static constexpr unsigned int MAX_CACHE_SIZE = 1000;
+	void RemoveCache(cache_list::iterator it)
+	{
+		cachemap.erase(it->query.question);
+		cache.erase(it);
+	}
 
-	static bool IsExpired(const DNS::Query& record)
+	/** Removes the least recently used entries until the cache fits within the maximum size. */
+	void TrimCache(size_t maxsize)
 	{
-		const auto& req = record.answers[0];
-		return (req.created + static_cast<time_t>(req.ttl) < ServerInstance->Time());
+		while (cache.size() > maxsize)
+		{
+			stats_evicted++;
+			RemoveCache(std::prev(cache.end()));
+		}
+	}
+
+	/** Sends a request to refresh a cache entry which is about to expire.
+	 * @param entry The entry to refresh.
+	 */
+	void Prefetch(CacheEntry& entry)
+	{
+		entry.prefetching = true;
+		auto* req = new PrefetchRequest(this, creator, entry.query.question);
+		try
+		{
+			ServerInstance->Logs.Debug(MODNAME, "cache: Prefetching {}", entry.query.question.name);
+			this->Process(req);
+			stats_prefetch++;
+		}
+		catch (const DNS::Exception& ex)
+		{
+			ServerInstance->Logs.Debug(MODNAME, "cache: Unable to prefetch {}: {}", entry.query.question.name, ex.GetReason());
+			delete req;
+		}
 	}
 
 	/** Check the DNS cache to see if request can be handled by a cached result
@@ -408,31 +535,65 @@ class MyManager final
 	{
 		ServerInstance->Logs.Debug(MODNAME, "cache: Checking cache for {}", question.name);
 
-		cache_map::iterator it = this->cache.find(question);
-		if (it == this->cache.end())
+		cache_map::iterator it = this->cachemap.find(question);
+		if (it == this->cachemap.end())
+		{
+			stats_miss++;
 			return false;
+		}
 
-		auto& record = it->second;
-		if (IsExpired(record))
+		auto entry = it->second;
+		if (IsExpired(*entry))
 		{
-			this->cache.erase(it);
+			stats_miss++;
+			RemoveCache(entry);
 			return false;
 		}
 
+		// Move the entry to the front of the list so it is evicted last.
+		cache.splice(cache.begin(), cache, entry);
+		entry->hits++;
+		stats_hit++;
+
+		// Refresh popular entries when they are in the last tenth of their lifetime
+		// so that they do not drop out of the cache while they are still in use.
+		const auto remaining = static_cast<unsigned long>(entry->expires - ServerInstance->Time());
+		if (!entry->prefetching && !entry->query.error && entry->hits >= PREFETCH_HITS && remaining <= entry->ttl / 10)
+			Prefetch(*entry);
+
 		ServerInstance->Logs.Debug(MODNAME, "cache: Using cached result for {}", question.name);
+		auto& record = entry->query;
 		record.cached = true;
-		req->OnLookupComplete(&record);
+		if (record.error)
+			req->OnError(&record);
+		else
+			req->OnLookupComplete(&record);
 		return true;
 	}
 
-	/** Add a record to the dns cache
-	 * @param r The record
+	/** Inserts a response into the dns cache, replacing any existing entry for the same question.
+	 * @param r The response
+	 * @param ttl The time to cache the response for.
 	 */
-	void AddCache(DNS::Query& r)
+	void InsertCache(const DNS::Query& r, unsigned long ttl)
 	{
-		if (cache.size() >= MAX_CACHE_SIZE)
-			cache.clear();
+		cache_map::iterator it = cachemap.find(r.question);
+		if (it != cachemap.end())
+			RemoveCache(it->second);
+
+		if (!ttl || !cachesize)
+			return;
+
+		TrimCache(cachesize - 1);
+		cache.emplace_front(r, ttl);
+		cachemap[r.question] = cache.begin();
+	}
 
+	/** Add a successful response to the dns cache
+	 * @param r The response
+	 */
+	void AddCache(DNS::Query& r)
+	{
 		// Determine the lowest TTL value and use that as the TTL of the cache entry
 		unsigned int cachettl = UINT_MAX;
 		for (const auto& rr : r.answers)
@@ -441,12 +602,26 @@ class MyManager final
 				cachettl = rr.ttl;
 		}
 
-		cachettl = std::min<unsigned int>(cachettl, 5*60);
+		cachettl = static_cast<unsigned int>(std::min<unsigned long>(cachettl, maxttl));
 		auto& rr = r.answers.front();
 		// Set TTL to what we've determined to be the lowest
 		rr.ttl = cachettl;
 		ServerInstance->Logs.Debug(MODNAME, "cache: added cache for {} -> {} ttl: {}", rr.name, rr.rdata, rr.ttl);
-		this->cache[r.question] = r;
+		InsertCache(r, cachettl);
+	}
+
+	/** Add a negative response to the dns cache
+	 * @param p The response
+	 */
+	void AddNegativeCache(const Packet& p)
+	{
+		// RFC 2308 section 5: negative responses without an SOA record must not be cached.
+		const unsigned long cachettl = std::min<unsigned long>(p.negative_ttl, negativettl);
+		ServerInstance->Logs.Debug(MODNAME, "cache: added negative cache for {} ttl: {}", p.question.name, cachettl);
+
+		DNS::Query query(p.question);
+		query.error = p.error;
+		InsertCache(query, cachettl);
 	}
 
 public:
@@ -454,8 +629,21 @@ public:
 	size_t stats_total = 0;
 	size_t stats_success = 0;
 	size_t stats_failure = 0;
+	size_t stats_hit = 0;
+	size_t stats_miss = 0;
+	size_t stats_prefetch = 0;
+	size_t stats_evicted = 0;
 	unsigned long timeout = 0;
 
+	/** The maximum number of entries in the cache. */
+	size_t cachesize = 0;
+
+	/** The maximum time to cache a successful response for. */
+	unsigned long maxttl = 0;
+
+	/** The maximum time to cache a negative response for. */
+	unsigned long negativettl = 0;
+
 	MyManager(Module* c)
 		: Manager(c)
 		, Timer(5*60, true)
@@ -496,6 +684,31 @@ public:
 
 		// Remove all entries from the cache.
 		cache.clear();
+		cachemap.clear();
+	}
+
+	/** Retrieves the number of entries in the cache. */
+	size_t GetCacheSize() const { return cache.size(); }
+
+	/** Retrieves the number of negative entries in the cache. */
+	size_t GetNegativeCacheSize() const
+	{
+		size_t count = 0;
+		for (const auto& entry : cache)
+		{
+			if (entry.query.error)
+				count++;
+		}
+		return count;
+	}
+
+	/** Sets the maximum number of entries in the cache, evicting any which no longer fit.
+	 * @param size The new maximum number of entries.
+	 */
+	void SetCacheSize(size_t size)
+	{
+		cachesize = size;
+		TrimCache(cachesize);
 	}
 
 	unsigned long GetDefaultTimeout() const override
@@ -626,6 +839,8 @@ public:
 				return "AAAA";
 			case DNS::QUERY_CNAME:
 				return "CNAME";
+			case DNS::QUERY_SOA:
+				return "SOA";
 			case DNS::QUERY_PTR:
 				return "PTR";
 			case DNS::QUERY_TXT:
@@ -736,6 +951,8 @@ public:
 			this->stats_failure++;
 			recv_packet.error = error;
 			request->OnError(&recv_packet);
+			if (error == DNS::ERROR_DOMAIN_NOT_FOUND)
+				this->AddNegativeCache(recv_packet);
 		}
 		else if (recv_packet.answers.empty())
 		{
@@ -743,6 +960,7 @@ public:
 			this->stats_failure++;
 			recv_packet.error = DNS::ERROR_NO_RECORDS;
 			request->OnError(&recv_packet);
+			this->AddNegativeCache(recv_packet);
 		}
 		else
 		{
@@ -761,13 +979,12 @@ public:
 	bool Tick() override
 	{
 		unsigned long expired = 0;
-		for (cache_map::iterator it = this->cache.begin(); it != this->cache.end(); )
+		for (cache_list::iterator it = this->cache.begin(); it != this->cache.end(); )
 		{
-			const auto& query = it->second;
-			if (IsExpired(query))
+			if (IsExpired(*it))
 			{
 				expired++;
-				this->cache.erase(it++);
+				RemoveCache(it++);
 			}
 			else
 				++it;
@@ -935,6 +1152,9 @@ public:
 			this->manager.Rehash(DNSServer, SourceIP, SourcePort);
 
 		this->manager.timeout = tag->getDuration("timeout", 10, 1);
+		this->manager.maxttl = tag->getDuration("cachettl", 60*60);
+		this->manager.negativettl = tag->getDuration("negativettl", 5*60);
+		this->manager.SetCacheSize(tag->getNum<size_t>("cachesize", 10000));
 	}
 
 	ModResult OnStats(Stats::Context& stats) override
@@ -943,6 +1163,9 @@ public:
 		{
 			stats.AddGenericRow(INSP_FORMAT("DNS requests: {} ({} succeeded, {} failed)",
 				manager.stats_total, manager.stats_success, manager.stats_failure));
+			stats.AddGenericRow(INSP_FORMAT("DNS cache: {} entries ({} negative), {} hits, {} misses, {} prefetched, {} evicted",
+				manager.GetCacheSize(), manager.GetNegativeCacheSize(), manager.stats_hit, manager.stats_miss,
+				manager.stats_prefetch, manager.stats_evicted));
 		}
 		return MOD_RES_PASSTHRU;
 	}
@@ -35,13 +35,137 @@ enum class ShowModes
 	ALL,
 };
 
+/** The details of a channel which are needed to respond to a LIST request. */
+struct ListEntry final
+{
+	/** The name of the channel. */
+	std::string name;
+
+	/** The topic of the channel. */
+	std::string topic;
+
+	/** The time at which the channel was created. */
+	time_t age;
+
+	/** The time at which the topic of the channel was set. */
+	time_t topicset;
+
+	/** The number of users in the channel. */
+	size_t users;
+};
+
+/** A snapshot of all of the channels on the network sorted by name. This is shared by all in
+ * progress LIST requests so memory usage does not depend on how many users are listing.
+ */
+struct ListSnapshot final
+{
+	/** The time at which this snapshot was created. */
+	time_t created;
+
+	/** The channels which existed when this snapshot was created. */
+	std::vector<ListEntry> entries;
+};
+
+/** The state of a LIST request which is being sent to a user as their sendq drains. */
+struct ListCursor final
+{
+	/** The snapshot that is being listed. */
+	std::shared_ptr<const ListSnapshot> snapshot;
+
+	/** The position of the next entry within the snapshot. */
+	size_t position = 0;
+
+	// C: Searching based on creation time, via the "C<val" and "C>val" modifiers
+	// to search for a channel creation time that is lower or higher than val
+	// respectively.
+	std::optional<time_t> mincreationtime;
+	std::optional<time_t> maxcreationtime;
+
+	// M: Searching based on mask.
+	std::string match;
+
+	// N: Searching based on !mask.
+	std::string notmatch;
+
+	// T: Searching based on topic time, via the "T<val" and "T>val" modifiers to
+	// search for a topic time that is lower or higher than val respectively.
+	std::optional<time_t> mintopictime;
+	std::optional<time_t> maxtopictime;
+
+	// U: Searching based on user count within the channel, via the "<val" and
+	// ">val" modifiers to search for a channel that has less than or more than
+	// val users respectively.
+	size_t minusers = 0;
+	size_t maxusers = 0;
+
+	/** Whether the user can see secret and private channels. */
+	bool has_privs;
+
+	/** Whether to show channel modes to the user. */
+	bool show_modes;
+
+	/** Determines whether the specified entry matches the search constraints of this request.
+	 * @param entry The entry to check.
+	 * @return True if the entry matches; otherwise, false.
+	 */
+	bool Matches(const ListEntry& entry) const
+	{
+		// Check the user count if a search has been specified.
+		if ((minusers && entry.users <= minusers) || (maxusers && entry.users >= maxusers))
+			return false;
+
+		// Check the creation ts if a search has been specified.
+		if ((mincreationtime && entry.age <= *mincreationtime) || (maxcreationtime && entry.age >= *maxcreationtime))
+			return false;
+
+		// Check the topic ts if a search has been specified.
+		if ((mintopictime && (!entry.topicset || entry.topicset <= *mintopictime)) || (maxtopictime && (!entry.topicset || entry.topicset >= *maxtopictime)))
+			return false;
+
+		// Attempt to match a glob pattern.
+		if (!match.empty() && !InspIRCd::Match(entry.name, match) && !InspIRCd::Match(entry.topic, match))
+			return false;
+
+		// Attempt to match an inverted glob pattern.
+		if (!notmatch.empty() && (InspIRCd::Match(entry.name, notmatch) || InspIRCd::Match(entry.topic, notmatch)))
+			return false;
+
+		return true;
+	}
+};
+
+class CommandList;
+
+/** Resumes in progress LIST requests as the sendq of the listing users drains. */
+class ListTimer final
+	: public Timer
+{
+private:
+	CommandList& cmd;
+
+public:
+	ListTimer(CommandList& list)
+		: Timer(std::chrono::milliseconds(100), false)
+		, cmd(list)
+	{
+	}
+
+	bool Tick() override;
+};
+
 class CommandList final
-	: public Command
+	: public SplitCommand
 {
 private:
 	ChanModeReference secretmode;
 	ChanModeReference privatemode;
 
+	/** The most recently created channel snapshot. */
+	std::shared_ptr<const ListSnapshot> snapshot;
+
+	/** Resumes LIST requests which did not fit in the sendq of the user. */
+	ListTimer timer;
+
 	/** Parses the creation time or topic set time out of a LIST parameter.
 	 * @param value The parameter containing a minute count.
 	 * @return The UNIX time at \p value minutes ago.
@@ -54,46 +178,138 @@ private:
 		return ServerInstance->Time() - (minutes * 60);
 	}
 
+	/** Retrieves the current channel snapshot, rebuilding it if it has expired. */
+	std::shared_ptr<const ListSnapshot> GetSnapshot()
+	{
+		if (snapshot && snapshot->created + snapshotinterval > ServerInstance->Time())
+			return snapshot;
+
+		auto newsnapshot = std::make_shared<ListSnapshot>();
+		newsnapshot->created = ServerInstance->Time();
+		newsnapshot->entries.reserve(ServerInstance->Channels.GetChans().size());
+		for (const auto& [_, chan] : ServerInstance->Channels.GetChans())
+		{
+			newsnapshot->entries.push_back({
+				chan->name,
+				chan->topic,
+				chan->age,
+				chan->topicset,
+				chan->GetUsers().size(),
+			});
+		}
+		std::sort(newsnapshot->entries.begin(), newsnapshot->entries.end(), [](const ListEntry& lhs, const ListEntry& rhs) {
+			return irc::insensitive_swo()(lhs.name, rhs.name);
+		});
+
+		snapshot = newsnapshot;
+		return snapshot;
+	}
+
+	/** Sends a single LIST reply to a user.
+	 * @param user The user to send the reply to.
+	 * @param cursor The request that is being sent.
+	 * @param entry The channel to send.
+	 */
+	void SendEntry(LocalUser* user, const ListCursor& cursor, const ListEntry& entry)
+	{
+		// Unprivileged users and channel modes need the current state of the channel as it may
+		// have become secret or private since the snapshot was created.
+		Channel* chan = nullptr;
+		bool n = cursor.has_privs;
+		if (!n || cursor.show_modes)
+		{
+			chan = ServerInstance->Channels.Find(entry.name);
+			if (!chan)
+				return; // Channel has been destroyed since the snapshot was created.
+
+			// if the channel is not private/secret, OR the user is on the channel anyway
+			n = n || chan->HasUser(user);
+		}
+
+		// If we're not in the channel and +s is set on it, we want to ignore it
+		if (!n && chan->IsModeSet(secretmode))
+			return;
+
+		if (!n && chan->IsModeSet(privatemode))
+		{
+			// Channel is private (+p) and user is outside/not privileged
+			user->WriteNumeric(RPL_LIST, '*', entry.users, "");
+		}
+		else if (cursor.show_modes)
+		{
+			// Show the list response with the modes and topic.
+			user->WriteNumeric(RPL_LIST, entry.name, entry.users, INSP_FORMAT("[+{}] {}", chan->ChanModes(n), entry.topic));
+		}
+		else
+		{
+			// Show the list response with just the topic.
+			user->WriteNumeric(RPL_LIST, entry.name, entry.users, entry.topic);
+		}
+	}
+
 public:
+	/** The LIST requests which are currently being sent. */
+	std::unordered_map<LocalUser*, ListCursor> cursors;
+
 	// Whether to show modes in the LIST response.
 	ShowModes showmodes;
 
+	/** The number of seconds after which the channel snapshot is rebuilt. */
+	time_t snapshotinterval;
+
 	CommandList(Module* parent)
-		: Command(parent, "LIST")
+		: SplitCommand(parent, "LIST")
 		, secretmode(creator, "secret")
 		, privatemode(creator, "private")
+		, timer(*this)
 	{
 		penalty = 5000;
 	}
 
-	CmdResult Handle(User* user, const Params& parameters) override;
-};
+	/** Sends LIST replies to a user until their sendq is full or the request is complete.
+	 * @param user The user to send replies to.
+	 * @param cursor The request that is being sent.
+	 * @return True if the request is complete; otherwise, false.
+	 */
+	bool Resume(LocalUser* user, ListCursor& cursor)
+	{
+		const auto& entries = cursor.snapshot->entries;
+		const unsigned long sendqmax = user->GetClass()->softsendqmax;
+		while (cursor.position < entries.size())
+		{
+			if (user->eh.GetSendQSize() >= sendqmax)
+				return false;
 
-CmdResult CommandList::Handle(User* user, const Params& parameters)
-{
-	// C: Searching based on creation time, via the "C<val" and "C>val" modifiers
-	// to search for a channel creation time that is lower or higher than val
-	// respectively.
-	std::optional<time_t> mincreationtime;
-	std::optional<time_t> maxcreationtime;
+			const ListEntry& entry = entries[cursor.position++];
+			if (cursor.Matches(entry))
+				SendEntry(user, cursor, entry);
+		}
 
-	// M: Searching based on mask.
-	std::string match;
+		user->WriteNumeric(RPL_LISTEND, "End of channel list.");
+		return true;
+	}
 
-	// N: Searching based on !mask.
-	std::string notmatch;
+	CmdResult HandleLocal(LocalUser* user, const Params& parameters) override;
+};
 
-	// T: Searching based on topic time, via the "T<val" and "T>val" modifiers to
-	// search for a topic time that is lower or higher than val respectively.
-	std::optional<time_t> mintopictime;
-	std::optional<time_t> maxtopictime;
+bool ListTimer::Tick()
+{
+	for (auto it = cmd.cursors.begin(); it != cmd.cursors.end(); )
+	{
+		if (cmd.Resume(it->first, it->second))
+			it = cmd.cursors.erase(it);
+		else
+			++it;
+	}
 
-	// U: Searching based on user count within the channel, via the "<val" and
-	// ">val" modifiers to search for a channel that has less than or more than
-	// val users respectively.
-	size_t minusers = 0;
-	size_t maxusers = 0;
+	if (!cmd.cursors.empty())
+		ServerInstance->Timers.AddTimer(this);
+	return true;
+}
 
+CmdResult CommandList::HandleLocal(LocalUser* user, const Params& parameters)
+{
+	ListCursor cursor;
 	if (!parameters.empty())
 	{
 		irc::commasepstream constraints(parameters[0]);
@@ -101,95 +317,57 @@ CmdResult CommandList::Handle(User* user, const Params& parameters)
 		{
 			if (constraint[0] == '<')
 			{
-				maxusers = ConvToNum<size_t>(constraint.c_str() + 1);
+				cursor.maxusers = ConvToNum<size_t>(constraint.c_str() + 1);
 			}
 			else if (constraint[0] == '>')
 			{
-				minusers = ConvToNum<size_t>(constraint.c_str() + 1);
+				cursor.minusers = ConvToNum<size_t>(constraint.c_str() + 1);
 			}
 			else if (!constraint.compare(0, 2, "C<", 2) || !constraint.compare(0, 2, "c<", 2))
 			{
-				mincreationtime = ParseMinutes(constraint);
+				cursor.mincreationtime = ParseMinutes(constraint);
 			}
 			else if (!constraint.compare(0, 2, "C>", 2) || !constraint.compare(0, 2, "c>", 2))
 			{
-				maxcreationtime = ParseMinutes(constraint);
+				cursor.maxcreationtime = ParseMinutes(constraint);
 			}
 			else if (!constraint.compare(0, 2, "T<", 2) || !constraint.compare(0, 2, "t<", 2))
 			{
-				mintopictime = ParseMinutes(constraint);
+				cursor.mintopictime = ParseMinutes(constraint);
 			}
 			else if (!constraint.compare(0, 2, "T>", 2) || !constraint.compare(0, 2, "t>", 2))
 			{
-				maxtopictime = ParseMinutes(constraint);
+				cursor.maxtopictime = ParseMinutes(constraint);
 			}
 			else if (constraint[0] == '!')
 			{
 				// Ensure that the user didn't just run "LIST !".
 				if (constraint.length() > 2)
-					notmatch = constraint.substr(1);
+					cursor.notmatch = constraint.substr(1);
 			}
 			else
 			{
-				match = constraint;
+				cursor.match = constraint;
 			}
 		}
 	}
 
-	const bool has_privs = user->HasPrivPermission("channels/auspex");
-	const bool show_modes = (showmodes == ShowModes::ALL) || (showmodes == ShowModes::OPERS && has_privs);
+	cursor.has_privs = user->HasPrivPermission("channels/auspex");
+	cursor.show_modes = (showmodes == ShowModes::ALL) || (showmodes == ShowModes::OPERS && cursor.has_privs);
+	cursor.snapshot = GetSnapshot();
 
 	user->WriteNumeric(RPL_LISTSTART, "Channel", "Users Name");
 
-	for (const auto& [_, chan] : ServerInstance->Channels.GetChans())
+	// Send as much as fits in the sendq now and the rest as it drains. If the user already
+	// has a LIST in progress then it is replaced by this one.
+	if (Resume(user, cursor))
+		cursors.erase(user);
+	else
 	{
-		// Check the user count if a search has been specified.
-		const size_t users = chan->GetUsers().size();
-		if ((minusers && users <= minusers) || (maxusers && users >= maxusers))
-			continue;
-
-		// Check the creation ts if a search has been specified.
-		const time_t creationtime = chan->age;
-		if ((mincreationtime && creationtime <= *mincreationtime) || (maxcreationtime && creationtime >= *maxcreationtime))
-			continue;
-
-		// Check the topic ts if a search has been specified.
-		const time_t topictime = chan->topicset;
-		if ((mintopictime && (!topictime || topictime <= *mintopictime)) || (maxtopictime && (!topictime || topictime >= *maxtopictime)))
-			continue;
-
-		// Attempt to match a glob pattern.
-		if (!match.empty() && !InspIRCd::Match(chan->name, match) && !InspIRCd::Match(chan->topic, match))
-			continue;
-
-		// Attempt to match an inverted glob pattern.
-		if (!notmatch.empty() && (InspIRCd::Match(chan->name, notmatch) || InspIRCd::Match(chan->topic, notmatch)))
-			continue;
-
-		// if the channel is not private/secret, OR the user is on the channel anyway
-		bool n = (has_privs || chan->HasUser(user));
-
-		// If we're not in the channel and +s is set on it, we want to ignore it
-		if ((n) || (!chan->IsModeSet(secretmode)))
-		{
-			if ((!n) && (chan->IsModeSet(privatemode)))
-			{
-				// Channel is private (+p) and user is outside/not privileged
-				user->WriteNumeric(RPL_LIST, '*', users, "");
-			}
-			else if (show_modes)
-			{
-				// Show the list response with the modes and topic.
-				user->WriteNumeric(RPL_LIST, chan->name, users, INSP_FORMAT("[+{}] {}", chan->ChanModes(n), chan->topic));
-			}
-			else
-			{
-				// Show the list response with just the modes.
-				user->WriteNumeric(RPL_LIST, chan->name, users, chan->topic);
-			}
-		}
+		cursors[user] = std::move(cursor);
+		if (!timer.GetTrigger())
+			ServerInstance->Timers.AddTimer(&timer);
 	}
-	user->WriteNumeric(RPL_LISTEND, "End of channel list.");
 
 	return CmdResult::SUCCESS;
 }
@@ -212,6 +390,7 @@ public:
 	void ReadConfig(ConfigStatus& status) override
 	{
 		const auto& tag = ServerInstance->Config->ConfValue("options");
+		cmd.snapshotinterval = tag->getDuration("listsnapshot", 10);
 		cmd.showmodes = tag->getEnum("modesinlist", ShowModes::OPERS, {
 			{ "no",    ShowModes::NOBODY },
 			{ "opers", ShowModes::OPERS  },
@@ -219,6 +398,11 @@ public:
 		});
 	}
 
+	void OnUserDisconnect(LocalUser* user) override
+	{
+		cmd.cursors.erase(user);
+	}
+
 	void OnBuildISupport(ISupport::TokenMap& tokens) override
 	{
 		tokens["ELIST"] = "CMNTU";
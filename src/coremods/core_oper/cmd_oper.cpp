@@ -32,6 +32,23 @@ namespace
 		user->CommandFloodPenalty += 10'000;
 		return CmdResult::FAILURE;
 	}
+
+	CmdResult CheckedOper(LocalUser* user, const std::shared_ptr<OperAccount>& account, const std::string& name, bool valid)
+	{
+		if (!valid)
+		{
+			ServerInstance->SNO.WriteGlobalSno('o', "{} ({}) [{}] failed to log into the \x02{}\x02 oper account because they specified the wrong password.",
+				user->nick, user->GetRealUserHost(), user->GetAddress(), name);
+			return FailedOper(user, name);
+		}
+
+		// Attempt to log the user into the account (modules will log if this fails).
+		if (!user->OperLogin(account))
+			return FailedOper(user, name);
+
+		// If they have reached this point then the login succeeded,
+		return CmdResult::SUCCESS;
+	}
 }
 
 CommandOper::CommandOper(Module* parent)
@@ -51,20 +68,35 @@ CmdResult CommandOper::HandleLocal(LocalUser* user, const Params& parameters)
 		return FailedOper(user, parameters[0]);
 	}
 
-	// Check whether the password is correct.
+	// Check whether the password is correct. This may be done on a worker thread if the password
+	// is expensive to hash so we stop processing commands from the user until we have a result.
 	auto account = it->second;
 	const auto& password = parameters.size() > 1 ? parameters[1] : "";
-	if (!account->CheckPassword(password))
-	{
-		ServerInstance->SNO.WriteGlobalSno('o', "{} ({}) [{}] failed to log into the \x02{}\x02 oper account because they specified the wrong password.",
-			user->nick, user->GetRealUserHost(), user->GetAddress(), parameters[0]);
-		return FailedOper(user, parameters[0]);
-	}
+	auto result = std::make_shared<std::optional<CmdResult>>();
+	auto pending = std::make_shared<bool>(false);
+	account->CheckPassword(password, [this, result, pending, account, parameters, uuid = user->uuid](bool valid) {
+		auto* luser = ServerInstance->Users.FindUUID<LocalUser>(uuid);
+		if (!luser)
+			return; // User quit whilst we were checking the password.
 
-	// Attempt to log the user into the account (modules will log if this fails).
-	if (!user->OperLogin(account))
-		return FailedOper(user, parameters[0]);
+		if (!*pending)
+		{
+			// The password was checked synchronously so we can return the result directly.
+			*result = CheckedOper(luser, account, parameters[0], valid);
+			return;
+		}
+
+		luser->Resume();
+		CommandParser::ResumeCommand(this, parameters, luser, [luser, account, &parameters, valid]() {
+			return CheckedOper(luser, account, parameters[0], valid);
+		});
+	});
+
+	if (result->has_value())
+		return **result;
 
-	// If they have reached this point then the login succeeded,
+	// The result will be passed to the post-command hooks once the password has been checked.
+	*pending = true;
+	user->Suspend();
 	return CmdResult::SUCCESS;
 }
@@ -31,12 +31,12 @@ static ClientProtocol::Serializer* dummyserializer;
 class DummySerializer final
 	: public ClientProtocol::Serializer
 {
-	bool Parse(LocalUser* user, const std::string& line, ClientProtocol::ParseOutput& parseoutput) override
+	bool Parse(LocalUser* user, const std::string_view& line, ClientProtocol::ParseOutput& parseoutput) override
 	{
 		return false;
 	}
 
-	ClientProtocol::SerializedMessage Serialize(const ClientProtocol::Message& msg, const ClientProtocol::TagSelection& tagwl) const override
+	std::string Serialize(const ClientProtocol::Message& msg, const ClientProtocol::TagSelection& tagwl) const override
 	{
 		return {};
 	}
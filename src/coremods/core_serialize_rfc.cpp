@@ -45,14 +45,14 @@ public:
 	{
 	}
 
-	bool Parse(LocalUser* user, const std::string& line, ClientProtocol::ParseOutput& parseoutput) override;
-	ClientProtocol::SerializedMessage Serialize(const ClientProtocol::Message& msg, const ClientProtocol::TagSelection& tagwl) const override;
+	bool Parse(LocalUser* user, const std::string_view& line, ClientProtocol::ParseOutput& parseoutput) override;
+	std::string Serialize(const ClientProtocol::Message& msg, const ClientProtocol::TagSelection& tagwl) const override;
 };
 
-bool RFCSerializer::Parse(LocalUser* user, const std::string& line, ClientProtocol::ParseOutput& parseoutput)
+bool RFCSerializer::Parse(LocalUser* user, const std::string_view& line, ClientProtocol::ParseOutput& parseoutput)
 {
 	size_t start = line.find_first_not_of(' ');
-	if (start == std::string::npos)
+	if (start == std::string_view::npos)
 	{
 		// Discourage the user from flooding the server.
 		user->CommandFloodPenalty += 2000;
@@ -187,7 +187,7 @@ void RFCSerializer::SerializeTags(const ClientProtocol::TagMap& tags, const Clie
 		line.push_back(' ');
 }
 
-ClientProtocol::SerializedMessage RFCSerializer::Serialize(const ClientProtocol::Message& msg, const ClientProtocol::TagSelection& tagwl) const
+std::string RFCSerializer::Serialize(const ClientProtocol::Message& msg, const ClientProtocol::TagSelection& tagwl) const
 {
 	std::string line;
 	SerializeTags(msg.GetTags(), tagwl, line);
@@ -55,6 +55,11 @@ public:
 	{
 		return statscap.IsEnabled(user);
 	}
+
+	bool OnlyDependsOnCaps() const override
+	{
+		return true;
+	}
 };
 
 
@@ -336,6 +341,41 @@ void CommandStats::DoStats(Stats::Context& stats)
 		}
 		break;
 
+		/* stats h (show hook and command latency) */
+		case 'h':
+		{
+			if (!Latency::enabled)
+			{
+				stats.AddRow(249, "Latency statistics are disabled; set <performance:latencystats> to enable them");
+				break;
+			}
+
+			// Only the entries which have used the most time in total are shown to avoid flooding.
+			std::vector<std::pair<std::string, const Latency::Histogram*>> entries;
+			for (const auto& [_, hook] : ServerInstance->Latency.GetHooks())
+				entries.emplace_back(hook.module + " " + hook.event, &hook.histogram);
+			for (const auto& [command, histogram] : ServerInstance->Latency.GetCommands())
+				entries.emplace_back("command " + command, &histogram);
+
+			const size_t shown = std::min<size_t>(entries.size(), 50);
+			std::partial_sort(entries.begin(), entries.begin() + shown, entries.end(), [](const auto& lhs, const auto& rhs) {
+				return lhs.second->GetTotal() > rhs.second->GetTotal();
+			});
+
+			const auto& latency = ServerInstance->Latency;
+			for (size_t idx = 0; idx < shown; ++idx)
+			{
+				const auto& [entry, histogram] = entries[idx];
+				stats.AddRow(249, INSP_FORMAT("{} calls {} total {:.0f}us mean {:.2f}us p50 {:.2f}us p99 {:.2f}us max {:.2f}us",
+					entry, histogram->GetCount(), latency.TicksToMicroseconds(histogram->GetTotal()),
+					latency.TicksToMicroseconds(histogram->GetTotal()) / histogram->GetCount(),
+					latency.TicksToMicroseconds(histogram->GetPercentile(50)),
+					latency.TicksToMicroseconds(histogram->GetPercentile(99)),
+					latency.TicksToMicroseconds(histogram->GetMax())));
+			}
+		}
+		break;
+
 		/* stats l (show user I/O stats) */
 		case 'l':
 		/* stats L (show user I/O stats with IP addresses) */
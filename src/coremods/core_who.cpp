@@ -422,18 +422,30 @@ void CommandWho::WhoChannel(LocalUser* source, const std::vector<std::string>& p
 		return;
 
 	bool inside = data.matchchan->HasUser(source);
-	for (const auto& [user, memb] : data.matchchan->GetUsers())
+	auto sendmember = [&](Membership* memb)
 	{
 		// Only show invisible users if the source is in the channel or has the users/auspex priv.
-		if (!inside && user->IsModeSet(invisiblemode) && !source->HasPrivPermission("users/auspex"))
-			continue;
+		if (!inside && memb->user->IsModeSet(invisiblemode) && !source->HasPrivPermission("users/auspex"))
+			return;
 
 		// Skip the user if it doesn't match the query.
 		if (!MatchChannel(source, memb, data))
-			continue;
+			return;
+
+		SendWhoLine(source, parameters, memb, memb->user, data);
+	};
 
-		SendWhoLine(source, parameters, memb, user, data);
+	// If the source only wants local users and is allowed to know which users are local then we
+	// can skip remote members entirely.
+	if (data.flags['l'] && (ServerInstance->Config->HideServer.empty() || source->HasPrivPermission("users/auspex")))
+	{
+		for (const auto& lm : data.matchchan->GetLocalUsers())
+			sendmember(lm.memb);
+		return;
 	}
+
+	for (const auto& [_, memb] : data.matchchan->GetUsers())
+		sendmember(memb);
 }
 
 template<typename T>
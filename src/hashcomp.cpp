@@ -166,8 +166,8 @@ size_t irc::insensitive::operator()(const std::string& s) const
 	return t;
 }
 
-irc::tokenstream::tokenstream(const std::string& msg, size_t start, size_t end)
-	: message(msg, start, end)
+irc::tokenstream::tokenstream(const std::string_view& msg, size_t start, size_t end)
+	: message(msg.substr(start, end))
 {
 }
 
@@ -60,6 +60,14 @@ bool InspIRCd::CheckPassword(const std::string& password, const std::string& pas
 	return false;
 }
 
+void InspIRCd::CheckPassword(const std::string& password, const std::string& passwordhash, const std::string& value, const PasswordCallback& callback)
+{
+	ModResult res;
+	FIRST_MOD_RESULT(OnCheckPasswordAsync, res, (password, passwordhash, value, callback));
+	if (res == MOD_RES_PASSTHRU)
+		callback(CheckPassword(password, passwordhash, value));
+}
+
 bool InspIRCd::IsValidMask(const std::string& mask)
 {
 	const char* dest = mask.c_str();
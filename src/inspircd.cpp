@@ -409,6 +409,7 @@ void InspIRCd::Cleanup()
 
 	GlobalCulls.Apply();
 	Modules.UnloadAll();
+	Workers.Stop();
 
 	/* Delete objects dynamically allocated in constructor (destructor would be more appropriate, but we're likely exiting) */
 	/* Must be deleted before modes as it decrements modelines */
@@ -513,6 +514,8 @@ InspIRCd::InspIRCd(int argc, char** argv)
 	 */
 	this->Config->Read();
 	this->Config->Apply(nullptr, "");
+	this->Users.RehashCloneCounts();
+	this->Latency.SetEnabled(Config->LatencyStats);
 
 	try
 	{
@@ -581,6 +584,9 @@ InspIRCd::InspIRCd(int argc, char** argv)
 	 */
 	if (!Config->CommandLine.nofork)
 	{
+		// Make sure nothing is still being written to the streams we are about to close.
+		Logs.Flush();
+
 		int fd = open("/dev/null", O_RDWR);
 
 		fclose(stdin);
@@ -674,9 +680,6 @@ void InspIRCd::Run()
 			if ((Time() % 3600) == 0)
 				FOREACH_MOD(OnGarbageCollect, ());
 
-			Timers.TickTimers();
-			Users.DoBackgroundUserStuff();
-
 			if ((Time() % 5) == 0)
 			{
 				FOREACH_MOD(OnBackgroundTimer, (Time()));
@@ -684,6 +687,10 @@ void InspIRCd::Run()
 			}
 		}
 
+		// Timers can be due at any millisecond so these are checked on every iteration. This also
+		// handles the housekeeping of local users such as pinging them.
+		Timers.TickTimers();
+
 		/* Call the socket engine to wait on the active
 		 * file descriptors. The socket engine has everything's
 		 * descriptors in its list... dns, modules, users,
@@ -712,15 +719,3 @@ void InspIRCd::SetSignal(int signal)
 {
 	lastsignal = signal;
 }
-
-#ifdef _WIN32
-int smain(int argc, char** argv)
-#else
-int main(int argc, char** argv)
-#endif
-{
-	new InspIRCd(argc, argv);
-	ServerInstance->Run();
-	delete ServerInstance;
-	return 0;
-}
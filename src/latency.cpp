@@ -0,0 +1,143 @@
+/*
+ * InspIRCd -- Internet Relay Chat Daemon
+ *
+ * This file is part of InspIRCd.  InspIRCd is free software: you can
+ * redistribute it and/or modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation, version 2.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "inspircd.h"
+
+bool Latency::enabled = false;
+
+void Latency::RecordHook(const Module* mod, uintptr_t key, std::string_view event, const Module* owner, uint64_t ticks)
+{
+	ServerInstance->Latency.RecordHook(mod, key, event, owner, ticks);
+}
+
+unsigned int Latency::Histogram::GetBucket(uint64_t value)
+{
+	// Small values are stored in a bucket of their own.
+	if (value < SUB_BUCKETS)
+		return static_cast<unsigned int>(value);
+
+	// Larger values are stored in the sub-bucket of their most significant bit.
+	unsigned int msb = 63;
+	while (!(value & (UINT64_C(1) << msb)))
+		msb--;
+
+	const unsigned int shift = msb - SUB_BITS;
+	const unsigned int sub = (value >> shift) & (SUB_BUCKETS - 1);
+	return (shift + 1) * SUB_BUCKETS + sub;
+}
+
+uint64_t Latency::Histogram::GetUpperBound(unsigned int bucket)
+{
+	if (bucket + 1 >= BUCKETS)
+		return UINT64_MAX;
+
+	// The upper bound of a bucket is one less than the lower bound of the next one.
+	const unsigned int next = bucket + 1;
+	if (next < SUB_BUCKETS)
+		return next - 1;
+
+	const unsigned int group = next / SUB_BUCKETS;
+	const uint64_t sub = next % SUB_BUCKETS;
+	return ((SUB_BUCKETS + sub) << (group - 1)) - 1;
+}
+
+void Latency::Histogram::Add(uint64_t value)
+{
+	uint32_t& bucket = buckets[GetBucket(value)];
+	if (bucket < UINT32_MAX)
+		bucket++;
+
+	count++;
+	total += value;
+	max = std::max(max, value);
+}
+
+uint64_t Latency::Histogram::GetPercentile(double percentile) const
+{
+	if (!count)
+		return 0;
+
+	const uint64_t target = std::max<uint64_t>(1, static_cast<uint64_t>(count * percentile / 100.0 + 0.5));
+	uint64_t seen = 0;
+	for (unsigned int bucket = 0; bucket < BUCKETS; ++bucket)
+	{
+		seen += buckets[bucket];
+		if (seen >= target)
+			return std::min(GetUpperBound(bucket), max);
+	}
+	return max;
+}
+
+void Latency::Tracker::RecordCommand(const std::string& command, uint64_t ticks)
+{
+	commands[command].Add(ticks);
+}
+
+void Latency::Tracker::RecordHook(const Module* mod, uintptr_t key, std::string_view event, const Module* owner, uint64_t ticks)
+{
+	auto it = hooks.find(HookKey(mod, key));
+	if (it == hooks.end())
+	{
+		it = hooks.emplace(HookKey(mod, key), HookStats()).first;
+		it->second.module = mod->ModuleFile;
+		it->second.event = event;
+		it->second.owner = owner;
+	}
+	it->second.histogram.Add(ticks);
+}
+
+void Latency::Tracker::RemoveModule(const Module* mod)
+{
+	for (auto it = hooks.begin(); it != hooks.end(); )
+	{
+		// The key of an event which is provided by a module may be reused once it is unloaded.
+		if (it->first.first == mod || it->second.owner == mod)
+			it = hooks.erase(it);
+		else
+			++it;
+	}
+}
+
+void Latency::Tracker::Reset()
+{
+	commands.clear();
+	hooks.clear();
+	startticks = Now();
+	starttime = std::chrono::steady_clock::now();
+}
+
+void Latency::Tracker::SetEnabled(bool enable)
+{
+	if (enable && !Latency::enabled)
+		Reset();
+	Latency::enabled = enable;
+}
+
+double Latency::Tracker::TicksToMicroseconds(uint64_t ticks) const
+{
+#ifdef INSPIRCD_LATENCY_TSC
+	// The rate of the cycle counter is calibrated against the monotonic clock over the period
+	// that statistics have been collected for.
+	const auto elapsed = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - starttime).count();
+	const uint64_t elapsedticks = Now() - startticks;
+	if (elapsed <= 0 || !elapsedticks)
+		return 0;
+	return ticks * (elapsed / elapsedticks);
+#else
+	return ticks / 1000.0;
+#endif
+}
@@ -168,7 +168,7 @@ ListenSocket::ListenSocket(const std::shared_ptr<ConfigTag>& tag, const irc::soc
 	else
 	{
 		SocketEngine::NonBlocking(GetFd());
-		SocketEngine::AddFd(this, FD_WANT_POLL_READ | FD_WANT_NO_WRITE);
+		SocketEngine::AddFd(this, FD_WANT_POLL_READ | FD_WANT_NO_WRITE | FD_ACCEPTS);
 
 		this->ResetIOHookProvider();
 	}
@@ -194,6 +194,13 @@ void ListenSocket::OnEventHandlerRead()
 	irc::sockets::sockaddrs client(false);
 	socklen_t length = sizeof(client);
 	int incomingfd = SocketEngine::Accept(this, &client.sa, &length);
+	if (incomingfd >= 0)
+		SocketEngine::NonBlocking(incomingfd);
+	OnAccept(incomingfd, client);
+}
+
+void ListenSocket::OnAccept(int incomingfd, irc::sockets::sockaddrs& client)
+{
 	if (incomingfd < 0)
 	{
 		ServerInstance->Logs.Debug("SOCKET", "Refused connection to {}: {}",
@@ -206,7 +213,7 @@ void ListenSocket::OnEventHandlerRead()
 			bind_sa.str(), incomingfd);
 
 	irc::sockets::sockaddrs server(bind_sa);
-	length = sizeof(server);
+	socklen_t length = sizeof(server);
 	if (getsockname(incomingfd, &server.sa, &length))
 	{
 		ServerInstance->Logs.Debug("SOCKET", "Unable to get peer name for fd {}: {}",
@@ -251,8 +258,6 @@ void ListenSocket::OnEventHandlerRead()
 		strcpy(client.un.sun_path, server.un.sun_path);
 	}
 
-	SocketEngine::NonBlocking(incomingfd);
-
 	ModResult res;
 	FIRST_MOD_RESULT(OnAcceptConnection, res, (incomingfd, this, client, server));
 	if (res == MOD_RES_ALLOW)
@@ -197,6 +197,7 @@ bool ListModeBase::OnModeChange(User* source, User*, Channel* channel, Modes::Ch
 			change.set_by.value_or(ServerInstance->Config->MaskInList ? source->GetMask() : source->nick),
 			change.set_at.value_or(ServerInstance->Time())
 		);
+		channel->InvalidateBans();
 		return true;
 	}
 	else
@@ -212,6 +213,7 @@ bool ListModeBase::OnModeChange(User* source, User*, Channel* channel, Modes::Ch
 
 				change.param = it->mask;
 				stdalgo::vector::swaperase(cd->list, it);
+				channel->InvalidateBans();
 				return true;
 			}
 		}
@@ -21,6 +21,9 @@
 #include "clientprotocolmsg.h"
 #include "timeutils.h"
 
+#include <condition_variable>
+#include <mutex>
+
 #include <fmt/color.h>
 
 const char* Log::LevelToString(Log::Level level)
@@ -68,15 +71,322 @@ public:
 };
 
 
-Log::FileMethod::FileMethod(const std::string& n, FILE* fh, unsigned long fl, bool ac)
-	: Timer(15*60, true)
-	, autoclose(ac)
+class Log::Manager::Writer final
+	: public Thread
+{
+private:
+	/** The maximum number of bytes of messages to write before flushing the loggers. */
+	static constexpr size_t MAX_BATCH_SIZE = 1024 * 1024;
+
+	/** A message which is waiting to be written. */
+	struct Entry final
+	{
+		/** The next entry in the queue. */
+		std::atomic<Entry*> next = { nullptr };
+
+		/** The logger to write the message to. */
+		std::shared_ptr<AsyncMethod> method;
+
+		/** The level the message was logged at. */
+		Level level = Level::NORMAL;
+
+		/** The formatted message. */
+		std::string text;
+
+		/** Retrieves the amount of memory used by this entry. */
+		size_t GetSize() const { return sizeof(Entry) + text.size(); }
+	};
+
+	/** A placeholder entry which ensures the queue is never actually empty. */
+	Entry stub;
+
+	/** The most recently pushed entry. This is swapped atomically by producers. */
+	std::atomic<Entry*> head = { &stub };
+
+	/** The oldest entry which has not been popped yet. Only accessed on the writer thread. */
+	Entry* tail = &stub;
+
+	/** The number of entries which have been pushed to the queue. */
+	std::atomic_uint64_t pushed = { 0 };
+
+	/** The number of entries which have been popped from the queue. Only accessed on the writer thread. */
+	uint64_t popped = 0;
+
+	/** The number of entries which have been written and destroyed. MUST HOLD MUTEX to modify. */
+	std::atomic_uint64_t written = { 0 };
+
+	/** The amount of memory used by queued entries. */
+	std::atomic_size_t queued = { 0 };
+
+	/** The number of messages which have been dropped since this was last checked. */
+	std::atomic_size_t dropped = { 0 };
+
+	/** The maximum amount of memory which queued entries can use. */
+	std::atomic_size_t limit = { 8 * 1024 * 1024 };
+
+	/** Whether to wait for space in the queue instead of dropping messages when it is full. */
+	std::atomic_bool block = { false };
+
+	/** Whether the writer is waiting for entries to be pushed. */
+	std::atomic_bool sleeping = { false };
+
+	/** Whether the writer should exit once the queue is empty. MUST HOLD MUTEX to modify. */
+	std::atomic_bool exiting = { false };
+
+	/** Mutex which is held when the writer is going to sleep and by threads that are waiting for it. */
+	std::mutex mutex;
+
+	/** Signalled when an entry is pushed to the queue whilst the writer is sleeping. */
+	std::condition_variable wakeup;
+
+	/** Signalled when the writer has finished writing a batch of entries. */
+	std::condition_variable progress;
+
+	/** Marks a logger as failed so that it is removed the next time it is used on the main thread. */
+	static void Fail(AsyncMethod* method, const CoreException& err)
+	{
+		method->failreason = err.GetReason();
+		method->failed.store(true, std::memory_order_release);
+	}
+
+	/** Adds an entry to the head of the queue. This is lock-free and can be called from any thread. */
+	void Link(Entry* entry)
+	{
+		entry->next.store(nullptr, std::memory_order_relaxed);
+		Entry* prev = head.exchange(entry, std::memory_order_acq_rel);
+		prev->next.store(entry, std::memory_order_release);
+	}
+
+	/** Removes an entry from the tail of the queue. This is only called on the writer thread.
+	 * @return The oldest entry or nullptr if the queue is empty or an entry is still being pushed.
+	 */
+	Entry* Pop()
+	{
+		Entry* curr = tail;
+		Entry* next = curr->next.load(std::memory_order_acquire);
+		if (curr == &stub)
+		{
+			if (!next)
+				return nullptr;
+
+			tail = curr = next;
+			next = next->next.load(std::memory_order_acquire);
+		}
+
+		if (next)
+		{
+			tail = next;
+			return curr;
+		}
+
+		if (curr != head.load(std::memory_order_acquire))
+			return nullptr; // A producer is part of the way through pushing.
+
+		// This is the last entry so we need to push the stub back to take its place.
+		Link(&stub);
+		next = curr->next.load(std::memory_order_acquire);
+		if (!next)
+			return nullptr;
+
+		tail = next;
+		return curr;
+	}
+
+	/** Wakes up the writer if it is waiting for entries. */
+	void Wake()
+	{
+		if (sleeping.load())
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			wakeup.notify_one();
+		}
+	}
+
+protected:
+	void OnStart() override
+	{
+		std::vector<std::shared_ptr<AsyncMethod>> batch;
+		for (;;)
+		{
+			size_t count = 0;
+			size_t bytes = 0;
+			while (bytes < MAX_BATCH_SIZE)
+			{
+				Entry* entry = Pop();
+				if (!entry)
+					break;
+
+				popped++;
+				AsyncMethod* method = entry->method.get();
+				if (!method->failed.load(std::memory_order_relaxed))
+				{
+					try
+					{
+						method->Write(entry->level, entry->text);
+						if (std::find(batch.begin(), batch.end(), entry->method) == batch.end())
+							batch.push_back(entry->method);
+					}
+					catch (const CoreException& err)
+					{
+						Fail(method, err);
+					}
+				}
+
+				count++;
+				bytes += entry->GetSize();
+				delete entry;
+			}
+
+			for (const auto& method : batch)
+			{
+				try
+				{
+					method->Flush();
+				}
+				catch (const CoreException& err)
+				{
+					Fail(method.get(), err);
+				}
+			}
+			batch.clear();
+
+			if (count)
+			{
+				queued.fetch_sub(bytes);
+				{
+					std::lock_guard<std::mutex> lock(mutex);
+					written.fetch_add(count);
+				}
+				progress.notify_all();
+				continue;
+			}
+
+			std::unique_lock<std::mutex> lock(mutex);
+			sleeping.store(true);
+			if (pushed.load() == popped)
+			{
+				if (exiting.load())
+					break;
+
+				wakeup.wait(lock);
+			}
+			else
+			{
+				// An entry is part of the way through being pushed.
+				lock.unlock();
+				std::this_thread::yield();
+			}
+			sleeping.store(false);
+		}
+	}
+
+	void OnStop() override
+	{
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			exiting.store(true);
+		}
+		wakeup.notify_one();
+	}
+
+public:
+	~Writer() override
+	{
+		Stop();
+	}
+
+	/** Updates the limits on the size of the queue.
+	 * @param maxsize The maximum amount of memory which queued entries can use.
+	 * @param blockonfull Whether to wait for space instead of dropping messages when the queue is full.
+	 */
+	void Configure(size_t maxsize, bool blockonfull)
+	{
+		limit.store(maxsize);
+		block.store(blockonfull);
+	}
+
+	/** Waits until all of the entries which are currently queued have been written. */
+	void Flush()
+	{
+		if (!IsRunning())
+			return;
+
+		const uint64_t target = pushed.load();
+		std::unique_lock<std::mutex> lock(mutex);
+		wakeup.notify_one();
+		progress.wait(lock, [this, target] { return written.load() >= target; });
+	}
+
+	/** Pushes a message to the queue. This can be called from any thread. */
+	void Push(std::shared_ptr<AsyncMethod>&& method, Level level, std::string&& text)
+	{
+		auto* entry = new Entry();
+		entry->method = std::move(method);
+		entry->level = level;
+		entry->text = std::move(text);
+
+		const size_t size = entry->GetSize();
+		const auto has_space = [this, size] {
+			const size_t used = queued.load();
+			return !used || used + size <= limit.load();
+		};
+
+		if (!has_space())
+		{
+			if (!block.load())
+			{
+				dropped.fetch_add(1);
+				delete entry;
+				return;
+			}
+
+			std::unique_lock<std::mutex> lock(mutex);
+			wakeup.notify_one();
+			progress.wait(lock, has_space);
+		}
+
+		queued.fetch_add(size);
+		Link(entry);
+		pushed.fetch_add(1);
+		Wake();
+	}
+
+	/** Starts the writer thread if it is not already running. This is deferred until the first
+	 * message is logged as the server may fork into the background before then.
+	 */
+	void StartIfNeeded()
+	{
+		if (!IsRunning())
+			Start();
+	}
+
+	/** Retrieves the number of messages which have been dropped since this was last called. This
+	 * only returns non-zero once the queue has drained enough to report it.
+	 */
+	size_t TakeDropped()
+	{
+		if (!dropped.load() || queued.load() > limit.load() / 2)
+			return 0;
+
+		return dropped.exchange(0);
+	}
+};
+
+void Log::AsyncMethod::OnLog(time_t time, Level level, const std::string& type, const std::string& message)
+{
+	if (failed.load(std::memory_order_acquire))
+		throw CoreException(failreason);
+
+	std::string entry;
+	Format(time, level, type, message, entry);
+	ServerInstance->Logs.Queue(shared_from_this(), level, std::move(entry));
+}
+
+Log::FileMethod::FileMethod(const std::string& n, FILE* fh, bool ac)
+	: autoclose(ac)
 	, file(fh)
-	, flush(fl)
 	, name(n)
 {
-	if (flush > 1)
-		ServerInstance->Timers.AddTimer(this);
 }
 
 Log::FileMethod::~FileMethod()
@@ -85,7 +395,7 @@ Log::FileMethod::~FileMethod()
 		fclose(file);
 }
 
-void Log::FileMethod::OnLog(time_t time, Level level, const std::string& type, const std::string& message)
+void Log::FileMethod::Format(time_t time, Level level, const std::string& type, const std::string& message, std::string& out)
 {
 	static time_t prevtime = 0;
 	static std::string timestr;
@@ -95,28 +405,30 @@ void Log::FileMethod::OnLog(time_t time, Level level, const std::string& type, c
 		timestr = Time::ToString(prevtime);
 	}
 
-	fputs(timestr.c_str(), file);
-	fputs(" ", file);
-	fputs(type.c_str(), file);
-	fputs(": ", file);
-	fputs(message.c_str(), file);
+	out.reserve(timestr.length() + type.length() + message.length() + 5);
+	out.append(timestr).append(" ").append(type).append(": ").append(message);
 #if defined _WIN32
-	fputs("\r\n", file);
+	out.append("\r\n");
 #else
-	fputs("\n", file);
+	out.append("\n");
 #endif
+}
 
-	if (!(++lines % flush))
-		fflush(file);
-
-	if (ferror(file))
-		throw CoreException(INSP_FORMAT("Unable to write to {}: {}", name, strerror(errno)));
+void Log::FileMethod::Write(Level level, const std::string& entry)
+{
+	buffer.append(entry);
 }
 
-bool Log::FileMethod::Tick()
+void Log::FileMethod::Flush()
 {
-	fflush(file);
-	return true;
+	if (buffer.empty())
+		return;
+
+	const bool success = fwrite(buffer.data(), 1, buffer.size(), file) == buffer.size() && !fflush(file);
+	buffer.clear();
+
+	if (!success)
+		throw CoreException(INSP_FORMAT("Unable to write to {}: {}", name, strerror(errno)));
 }
 
 Log::Engine::Engine(Module* Creator, const std::string& Name)
@@ -149,8 +461,7 @@ Log::MethodPtr Log::FileEngine::Create(const std::shared_ptr<ConfigTag>& tag)
 			tag->source.str(), strerror(errno)));
 	}
 
-	const unsigned long flush = tag->getNum<unsigned long>("flush", 20, 1);
-	return std::make_shared<FileMethod>(fulltarget, fh, flush, true);
+	return std::make_shared<FileMethod>(fulltarget, fh, true);
 }
 
 Log::StreamEngine::StreamEngine(Module* Creator, const std::string& Name, FILE* fh)
@@ -161,7 +472,7 @@ Log::StreamEngine::StreamEngine(Module* Creator, const std::string& Name, FILE*
 
 Log::MethodPtr Log::StreamEngine::Create(const std::shared_ptr<ConfigTag>& tag)
 {
-	return std::make_shared<FileMethod>(name, file, 1, false);
+	return std::make_shared<FileMethod>(name, file, false);
 }
 
 Log::Manager::CachedMessage::CachedMessage(time_t ts, Level l, const std::string& t, const std::string& m)
@@ -190,9 +501,16 @@ Log::Manager::Manager()
 	: filelog(nullptr)
 	, stderrlog(nullptr, "stderr", stderr)
 	, stdoutlog(nullptr, "stdout", stdout)
+	, writer(std::make_unique<Writer>())
 {
 }
 
+Log::Manager::~Manager()
+{
+	// Destroying the writer waits for any queued messages to be written.
+	writer.reset();
+}
+
 void Log::Manager::CloseLogs()
 {
 	logging = true; // Prevent writing to dying loggers.
@@ -217,8 +535,20 @@ void Log::Manager::EnableDebugMode()
 	}
 }
 
+void Log::Manager::Flush()
+{
+	writer->Flush();
+}
+
 void Log::Manager::OpenLogs(bool requiremethods)
 {
+	const auto& performance = ServerInstance->Config->ConfValue("performance");
+	writer->Configure(performance->getNum<size_t>("logqueuesize", 8 * 1024 * 1024, 64 * 1024),
+		performance->getEnum("logoverflow", false, {
+			{ "block", true  },
+			{ "drop",  false },
+		}));
+
 	// If the server is started in debug mode we don't write logs.
 	if (ServerInstance->Config->CommandLine.forcedebug)
 	{
@@ -315,6 +645,10 @@ void Log::Manager::UnloadEngine(const Engine* engine)
 	loggers.erase(std::remove_if(loggers.begin(), loggers.end(), [&engine](const Info& info) { return info.engine == engine; }), loggers.end());
 	logging = false;
 
+	// The engine's loggers may still have messages queued which need to be written before the
+	// module that provides them is unloaded.
+	writer->Flush();
+
 	Normal("LOG", "The {} log engine is unloading; removed {}/{} loggers.", engine->name.c_str(), logger_count - loggers.size(), logger_count);
 }
 
@@ -365,4 +699,14 @@ void Log::Manager::Write(Level level, const std::string& type, const std::string
 	if (caching)
 		cache.emplace_back(time, level, type, message);
 	logging = false;
+
+	const auto dropped = writer->TakeDropped();
+	if (dropped)
+		Warning("LOG", "Dropped {} log messages because the log queue was full.", dropped);
+}
+
+void Log::Manager::Queue(std::shared_ptr<AsyncMethod> method, Level level, std::string&& entry)
+{
+	writer->StartIfNeeded();
+	writer->Push(std::move(method), level, std::move(entry));
 }
@@ -0,0 +1,34 @@
+/*
+ * InspIRCd -- Internet Relay Chat Daemon
+ *
+ * This file is part of InspIRCd.  InspIRCd is free software: you can
+ * redistribute it and/or modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation, version 2.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+/* The entry point is kept separate from the rest of the core so that the benchmarks in tools/bench
+ * can be linked against the core objects with an entry point of their own.
+ */
+
+#include "inspircd.h"
+
+#ifdef _WIN32
+int smain(int argc, char** argv)
+#else
+int main(int argc, char** argv)
+#endif
+{
+	new InspIRCd(argc, argv);
+	ServerInstance->Run();
+	delete ServerInstance;
+	return 0;
+}
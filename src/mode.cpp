@@ -217,7 +217,14 @@ bool PrefixMode::OnModeChange(User* source, User*, Channel* chan, Modes::Change&
 
 void PrefixMode::Update(ModeHandler::Rank rank, ModeHandler::Rank setrank, ModeHandler::Rank unsetrank, bool selfrm)
 {
-	prefixrank = rank;
+	if (prefixrank != rank)
+	{
+		// The member indices of channels are keyed by rank so they need to be rebuilt.
+		prefixrank = rank;
+		for (const auto& [_, chan] : ServerInstance->Channels.GetChans())
+			chan->RebuildUserRanks();
+	}
+
 	ranktoset = setrank;
 	ranktounset = unsetrank;
 	selfremove = selfrm;
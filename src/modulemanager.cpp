@@ -80,6 +80,9 @@ bool ModuleManager::Load(const std::string& modname, bool defer)
 				ConfigStatus confstatus;
 				newmod->init();
 				newmod->ReadConfig(confstatus);
+
+				// The new module may change which bans users match.
+				ServerInstance->Channels.InvalidateBans();
 			}
 
 			ServerInstance->Logs.Normal("MODULE", "New module introduced: {} (version {}, properties {})",
@@ -132,6 +132,8 @@ void		Module::OnBackgroundTimer(time_t) { DetachEvent(I_OnBackgroundTimer); }
 ModResult	Module::OnPreCommand(std::string&, CommandBase::Params&, LocalUser*, bool) { DetachEvent(I_OnPreCommand); return MOD_RES_PASSTHRU; }
 void		Module::OnPostCommand(Command*, const CommandBase::Params&, LocalUser*, CmdResult, bool) { DetachEvent(I_OnPostCommand); }
 void		Module::OnCommandBlocked(const std::string&, const CommandBase::Params&, LocalUser*) { DetachEvent(I_OnCommandBlocked); }
+void		Module::OnCommandSuspended(Command*, const CommandBase::Params&, LocalUser*) { DetachEvent(I_OnCommandSuspended); }
+void		Module::OnCommandResumed(Command*, const CommandBase::Params&, LocalUser*) { DetachEvent(I_OnCommandResumed); }
 void		Module::OnUserInit(LocalUser*) { DetachEvent(I_OnUserInit); }
 void		Module::OnUserPostInit(LocalUser*) { DetachEvent(I_OnUserPostInit); }
 ModResult	Module::OnCheckReady(LocalUser*) { DetachEvent(I_OnCheckReady); return MOD_RES_PASSTHRU; }
@@ -146,6 +148,7 @@ ModResult	Module::OnCheckChannelBan(User*, Channel*) { DetachEvent(I_OnCheckChan
 ModResult	Module::OnCheckBan(User*, Channel*, const std::string&) { DetachEvent(I_OnCheckBan); return MOD_RES_PASSTHRU; }
 ModResult	Module::OnPreTopicChange(User*, Channel*, const std::string&) { DetachEvent(I_OnPreTopicChange); return MOD_RES_PASSTHRU; }
 ModResult	Module::OnCheckPassword(const std::string&, const std::string&, const std::string&) { DetachEvent(I_OnCheckPassword); return MOD_RES_PASSTHRU; }
+ModResult	Module::OnCheckPasswordAsync(const std::string&, const std::string&, const std::string&, const PasswordCallback&) { DetachEvent(I_OnCheckPasswordAsync); return MOD_RES_PASSTHRU; }
 void		Module::OnPostConnect(User*) { DetachEvent(I_OnPostConnect); }
 void		Module::OnUserPostMessage(User*, const MessageTarget&, const MessageDetails&) { DetachEvent(I_OnUserPostMessage); }
 void		Module::OnUserMessageBlocked(User*, const MessageTarget&, const MessageDetails&) { DetachEvent(I_OnUserMessageBlocked); }
@@ -434,6 +437,9 @@ void ModuleManager::UnregisterModes(Module* mod, ModeType modetype)
 
 void ModuleManager::DoSafeUnload(Module* mod)
 {
+	// Jobs on the thread pool may be running code from the module so we need to wait for them.
+	ServerInstance->Workers.Flush();
+
 	// First, notify all modules that a module is about to be unloaded, so in case
 	// they pass execution to the soon to be unloaded module, it will happen now,
 	// i.e. before we unregister the services of the module being unloaded
@@ -487,7 +493,11 @@ void ModuleManager::DoSafeUnload(Module* mod)
 
 	DetachAll(mod);
 
+	// The module may have changed which bans users match.
+	ServerInstance->Channels.InvalidateBans();
+
 	Modules.erase(modfind);
+	ServerInstance->Latency.RemoveModule(mod);
 	ServerInstance->GlobalCulls.AddItem(mod);
 
 	ServerInstance->Logs.Normal("MODULE", "The {} module was unloaded", mod->ModuleFile);
@@ -0,0 +1,275 @@
+/*
+ * InspIRCd -- Internet Relay Chat Daemon
+ *
+ * This file is part of InspIRCd.  InspIRCd is free software: you can
+ * redistribute it and/or modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation, version 2.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/// $CompilerFlags: find_compiler_flags("zlib" "")
+/// $LinkerFlags: find_linker_flags("zlib" "-lz")
+
+/// $PackageInfo: require_system("alpine") zlib-dev
+/// $PackageInfo: require_system("arch") zlib
+/// $PackageInfo: require_system("darwin") zlib
+/// $PackageInfo: require_system("debian~") zlib1g-dev
+/// $PackageInfo: require_system("rhel~") zlib-devel
+
+
+#include "inspircd.h"
+#include "modules/compress.h"
+
+#include <zlib.h>
+
+namespace
+{
+	/** The preset dictionary which both ends of a link prime their streams with. The
+	 * tokens that occur most often in server-to-server traffic are towards the end as
+	 * zlib can encode shorter distances more cheaply.
+	 */
+	const std::string dictionary =
+		"SINFO rawversion SINFO customversion SINFO desc SERVER ENDBURST BURST SQUIT "
+		"ADDLINE G ADDLINE Z ADDLINE Q ADDLINE E DELLINE OPERTYPE :server FHOST FIDENT "
+		"FRHOST FNAME IJOIN KICK PART QUIT :Ping timeout: NICK AWAY PRIVMSG NOTICE "
+		"TAGMSG ENCAP * LMODE FTOPIC FMODE METADATA * METADATA * ssl_cert METADATA "
+		"accountname METADATA * saslmechlist :vtrsE METADATA * modules METADATA "
+		"@time= PING PONG FJOIN # :o, FJOIN # :, +nt UID 127.0.0.1 * :";
+
+	/** The size of the buffer that compressed and decompressed data is staged in. */
+	constexpr size_t BUFFER_SIZE = 16 * 1024;
+}
+
+class ZlibHook final
+	: public Compress::Hook
+{
+private:
+	/** The stream used for compressing outgoing data. */
+	z_stream deflater;
+
+	/** The stream used for decompressing incoming data. */
+	z_stream inflater;
+
+	/** Whether deflater has been initialised. */
+	bool deflateready = false;
+
+	/** Whether inflater has been initialised. */
+	bool inflateready = false;
+
+	/** Passes all pending input of the deflater through it.
+	 * @param out The buffer to append the compressed data to.
+	 * @param flush The zlib flush mode to use.
+	 * @return True if the data was compressed; otherwise, false.
+	 */
+	bool Deflate(std::string& out, int flush)
+	{
+		char buffer[BUFFER_SIZE];
+		do
+		{
+			deflater.next_out = reinterpret_cast<Bytef*>(buffer);
+			deflater.avail_out = sizeof(buffer);
+			if (deflate(&deflater, flush) == Z_STREAM_ERROR)
+				return false;
+
+			out.append(buffer, sizeof(buffer) - deflater.avail_out);
+		}
+		while (deflater.avail_out == 0);
+		return true;
+	}
+
+	/** Initialises the deflater.
+	 * @param level The compression level to use.
+	 * @return True if the deflater is ready; otherwise, false.
+	 */
+	bool InitDeflate(int level)
+	{
+		memset(&deflater, 0, sizeof(deflater));
+		if (deflateInit(&deflater, level) != Z_OK)
+			return false;
+
+		deflateready = true;
+		return deflateSetDictionary(&deflater, reinterpret_cast<const Bytef*>(dictionary.data()), static_cast<uInt>(dictionary.size())) == Z_OK;
+	}
+
+	/** Initialises the inflater.
+	 * @return True if the inflater is ready; otherwise, false.
+	 */
+	bool InitInflate()
+	{
+		memset(&inflater, 0, sizeof(inflater));
+		if (inflateInit(&inflater) != Z_OK)
+			return false;
+
+		inflateready = true;
+		return true;
+	}
+
+public:
+	ZlibHook(const std::shared_ptr<IOHookProvider>& hookprov, StreamSocket* sock, bool compress, bool decompress, int level)
+		: Compress::Hook(hookprov, compress, decompress)
+	{
+		// Both streams are initialised up front so that a failure is reported
+		// when the hook is attached rather than part way through a burst.
+		if (!InitDeflate(level) || !InitInflate())
+			sock->SetError("Unable to initialise zlib");
+
+		sock->AddIOHookFront(this);
+	}
+
+	~ZlibHook() override
+	{
+		if (deflateready)
+			deflateEnd(&deflater);
+		if (inflateready)
+			inflateEnd(&inflater);
+	}
+
+	ssize_t OnStreamSocketWrite(StreamSocket* sock, StreamSocket::SendQueue& uppersendq) override
+	{
+		if (!compressing)
+		{
+			GetSendQ().moveall(uppersendq);
+			return 1;
+		}
+
+		if (uppersendq.empty())
+			return 1;
+
+		std::string out;
+		for (const auto& elem : uppersendq)
+		{
+			raw_out += elem.length();
+			deflater.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(elem.data()));
+			deflater.avail_in = static_cast<uInt>(elem.length());
+			if (!Deflate(out, Z_NO_FLUSH))
+			{
+				sock->SetError("Compression error");
+				return -1;
+			}
+		}
+		uppersendq.clear();
+
+		// Everything queued during this loop iteration is flushed together so the
+		// remote end never waits on data which is sitting in the compressor. This
+		// covers the end of a burst and idle periods without needing a timer.
+		if (!Deflate(out, Z_SYNC_FLUSH))
+		{
+			sock->SetError("Compression error");
+			return -1;
+		}
+
+		wire_out += out.length();
+		GetSendQ().push_back(StreamSocket::SendQueue::Element(std::move(out)));
+		return 1;
+	}
+
+	ssize_t OnStreamSocketRead(StreamSocket* sock, std::string& destrecvq) override
+	{
+		std::string& recvq = GetRecvQ();
+		if (!decompressing)
+		{
+			destrecvq.append(recvq);
+			recvq.clear();
+			return 1;
+		}
+
+		if (recvq.empty())
+			return 0;
+
+		wire_in += recvq.length();
+		inflater.next_in = reinterpret_cast<Bytef*>(recvq.data());
+		inflater.avail_in = static_cast<uInt>(recvq.length());
+
+		const size_t prevsize = destrecvq.length();
+		char buffer[BUFFER_SIZE];
+		for (;;)
+		{
+			inflater.next_out = reinterpret_cast<Bytef*>(buffer);
+			inflater.avail_out = sizeof(buffer);
+
+			const int ret = inflate(&inflater, Z_NO_FLUSH);
+			if (ret == Z_NEED_DICT)
+			{
+				if (inflateSetDictionary(&inflater, reinterpret_cast<const Bytef*>(dictionary.data()), static_cast<uInt>(dictionary.size())) != Z_OK)
+				{
+					sock->SetError("Compressed stream uses an unknown dictionary");
+					return -1;
+				}
+				continue;
+			}
+
+			if (ret == Z_STREAM_END)
+			{
+				sock->SetError("Compressed stream ended unexpectedly");
+				return -1;
+			}
+
+			if (ret != Z_OK && ret != Z_BUF_ERROR)
+			{
+				sock->SetError(INSP_FORMAT("Decompression error: {}", inflater.msg ? inflater.msg : "unknown error"));
+				return -1;
+			}
+
+			destrecvq.append(buffer, sizeof(buffer) - inflater.avail_out);
+			if (inflater.avail_out != 0)
+				break;
+		}
+
+		recvq.erase(0, recvq.length() - inflater.avail_in);
+		raw_in += destrecvq.length() - prevsize;
+		return destrecvq.length() > prevsize ? 1 : 0;
+	}
+};
+
+class ZlibHookProvider final
+	: public Compress::Provider
+{
+public:
+	/** The compression level to use for new hooks. */
+	int level = 6;
+
+	ZlibHookProvider(Module* mod)
+		: Compress::Provider(mod, "zlib")
+	{
+	}
+
+	Compress::Hook* Attach(StreamSocket* sock, bool compress, bool decompress) override
+	{
+		return new ZlibHook(shared_from_this(), sock, compress, decompress, level);
+	}
+};
+
+class ModuleCompressZlib final
+	: public Module
+{
+private:
+	std::shared_ptr<ZlibHookProvider> hookprov;
+
+public:
+	ModuleCompressZlib()
+		: Module(VF_VENDOR, "Allows server links to be compressed using the zlib library.")
+		, hookprov(std::make_shared<ZlibHookProvider>(this))
+	{
+	}
+
+	void init() override
+	{
+		ServerInstance->Logs.Normal(MODNAME, "Module was compiled against zlib version {} and is running against version {}",
+			ZLIB_VERSION, zlibVersion());
+	}
+
+	void ReadConfig(ConfigStatus& status) override
+	{
+		const auto& tag = ServerInstance->Config->ConfValue("zlib");
+		hookprov->level = static_cast<int>(tag->getNum<long>("level", 6, 1, 9));
+	}
+};
+
+MODULE_INIT(ModuleCompressZlib)
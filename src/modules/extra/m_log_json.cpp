@@ -41,52 +41,42 @@
 #include "timeutils.h"
 
 class JSONMethod final
-	: public Log::Method
-	, public Timer
+	: public Log::FileMethod
 {
 private:
-	// Whether to autoclose the file on exit.
-	bool autoclose;
+	/// The name the underlying file.
+	const std::string name;
 
-	// The file to which the log is written.
-	FILE* file;
+#ifndef HAS_YYJSON
+	// Adapts a string for use as a RapidJSON output stream.
+	struct StringStream final
+	{
+		// RapidJSON API: The type of character that this stream accepts.
+		typedef char Ch;
 
-	// How often the file stream should be flushed.
-	const unsigned long flush;
+		// The string to write to.
+		std::string& out;
 
-	// The number of lines which have been written since the file stream was created.
-	unsigned long lines = 0;
+		// RapidJSON API: Strings do not need to be flushed.
+		void Flush() { }
 
-	/// The name the underlying file.
-	const std::string name;
+		// RapidJSON API: Write a character to the string.
+		void Put(Ch c)
+		{
+			out.push_back(c);
+		}
+	};
+#endif
 
 public:
-	// RapidJSON API: The type of character that this writer accepts.
-	typedef char Ch;
-
-	JSONMethod(const std::string& n, FILE* fh, unsigned long fl, bool ac) ATTR_NOT_NULL(3)
-		: Timer(15*60, true)
-		, autoclose(ac)
-		, file(fh)
-		, flush(fl)
+	JSONMethod(const std::string& n, FILE* fh, bool ac) ATTR_NOT_NULL(3)
+		: Log::FileMethod(n, fh, ac)
 		, name(n)
 	{
-		if (flush > 1)
-			ServerInstance->Timers.AddTimer(this);
 	}
 
-	~JSONMethod() override
-	{
-		if (autoclose)
-			fclose(file);
-	}
-
-#ifndef HAS_YYJSON
-	// RapidJSON API: We implement our own flushing in OnLog.
-	void Flush() { }
-#endif
-
-	void OnLog(time_t time, Log::Level level, const std::string& type, const std::string& message) override
+protected:
+	void Format(time_t time, Log::Level level, const std::string& type, const std::string& message, std::string& outmsg) override
 	{
 		static time_t prevtime = 0;
 		static std::string timestr;
@@ -110,15 +100,26 @@ public:
 		error |= !yyjson_mut_obj_add_strn(doc, root, "level", levelstr, strlen(levelstr));
 		error |= !yyjson_mut_obj_add_strn(doc, root, "message", message.c_str(), message.length());
 
-		yyjson_write_err errmsg;
-		error |= !yyjson_mut_write_fp(file, doc, YYJSON_WRITE_ALLOW_INVALID_UNICODE | YYJSON_WRITE_NEWLINE_AT_END, nullptr, &errmsg);
+		size_t jsonlen = 0;
+		yyjson_write_err errmsg = { };
+		auto* json = yyjson_mut_write_opts(doc, YYJSON_WRITE_ALLOW_INVALID_UNICODE | YYJSON_WRITE_NEWLINE_AT_END, nullptr, &jsonlen, &errmsg);
+		if (json)
+		{
+			outmsg.append(json, jsonlen);
+			free(json);
+		}
+		else
+		{
+			error = true;
+		}
 
 		yyjson_mut_doc_free(doc);
 
 		if (error)
 			throw CoreException(INSP_FORMAT("Unable to generate JSON for {}: {}", name, errmsg.msg ? errmsg.msg : "unknown error"));
 #else
-		rapidjson::Writer writer(*this);
+		StringStream stream { outmsg };
+		rapidjson::Writer writer(stream);
 		writer.StartObject();
 		{
 			writer.Key("time", 4);
@@ -136,31 +137,11 @@ public:
 		writer.EndObject();
 
 # ifdef _WIN32
-		fputs("\r\n", file);
+		outmsg.append("\r\n");
 # else
-		fputs("\n", file);
+		outmsg.append("\n");
 # endif
 #endif
-
-		if (!(++lines % flush))
-			fflush(file);
-
-		if (ferror(file))
-			throw CoreException(INSP_FORMAT("Unable to write to {}: {}", name, strerror(errno)));
-	}
-
-#ifndef HAS_YYJSON
-	// RapidJSON API: Write a character to the file.
-	void Put(Ch c)
-	{
-		fputc(c, file);
-	}
-#endif
-
-	bool Tick() override
-	{
-		fflush(file);
-		return true;
 	}
 };
 
@@ -187,8 +168,7 @@ public:
 				fulltarget, tag->source.str(), strerror(errno)));
 		}
 
-		const unsigned long flush = tag->getNum<unsigned long>("flush", 20, 1);
-		return std::make_shared<JSONMethod>(fulltarget, fh, flush, true);
+		return std::make_shared<JSONMethod>(fulltarget, fh, true);
 	}
 };
 
@@ -207,7 +187,7 @@ public:
 
 	Log::MethodPtr Create(const std::shared_ptr<ConfigTag>& tag) override
 	{
-		return std::make_shared<JSONMethod>(name, file, 1, false);
+		return std::make_shared<JSONMethod>(name, file, false);
 	}
 };
 
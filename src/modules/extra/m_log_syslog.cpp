@@ -22,7 +22,7 @@
 #include <syslog.h>
 
 class SyslogMethod final
-	: public Log::Method
+	: public Log::AsyncMethod
 {
 private:
 	// Converts an InspIRCd log level to syslog priority.
@@ -48,10 +48,16 @@ private:
 		return LOG_NOTICE;
 	}
 
-public:
-	void OnLog(time_t time, Log::Level level, const std::string& type, const std::string& message) override
+protected:
+	void Format(time_t time, Log::Level level, const std::string& type, const std::string& message, std::string& out) override
 	{
-		syslog(LevelToPriority(level), "%s: %s", type.c_str(), message.c_str());
+		out.reserve(type.length() + message.length() + 2);
+		out.append(type).append(": ").append(message);
+	}
+
+	void Write(Log::Level level, const std::string& entry) override
+	{
+		syslog(LevelToPriority(level), "%s", entry.c_str());
 	}
 };
 
@@ -70,10 +76,27 @@ public:
 	}
 };
 
+class SyslogConnection final
+{
+public:
+	SyslogConnection()
+	{
+		openlog("inspircd", LOG_NDELAY|LOG_PID, LOG_USER);
+	}
+
+	~SyslogConnection()
+	{
+		closelog();
+	}
+};
+
 class ModuleLogSyslog final
 	: public Module
 {
 private:
+	// This must be declared before the engine so that it is closed after any queued messages have
+	// been written by the engine.
+	SyslogConnection connection;
 	SyslogEngine engine;
 
 public:
@@ -81,12 +104,6 @@ public:
 		: Module(VF_VENDOR, "Provides the ability to log to syslog.")
 		, engine(this)
 	{
-		openlog("inspircd", LOG_NDELAY|LOG_PID, LOG_USER);
-	}
-
-	~ModuleLogSyslog() override
-	{
-		closelog();
 	}
 };
 
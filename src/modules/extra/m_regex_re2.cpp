@@ -29,6 +29,7 @@
 #include "modules/regex.h"
 
 #include <re2/re2.h>
+#include <re2/set.h>
 
 class RE2Pattern final
 	: public Regex::Pattern
@@ -36,6 +37,7 @@ class RE2Pattern final
 private:
 	RE2 regex;
 
+public:
 	static RE2::Options BuildOptions(uint8_t options)
 	{
 		RE2::Options re2options;
@@ -44,7 +46,6 @@ private:
 		return re2options;
 	}
 
-public:
 	RE2Pattern(const Module* mod, const std::string& pattern, uint8_t options)
 		: Regex::Pattern(pattern, options)
 		, regex(pattern, BuildOptions(options))
@@ -80,11 +81,108 @@ public:
 	}
 };
 
+class RE2PatternSet final
+	: public Regex::PatternSet
+{
+private:
+	/** The patterns which have a specific set of options. */
+	struct OptionSet final
+	{
+		/** The patterns combined into a single automaton. */
+		RE2::Set regexset;
+
+		/** The indices within the pattern list of the patterns in the set. */
+		std::vector<size_t> indices;
+
+		OptionSet(uint8_t options)
+			: regexset(RE2Pattern::BuildOptions(options), RE2::ANCHOR_BOTH)
+		{
+		}
+	};
+
+	/** RE2 sets share options between all patterns so patterns are grouped by their options. */
+	std::vector<OptionSet> optionsets;
+
+	/** The indices of the patterns which could not be combined and have to be matched individually. */
+	std::vector<size_t> fallback;
+
+	/** The indices of the patterns which matched within an option set. */
+	std::vector<int> setmatches;
+
+public:
+	RE2PatternSet(const Module* mod, const Regex::PatternList& patterns)
+		: Regex::PatternSet(patterns)
+	{
+		insp::flat_map<uint8_t, size_t> optionidx;
+		for (size_t idx = 0; idx < patterns.size(); ++idx)
+		{
+			const auto& pattern = patterns[idx];
+			auto it = optionidx.find(pattern->GetOptions());
+			if (it == optionidx.end())
+			{
+				it = optionidx.emplace(pattern->GetOptions(), optionsets.size()).first;
+				optionsets.emplace_back(pattern->GetOptions());
+			}
+
+			OptionSet& optionset = optionsets[it->second];
+			if (optionset.regexset.Add(pattern->GetPattern(), nullptr) < 0)
+				fallback.push_back(idx);
+			else
+				optionset.indices.push_back(idx);
+		}
+
+		for (auto& optionset : optionsets)
+		{
+			if (!optionset.regexset.Compile())
+			{
+				// The automaton is too big so match the patterns individually instead.
+				fallback.insert(fallback.end(), optionset.indices.begin(), optionset.indices.end());
+				optionset.indices.clear();
+			}
+		}
+	}
+
+	bool IsMatch(const std::string& text, std::vector<size_t>& matches) override
+	{
+		matches.clear();
+		for (const auto& optionset : optionsets)
+		{
+			if (optionset.indices.empty())
+				continue;
+
+			RE2::Set::ErrorInfo error;
+			if (optionset.regexset.Match(text, &setmatches, &error))
+			{
+				for (const auto setidx : setmatches)
+					matches.push_back(optionset.indices[setidx]);
+			}
+			else if (error.kind != RE2::Set::kNoError)
+			{
+				// The DFA ran out of memory so we have to match the patterns individually.
+				for (const auto idx : optionset.indices)
+				{
+					if (GetPatterns()[idx]->IsMatch(text))
+						matches.push_back(idx);
+				}
+			}
+		}
+
+		for (const auto idx : fallback)
+		{
+			if (GetPatterns()[idx]->IsMatch(text))
+				matches.push_back(idx);
+		}
+
+		std::sort(matches.begin(), matches.end());
+		return !matches.empty();
+	}
+};
+
 class ModuleRegexRE2 final
 	: public Module
 {
 private:
-	Regex::SimpleEngine<RE2Pattern> regex;
+	Regex::SimpleEngine<RE2Pattern, RE2PatternSet> regex;
 
 public:
 	ModuleRegexRE2()
@@ -33,6 +33,7 @@
 
 #include "inspircd.h"
 #include "modules/sql.h"
+#include "threadsocket.h"
 #include "utility/string.h"
 
 #include <sqlite3.h>
@@ -44,11 +45,22 @@ class SQLite3Result final
 	: public SQL::Result
 {
 public:
+	SQL::Error err;
 	int currentrow = 0;
 	int rows = 0;
 	std::vector<std::string> columns;
 	std::vector<SQL::Row> fieldlists;
 
+	SQLite3Result()
+		: err(SQL::SUCCESS)
+	{
+	}
+
+	SQLite3Result(SQL::ErrorCode code, const std::string& message)
+		: err(code, message)
+	{
+	}
+
 	int Rows() override
 	{
 		return rows;
@@ -88,102 +100,644 @@ public:
 	}
 };
 
+/** A handle to an SQLite database which is only ever used by a single worker thread. */
+class SQLite3Connection final
+{
+private:
+	/** A statement which has been prepared and cached for reuse. */
+	struct CachedStatement final
+	{
+		/** The prepared statement. */
+		sqlite3_stmt* stmt;
+
+		/** The number of bytes of query text which the statement was prepared from. */
+		size_t length;
+
+		/** The value of the use counter when the statement was last used. */
+		uint64_t lastused;
+	};
+
+	/** The underlying database handle. */
+	sqlite3* db = nullptr;
+
+	/** The statements prepared on this handle keyed by the query text they were prepared from. */
+	std::unordered_map<std::string, CachedStatement> statements;
+
+	/** The maximum number of statements to keep in the cache. */
+	size_t maxstatements = 0;
+
+	/** A counter which is incremented every time a statement is used. */
+	uint64_t uses = 0;
+
+	/** Prepares the next statement in a query, reusing a cached one if possible.
+	 * @param query The query text.
+	 * @param offset The offset of the statement within the query text.
+	 * @param stmt The location to store the statement or nullptr if there are no more statements.
+	 * @param length The location to store the number of bytes of query text which were consumed.
+	 * @param cache Whether to add a newly prepared statement to the cache.
+	 * @return True if the statement was prepared; otherwise, false.
+	 */
+	bool Prepare(const std::string& query, size_t offset, sqlite3_stmt*& stmt, size_t& length, bool cache)
+	{
+		std::string key(query, offset);
+		auto it = statements.find(key);
+		if (it != statements.end())
+		{
+			it->second.lastused = ++uses;
+			stmt = it->second.stmt;
+			length = it->second.length;
+			return true;
+		}
+
+		const char* start = query.c_str() + offset;
+		const char* tail = nullptr;
+		if (sqlite3_prepare_v2(db, start, static_cast<int>(query.length() - offset), &stmt, &tail) != SQLITE_OK)
+			return false;
+
+		length = tail - start;
+		if (!stmt || !maxstatements || !cache)
+			return true;
+
+		if (statements.size() >= maxstatements)
+		{
+			// Evict the statement which has gone the longest without being used.
+			auto oldest = statements.begin();
+			for (auto sit = statements.begin(); sit != statements.end(); ++sit)
+			{
+				if (sit->second.lastused < oldest->second.lastused)
+					oldest = sit;
+			}
+			sqlite3_finalize(oldest->second.stmt);
+			statements.erase(oldest);
+		}
+		statements.emplace(std::move(key), CachedStatement { stmt, length, ++uses });
+		return true;
+	}
+
+	/** Releases a statement once it has been executed.
+	 * @param query The query text.
+	 * @param offset The offset of the statement within the query text.
+	 * @param stmt The statement to release.
+	 */
+	void Release(const std::string& query, size_t offset, sqlite3_stmt* stmt)
+	{
+		if (statements.count(query.substr(offset)))
+		{
+			sqlite3_reset(stmt);
+			sqlite3_clear_bindings(stmt);
+		}
+		else
+		{
+			sqlite3_finalize(stmt);
+		}
+	}
+
+public:
+	~SQLite3Connection()
+	{
+		Close();
+	}
+
+	/** Opens the database.
+	 * @param path The path to the database.
+	 * @param flags The flags to open the database with.
+	 * @param busytimeout The time in milliseconds to wait for a lock held by another connection.
+	 * @param cachesize The maximum number of prepared statements to cache.
+	 * @return True if the database was opened; otherwise, false.
+	 */
+	bool Open(const std::string& path, int flags, int busytimeout, size_t cachesize)
+	{
+		maxstatements = cachesize;
+		if (sqlite3_open_v2(path.c_str(), &db, flags | SQLITE_OPEN_NOMUTEX, nullptr) != SQLITE_OK)
+		{
+			// Even in case of an error the handle must be closed.
+			sqlite3_close(db);
+			db = nullptr;
+			return false;
+		}
+
+		sqlite3_busy_timeout(db, busytimeout);
+		return true;
+	}
+
+	/** Closes the database, finalizing all cached statements. */
+	void Close()
+	{
+		for (const auto& [_, statement] : statements)
+			sqlite3_finalize(statement.stmt);
+		statements.clear();
+
+		if (db)
+		{
+			sqlite3_close(db);
+			db = nullptr;
+		}
+	}
+
+	/** Aborts the query which is currently executing. This is safe to call from any thread. */
+	void Interrupt()
+	{
+		if (db)
+			sqlite3_interrupt(db);
+	}
+
+	/** Retrieves the underlying database handle. */
+	sqlite3* GetHandle() const { return db; }
+
+	/** Executes every statement in a query. If a statement returns rows then the result contains
+	 * the rows from the last such statement.
+	 * @param query The query to execute.
+	 * @param params The values of the numbered parameters (?1, ?2, etc) in the query.
+	 * @param readonly Whether the query must not modify the database.
+	 * @param cache Whether the statements of the query are worth caching.
+	 * @return The result of the query or nullptr if readonly was set and the query was not read-only.
+	 */
+	std::unique_ptr<SQLite3Result> Execute(const std::string& query, const std::vector<std::string>& params, bool readonly, bool cache)
+	{
+		if (!db)
+			return std::make_unique<SQLite3Result>(SQL::BAD_CONN, "Database connection is null");
+
+		auto res = std::make_unique<SQLite3Result>();
+		for (size_t offset = 0; offset < query.length(); )
+		{
+			sqlite3_stmt* stmt;
+			size_t length;
+			if (!Prepare(query, offset, stmt, length, cache))
+				return std::make_unique<SQLite3Result>(SQL::QSEND_FAIL, sqlite3_errmsg(db));
+
+			if (!stmt)
+			{
+				// Only whitespace or comments remain.
+				if (!length)
+					break;
+
+				offset += length;
+				continue;
+			}
+
+			if (readonly && !sqlite3_stmt_readonly(stmt))
+			{
+				Release(query, offset, stmt);
+				return nullptr;
+			}
+
+			const int paramcount = sqlite3_bind_parameter_count(stmt);
+			for (int i = 1; i <= paramcount; i++)
+			{
+				const char* name = sqlite3_bind_parameter_name(stmt, i);
+				const size_t index = name ? ConvToNum<size_t>(name + 1) : 0;
+				if (index && index <= params.size())
+				{
+					const std::string& value = params[index - 1];
+					sqlite3_bind_text(stmt, i, value.c_str(), static_cast<int>(value.length()), SQLITE_STATIC);
+				}
+			}
+
+			const int cols = sqlite3_column_count(stmt);
+			if (cols)
+			{
+				res->rows = 0;
+				res->fieldlists.clear();
+				res->columns.resize(cols);
+				for (int i = 0; i < cols; i++)
+					res->columns[i] = sqlite3_column_name(stmt, i);
+			}
+
+			int err;
+			while ((err = sqlite3_step(stmt)) == SQLITE_ROW)
+			{
+				// Add the row
+				SQL::Row& row = res->fieldlists.emplace_back(cols);
+				for (int i = 0; i < cols; i++)
+				{
+					const char* txt = (const char*)sqlite3_column_text(stmt, i);
+					if (txt)
+						row[i] = txt;
+				}
+				res->rows++;
+			}
+
+			if (err != SQLITE_DONE)
+			{
+				res = std::make_unique<SQLite3Result>(SQL::QREPLY_FAIL, sqlite3_errmsg(db));
+				Release(query, offset, stmt);
+				break;
+			}
+
+			Release(query, offset, stmt);
+			offset += length;
+		}
+		return res;
+	}
+};
+
+/** The thread which executes queries which modify a database and delivers results to the main thread. */
+class DatabaseThread final
+	: public SocketThread
+{
+private:
+	SQLConn& parent;
+
+public:
+	DatabaseThread(SQLConn& p)
+		: parent(p)
+	{
+	}
+
+	void OnStart() override;
+	void OnNotify() override;
+
+	/** Waits for the queue to change. The queue lock MUST be held. */
+	void Wait()
+	{
+		WaitForQueue();
+	}
+};
+
+/** A thread which executes read-only queries using its own read-only connection. */
+class ReaderThread final
+	: public Thread
+{
+private:
+	SQLConn& parent;
+
+public:
+	SQLite3Connection conn;
+
+	ReaderThread(SQLConn& p)
+		: parent(p)
+	{
+	}
+
+	void OnStart() override;
+};
+
 class SQLConn final
 	: public SQL::Provider
 {
-	sqlite3* conn;
+private:
+	/** A query which is waiting to be executed or is currently executing. */
+	struct QueueItem final
+	{
+		/** The query to deliver the result to or nullptr if its creator has been unloaded. */
+		SQL::Query* query;
+
+		/** The text of the query. */
+		const std::string querystr;
+
+		/** The values of the numbered parameters in the query. */
+		const std::vector<std::string> params;
+
+		/** The module which submitted the query. */
+		Module* const creator;
+
+		/** Whether the query has to be executed on the read-write connection. */
+		bool write;
+
+		/** Whether the statements of the query are worth caching. */
+		const bool cache;
+
+		/** Whether a worker is currently executing the query. */
+		bool running = false;
+
+		QueueItem(SQL::Query* q, const std::string& qs, std::vector<std::string>&& ps, bool w, bool c)
+			: query(q)
+			, querystr(qs)
+			, params(std::move(ps))
+			, creator(q->creator)
+			, write(w)
+			, cache(c)
+		{
+		}
+	};
+
+	/** A list of queries which have finished executing. */
+	typedef std::vector<std::pair<SQL::Query*, std::unique_ptr<SQLite3Result>>> ResultList;
+
+	/** The <database> tag which configured this connection. */
 	std::shared_ptr<ConfigTag> config;
 
+	/** The queries which have been submitted in the order they were submitted. */
+	std::list<QueueItem> queue;
+
+	/** The queries which have finished but have not been delivered yet. */
+	ResultList results;
+
+	/** Whether the workers should shut down. */
+	bool shutdown = false;
+
+	/** The read-write connection to the database. */
+	SQLite3Connection writer;
+
+	/** The thread which owns the read-write connection. */
+	DatabaseThread dispatcher;
+
+	/** The threads which own a read-only connection. */
+	std::vector<ReaderThread*> readers;
+
+	/** Finds the next query which a worker may start. Queries from a module are ordered with
+	 * respect to each other: reads from it may run concurrently but a write only starts once
+	 * its earlier queries have finished and blocks its later queries until it has finished.
+	 * Queries from different modules do not wait for each other. The queue lock MUST be held.
+	 * @param write Whether the worker can execute queries which modify the database.
+	 * @return The query to execute or the end of the queue if there is none.
+	 */
+	std::list<QueueItem>::iterator Claim(bool write)
+	{
+		// Maps each module seen so far to whether it has an unfinished write.
+		insp::flat_map<Module*, bool> seen;
+		for (auto it = queue.begin(); it != queue.end(); ++it)
+		{
+			auto sit = seen.find(it->creator);
+			if (!it->running && (write || !it->write))
+			{
+				if (sit == seen.end() || (!sit->second && !it->write))
+					return it;
+			}
+
+			if (sit == seen.end())
+				seen.emplace(it->creator, it->write);
+			else
+				sit->second |= it->write;
+		}
+		return queue.end();
+	}
+
+	/** Converts placeholders which make up a whole string literal (e.g. '$nick') into numbered
+	 * parameters so that the query text is the same whatever the values are.
+	 * @param q The query text.
+	 * @param marker The character which starts a placeholder.
+	 * @param resolve Retrieves the value of a placeholder from its name.
+	 * @param out The location to store the query text with numbered parameters.
+	 * @param params The location to store the values of the numbered parameters.
+	 * @return False if a placeholder is used anywhere else and has to be substituted into the text.
+	 */
+	static bool BindPlaceholders(const std::string& q, char marker, const std::function<std::string(const std::string&)>& resolve,
+		std::string& out, std::vector<std::string>& params)
+	{
+		bool quoted = false;
+		for (size_t i = 0; i < q.length(); ++i)
+		{
+			const char chr = q[i];
+			if (chr != marker)
+			{
+				if (chr == '\'')
+					quoted = !quoted;
+				out.push_back(chr);
+				continue;
+			}
+
+			std::string name;
+			size_t end = i + 1;
+			while (marker == '$' && end < q.length() && isalnum(q[end]))
+				name.push_back(q[end++]);
+
+			// The placeholder must be directly between the quotes of a literal.
+			if (!quoted || q[i - 1] != '\'' || (i >= 2 && q[i - 2] == '\'')
+				|| end >= q.length() || q[end] != '\'' || (end + 1 < q.length() && q[end + 1] == '\''))
+				return false;
+
+			params.push_back(resolve(name));
+			out.back() = '?';
+			out.append(ConvToStr(params.size()));
+			quoted = false;
+			i = end;
+		}
+		return true;
+	}
+
+	/** Queues a query for execution.
+	 * @param query The query to deliver the result to.
+	 * @param q The text of the query.
+	 * @param params The values of the numbered parameters in the query.
+	 * @param cache Whether the statements of the query are worth caching.
+	 */
+	void Submit(SQL::Query* query, const std::string& q, std::vector<std::string>&& params, bool cache)
+	{
+		ServerInstance->Logs.Debug(MODNAME, "Queueing SQLite3 query: {}", q);
+		dispatcher.LockQueue();
+		queue.emplace_back(query, q, std::move(params), readers.empty() || !IsReadQuery(q), cache);
+		dispatcher.UnlockQueueWakeup();
+	}
+
+	/** Determines whether a query is a single SELECT statement which can be sent to a reader. The
+	 * readers check this again before executing it so a false positive is handed back to the writer.
+	 * @param query The query to check.
+	 */
+	static bool IsReadQuery(const std::string& query)
+	{
+		size_t start = query.find_first_not_of(" \t\r\n(");
+		if (start == std::string::npos || !insp::equalsci(query.substr(start, 6), "select"))
+			return false;
+
+		size_t semicolon = query.find(';');
+		return semicolon == std::string::npos || query.find_first_not_of(" \t\r\n;", semicolon) == std::string::npos;
+	}
+
 public:
 	SQLConn(Module* Parent, const std::shared_ptr<ConfigTag>& tag)
 		: SQL::Provider(Parent, tag->getString("id"))
 		, config(tag)
+		, dispatcher(*this)
 	{
-		std::string host = tag->getString("hostname");
-		if (sqlite3_open_v2(host.c_str(), &conn, SQLITE_OPEN_READWRITE, nullptr) != SQLITE_OK)
+		const std::string host = tag->getString("hostname");
+		const int busytimeout = static_cast<int>(tag->getDuration("busytimeout", 5, 0, 600) * 1000);
+		const size_t cachesize = tag->getNum<size_t>("statementcache", 64, 0, 10000);
+
+		if (!writer.Open(host, SQLITE_OPEN_READWRITE, busytimeout, cachesize))
 		{
-			// Even in case of an error conn must be closed
-			sqlite3_close(conn);
-			conn = nullptr;
 			ServerInstance->Logs.Critical(MODNAME, "WARNING: Could not open DB with id: " + tag->getString("id"));
 		}
-	}
+		else if (tag->getBool("wal", true))
+		{
+			// WAL mode allows the readers to keep reading whilst the writer is writing.
+			char* error = nullptr;
+			if (sqlite3_exec(writer.GetHandle(), "PRAGMA journal_mode=WAL;", nullptr, nullptr, &error) != SQLITE_OK)
+			{
+				ServerInstance->Logs.Warning(MODNAME, "Unable to enable WAL mode for DB with id {}: {}", GetId(), error ? error : "unknown error");
+				sqlite3_free(error);
+			}
+		}
 
-	~SQLConn() override
-	{
-		if (conn)
+		const unsigned long readercount = writer.GetHandle() ? tag->getNum<unsigned long>("readers", 2, 0, 16) : 0;
+		for (unsigned long i = 0; i < readercount; ++i)
 		{
-			sqlite3_interrupt(conn);
-			sqlite3_close(conn);
+			auto* reader = new ReaderThread(*this);
+			if (!reader->conn.Open(host, SQLITE_OPEN_READONLY, busytimeout, cachesize))
+			{
+				ServerInstance->Logs.Warning(MODNAME, "Unable to open a read-only connection to DB with id {}", GetId());
+				delete reader;
+				break;
+			}
+			readers.push_back(reader);
 		}
+
+		dispatcher.Start();
+		for (auto* reader : readers)
+			reader->Start();
 	}
 
-	void Query(SQL::Query* query, const std::string& q)
+	~SQLConn() override
 	{
-		if (!conn)
-		{
-			SQL::Error error(SQL::BAD_CONN, "Database connection is null");
-			query->OnError(error);
-			return;
-		}
+		dispatcher.LockQueue();
+		shutdown = true;
+		writer.Interrupt();
+		for (auto* reader : readers)
+			reader->conn.Interrupt();
+		dispatcher.UnlockQueueWakeup();
 
-		SQLite3Result res;
-		sqlite3_stmt* stmt;
-		int err = sqlite3_prepare_v2(conn, q.c_str(), static_cast<int>(q.length()), &stmt, nullptr);
-		if (err != SQLITE_OK)
+		for (auto* reader : readers)
 		{
-			SQL::Error error(SQL::QSEND_FAIL, sqlite3_errmsg(conn));
-			query->OnError(error);
-			return;
+			reader->Stop();
+			delete reader;
 		}
-		int cols = sqlite3_column_count(stmt);
-		res.columns.resize(cols);
-		for(int i=0; i < cols; i++)
+		dispatcher.Stop();
+
+		// Deliver the queries which finished and fail the ones which never started.
+		DeliverResults();
+		SQL::Error err(SQL::BAD_CONN, "Database connection was closed");
+		for (const auto& item : queue)
 		{
-			res.columns[i] = sqlite3_column_name(stmt, i);
+			if (!item.query)
+				continue;
+
+			item.query->OnError(err);
+			delete item.query;
 		}
-		while (true)
+	}
+
+	/** Retrieves the <database> tag which configured this connection. */
+	const std::shared_ptr<ConfigTag>& GetConfig() const { return config; }
+
+	/** Executes queries until the connection is closed. Called on a worker thread.
+	 * @param conn The connection to execute queries with.
+	 * @param write Whether conn can execute queries which modify the database.
+	 */
+	void Work(SQLite3Connection& conn, bool write)
+	{
+		dispatcher.LockQueue();
+		while (!shutdown)
 		{
-			err = sqlite3_step(stmt);
-			if (err == SQLITE_ROW)
+			auto item = Claim(write);
+			if (item == queue.end())
 			{
-				// Add the row
-				res.fieldlists.resize(res.rows + 1);
-				res.fieldlists[res.rows].resize(cols);
-				for(int i=0; i < cols; i++)
+				dispatcher.Wait();
+				continue;
+			}
+
+			// The main thread never erases a running item so it is safe to use it unlocked.
+			item->running = true;
+			dispatcher.UnlockQueue();
+			std::unique_ptr<SQLite3Result> res = conn.Execute(item->querystr, item->params, !write, item->cache);
+			dispatcher.LockQueue();
+
+			if (res)
+			{
+				if (item->query)
 				{
-					const char* txt = (const char*)sqlite3_column_text(stmt, i);
-					if (txt)
-						res.fieldlists[res.rows][i] = txt;
+					// Results which finish before the main thread wakes up are delivered with this one.
+					if (results.empty())
+						dispatcher.NotifyParent();
+					results.emplace_back(item->query, std::move(res));
 				}
-				res.rows++;
+				queue.erase(item);
 			}
-			else if (err == SQLITE_DONE)
+			else
 			{
-				query->OnResult(res);
-				break;
+				// The query modifies the database so it needs to be executed by the writer.
+				item->running = false;
+				item->write = true;
 			}
+
+			// Finishing a query may allow a query which another worker is waiting for to start.
+			dispatcher.UnlockQueueWakeup();
+			dispatcher.LockQueue();
+		}
+		dispatcher.UnlockQueue();
+	}
+
+	/** Executes queries on the read-write connection. Called on the writer thread. */
+	void WorkWriter()
+	{
+		Work(writer, true);
+	}
+
+	/** Delivers the results of finished queries to their callers. */
+	void DeliverResults()
+	{
+		ResultList delivering;
+		dispatcher.LockQueue();
+		delivering.swap(results);
+		dispatcher.UnlockQueue();
+
+		for (const auto& [query, result] : delivering)
+		{
+			if (result->err.code == SQL::SUCCESS)
+				query->OnResult(*result);
 			else
+				query->OnError(result->err);
+			delete query;
+		}
+	}
+
+	/** Fails all queries which were submitted by a module.
+	 * @param mod The module which is being unloaded.
+	 */
+	void RemoveQueries(Module* mod)
+	{
+		std::vector<SQL::Query*> removed;
+		dispatcher.LockQueue();
+		for (auto it = queue.begin(); it != queue.end(); )
+		{
+			if (!it->query || it->creator != mod)
 			{
-				SQL::Error error(SQL::QREPLY_FAIL, sqlite3_errmsg(conn));
-				query->OnError(error);
-				break;
+				++it;
+				continue;
+			}
+
+			removed.push_back(it->query);
+			if (it->running)
+			{
+				// The worker will discard the result when it finishes.
+				it->query = nullptr;
+				++it;
 			}
+			else
+				it = queue.erase(it);
 		}
-		sqlite3_finalize(stmt);
+		dispatcher.UnlockQueue();
+
+		SQL::Error err(SQL::BAD_DBID);
+		for (auto* query : removed)
+		{
+			query->OnError(err);
+			delete query;
+		}
+		DeliverResults();
 	}
 
 	void Submit(SQL::Query* query, const std::string& q) override
 	{
-		ServerInstance->Logs.Debug(MODNAME, "Executing SQLite3 query: {}", q);
-		Query(query, q);
-		delete query;
+		Submit(query, q, {}, true);
 	}
 
 	void Submit(SQL::Query* query, const std::string& q, const SQL::ParamList& p) override
 	{
 		std::string res;
+		std::vector<std::string> params;
 		unsigned int param = 0;
+		const auto resolve = [&](const std::string&) {
+			return param < p.size() ? p[param++] : std::string();
+		};
+		if (BindPlaceholders(q, '?', resolve, res, params))
+		{
+			Submit(query, res, std::move(params), true);
+			return;
+		}
+
+		// The values have to be substituted into the query text so it is not worth caching.
+		res.clear();
+		param = 0;
 		for (const auto chr : q)
 		{
 			if (chr != '?')
@@ -198,12 +752,25 @@ public:
 				}
 			}
 		}
-		Submit(query, res);
+		Submit(query, res, {}, false);
 	}
 
 	void Submit(SQL::Query* query, const std::string& q, const SQL::ParamMap& p) override
 	{
 		std::string res;
+		std::vector<std::string> params;
+		const auto resolve = [&p](const std::string& field) {
+			auto it = p.find(field);
+			return it != p.end() ? it->second : std::string();
+		};
+		if (BindPlaceholders(q, '$', resolve, res, params))
+		{
+			Submit(query, res, std::move(params), true);
+			return;
+		}
+
+		// The values have to be substituted into the query text so it is not worth caching.
+		res.clear();
 		for(std::string::size_type i = 0; i < q.length(); i++)
 		{
 			if (q[i] != '$')
@@ -225,10 +792,25 @@ public:
 				}
 			}
 		}
-		Submit(query, res);
+		Submit(query, res, {}, false);
 	}
 };
 
+void DatabaseThread::OnStart()
+{
+	parent.WorkWriter();
+}
+
+void DatabaseThread::OnNotify()
+{
+	parent.DeliverResults();
+}
+
+void ReaderThread::OnStart()
+{
+	parent.Work(conn, false);
+}
+
 class ModuleSQLite3 final
 	: public Module
 {
@@ -250,6 +832,9 @@ public:
 	{
 		ServerInstance->Logs.Normal(MODNAME, "Module was compiled against SQLite version {} and is running against version {}",
 			SQLITE_VERSION, sqlite3_libversion());
+
+		if (!sqlite3_threadsafe())
+			throw ModuleException(this, "SQLite was built without thread support which is required to execute queries asynchronously");
 	}
 
 	void ClearConns()
@@ -264,17 +849,44 @@ public:
 
 	void ReadConfig(ConfigStatus& status) override
 	{
-		ClearConns();
-
+		ConnMap newconns;
 		for (const auto& [_, tag] : ServerInstance->Config->ConfTags("database"))
 		{
 			if (!insp::equalsci(tag->getString("module"), "sqlite"))
 				continue;
 
+			const std::string id = tag->getString("id");
+			auto it = conns.find(id);
+			if (it != conns.end())
+			{
+				const auto& olditems = it->second->GetConfig()->GetItems();
+				const auto& newitems = tag->GetItems();
+				if (std::equal(olditems.begin(), olditems.end(), newitems.begin(), newitems.end()))
+				{
+					// The connection has not changed so keep its workers and statement cache.
+					newconns.emplace(id, it->second);
+					conns.erase(it);
+					continue;
+				}
+
+				ServerInstance->Modules.DelService(*it->second);
+				delete it->second;
+				conns.erase(it);
+			}
+
 			auto* conn = new SQLConn(this, tag);
-			conns.emplace(tag->getString("id"), conn);
+			newconns.emplace(id, conn);
 			ServerInstance->Modules.AddService(*conn);
 		}
+
+		ClearConns();
+		conns.swap(newconns);
+	}
+
+	void OnUnloadModule(Module* mod) override
+	{
+		for (const auto& [_, conn] : conns)
+			conn->RemoveQueries(mod);
 	}
 };
 
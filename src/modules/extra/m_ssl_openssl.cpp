@@ -62,6 +62,11 @@
 # define INSPIRCD_OPENSSL_AUTO_DH
 #endif
 
+#if defined SSL_OP_ENABLE_KTLS && !defined OPENSSL_NO_KTLS
+# define INSPIRCD_OPENSSL_KTLS
+static constexpr size_t KTLS_IOV_MAX = std::min<size_t>(IOV_MAX, 128);
+#endif
+
 static int exdataindex;
 static Module* thismod;
 
@@ -328,6 +333,10 @@ namespace OpenSSL
 		 */
 		const unsigned int outrecsize;
 
+		/** True if encryption should be offloaded to the kernel when possible, false if not
+		 */
+		bool ktls;
+
 		static int error_callback(const char* str, size_t len, void* u)
 		{
 			Profile* profile = reinterpret_cast<Profile*>(u);
@@ -369,6 +378,12 @@ namespace OpenSSL
 				setoptions |= SSL_OP_NO_TLSv1_3;
 #endif
 
+#ifdef INSPIRCD_OPENSSL_KTLS
+			// Kernel TLS is opt-in as it requires a socket BIO instead of our own one.
+			if (ktls)
+				setoptions |= SSL_OP_ENABLE_KTLS;
+#endif
+
 			if (!setoptions && !clearoptions)
 				return; // Nothing to do
 
@@ -387,7 +402,17 @@ namespace OpenSSL
 			, clientctx(SSL_CTX_new(TLS_client_method()))
 			, allowrenego(tag->getBool("renegotiation")) // Disallow by default
 			, outrecsize(tag->getNum<unsigned int>("outrecsize", 2048, 512, 16384))
+			, ktls(tag->getBool("ktls"))
 		{
+#ifndef INSPIRCD_OPENSSL_KTLS
+			if (ktls)
+			{
+				ServerInstance->Logs.Warning(MODNAME, "Kernel TLS was enabled for the {} profile at {} but is not supported by this build of OpenSSL; ignoring.",
+					name, tag->source.str());
+				ktls = false;
+			}
+#endif
+
 #ifndef INSPIRCD_OPENSSL_AUTO_DH
 			if ((!ctx.SetDH(dh)) || (!clientctx.SetDH(dh)))
 				throw Exception("Couldn't set DH parameters");
@@ -493,6 +518,7 @@ namespace OpenSSL
 		const std::vector<const EVP_MD*> GetDigests() { return digests; }
 		bool AllowRenegotiation() const { return allowrenego; }
 		unsigned int GetOutgoingRecordSize() const { return outrecsize; }
+		bool UseKernelTLS() const { return ktls; }
 	};
 
 	namespace BIOMethod
@@ -544,8 +570,15 @@ class OpenSSLIOHook final
 {
 private:
 	SSL* sess;
+	StreamSocket* const streamsock;
 	bool data_to_write = false;
 
+	/** Whether the kernel is encrypting data sent to the peer. */
+	bool ktlssend = false;
+
+	/** Whether the kernel is decrypting data received from the peer. */
+	bool ktlsrecv = false;
+
 	// Returns 1 if handshake succeeded, 0 if it is still in progress, -1 if it failed
 	int Handshake(StreamSocket* user)
 	{
@@ -580,6 +613,15 @@ private:
 
 			status = STATUS_OPEN;
 
+			// These are always false for our own BIO so there's no need to check the profile.
+			ktlssend = BIO_get_ktls_send(SSL_get_wbio(sess));
+			ktlsrecv = BIO_get_ktls_recv(SSL_get_rbio(sess));
+			if (GetProfile().UseKernelTLS())
+			{
+				ServerInstance->Logs.Debug(MODNAME, "Session {} kernel TLS offload: send {} receive {}", fmt::ptr(sess),
+					ktlssend ? "on" : "off", ktlsrecv ? "on" : "off");
+			}
+
 			SocketEngine::ChangeEventMask(user, FD_WANT_POLL_READ | FD_WANT_NO_WRITE | FD_ADD_TRIAL_WRITE);
 
 			return 1;
@@ -601,7 +643,73 @@ private:
 		sess = nullptr;
 		certificate = nullptr;
 		status = STATUS_NONE;
+		ktlssend = ktlsrecv = false;
+	}
+
+#ifdef INSPIRCD_OPENSSL_KTLS
+	// Writes the send queue directly to a socket which the kernel is encrypting. Returns 1 if the
+	// send queue was written, 0 if the socket blocked, -1 on fatal error.
+	int WriteKernel(StreamSocket* user, StreamSocket::SendQueue& sendq)
+	{
+		while (!sendq.empty())
+		{
+			SocketEngine::IOVector iovecs[KTLS_IOV_MAX];
+			int bufcount = 0;
+			size_t bufbytes = 0;
+			for (auto it = sendq.begin(); it != sendq.end() && bufcount < static_cast<int>(KTLS_IOV_MAX); ++it, ++bufcount)
+			{
+				iovecs[bufcount].iov_base = const_cast<char*>(it->data());
+				iovecs[bufcount].iov_len = it->length();
+				bufbytes += it->length();
+			}
+
+			ssize_t ret = SocketEngine::WriteV(user, iovecs, bufcount);
+			if (ret > 0)
+			{
+				for (size_t remaining = ret; remaining && !sendq.empty(); )
+				{
+					const size_t frontlen = sendq.front().length();
+					if (frontlen > remaining)
+					{
+						sendq.erase_front(remaining);
+						break;
+					}
+
+					remaining -= frontlen;
+					sendq.pop_front();
+				}
+
+				if (static_cast<size_t>(ret) < bufbytes)
+				{
+					// Partial write, the socket is going to block.
+					SocketEngine::ChangeEventMask(user, FD_WANT_SINGLE_WRITE);
+					return 0;
+				}
+			}
+			else if (ret == 0)
+			{
+				CloseSession();
+				user->SetError("Connection closed");
+				return -1;
+			}
+			else if (SocketEngine::IgnoreError())
+			{
+				SocketEngine::ChangeEventMask(user, FD_WANT_SINGLE_WRITE);
+				return 0;
+			}
+			else if (errno != EINTR)
+			{
+				user->SetError(SocketEngine::LastError());
+				CloseSession();
+				return -1;
+			}
+		}
+
+		data_to_write = false;
+		SocketEngine::ChangeEventMask(user, FD_WANT_POLL_READ | FD_WANT_NO_WRITE);
+		return 1;
 	}
+#endif
 
 	void VerifyCertificate()
 	{
@@ -717,9 +825,7 @@ private:
 			// The other side is trying to renegotiate, kill the connection and change status
 			// to STATUS_NONE so CheckRenego() closes the session
 			status = STATUS_NONE;
-			BIO* bio = SSL_get_rbio(sess);
-			EventHandler* eh = static_cast<StreamSocket*>(BIO_get_data(bio));
-			SocketEngine::Shutdown(eh, 2);
+			SocketEngine::Shutdown(streamsock, 2);
 		}
 	}
 
@@ -761,10 +867,20 @@ public:
 	OpenSSLIOHook(const std::shared_ptr<IOHookProvider>& hookprov, StreamSocket* sock, SSL* session)
 		: SSLIOHook(hookprov)
 		, sess(session)
+		, streamsock(sock)
 	{
-		// Create BIO instance and store a pointer to the socket in it which will be used by the read and write functions
-		BIO* bio = BIO_new(biomethods);
-		BIO_set_data(bio, sock);
+		BIO* bio;
+#ifdef INSPIRCD_OPENSSL_KTLS
+		// OpenSSL can only enable kernel TLS on its own socket BIO.
+		if (GetProfile().UseKernelTLS())
+			bio = BIO_new_socket(sock->GetFd(), BIO_NOCLOSE);
+		else
+#endif
+		{
+			// Create BIO instance and store a pointer to the socket in it which will be used by the read and write functions
+			bio = BIO_new(biomethods);
+			BIO_set_data(bio, sock);
+		}
 		SSL_set_bio(sess, bio, bio);
 
 		SSL_set_ex_data(sess, exdataindex, this);
@@ -846,6 +962,12 @@ public:
 
 		data_to_write = true;
 
+#ifdef INSPIRCD_OPENSSL_KTLS
+		// The kernel encrypts anything written to the socket so we can skip OpenSSL entirely.
+		if (ktlssend)
+			return WriteKernel(user, sendq);
+#endif
+
 		// Session is ready for transferring application data
 		while (!sendq.empty())
 		{
@@ -911,6 +1033,11 @@ public:
 		out.append(UnknownIfNULL(SSL_get_cipher(sess)));
 	}
 
+	bool IsKernelOffloaded() const override
+	{
+		return ktlssend || ktlsrecv;
+	}
+
 	bool GetServerName(std::string& out) const override
 	{
 		const char* name = SSL_get_servername(sess, TLSEXT_NAMETYPE_host_name);
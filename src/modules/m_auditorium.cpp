@@ -135,6 +135,12 @@ public:
 		return MOD_RES_DENY;
 	}
 
+	ModResult OnNamesListVariant(LocalUser* issuer, Channel* chan, std::string& variant) override
+	{
+		// The members which are visible depend on who is asking.
+		return chan->IsModeSet(&aum) ? MOD_RES_DENY : MOD_RES_PASSTHRU;
+	}
+
 	/** Build CUList for showing this join/part/kick */
 	void BuildExcept(Membership* memb, CUList& excepts)
 	{
@@ -318,6 +318,15 @@ Cap::ExtItem::ExtItem(Module* mod)
 {
 }
 
+void Cap::ExtItem::Delete(Extensible* container, void* item)
+{
+	// The capabilities are going away so the fingerprint needs to go with them.
+	LocalUser* user = IS_LOCAL(static_cast<User*>(container));
+	if (user)
+		user->capfingerprint = 0;
+	IntExtItem::Delete(container, item);
+}
+
 std::string Cap::ExtItem::ToHuman(const Extensible* container, void* item) const noexcept
 {
 	return SerializeCaps(container, true);
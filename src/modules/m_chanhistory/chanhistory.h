@@ -0,0 +1,318 @@
+/*
+ * InspIRCd -- Internet Relay Chat Daemon
+ *
+ * This file is part of InspIRCd.  InspIRCd is free software: you can
+ * redistribute it and/or modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation, version 2.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#pragma once
+
+#include "inspircd.h"
+#include "clientprotocolmsg.h"
+
+/** A message which has been read from the history log. The views point into the log and are
+ * only valid until the segment which contains the message is released.
+ */
+struct HistoryRecord final
+{
+	/** The time at which the message was sent in milliseconds since the UNIX epoch. */
+	uint64_t time = 0;
+
+	/** The type of message (PRIVMSG or NOTICE). */
+	MessageType type = MessageType::PRIVMSG;
+
+	/** The name of the channel the message was sent to. */
+	std::string_view channel;
+
+	/** The message id of the message or an empty string if it does not have one. */
+	std::string_view msgid;
+
+	/** The nick!user\@host of the user who sent the message. */
+	std::string_view source;
+
+	/** The text of the message. */
+	std::string_view text;
+
+	/** The other tags of the message in the compact encoding used by the log. Use NextTag() to decode them. */
+	std::string_view tags;
+
+	/** Encodes a message tag in the compact encoding used by the log.
+	 * @param out The string to append the encoded tag to.
+	 * @param name The name of the tag.
+	 * @param value The value of the tag.
+	 * @return True if the tag was encoded; otherwise, false if it was too long.
+	 */
+	static bool EncodeTag(std::string& out, std::string_view name, std::string_view value);
+
+	/** Decodes the next tag from an encoded tag list.
+	 * @param tagdata The encoded tags. Advanced past the decoded tag.
+	 * @param name The location to store the name of the tag.
+	 * @param value The location to store the value of the tag.
+	 * @return True if a tag was decoded; otherwise, false if the end of the list was reached.
+	 */
+	static bool NextTag(std::string_view& tagdata, std::string_view& name, std::string_view& value);
+};
+
+/** An append-only log of messages which is split into fixed size segments. When persistence is
+ * enabled the segments are memory-mapped files which are reloaded when the module is loaded.
+ */
+class HistoryLog final
+{
+public:
+	/** The location of a message within the log. */
+	struct Position final
+	{
+		/** The identifier of the segment which contains the message. */
+		uint32_t segment;
+
+		/** The offset of the message within the segment. */
+		uint32_t offset;
+	};
+
+	/** A callback which is called for every message in the log when it is opened. */
+	typedef std::function<void(const HistoryRecord&, const Position&)> LoadCallback;
+
+private:
+	struct Segment;
+
+	/** The directory the segment files are stored in or an empty string if the log is only kept in memory. */
+	std::string directory;
+
+	/** The size of each segment. */
+	size_t segmentsize = 0;
+
+	/** The segments in the log keyed by their identifier. */
+	std::map<uint32_t, std::unique_ptr<Segment>> segments;
+
+	/** The segment that messages are currently appended to. */
+	Segment* active = nullptr;
+
+	/** Creates a new segment and makes it the active segment. If the file which backs the
+	 * segment can not be created then the segment is only stored in memory. The previous active
+	 * segment is removed if all of its records have already been released.
+	 */
+	void CreateSegment();
+
+	/** Opens an existing segment file and reads the messages in it.
+	 * @param id The identifier of the segment.
+	 * @param path The path to the segment file.
+	 * @param callback The callback to call for every message in the segment.
+	 */
+	void LoadSegment(uint32_t id, const std::string& path, const LoadCallback& callback);
+
+	/** Removes a segment from the log, deleting its file if there is one.
+	 * @param segment The segment to remove.
+	 */
+	void RemoveSegment(Segment* segment);
+
+public:
+	HistoryLog();
+	~HistoryLog();
+
+	/** Opens the log, loading any existing segments.
+	 * @param dir The directory to store the segments in or an empty string to only store them in memory.
+	 * @param size The size of each segment.
+	 * @param callback The callback to call for every message which is already in the log.
+	 */
+	void Open(const std::string& dir, size_t size, const LoadCallback& callback);
+
+	/** Closes the log, unmapping all segments. Segment files are kept so the log can be reopened later. */
+	void Close();
+
+	/** Appends a message to the log.
+	 * @param record The message to append.
+	 * @param pos The location to store the position of the message.
+	 * @return True if the message was appended; otherwise, false.
+	 */
+	bool Append(const HistoryRecord& record, Position& pos);
+
+	/** Reads a message from the log.
+	 * @param pos The position of the message.
+	 * @param record The location to store the message.
+	 * @return True if the message was read; otherwise, false.
+	 */
+	bool Read(const Position& pos, HistoryRecord& record) const;
+
+	/** Releases a message which has been removed from the history of its channel. Segments
+	 * which no longer contain any messages are deleted.
+	 * @param pos The position of the message.
+	 */
+	void Release(const Position& pos);
+
+	/** Retrieves the number of segments in the log. */
+	size_t GetSegmentCount() const { return segments.size(); }
+
+	/** Determines whether the log has been opened. */
+	bool IsOpen() const { return segmentsize != 0; }
+
+	/** Determines whether the log is stored on disk. */
+	bool IsPersistent() const { return !directory.empty(); }
+};
+
+/** A message within the history of a channel. */
+struct HistoryEntry final
+{
+	/** The time at which the message was sent in milliseconds since the UNIX epoch. */
+	uint64_t time;
+
+	/** The position of the message within the log. */
+	HistoryLog::Position pos;
+};
+
+/** The history of a single channel. */
+struct HistoryChannel final
+{
+	/** The sequence number of the first entry. Sequence numbers are never reused so they can be
+	 * used to refer to an entry after older entries have been removed.
+	 */
+	uint64_t firstseq = 0;
+
+	/** The messages in the history of the channel ordered by time. */
+	std::deque<HistoryEntry> entries;
+
+	/** Maps a hash of the message id of each entry to its sequence number. */
+	std::unordered_map<uint64_t, uint64_t> msgids;
+
+	/** The messages in the history of the channel which have been built for sending to users. These
+	 * keep their serialized form between sends so replaying history does not rebuild it every time.
+	 */
+	std::deque<std::unique_ptr<ClientProtocol::Messages::Privmsg>> cache;
+
+	/** The sequence number of the first message in the cache. */
+	uint64_t cachefirst = 0;
+
+	/** The time at which the cache was last used. */
+	time_t cacheused = 0;
+
+	/** The maximum number of messages to keep. */
+	unsigned long maxlen;
+
+	/** The maximum age of messages to keep in seconds or 0 to keep them until there are too many. */
+	unsigned long maxtime;
+
+	HistoryChannel(unsigned long len, unsigned long time)
+		: maxlen(len)
+		, maxtime(time)
+	{
+	}
+
+	/** Retrieves the sequence number after the newest entry. */
+	uint64_t GetEndSeq() const { return firstseq + entries.size(); }
+};
+
+/** Stores the history of all channels in a HistoryLog and indexes it by time and message id. */
+class HistoryStore final
+{
+public:
+	/** Maps channel names to their history. */
+	typedef std::unordered_map<std::string, HistoryChannel, irc::insensitive, irc::StrHashComp> ChannelMap;
+
+private:
+	/** The log the messages are stored in. */
+	HistoryLog log;
+
+	/** The history of each channel. */
+	ChannelMap channels;
+
+	/** Adds a message which is already in the log to the index of a channel.
+	 * @param history The history of the channel.
+	 * @param record The message to index.
+	 * @param pos The position of the message within the log.
+	 */
+	static void Index(HistoryChannel& history, const HistoryRecord& record, const HistoryLog::Position& pos);
+
+	/** Removes the oldest entry from the history of a channel.
+	 * @param history The history to remove the entry from.
+	 */
+	void PopFront(HistoryChannel& history);
+
+public:
+	/** The maximum number of messages to keep for a channel which does not have its own limits. */
+	unsigned long defaultmaxlen = 50;
+
+	/** The maximum age of messages to keep for a channel which does not have its own limits. */
+	unsigned long defaultmaxtime = 0;
+
+	/** Opens the store, loading the history in an existing log.
+	 * @param dir The directory to store the log in or an empty string to only store it in memory.
+	 * @param segmentsize The size of each segment of the log.
+	 */
+	void Open(const std::string& dir, size_t segmentsize);
+
+	/** Closes the store. */
+	void Close();
+
+	/** Adds a message to the history of a channel.
+	 * @param history The history of the channel.
+	 * @param record The message to add.
+	 */
+	void Add(HistoryChannel& history, const HistoryRecord& record);
+
+	/** Retrieves the history of a channel, creating it if it does not exist, and updates its limits.
+	 * @param channel The name of the channel.
+	 * @param maxlen The maximum number of messages to keep.
+	 * @param maxtime The maximum age of messages to keep in seconds.
+	 * @return The history of the channel.
+	 */
+	HistoryChannel& Get(const std::string& channel, unsigned long maxlen, unsigned long maxtime);
+
+	/** Retrieves the history of a channel.
+	 * @param channel The name of the channel.
+	 * @return The history of the channel or nullptr if it has none.
+	 */
+	HistoryChannel* Find(const std::string& channel);
+
+	/** Removes all history for a channel.
+	 * @param channel The name of the channel.
+	 */
+	void Remove(const std::string& channel);
+
+	/** Removes messages which exceed the limits of a channel.
+	 * @param history The history to prune.
+	 * @return The number of messages which remain.
+	 */
+	size_t Prune(HistoryChannel& history);
+
+	/** Removes messages which exceed the limits of every channel. Channels which have no
+	 * messages left are removed.
+	 */
+	void PruneAll();
+
+	/** Reads the message with the specified sequence number.
+	 * @param history The history which contains the message.
+	 * @param seq The sequence number of the message.
+	 * @param record The location to store the message.
+	 * @return True if the message was read; otherwise, false.
+	 */
+	bool Read(const HistoryChannel& history, uint64_t seq, HistoryRecord& record) const;
+
+	/** Finds the message with the specified message id.
+	 * @param history The history to search.
+	 * @param msgid The message id to search for.
+	 * @return The sequence number of the message or std::nullopt if it was not found.
+	 */
+	std::optional<uint64_t> FindMessageId(const HistoryChannel& history, std::string_view msgid) const;
+
+	/** Finds the first message which was sent at or after the specified time.
+	 * @param history The history to search.
+	 * @param time The time in milliseconds since the UNIX epoch.
+	 * @return The sequence number of the message or the end sequence number if there is none.
+	 */
+	uint64_t FindTime(const HistoryChannel& history, uint64_t time) const;
+
+	/** Retrieves the history of every channel. */
+	ChannelMap& GetChannels() { return channels; }
+
+	/** Retrieves the log which the messages are stored in. */
+	const HistoryLog& GetLog() const { return log; }
+};
@@ -0,0 +1,694 @@
+/*
+ * InspIRCd -- Internet Relay Chat Daemon
+ *
+ *   Copyright (C) 2021 Dominic Hamon
+ *   Copyright (C) 2017-2025 Sadie Powell <sadie@sadiepowell.dev>
+ *   Copyright (C) 2013 Daniel Vassdal <shutter@canternet.org>
+ *   Copyright (C) 2012, 2014, 2018 Attila Molnar <attilamolnar@hush.com>
+ *   Copyright (C) 2012 Robby <robby@chatbelgie.be>
+ *   Copyright (C) 2009-2010 Daniel De Graaf <danieldg@inspircd.org>
+ *
+ * This file is part of InspIRCd.  InspIRCd is free software: you can
+ * redistribute it and/or modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation, version 2.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+
+
+#include "inspircd.h"
+#include "clientprotocolmsg.h"
+#include "modules/cap.h"
+#include "modules/ircv3_batch.h"
+#include "modules/ircv3_replies.h"
+#include "modules/ircv3_servertime.h"
+#include "modules/isupport.h"
+#include "modules/server.h"
+#include "numerichelper.h"
+#include "timeutils.h"
+
+#include "chanhistory.h"
+
+#ifdef _WIN32
+# define timegm _mkgmtime
+#endif
+
+struct HistoryList final
+{
+	unsigned long maxlen;
+	unsigned long maxtime;
+
+	HistoryList(unsigned long len, unsigned long time)
+		: maxlen(len)
+		, maxtime(time)
+	{
+	}
+};
+
+class HistoryMode final
+	: public ParamMode<HistoryMode, SimpleExtItem<HistoryList>>
+{
+private:
+	HistoryStore& store;
+
+	bool ParseDuration(User* user, irc::sepstream& stream, unsigned long& duration)
+	{
+		std::string durationstr;
+		if (!stream.GetToken(durationstr))
+			return false;
+
+		if (!Duration::TryFrom(durationstr, duration) || duration == 0)
+			return false;
+
+		if (IS_LOCAL(user) && maxduration && duration > maxduration)
+			duration = maxduration; // Clamp for local users.
+
+		return true;
+	}
+
+	bool ParseLines(User* user, irc::sepstream& stream, unsigned long& lines)
+	{
+		std::string linesstr;
+		if (!stream.GetToken(linesstr))
+			return false;
+
+		lines = ConvToNum<unsigned long>(linesstr);
+		if (lines == 0)
+			return false;
+
+		if (IS_LOCAL(user) && maxlines && lines > maxlines)
+			lines = maxlines; // Clamp for local users.
+
+		return true;
+	}
+
+public:
+	unsigned long maxduration;
+	unsigned long maxlines;
+
+	HistoryMode(Module* Creator, HistoryStore& hs)
+		: ParamMode<HistoryMode, SimpleExtItem<HistoryList>>(Creator, "history", 'H')
+		, store(hs)
+	{
+		syntax = "<max-messages>:<max-duration>";
+	}
+
+	bool OnSet(User* source, Channel* channel, std::string& parameter) override
+	{
+		irc::sepstream stream(parameter, ':');
+
+		unsigned long lines;
+		unsigned long duration;
+		if (!ParseLines(source, stream, lines) || !ParseDuration(source, stream, duration))
+		{
+			source->WriteNumeric(Numerics::InvalidModeParameter(channel, this, parameter));
+			return false;
+		}
+
+		HistoryList* limits = ext.Get(channel);
+		if (limits)
+		{
+			limits->maxlen = lines;
+			limits->maxtime = duration;
+		}
+		else
+		{
+			ext.SetFwd(channel, lines, duration);
+		}
+
+		// Shrink the stored history if the new limits are lower than the old ones.
+		HistoryChannel* history = store.Find(channel->name);
+		if (history)
+		{
+			history->maxlen = lines;
+			history->maxtime = duration;
+			store.Prune(*history);
+		}
+		return true;
+	}
+
+	void OnUnset(User* source, Channel* channel) override
+	{
+		// The mode is also unset when the module is unloaded but the history should be kept then.
+		if (!creator->dying)
+			store.Remove(channel->name);
+	}
+
+	void SerializeParam(Channel* chan, const HistoryList* limits, std::string& out)
+	{
+		out.append(ConvToStr(limits->maxlen));
+		out.append(":");
+		out.append(Duration::ToString(limits->maxtime));
+	}
+};
+
+/** Builds messages from the history store and sends them to users in a batch. */
+class HistorySender final
+{
+private:
+	HistoryStore& store;
+	IRCv3::Batch::API batchmanager;
+	IRCv3::Batch::Batch batch;
+	IRCv3::ServerTime::API servertimemanager;
+	ClientProtocol::MessageTagEvent tagevent;
+
+	void AddTag(ClientProtocol::Message& msg, const std::string& tagkey, std::string& tagval)
+	{
+		for (auto* subscriber : tagevent.GetSubscribers())
+		{
+			ClientProtocol::MessageTagProvider* const tagprov = static_cast<ClientProtocol::MessageTagProvider*>(subscriber);
+			const ModResult res = tagprov->OnProcessTag(ServerInstance->FakeClient, tagkey, tagval);
+			if (res == MOD_RES_ALLOW)
+				msg.AddTag(tagkey, tagprov, tagval);
+			else if (res == MOD_RES_DENY)
+				break;
+		}
+	}
+
+	std::unique_ptr<ClientProtocol::Messages::Privmsg> BuildMessage(const HistoryRecord& record)
+	{
+		const std::string source(record.source);
+		auto msg = std::make_unique<ClientProtocol::Messages::Privmsg>(source, std::string(record.channel), std::string(record.text), record.type);
+		msg->CopyAll();
+
+		std::string tagval;
+		if (!record.msgid.empty())
+		{
+			tagval.assign(record.msgid);
+			AddTag(*msg, "msgid", tagval);
+		}
+
+		std::string_view tagdata = record.tags;
+		std::string_view tagname;
+		std::string_view tagvalue;
+		while (HistoryRecord::NextTag(tagdata, tagname, tagvalue))
+		{
+			tagval.assign(tagvalue);
+			AddTag(*msg, std::string(tagname), tagval);
+		}
+
+		if (servertimemanager)
+			servertimemanager->Set(*msg, static_cast<time_t>(record.time / 1000), static_cast<long>(record.time % 1000));
+		return msg;
+	}
+
+	ClientProtocol::Messages::Privmsg* GetMessage(HistoryChannel& history, uint64_t seq, std::unique_ptr<ClientProtocol::Messages::Privmsg>& temp)
+	{
+		const uint64_t cacheend = history.cachefirst + history.cache.size();
+		if (!history.cache.empty() && seq >= history.cachefirst && seq < cacheend)
+			return history.cache[seq - history.cachefirst].get();
+
+		HistoryRecord record;
+		if (!store.Read(history, seq, record))
+			return nullptr;
+
+		// Only extend the cache with messages which are next to it so it stays a single range.
+		auto msg = BuildMessage(record);
+		if (history.cache.empty())
+		{
+			history.cachefirst = seq;
+			history.cache.push_back(std::move(msg));
+			return history.cache.back().get();
+		}
+
+		if (seq == cacheend)
+		{
+			history.cache.push_back(std::move(msg));
+			return history.cache.back().get();
+		}
+
+		if (seq + 1 == history.cachefirst)
+		{
+			history.cachefirst--;
+			history.cache.push_front(std::move(msg));
+			return history.cache.front().get();
+		}
+
+		temp = std::move(msg);
+		return temp.get();
+	}
+
+	void AddToBatch(ClientProtocol::Message& msg)
+	{
+		// Cached messages keep the tag of the batch they were last sent in. If the batch has
+		// been given a different reference tag since then the old tag needs to be replaced.
+		const ClientProtocol::TagMap& tags = msg.GetTags();
+		auto it = tags.find("batch");
+		if (it != tags.end() && (!batch.IsRunning() || it->second.provdata != &batch || it->second.value != batch.GetRefTagStr()))
+			msg.RemoveTag("batch");
+		batch.AddToBatch(msg);
+	}
+
+public:
+	HistorySender(Module* mod, HistoryStore& hs)
+		: store(hs)
+		, batchmanager(mod)
+		, batch("chathistory")
+		, servertimemanager(mod)
+		, tagevent(mod)
+	{
+	}
+
+	/** Sends a range of messages from the history of a channel to a user in a chathistory batch.
+	 * @param user The user to send the messages to.
+	 * @param history The history to send messages from or nullptr to send an empty batch.
+	 * @param target The name of the channel the history is for.
+	 * @param first The sequence number of the first message to send.
+	 * @param last The sequence number after the last message to send.
+	 */
+	void Send(LocalUser* user, HistoryChannel* history, const std::string& target, uint64_t first, uint64_t last)
+	{
+		if (batchmanager)
+		{
+			batchmanager->Start(batch);
+			if (batch.IsRunning())
+			{
+				batch.GetBatchStartMessage().PushParamRef(target);
+				batchmanager->Include(batch, user);
+			}
+		}
+
+		if (history)
+		{
+			history->cacheused = ServerInstance->Time();
+			for (uint64_t seq = first; seq < last; ++seq)
+			{
+				std::unique_ptr<ClientProtocol::Messages::Privmsg> temp;
+				ClientProtocol::Messages::Privmsg* msg = GetMessage(*history, seq, temp);
+				if (!msg)
+					continue;
+
+				AddToBatch(*msg);
+				user->Send(ServerInstance->GetRFCEvents().privmsg, *msg);
+			}
+		}
+
+		if (batchmanager)
+			batchmanager->End(batch);
+	}
+};
+
+class CommandChatHistory final
+	: public SplitCommand
+{
+private:
+	/** The range of messages which a message reference points to. */
+	struct Bound final
+	{
+		/** The sequence number of the first message which is not before the reference. */
+		uint64_t lower = 0;
+
+		/** The sequence number of the first message which is after the reference. */
+		uint64_t upper = 0;
+	};
+
+	HistoryStore& store;
+	HistorySender& sender;
+	IRCv3::Replies::Fail failrpl;
+
+	static bool ParseTimestamp(const std::string& str, uint64_t& out)
+	{
+		tm ts = { };
+		int length = 0;
+		if (sscanf(str.c_str(), "%4d-%2d-%2dT%2d:%2d:%2d%n", &ts.tm_year, &ts.tm_mon, &ts.tm_mday,
+			&ts.tm_hour, &ts.tm_min, &ts.tm_sec, &length) != 6)
+			return false;
+
+		uint64_t millisecs = 0;
+		size_t pos = length;
+		if (pos < str.length() && str[pos] == '.')
+		{
+			size_t digits = 0;
+			for (pos++; pos < str.length() && isdigit(static_cast<unsigned char>(str[pos])); ++pos, ++digits)
+			{
+				if (digits < 3)
+					millisecs = (millisecs * 10) + (str[pos] - '0');
+			}
+
+			if (!digits)
+				return false;
+
+			for (; digits < 3; ++digits)
+				millisecs *= 10;
+		}
+
+		if (pos + 1 != str.length() || str[pos] != 'Z')
+			return false;
+
+		ts.tm_year -= 1900;
+		ts.tm_mon -= 1;
+		const time_t secs = timegm(&ts);
+		if (secs < 0)
+			return false;
+
+		out = (static_cast<uint64_t>(secs) * 1000) + millisecs;
+		return true;
+	}
+
+	bool ParseReference(LocalUser* user, const std::string& subcommand, const HistoryChannel* history, const std::string& ref, Bound& bound)
+	{
+		if (!ref.compare(0, 10, "timestamp="))
+		{
+			uint64_t time;
+			if (!ParseTimestamp(ref.substr(10), time))
+			{
+				failrpl.Send(user, this, "INVALID_PARAMS", subcommand, "Invalid timestamp.");
+				return false;
+			}
+
+			if (history)
+			{
+				bound.lower = store.FindTime(*history, time);
+				bound.upper = store.FindTime(*history, time + 1);
+			}
+			return true;
+		}
+
+		if (!ref.compare(0, 6, "msgid="))
+		{
+			const std::optional<uint64_t> seq = history ? store.FindMessageId(*history, ref.substr(6)) : std::nullopt;
+			if (!seq)
+			{
+				failrpl.Send(user, this, "INVALID_MSGREFID", subcommand, ref.substr(6), "Unknown message id.");
+				return false;
+			}
+
+			bound.lower = *seq;
+			bound.upper = *seq + 1;
+			return true;
+		}
+
+		failrpl.Send(user, this, "INVALID_PARAMS", subcommand, "Invalid message reference.");
+		return false;
+	}
+
+public:
+	unsigned long maxlimit;
+
+	CommandChatHistory(Module* Creator, HistoryStore& hs, HistorySender& hsender)
+		: SplitCommand(Creator, "CHATHISTORY", 4, 5)
+		, store(hs)
+		, sender(hsender)
+		, failrpl(Creator)
+	{
+		syntax = {
+			"{BEFORE|AFTER|AROUND} <target> {timestamp|msgid}=<ref> <limit>",
+			"LATEST <target> {* | {timestamp|msgid}=<ref>} <limit>",
+			"BETWEEN <target> {timestamp|msgid}=<ref> {timestamp|msgid}=<ref> <limit>",
+		};
+	}
+
+	CmdResult HandleLocal(LocalUser* user, const Params& parameters) override
+	{
+		const std::string subcommand = parameters[0];
+		const bool between = irc::equals(subcommand, "BETWEEN");
+		if (!between && !irc::equals(subcommand, "BEFORE") && !irc::equals(subcommand, "AFTER")
+			&& !irc::equals(subcommand, "AROUND") && !irc::equals(subcommand, "LATEST"))
+		{
+			failrpl.Send(user, this, "INVALID_PARAMS", subcommand, "Unknown subcommand.");
+			return CmdResult::FAILURE;
+		}
+
+		if (parameters.size() < (between ? 5 : 4))
+		{
+			failrpl.Send(user, this, "NEED_MORE_PARAMS", subcommand, "Missing parameters.");
+			return CmdResult::FAILURE;
+		}
+
+		const std::string& target = parameters[1];
+		Channel* chan = ServerInstance->Channels.Find(target);
+		if (!chan || !chan->HasUser(user))
+		{
+			failrpl.Send(user, this, "INVALID_TARGET", subcommand, target, "You do not have access to the history of this target.");
+			return CmdResult::FAILURE;
+		}
+
+		uint64_t limit = ConvToNum<uint64_t>(parameters.back());
+		if (!limit)
+		{
+			failrpl.Send(user, this, "INVALID_PARAMS", subcommand, "Invalid limit.");
+			return CmdResult::FAILURE;
+		}
+		if (maxlimit && limit > maxlimit)
+			limit = maxlimit;
+
+		HistoryChannel* history = store.Find(chan->name);
+		if (history)
+			store.Prune(*history);
+
+		const uint64_t firstseq = history ? history->firstseq : 0;
+		const uint64_t endseq = history ? history->GetEndSeq() : 0;
+
+		Bound ref;
+		if (!irc::equals(subcommand, "LATEST") || parameters[2] != "*")
+		{
+			if (!ParseReference(user, subcommand, history, parameters[2], ref))
+				return CmdResult::FAILURE;
+		}
+		else
+		{
+			ref.lower = ref.upper = firstseq;
+		}
+
+		// Messages are always sent oldest first so work out the range and then send it.
+		uint64_t first = firstseq;
+		uint64_t last = firstseq;
+		if (irc::equals(subcommand, "BEFORE"))
+		{
+			last = ref.lower;
+			first = std::max(firstseq, last > limit ? last - limit : 0);
+		}
+		else if (irc::equals(subcommand, "AFTER"))
+		{
+			first = ref.upper;
+			last = std::min(endseq, first + limit);
+		}
+		else if (irc::equals(subcommand, "LATEST"))
+		{
+			last = endseq;
+			first = std::max(ref.upper, last > limit ? last - limit : 0);
+		}
+		else if (irc::equals(subcommand, "AROUND"))
+		{
+			first = std::max(firstseq, ref.lower > limit / 2 ? ref.lower - limit / 2 : 0);
+			last = std::min(endseq, first + limit);
+			first = std::max(firstseq, last > limit ? last - limit : 0);
+		}
+		else // BETWEEN
+		{
+			Bound other;
+			if (!ParseReference(user, subcommand, history, parameters[3], other))
+				return CmdResult::FAILURE;
+
+			if (ref.lower <= other.lower)
+			{
+				// Forwards from the first reference.
+				first = ref.upper;
+				last = std::min(other.lower, first + limit);
+			}
+			else
+			{
+				// Backwards from the first reference.
+				last = ref.lower;
+				first = std::max(other.upper, last > limit ? last - limit : 0);
+			}
+		}
+
+		if (first > last)
+			first = last;
+
+		sender.Send(user, history, chan->name, first, last);
+		return CmdResult::SUCCESS;
+	}
+};
+
+class ModuleChanHistory final
+	: public Module
+	, public ISupport::EventListener
+	, public ServerProtocol::RouteEventListener
+{
+private:
+	HistoryStore store;
+	HistoryMode historymode;
+	SimpleUserMode nohistorymode;
+	UserModeReference botmode;
+	IRCv3::Batch::CapReference batchcap;
+	Cap::Capability chathistorycap;
+	HistorySender sender;
+	CommandChatHistory cmd;
+	bool prefixmsg;
+	bool savefrombots;
+	bool sendtobots;
+
+	void ClearCaches()
+	{
+		for (auto& [_, history] : store.GetChannels())
+			history.cache.clear();
+	}
+
+public:
+	ModuleChanHistory()
+		: Module(VF_VENDOR, "Adds channel mode H (history) which allows message history to be viewed on joining the channel and with the IRCv3 CHATHISTORY command.")
+		, ISupport::EventListener(this)
+		, ServerProtocol::RouteEventListener(this)
+		, historymode(this, store)
+		, nohistorymode(this, "nohistory", 'N')
+		, botmode(this, "bot")
+		, batchcap(this)
+		, chathistorycap(this, "draft/chathistory")
+		, sender(this, store)
+		, cmd(this, store, sender)
+	{
+	}
+
+	void ReadConfig(ConfigStatus& status) override
+	{
+		const auto& tag = ServerInstance->Config->ConfValue("chanhistory");
+		historymode.maxduration = tag->getDuration("maxduration", 60*60*24*28);
+		historymode.maxlines = tag->getNum<unsigned long>("maxlines", 50);
+		cmd.maxlimit = tag->getNum<unsigned long>("chathistorylimit", 100, 1);
+		prefixmsg = tag->getBool("prefixmsg", true);
+		savefrombots = tag->getBool("savefrombots", true);
+		sendtobots = tag->getBool("sendtobots", tag->getBool("bots", true));
+
+		// History which is loaded from disk is kept within these limits until its channel is created.
+		store.defaultmaxlen = historymode.maxlines ? historymode.maxlines : 50;
+		store.defaultmaxtime = historymode.maxduration;
+
+		if (!store.GetLog().IsOpen())
+		{
+			// The store can not be moved while the module is loaded.
+			const std::string directory = tag->getBool("persist", true)
+				? ServerInstance->Config->Paths.PrependData(tag->getString("directory", "history", 1))
+				: "";
+			store.Open(directory, tag->getNum<size_t>("segmentsize", 4*1024*1024, 64*1024, UINT32_MAX));
+		}
+	}
+
+	void OnBuildISupport(ISupport::TokenMap& tokens) override
+	{
+		tokens["CHATHISTORY"] = ConvToStr(cmd.maxlimit);
+		tokens["MSGREFTYPES"] = "timestamp,msgid";
+	}
+
+	void OnShutdown(const std::string& reason) override
+	{
+		// Close the store before users quit and channels are deleted so the history survives.
+		store.Close();
+	}
+
+	void OnLoadModule(Module* mod) override
+	{
+		// The new module may provide tags which the cached messages do not have.
+		ClearCaches();
+	}
+
+	void OnUnloadModule(Module* mod) override
+	{
+		// Cached messages refer to tag providers which may belong to the module being unloaded.
+		ClearCaches();
+	}
+
+	void OnBackgroundTimer(time_t curtime) override
+	{
+		store.PruneAll();
+
+		for (auto& [_, history] : store.GetChannels())
+		{
+			if (!history.cache.empty() && history.cacheused + 60 < curtime)
+				history.cache.clear();
+		}
+	}
+
+	void OnChannelDelete(Channel* chan) override
+	{
+		store.Remove(chan->name);
+	}
+
+	ModResult OnRouteMessage(const Channel* channel, const Server* server) override
+	{
+		return channel->IsModeSet(historymode) && !server->IsService() ? MOD_RES_ALLOW : MOD_RES_PASSTHRU;
+	}
+
+	void OnUserPostMessage(User* user, const MessageTarget& target, const MessageDetails& details) override
+	{
+		if (target.type != MessageTarget::TYPE_CHANNEL || target.status)
+			return;
+
+		if (user->IsModeSet(botmode) && !savefrombots)
+			return;
+
+		std::string_view ctcpname;
+		if (details.IsCTCP(ctcpname) && !irc::equals(ctcpname, "ACTION"))
+			return;
+
+		auto* chan = target.Get<Channel>();
+		HistoryList* list = historymode.ext.Get(chan);
+		if (!list)
+			return;
+
+		HistoryRecord record;
+		std::string tags;
+		for (const auto& [tagname, tagvalue] : details.tags_out)
+		{
+			if (tagname == "msgid")
+				record.msgid = tagvalue.value;
+			else
+				HistoryRecord::EncodeTag(tags, tagname, tagvalue.value);
+		}
+
+		record.time = ServerInstance->Time_ms();
+		record.type = details.type;
+		record.channel = chan->name;
+		record.source = user->GetMask();
+		record.text = details.text;
+		record.tags = tags;
+		store.Add(store.Get(chan->name, list->maxlen, list->maxtime), record);
+	}
+
+	void OnPostJoin(Membership* memb) override
+	{
+		LocalUser* localuser = IS_LOCAL(memb->user);
+		if (!localuser)
+			return;
+
+		if (memb->user->IsModeSet(botmode) && !sendtobots)
+			return;
+
+		if (memb->user->IsModeSet(nohistorymode))
+			return;
+
+		HistoryList* list = historymode.ext.Get(memb->chan);
+		if (!list)
+			return;
+
+		HistoryChannel* history = store.Find(memb->chan->name);
+		if (!history)
+			return;
+
+		history->maxlen = list->maxlen;
+		history->maxtime = list->maxtime;
+		if (!store.Prune(*history))
+			return;
+
+		if ((prefixmsg) && (!batchcap.IsEnabled(localuser)))
+		{
+			auto message = INSP_FORMAT("Replaying up to {} lines of pre-join history", list->maxlen);
+			if (list->maxtime > 0)
+				message += INSP_FORMAT(" from the last {}", Duration::ToLongString(list->maxtime));
+			memb->WriteNotice(message);
+		}
+
+		sender.Send(localuser, history, memb->chan->name, history->firstseq, history->GetEndSeq());
+	}
+};
+
+MODULE_INIT(ModuleChanHistory)
@@ -0,0 +1,731 @@
+/*
+ * InspIRCd -- Internet Relay Chat Daemon
+ *
+ * This file is part of InspIRCd.  InspIRCd is free software: you can
+ * redistribute it and/or modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation, version 2.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <filesystem>
+
+#ifndef _WIN32
+# include <fcntl.h>
+# include <sys/mman.h>
+# include <unistd.h>
+#endif
+
+#include "chanhistory.h"
+
+namespace
+{
+	/** The magic bytes at the start of every segment file. */
+	constexpr char SEGMENT_MAGIC[8] = { 'I', 'R', 'C', 'H', 'I', 'S', 'T', '1' };
+
+	/** The size of the header at the start of every segment. */
+	constexpr size_t SEGMENT_HEADER = 16;
+
+	/** Set in the flags of a record when it has been released. */
+	constexpr uint8_t RECORD_RELEASED = 1;
+
+	/** The header at the start of every record in a segment. */
+	struct RecordHeader final
+	{
+		/** The size of the record including this header and any padding or 0 if there are no more records. */
+		uint32_t length;
+
+		/** A checksum of the fields from time to type and the payload of the record. */
+		uint32_t checksum;
+
+		/** The time at which the message was sent in milliseconds since the UNIX epoch. */
+		uint64_t time;
+
+		/** The lengths of the fields in the payload. */
+		uint16_t chanlen;
+		uint16_t msgidlen;
+		uint16_t sourcelen;
+		uint16_t textlen;
+		uint16_t tagslen;
+
+		/** The MessageType of the message. */
+		uint8_t type;
+
+		/** Flags which can change after the record is written. Not included in the checksum. */
+		uint8_t flags;
+
+		/** Reserved for future use. */
+		uint32_t reserved;
+	};
+	static_assert(sizeof(RecordHeader) == 32);
+
+	/** The bytes of the header which are covered by the checksum. */
+	constexpr size_t CHECKSUM_START = offsetof(RecordHeader, time);
+	constexpr size_t CHECKSUM_END = offsetof(RecordHeader, flags);
+
+	uint32_t Checksum(const RecordHeader& header, const char* payload, size_t length)
+	{
+		// FNV-1a is plenty for spotting torn writes and is cheap enough to run over every record at startup.
+		uint32_t hash = 2166136261u;
+		const auto* hdr = reinterpret_cast<const unsigned char*>(&header);
+		for (size_t idx = CHECKSUM_START; idx < CHECKSUM_END; ++idx)
+			hash = (hash ^ hdr[idx]) * 16777619u;
+		for (size_t idx = 0; idx < length; ++idx)
+			hash = (hash ^ static_cast<unsigned char>(payload[idx])) * 16777619u;
+		return hash;
+	}
+
+	uint64_t HashMessageId(std::string_view msgid)
+	{
+		uint64_t hash = 14695981039346656037ull;
+		for (const auto chr : msgid)
+			hash = (hash ^ static_cast<unsigned char>(chr)) * 1099511628211ull;
+		return hash;
+	}
+
+	constexpr size_t Align(size_t length)
+	{
+		return (length + 7) & ~static_cast<size_t>(7);
+	}
+
+	std::string GetSegmentPath(const std::string& directory, uint32_t id)
+	{
+		return INSP_FORMAT("{}/history-{:08}.log", directory, id);
+	}
+}
+
+struct HistoryLog::Segment final
+{
+	/** The identifier of this segment. */
+	uint32_t id;
+
+	/** The path to the file which backs this segment or an empty string if it is only in memory. */
+	std::string path;
+
+	/** The memory which backs this segment if it is not stored on disk. */
+	std::vector<char> memory;
+
+	/** The contents of the segment. */
+	char* data = nullptr;
+
+	/** The size of the segment. */
+	size_t size = 0;
+
+	/** The number of bytes which have been written to the segment. */
+	size_t used = SEGMENT_HEADER;
+
+	/** The number of records in the segment which have not been released. */
+	size_t live = 0;
+
+#ifdef _WIN32
+	HANDLE file = INVALID_HANDLE_VALUE;
+	HANDLE mapping = nullptr;
+#else
+	int fd = -1;
+#endif
+
+	Segment(uint32_t i)
+		: id(i)
+	{
+	}
+
+	~Segment()
+	{
+		Unmap();
+	}
+
+	/** Maps the file which backs this segment into memory.
+	 * @param create Whether to create the file with the specified size.
+	 * @param newsize The size to create the file with.
+	 * @return True if the file was mapped; otherwise, false.
+	 */
+	bool Map(bool create, size_t newsize)
+	{
+#ifdef _WIN32
+		file = CreateFileA(path.c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, nullptr,
+			create ? CREATE_NEW : OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+		if (file == INVALID_HANDLE_VALUE)
+			return false;
+
+		LARGE_INTEGER filesize;
+		if (create)
+			filesize.QuadPart = static_cast<LONGLONG>(newsize);
+		else if (!GetFileSizeEx(file, &filesize))
+			return false;
+		size = static_cast<size_t>(filesize.QuadPart);
+
+		// Allocate the file up front so that running out of disk space is detected here rather
+		// than when writing to the mapping.
+		if (create && (!SetFilePointerEx(file, filesize, nullptr, FILE_BEGIN) || !SetEndOfFile(file)))
+			return false;
+
+		mapping = CreateFileMappingA(file, nullptr, PAGE_READWRITE, filesize.HighPart, filesize.LowPart, nullptr);
+		if (!mapping)
+			return false;
+
+		data = static_cast<char*>(MapViewOfFile(mapping, FILE_MAP_WRITE, 0, 0, size));
+		return data != nullptr;
+#else
+		fd = open(path.c_str(), O_RDWR | O_CLOEXEC | (create ? O_CREAT | O_EXCL : 0), 0600);
+		if (fd < 0)
+			return false;
+
+		if (create)
+		{
+			// Reserve the blocks up front as writing to a hole in a shared mapping when the disk
+			// is full raises SIGBUS rather than failing.
+#ifdef __APPLE__
+			fstore_t store = { F_ALLOCATEALL, F_PEOFPOSMODE, 0, static_cast<off_t>(newsize), 0 };
+			if (fcntl(fd, F_PREALLOCATE, &store) < 0 || ftruncate(fd, static_cast<off_t>(newsize)) < 0)
+				return false;
+#else
+			const int error = posix_fallocate(fd, 0, static_cast<off_t>(newsize));
+			if (error)
+			{
+				errno = error;
+				return false;
+			}
+#endif
+			size = newsize;
+		}
+		else
+		{
+			off_t filesize = lseek(fd, 0, SEEK_END);
+			if (filesize < 0)
+				return false;
+			size = static_cast<size_t>(filesize);
+		}
+
+		if (!size)
+		{
+			errno = EINVAL;
+			return false;
+		}
+
+		void* mem = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+		if (mem == MAP_FAILED)
+			return false;
+
+		data = static_cast<char*>(mem);
+		return true;
+#endif
+	}
+
+	/** Determines whether the file which backs this segment is open. */
+	bool HasFile() const
+	{
+#ifdef _WIN32
+		return file != INVALID_HANDLE_VALUE;
+#else
+		return fd >= 0;
+#endif
+	}
+
+	/** Unmaps the file which backs this segment. */
+	void Unmap()
+	{
+		if (path.empty())
+			return;
+
+#ifdef _WIN32
+		if (data)
+			UnmapViewOfFile(data);
+		if (mapping)
+			CloseHandle(mapping);
+		if (file != INVALID_HANDLE_VALUE)
+			CloseHandle(file);
+		mapping = nullptr;
+		file = INVALID_HANDLE_VALUE;
+#else
+		if (data)
+			munmap(data, size);
+		if (fd >= 0)
+			close(fd);
+		fd = -1;
+#endif
+		data = nullptr;
+	}
+
+	/** Reads the header of the record at the specified offset. */
+	RecordHeader GetHeader(size_t offset) const
+	{
+		RecordHeader header;
+		memcpy(&header, data + offset, sizeof(header));
+		return header;
+	}
+};
+
+bool HistoryRecord::EncodeTag(std::string& out, std::string_view name, std::string_view value)
+{
+	if (name.empty() || name.length() > UINT8_MAX || value.length() > UINT16_MAX)
+		return false;
+
+	const auto namelen = static_cast<uint8_t>(name.length());
+	const auto valuelen = static_cast<uint16_t>(value.length());
+	out.push_back(static_cast<char>(namelen));
+	out.append(name);
+	out.append(reinterpret_cast<const char*>(&valuelen), sizeof(valuelen));
+	out.append(value);
+	return true;
+}
+
+bool HistoryRecord::NextTag(std::string_view& tagdata, std::string_view& name, std::string_view& value)
+{
+	if (tagdata.empty())
+		return false;
+
+	const size_t namelen = static_cast<uint8_t>(tagdata[0]);
+	if (tagdata.length() < 1 + namelen + sizeof(uint16_t))
+		return false;
+
+	uint16_t valuelen;
+	memcpy(&valuelen, tagdata.data() + 1 + namelen, sizeof(valuelen));
+
+	const size_t taglen = 1 + namelen + sizeof(valuelen) + valuelen;
+	if (tagdata.length() < taglen)
+		return false;
+
+	name = tagdata.substr(1, namelen);
+	value = tagdata.substr(1 + namelen + sizeof(valuelen), valuelen);
+	tagdata.remove_prefix(taglen);
+	return true;
+}
+
+HistoryLog::HistoryLog() = default;
+
+HistoryLog::~HistoryLog()
+{
+	Close();
+}
+
+void HistoryLog::CreateSegment()
+{
+	const uint32_t id = segments.empty() ? 1 : segments.rbegin()->first + 1;
+	auto segment = std::make_unique<Segment>(id);
+	if (IsPersistent())
+	{
+		segment->path = GetSegmentPath(directory, id);
+		if (!segment->Map(true, segmentsize))
+		{
+			ServerInstance->Logs.Critical(MODNAME, "Unable to create history segment \"{}\": {} ({}); it will only be stored in memory!",
+				segment->path, strerror(errno), errno);
+			// If the file could not even be created then it belongs to something else.
+			const bool created = segment->HasFile();
+			segment->Unmap();
+			if (created)
+			{
+				std::error_code ec;
+				std::filesystem::remove(segment->path, ec);
+			}
+			segment->path.clear();
+		}
+	}
+
+	if (segment->path.empty())
+	{
+		segment->memory.resize(segmentsize);
+		segment->data = segment->memory.data();
+		segment->size = segmentsize;
+	}
+
+	memcpy(segment->data, SEGMENT_MAGIC, sizeof(SEGMENT_MAGIC));
+	Segment* previous = active;
+	active = segment.get();
+	segments.emplace(id, std::move(segment));
+
+	// Release never removes the active segment so if every record in the previous segment was
+	// released whilst it was active it needs to be removed now.
+	if (previous && !previous->live)
+		RemoveSegment(previous);
+}
+
+void HistoryLog::LoadSegment(uint32_t id, const std::string& path, const LoadCallback& callback)
+{
+	auto segment = std::make_unique<Segment>(id);
+	segment->path = path;
+	if (!segment->Map(false, 0))
+	{
+		ServerInstance->Logs.Critical(MODNAME, "Unable to open history segment \"{}\": {} ({})",
+			path, strerror(errno), errno);
+		return;
+	}
+
+	if (segment->size < SEGMENT_HEADER + sizeof(RecordHeader) || memcmp(segment->data, SEGMENT_MAGIC, sizeof(SEGMENT_MAGIC)))
+	{
+		ServerInstance->Logs.Critical(MODNAME, "Ignoring history segment \"{}\" as it is not a valid segment.", path);
+		return;
+	}
+
+	size_t offset = SEGMENT_HEADER;
+	while (offset + sizeof(RecordHeader) <= segment->size)
+	{
+		const RecordHeader header = segment->GetHeader(offset);
+		if (!header.length)
+			break; // End of the segment.
+
+		const char* payload = segment->data + offset + sizeof(RecordHeader);
+		const size_t payloadlen = size_t(header.chanlen) + header.msgidlen + header.sourcelen + header.textlen + header.tagslen;
+		if (header.length % 8 || header.length < sizeof(RecordHeader) + payloadlen || offset + header.length > segment->size
+			|| Checksum(header, payload, payloadlen) != header.checksum)
+		{
+			// The server probably died while writing this record. Clear the rest of the segment so
+			// that nothing after it can be mistaken for a record once we start appending again.
+			ServerInstance->Logs.Warning(MODNAME, "History segment \"{}\" is damaged at offset {}; discarding the rest of it.",
+				path, offset);
+			memset(segment->data + offset, 0, segment->size - offset);
+			break;
+		}
+
+		if (!(header.flags & RECORD_RELEASED))
+		{
+			HistoryRecord record;
+			record.time = header.time;
+			record.type = header.type ? MessageType::NOTICE : MessageType::PRIVMSG;
+			record.channel = std::string_view(payload, header.chanlen);
+			payload += header.chanlen;
+			record.msgid = std::string_view(payload, header.msgidlen);
+			payload += header.msgidlen;
+			record.source = std::string_view(payload, header.sourcelen);
+			payload += header.sourcelen;
+			record.text = std::string_view(payload, header.textlen);
+			payload += header.textlen;
+			record.tags = std::string_view(payload, header.tagslen);
+
+			segment->live++;
+			callback(record, { id, static_cast<uint32_t>(offset) });
+		}
+		offset += header.length;
+	}
+
+	segment->used = offset;
+	segments.emplace(id, std::move(segment));
+}
+
+void HistoryLog::RemoveSegment(Segment* segment)
+{
+	if (segment == active)
+		active = nullptr;
+
+	const std::string path = segment->path;
+	segments.erase(segment->id);
+
+	if (!path.empty())
+	{
+		std::error_code ec;
+		if (!std::filesystem::remove(path, ec) && ec)
+			ServerInstance->Logs.Warning(MODNAME, "Unable to delete history segment \"{}\": {}", path, ec.message());
+	}
+}
+
+void HistoryLog::Open(const std::string& dir, size_t size, const LoadCallback& callback)
+{
+	Close();
+	directory = dir;
+	segmentsize = size;
+	if (!IsPersistent())
+		return;
+
+	std::error_code ec;
+	std::filesystem::create_directories(directory, ec);
+	if (ec)
+	{
+		ServerInstance->Logs.Critical(MODNAME, "Unable to create the history directory \"{}\": {}; history will only be stored in memory!",
+			directory, ec.message());
+		directory.clear();
+		return;
+	}
+
+	std::map<uint32_t, std::string> files;
+	for (const auto& entry : std::filesystem::directory_iterator(directory, ec))
+	{
+		const std::string name = entry.path().filename().string();
+		if (name.length() <= 12 || name.compare(0, 8, "history-") || name.compare(name.length() - 4, 4, ".log"))
+			continue;
+
+		const auto id = ConvToNum<uint32_t>(name.substr(8, name.length() - 12));
+		if (id)
+			files.emplace(id, entry.path().string());
+	}
+
+	for (const auto& [id, path] : files)
+		LoadSegment(id, path, callback);
+
+	if (!segments.empty())
+	{
+		// Continue appending to the newest segment. Older segments are only kept while they
+		// still contain messages which have not been released.
+		active = segments.rbegin()->second.get();
+		for (auto it = segments.begin(); it != segments.end(); )
+		{
+			Segment* segment = (it++)->second.get();
+			if (!segment->live && segment != active)
+				RemoveSegment(segment);
+		}
+	}
+
+	ServerInstance->Logs.Debug(MODNAME, "Loaded {} history segments from \"{}\".", segments.size(), directory);
+}
+
+void HistoryLog::Close()
+{
+	active = nullptr;
+	segments.clear();
+	directory.clear();
+	segmentsize = 0;
+}
+
+bool HistoryLog::Append(const HistoryRecord& record, Position& pos)
+{
+	if (record.channel.length() > UINT16_MAX || record.msgid.length() > UINT16_MAX || record.source.length() > UINT16_MAX
+		|| record.text.length() > UINT16_MAX || record.tags.length() > UINT16_MAX)
+		return false;
+
+	const size_t payloadlen = record.channel.length() + record.msgid.length() + record.source.length()
+		+ record.text.length() + record.tags.length();
+	const size_t length = Align(sizeof(RecordHeader) + payloadlen);
+	if (!segmentsize || length > segmentsize - SEGMENT_HEADER)
+		return false; // Can never fit in a segment.
+
+	if (!active || active->used + length > active->size)
+		CreateSegment();
+
+	RecordHeader header;
+	memset(&header, 0, sizeof(header));
+	header.time = record.time;
+	header.chanlen = static_cast<uint16_t>(record.channel.length());
+	header.msgidlen = static_cast<uint16_t>(record.msgid.length());
+	header.sourcelen = static_cast<uint16_t>(record.source.length());
+	header.textlen = static_cast<uint16_t>(record.text.length());
+	header.tagslen = static_cast<uint16_t>(record.tags.length());
+	header.type = record.type == MessageType::NOTICE ? 1 : 0;
+
+	char* payload = active->data + active->used + sizeof(RecordHeader);
+	char* ptr = payload;
+	for (const auto& field : { record.channel, record.msgid, record.source, record.text, record.tags })
+	{
+		memcpy(ptr, field.data(), field.length());
+		ptr += field.length();
+	}
+	header.checksum = Checksum(header, payload, payloadlen);
+
+	// The length is written last so a record which was only partially written is never read.
+	const uint32_t recordlen = static_cast<uint32_t>(length);
+	memcpy(active->data + active->used, &header, sizeof(header));
+	memcpy(active->data + active->used + offsetof(RecordHeader, length), &recordlen, sizeof(recordlen));
+
+	pos.segment = active->id;
+	pos.offset = static_cast<uint32_t>(active->used);
+	active->used += length;
+	active->live++;
+	return true;
+}
+
+bool HistoryLog::Read(const Position& pos, HistoryRecord& record) const
+{
+	auto it = segments.find(pos.segment);
+	if (it == segments.end())
+		return false;
+
+	const Segment& segment = *it->second;
+	if (pos.offset + sizeof(RecordHeader) > segment.used)
+		return false;
+
+	const RecordHeader header = segment.GetHeader(pos.offset);
+	const char* payload = segment.data + pos.offset + sizeof(RecordHeader);
+	record.time = header.time;
+	record.type = header.type ? MessageType::NOTICE : MessageType::PRIVMSG;
+	record.channel = std::string_view(payload, header.chanlen);
+	payload += header.chanlen;
+	record.msgid = std::string_view(payload, header.msgidlen);
+	payload += header.msgidlen;
+	record.source = std::string_view(payload, header.sourcelen);
+	payload += header.sourcelen;
+	record.text = std::string_view(payload, header.textlen);
+	payload += header.textlen;
+	record.tags = std::string_view(payload, header.tagslen);
+	return true;
+}
+
+void HistoryLog::Release(const Position& pos)
+{
+	auto it = segments.find(pos.segment);
+	if (it == segments.end())
+		return;
+
+	Segment* segment = it->second.get();
+	const uint8_t flags = RECORD_RELEASED;
+	memcpy(segment->data + pos.offset + offsetof(RecordHeader, flags), &flags, sizeof(flags));
+
+	if (segment->live)
+		segment->live--;
+
+	if (!segment->live && segment != active)
+		RemoveSegment(segment);
+}
+
+void HistoryStore::Index(HistoryChannel& history, const HistoryRecord& record, const HistoryLog::Position& pos)
+{
+	if (!record.msgid.empty())
+		history.msgids[HashMessageId(record.msgid)] = history.GetEndSeq();
+	history.entries.push_back({ record.time, pos });
+}
+
+void HistoryStore::PopFront(HistoryChannel& history)
+{
+	const HistoryEntry& entry = history.entries.front();
+	if (!history.msgids.empty())
+	{
+		HistoryRecord record;
+		if (log.Read(entry.pos, record) && !record.msgid.empty())
+		{
+			auto it = history.msgids.find(HashMessageId(record.msgid));
+			if (it != history.msgids.end() && it->second == history.firstseq)
+				history.msgids.erase(it);
+		}
+	}
+	log.Release(entry.pos);
+	history.entries.pop_front();
+
+	if (!history.cache.empty() && history.cachefirst == history.firstseq)
+	{
+		history.cache.pop_front();
+		history.cachefirst++;
+	}
+	history.firstseq++;
+}
+
+void HistoryStore::Open(const std::string& dir, size_t segmentsize)
+{
+	channels.clear();
+	log.Open(dir, segmentsize, [this](const HistoryRecord& record, const HistoryLog::Position& pos) {
+		// We don't know the limits of the channel yet so use the defaults until it is created.
+		HistoryChannel& history = Get(std::string(record.channel), defaultmaxlen, defaultmaxtime);
+		if (!history.entries.empty() && record.time < history.entries.back().time)
+		{
+			HistoryRecord ordered(record);
+			ordered.time = history.entries.back().time;
+			Index(history, ordered, pos);
+		}
+		else
+		{
+			Index(history, record, pos);
+		}
+	});
+	PruneAll();
+}
+
+void HistoryStore::Close()
+{
+	channels.clear();
+	log.Close();
+}
+
+void HistoryStore::Add(HistoryChannel& history, const HistoryRecord& record)
+{
+	// Keep the history ordered by time even if the clock goes backwards so we can binary search it.
+	HistoryRecord ordered(record);
+	if (!history.entries.empty() && ordered.time < history.entries.back().time)
+		ordered.time = history.entries.back().time;
+
+	HistoryLog::Position pos;
+	if (!log.Append(ordered, pos))
+	{
+		ServerInstance->Logs.Debug(MODNAME, "Unable to add a message to the history of {}.", ordered.channel);
+		return;
+	}
+
+	Index(history, ordered, pos);
+	while (history.entries.size() > history.maxlen)
+		PopFront(history);
+}
+
+HistoryChannel& HistoryStore::Get(const std::string& channel, unsigned long maxlen, unsigned long maxtime)
+{
+	auto it = channels.find(channel);
+	if (it == channels.end())
+		it = channels.emplace(std::piecewise_construct, std::forward_as_tuple(channel), std::forward_as_tuple(maxlen, maxtime)).first;
+
+	it->second.maxlen = maxlen;
+	it->second.maxtime = maxtime;
+	return it->second;
+}
+
+HistoryChannel* HistoryStore::Find(const std::string& channel)
+{
+	auto it = channels.find(channel);
+	return it == channels.end() ? nullptr : &it->second;
+}
+
+void HistoryStore::Remove(const std::string& channel)
+{
+	auto it = channels.find(channel);
+	if (it == channels.end())
+		return;
+
+	// Release the entries so the records are not loaded again on the next start.
+	for (const auto& entry : it->second.entries)
+		log.Release(entry.pos);
+	channels.erase(it);
+}
+
+size_t HistoryStore::Prune(HistoryChannel& history)
+{
+	while (history.entries.size() > history.maxlen)
+		PopFront(history);
+
+	if (history.maxtime)
+	{
+		const uint64_t mintime = static_cast<uint64_t>(ServerInstance->Time() - static_cast<time_t>(history.maxtime)) * 1000;
+		while (!history.entries.empty() && history.entries.front().time < mintime)
+			PopFront(history);
+	}
+	return history.entries.size();
+}
+
+void HistoryStore::PruneAll()
+{
+	for (auto it = channels.begin(); it != channels.end(); )
+	{
+		if (Prune(it->second))
+			++it;
+		else
+			it = channels.erase(it);
+	}
+}
+
+bool HistoryStore::Read(const HistoryChannel& history, uint64_t seq, HistoryRecord& record) const
+{
+	if (seq < history.firstseq || seq >= history.GetEndSeq())
+		return false;
+
+	return log.Read(history.entries[seq - history.firstseq].pos, record);
+}
+
+std::optional<uint64_t> HistoryStore::FindMessageId(const HistoryChannel& history, std::string_view msgid) const
+{
+	auto it = history.msgids.find(HashMessageId(msgid));
+	if (it == history.msgids.end())
+		return std::nullopt;
+
+	// Make sure this is actually the message we are looking for and not a hash collision.
+	HistoryRecord record;
+	if (!Read(history, it->second, record) || record.msgid != msgid)
+		return std::nullopt;
+
+	return it->second;
+}
+
+uint64_t HistoryStore::FindTime(const HistoryChannel& history, uint64_t time) const
+{
+	auto it = std::lower_bound(history.entries.begin(), history.entries.end(), time, [](const HistoryEntry& entry, uint64_t value) {
+		return entry.time < value;
+	});
+	return history.firstseq + std::distance(history.entries.begin(), it);
+}
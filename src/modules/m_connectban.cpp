@@ -37,37 +37,51 @@ class ModuleConnectBan final
 	, public WebIRC::EventListener
 {
 private:
-	typedef std::map<irc::sockets::cidr_mask, unsigned int> ConnectMap;
+	struct ConnectCount final
+	{
+		/** The number of connections from the range which have not decayed yet. */
+		unsigned long count = 0;
+
+		/** The time at which the count was last decayed. */
+		time_t updated = 0;
+
+		ConnectCount& operator+=(const ConnectCount& other)
+		{
+			count += other.count;
+			updated = std::max(updated, other.updated);
+			return *this;
+		}
+	};
 
-	ConnectMap connects;
+	insp::cidr_counter<ConnectCount> connects;
 	unsigned long threshold;
 	unsigned long banduration;
-	unsigned int ipv4_cidr;
-	unsigned int ipv6_cidr;
+	unsigned long decay;
 	unsigned long bootwait;
 	unsigned long splitwait;
 	time_t ignoreuntil = 0;
 	std::string banmessage;
 
-	unsigned char GetRange(LocalUser* user) const
+	/** Removes the connections which have decayed since the count was last updated. The count
+	 * drops by the threshold once every decay period.
+	 */
+	void Decay(ConnectCount& cc) const
 	{
-		sa_family_t family = user->client_sa.family();
-		switch (family)
+		const time_t now = ServerInstance->Time();
+		const auto elapsed = static_cast<unsigned long>(std::max<time_t>(now - cc.updated, 0));
+		if (!cc.count || elapsed >= decay)
 		{
-			case AF_INET:
-				return ipv4_cidr;
-
-			case AF_INET6:
-				return ipv6_cidr;
-
-			case AF_UNIX:
-				// Ranges for UNIX sockets are ignored entirely.
-				return 0;
+			cc.count = 0;
+			cc.updated = now;
+			return;
 		}
 
-		// If we have reached this point then we have encountered a bug.
-		ServerInstance->Logs.Debug(MODNAME, "BUG: ModuleConnectBan::GetRange(): socket type {} is unknown!", family);
-		return 0;
+		const unsigned long decayed = elapsed * threshold / decay;
+		if (!decayed)
+			return;
+
+		cc.count -= std::min(cc.count, decayed);
+		cc.updated += static_cast<time_t>(decayed * decay / threshold);
 	}
 
 	static bool IsExempt(LocalUser* user)
@@ -100,9 +114,12 @@ public:
 	{
 		const auto& tag = ServerInstance->Config->ConfValue("connectban");
 
-		ipv4_cidr = tag->getNum<unsigned int>("ipv4cidr", ServerInstance->Config->IPv4Range, 1, 32);
-		ipv6_cidr = tag->getNum<unsigned int>("ipv6cidr", ServerInstance->Config->IPv6Range, 1, 128);
+		const auto ipv4_cidr = tag->getNum<unsigned char>("ipv4cidr", ServerInstance->Config->IPv4Range, 1, 32);
+		const auto ipv6_cidr = tag->getNum<unsigned char>("ipv6cidr", ServerInstance->Config->IPv6Range, 1, 128);
+		connects.set_ranges(ipv4_cidr, ipv6_cidr);
+
 		threshold = tag->getNum<unsigned long>("threshold", 10, 2);
+		decay = tag->getDuration("decay", 60*60, 1);
 		bootwait = tag->getDuration("bootwait", 60*2);
 		splitwait = tag->getDuration("splitwait", 60*2);
 		banduration = tag->getDuration("banduration", 6*60*60, 1);
@@ -120,10 +137,9 @@ public:
 		// HACK: Lower the connection attempts for the gateway IP address. The user
 		// will be rechecked for connect spamming shortly after when their IP address
 		// is changed and OnChangeRemoteAddress is called.
-		irc::sockets::cidr_mask mask(user->client_sa, GetRange(user));
-		ConnectMap::iterator iter = connects.find(mask);
-		if (iter != connects.end() && iter->second)
-			iter->second--;
+		ConnectCount* cc = connects.find(user->client_sa);
+		if (cc && cc->count)
+			cc->count--;
 	}
 
 	void OnServerSplit(const Server* server, bool error) override
@@ -137,47 +153,40 @@ public:
 		if (IsExempt(u) || ignoreuntil > ServerInstance->Time())
 			return;
 
-		irc::sockets::cidr_mask mask(u->client_sa, GetRange(u));
-		ConnectMap::iterator i = connects.find(mask);
-
-		if (i != connects.end())
+		ConnectCount& cc = connects[u->client_sa];
+		Decay(cc);
+		if (++cc.count >= threshold)
 		{
-			i->second++;
-
-			if (i->second >= threshold)
+			// If an IPv6 address begins with a colon then expand it
+			// slightly to avoid breaking the server protocol.
+			std::string maskstr = connects.get_mask(u->client_sa).str();
+			if (maskstr[0] == ':')
+				maskstr.insert(maskstr.begin(), 1, '0');
+
+			// Create Z-line for set duration.
+			auto* zl = new ZLine(ServerInstance->Time(), banduration, MODNAME "@" + ServerInstance->Config->ServerName, banmessage, maskstr);
+			if (!ServerInstance->XLines->AddLine(zl, nullptr))
 			{
-				// If an IPv6 address begins with a colon then expand it
-				// slightly to avoid breaking the server protocol.
-				std::string maskstr = mask.str();
-				if (maskstr[0] == ':')
-					maskstr.insert(maskstr.begin(), 1, '0');
-
-				// Create Z-line for set duration.
-				auto* zl = new ZLine(ServerInstance->Time(), banduration, MODNAME "@" + ServerInstance->Config->ServerName, banmessage, maskstr);
-				if (!ServerInstance->XLines->AddLine(zl, nullptr))
-				{
-					delete zl;
-					return;
-				}
-
-				ServerInstance->SNO.WriteToSnoMask('x', "{} added a timed Z-line on {}, expires in {} (on {}): {}",
-					zl->source, maskstr, Duration::ToLongString(zl->duration),
-					Time::ToString(zl->expiry), zl->reason);
-				ServerInstance->SNO.WriteGlobalSno('a', "Connect flooding from IP range {} ({})", maskstr, threshold);
-				connects.erase(i);
-				ServerInstance->XLines->ApplyLines();
+				delete zl;
+				return;
 			}
-		}
-		else
-		{
-			connects[mask] = 1;
+
+			ServerInstance->SNO.WriteToSnoMask('x', "{} added a timed Z-line on {}, expires in {} (on {}): {}",
+				zl->source, maskstr, Duration::ToLongString(zl->duration),
+				Time::ToString(zl->expiry), zl->reason);
+			ServerInstance->SNO.WriteGlobalSno('a', "Connect flooding from IP range {} ({})", maskstr, threshold);
+			connects.erase(u->client_sa);
+			ServerInstance->XLines->ApplyLines();
 		}
 	}
 
 	void OnGarbageCollect() override
 	{
-		ServerInstance->Logs.Debug(MODNAME, "Clearing map.");
-		connects.clear();
+		connects.erase_if([this](ConnectCount& cc) {
+			Decay(cc);
+			return !cc.count;
+		});
+		ServerInstance->Logs.Debug(MODNAME, "Pruned decayed ranges, {} remaining.", connects.size());
 	}
 };
 
@@ -138,6 +138,7 @@ public:
 	}
 
 	ModResult OnNamesListItem(LocalUser* issuer, Membership*, std::string& prefixes, std::string& nick) override;
+	ModResult OnNamesListVariant(LocalUser* issuer, Channel* chan, std::string& variant) override;
 	ModResult OnWhoLine(const Who::Request& request, LocalUser* source, User* user, Membership* memb, Numeric::Numeric& numeric) override;
 	ModResult OnWhoVisible(const Who::Request& request, LocalUser* source, Membership* memb) override;
 	void OnUserJoin(Membership*, bool, bool, CUList&) override;
@@ -163,6 +164,12 @@ ModResult ModuleDelayJoin::OnNamesListItem(LocalUser* issuer, Membership* memb,
 	return MOD_RES_PASSTHRU;
 }
 
+ModResult ModuleDelayJoin::OnNamesListVariant(LocalUser* issuer, Channel* chan, std::string& variant)
+{
+	// Users who have not spoken yet are only hidden from other users.
+	return chan->IsModeSet(djm) ? MOD_RES_DENY : MOD_RES_PASSTHRU;
+}
+
 ModResult ModuleDelayJoin::OnWhoLine(const Who::Request& request, LocalUser* source, User* user, Membership* memb, Numeric::Numeric& numeric)
 {
 	// We don't need to do anything if they're not delayjoined.
@@ -211,6 +211,36 @@ private:
 	unsigned long saveperiod;
 	unsigned long maxbackoff;
 	unsigned char backoff;
+
+	/** The filters which apply to a type of message combined into pattern sets. */
+	struct FilterSet final
+	{
+		/** The patterns of the filters which match the message text as it was sent. */
+		Regex::PatternSetPtr raw;
+
+		/** The indices within filters of the filters in the raw set. */
+		std::vector<size_t> rawfilters;
+
+		/** The patterns of the filters which match the message text with formatting stripped. */
+		Regex::PatternSetPtr stripped;
+
+		/** The indices within filters of the filters in the stripped set. */
+		std::vector<size_t> strippedfilters;
+	};
+
+	/** The filter sets for PART, QUIT, PRIVMSG, and NOTICE messages. */
+	std::array<FilterSet, 4> filtersets;
+
+	/** Whether the filter sets need to be rebuilt before they are next used. */
+	bool rebuildsets = true;
+
+	/** The indices of the patterns which matched within a filter set. */
+	std::vector<size_t> setmatches;
+
+	/** The indices within filters of the filters which matched a message. */
+	std::vector<size_t> candidates;
+
+	void BuildFilterSets();
 	void FreeFilters();
 
 public:
@@ -386,6 +416,68 @@ void ModuleFilter::FreeFilters()
 {
 	filters.clear();
 	dirty = true;
+
+	// The sets may have been created by a regex engine which is being unloaded.
+	filtersets = {};
+	rebuildsets = true;
+}
+
+void ModuleFilter::BuildFilterSets()
+{
+	filtersets = {};
+	rebuildsets = false;
+	if (!RegexEngine || filters.empty())
+		return;
+
+	static constexpr std::array<int, 4> setflags = { FLAG_PART, FLAG_QUIT, FLAG_PRIVMSG, FLAG_NOTICE };
+	for (size_t setidx = 0; setidx < setflags.size(); ++setidx)
+	{
+		FilterSet& filterset = filtersets[setidx];
+		Regex::PatternList raw;
+		Regex::PatternList stripped;
+		for (size_t idx = 0; idx < filters.size(); ++idx)
+		{
+			const FilterResult& filter = filters[idx];
+			switch (setflags[setidx])
+			{
+				case FLAG_PART:
+					if (!filter.flag_part_message)
+						continue;
+					break;
+
+				case FLAG_QUIT:
+					if (!filter.flag_quit_message)
+						continue;
+					break;
+
+				case FLAG_PRIVMSG:
+					if (!filter.flag_privmsg)
+						continue;
+					break;
+
+				case FLAG_NOTICE:
+					if (!filter.flag_notice)
+						continue;
+					break;
+			}
+
+			if (filter.flag_strip_color)
+			{
+				stripped.push_back(filter.regex);
+				filterset.strippedfilters.push_back(idx);
+			}
+			else
+			{
+				raw.push_back(filter.regex);
+				filterset.rawfilters.push_back(idx);
+			}
+		}
+
+		if (!raw.empty())
+			filterset.raw = RegexEngine->CreateSet(raw);
+		if (!stripped.empty())
+			filterset.stripped = RegexEngine->CreateSet(stripped);
+	}
 }
 
 ModResult ModuleFilter::OnUserPreMessage(User* user, MessageTarget& msgtarget, MessageDetails& details)
@@ -788,21 +880,56 @@ void ModuleFilter::OnDecodeMetadata(Extensible* target, const std::string& extna
 const FilterResult* ModuleFilter::FilterMatch(User* user, const std::string& text, int flgs)
 {
 	static std::string stripped_text;
-	stripped_text.clear();
 
-	for (const auto& filter : filters)
+	if (rebuildsets)
+		BuildFilterSets();
+
+	const FilterSet* filterset;
+	switch (flgs)
 	{
-		/* Skip ones that dont apply to us */
-		if (!AppliesToMe(user, filter, flgs))
-			continue;
+		case FLAG_PART:
+			filterset = &filtersets[0];
+			break;
 
-		if ((filter.flag_strip_color) && (stripped_text.empty()))
+		case FLAG_QUIT:
+			filterset = &filtersets[1];
+			break;
+
+		case FLAG_PRIVMSG:
+			filterset = &filtersets[2];
+			break;
+
+		default:
+			filterset = &filtersets[3];
+			break;
+	}
+
+	// Find every filter which matches the text in one pass over each set.
+	candidates.clear();
+	if (filterset->raw && filterset->raw->IsMatch(text, setmatches))
+	{
+		for (const auto setidx : setmatches)
+			candidates.push_back(filterset->rawfilters[setidx]);
+	}
+
+	if (filterset->stripped)
+	{
+		stripped_text = text;
+		InspIRCd::StripColor(stripped_text);
+		if (filterset->stripped->IsMatch(stripped_text, setmatches))
 		{
-			stripped_text = text;
-			InspIRCd::StripColor(stripped_text);
+			for (const auto setidx : setmatches)
+				candidates.push_back(filterset->strippedfilters[setidx]);
 		}
+	}
 
-		if (filter.regex->IsMatch(filter.flag_strip_color ? stripped_text : text))
+	// Filters are checked in the order they were added so the result is the same as checking
+	// each filter individually.
+	std::sort(candidates.begin(), candidates.end());
+	for (const auto idx : candidates)
+	{
+		const FilterResult& filter = filters[idx];
+		if (AppliesToMe(user, filter, flgs))
 			return &filter;
 	}
 	return nullptr;
@@ -817,6 +944,7 @@ bool ModuleFilter::DeleteFilter(const std::string& freeform, std::string& reason
 			reason.assign(i->reason);
 			filters.erase(i);
 			dirty = true;
+			rebuildsets = true;
 			return true;
 		}
 	}
@@ -837,6 +965,7 @@ std::pair<bool, std::string> ModuleFilter::AddFilter(const std::string& freeform
 	{
 		filters.emplace_back(RegexEngine, freeform, reason, type, duration, flgs, config, enableflags);
 		dirty = true;
+		rebuildsets = true;
 	}
 	catch (const ModuleException& e)
 	{
@@ -895,6 +1024,7 @@ void ModuleFilter::ReadFilters()
 		{
 			removedfilters.insert(filter->freeform);
 			filter = filters.erase(filter);
+			rebuildsets = true;
 			continue;
 		}
 
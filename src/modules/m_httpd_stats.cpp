@@ -335,6 +335,49 @@ namespace Stats
 		serializer.EndBlock();
 	}
 
+	void LatencyHistogram(XMLSerializer& serializer, const Latency::Histogram& histogram)
+	{
+		const auto microseconds = [](uint64_t ticks) {
+			return INSP_FORMAT("{:.2f}", ServerInstance->Latency.TicksToMicroseconds(ticks));
+		};
+
+		serializer.Attribute("calls", histogram.GetCount())
+			.Attribute("total", microseconds(histogram.GetTotal()))
+			.Attribute("p50", microseconds(histogram.GetPercentile(50)))
+			.Attribute("p90", microseconds(histogram.GetPercentile(90)))
+			.Attribute("p99", microseconds(histogram.GetPercentile(99)))
+			.Attribute("max", microseconds(histogram.GetMax()));
+	}
+
+	void LatencyStats(XMLSerializer& serializer)
+	{
+		serializer.BeginBlock("latency")
+			.Attribute("enabled", Latency::enabled ? "yes" : "no");
+
+		serializer.BeginBlock("hooklist");
+		for (const auto& [_, hook] : ServerInstance->Latency.GetHooks())
+		{
+			serializer.BeginBlock("hook")
+				.Attribute("module", hook.module)
+				.Attribute("event", hook.event);
+			LatencyHistogram(serializer, hook.histogram);
+			serializer.EndBlock();
+		}
+		serializer.EndBlock();
+
+		serializer.BeginBlock("commandlist");
+		for (const auto& [command, histogram] : ServerInstance->Latency.GetCommands())
+		{
+			serializer.BeginBlock("command")
+				.Attribute("name", command);
+			LatencyHistogram(serializer, histogram);
+			serializer.EndBlock();
+		}
+		serializer.EndBlock();
+
+		serializer.EndBlock();
+	}
+
 	enum OrderBy
 	{
 		OB_NICK,
@@ -484,6 +527,10 @@ public:
 		{
 			Stats::General(serializer);
 		}
+		else if (request.GetPath() == "/stats/latency")
+		{
+			Stats::LatencyStats(serializer);
+		}
 		else if (request.GetPath() == "/stats/users")
 		{
 			Stats::ListUsers(serializer, request.GetParsedURI().query_params);
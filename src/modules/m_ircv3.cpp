@@ -207,6 +207,13 @@ public:
 			return MOD_RES_DENY;
 		return MOD_RES_PASSTHRU;
 	}
+
+	ModResult OnNamesListVariant(LocalUser* issuer, Channel* chan, std::string& variant) override
+	{
+		if (active && cap_noimplicitnames.IsEnabled(issuer))
+			variant.append("no-implicit-names;");
+		return MOD_RES_PASSTHRU;
+	}
 };
 
 MODULE_INIT(ModuleIRCv3)
@@ -78,6 +78,11 @@ public:
 	{
 		return acctag.GetCap().IsEnabled(user) && ctctagcap.IsEnabled(user);
 	}
+
+	bool OnlyDependsOnCaps() const override
+	{
+		return true;
+	}
 };
 
 class ModuleIRCv3AccountTag final
@@ -76,6 +76,12 @@ class IRCv3::Batch::ManagerImpl final
 			return false;
 
 		Batch& batch = *static_cast<Batch*>(tagdata.provdata);
+		SendStart(batch, user);
+		return true;
+	}
+
+	void SendStart(Batch& batch, LocalUser* user)
+	{
 		// Check if this is the first message the user is getting that is part of the batch
 		const intptr_t bits = batchbits.Get(user);
 		if (!(bits & batch.GetBit()))
@@ -87,8 +93,6 @@ class IRCv3::Batch::ManagerImpl final
 			batch.batchinfo->users.push_back(user);
 			user->Send(batch.batchinfo->startevent);
 		}
-
-		return true;
 	}
 
 	unsigned int NextFreeId() const
@@ -179,6 +183,12 @@ public:
 		delete batch.batchinfo;
 		batch.batchinfo = nullptr;
 	}
+
+	void Include(Batch& batch, LocalUser* user) override
+	{
+		if (batch.IsRunning() && cap.IsEnabled(user))
+			SendStart(batch, user);
+	}
 };
 
 class ModuleIRCv3Batch final
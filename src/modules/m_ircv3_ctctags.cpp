@@ -376,6 +376,11 @@ public:
 	{
 		return cap.IsEnabled(user);
 	}
+
+	bool OnlyDependsOnCaps() const override
+	{
+		return true;
+	}
 };
 
 class ModuleIRCv3CTCTags final
@@ -44,6 +44,11 @@ public:
 	{
 		return stdrplcap.IsEnabled(user) && echomsgcap.IsEnabled(user);
 	}
+
+	bool OnlyDependsOnCaps() const final
+	{
+		return true;
+	}
 };
 
 class ModuleIRCv3EchoMessage final
@@ -79,6 +79,9 @@ private:
 	insp::aligned_storage<ClientProtocol::Message> firstmsg;
 	size_t msgcount = 0;
 
+	// The label of a command which has been suspended whilst waiting for an asynchronous operation.
+	StringExtItem suspendedlabel;
+
 	void FlushFirstMsg(LocalUser* user)
 	{
 		// This isn't a side effect but we treat it like one to avoid the logic in OnUserWrite.
@@ -140,6 +143,7 @@ public:
 		, batchcap(this)
 		, ackmsgprov(this, "ACK")
 		, labelmsgprov(this, "labeled")
+		, suspendedlabel(this, "labeled-response-suspended", ExtensionType::USER)
 	{
 	}
 
@@ -180,6 +184,35 @@ public:
 		PostCommand(user);
 	}
 
+	void OnCommandSuspended(Command* command, const CommandBase::Params& parameters, LocalUser* user) override
+	{
+		if (tag.labeluser != user)
+			return;
+
+		// If the command has already replied then the replies so far are sent with the label
+		// and the rest will be unlabeled; otherwise, the label is kept until it resumes.
+		if (msgcount)
+		{
+			PostCommand(user);
+			return;
+		}
+
+		suspendedlabel.Set(user, tag.label);
+		tag.labeluser = nullptr;
+	}
+
+	void OnCommandResumed(Command* command, const CommandBase::Params& parameters, LocalUser* user) override
+	{
+		const std::string* label = suspendedlabel.Get(user);
+		if (!label || tag.labeluser)
+			return;
+
+		tag.label = *label;
+		tag.labeluser = user;
+		msgcount = 0;
+		suspendedlabel.Unset(user);
+	}
+
 	ModResult OnUserWrite(LocalUser* user, ClientProtocol::Message& msg) override
 	{
 		// The label user is writing a message to another user.
@@ -54,7 +54,7 @@ private:
 		utf8::unchecked::replace_invalid(in.begin(), in.end(), std::back_inserter(out));
 	}
 
-	inline static size_t TruncateUTF8(const std::string& str, size_t len)
+	inline static size_t TruncateUTF8(const std::string_view& str, size_t len)
 	{
 		if (str.length() < len)
 			return str.length();
@@ -72,19 +72,19 @@ public:
 	{
 	}
 
-	bool Parse(LocalUser* user, const std::string& line, ClientProtocol::ParseOutput& parseoutput) override;
-	ClientProtocol::SerializedMessage Serialize(const ClientProtocol::Message& msg, const ClientProtocol::TagSelection& tagwl) const override;
+	bool Parse(LocalUser* user, const std::string_view& line, ClientProtocol::ParseOutput& parseoutput) override;
+	std::string Serialize(const ClientProtocol::Message& msg, const ClientProtocol::TagSelection& tagwl) const override;
 };
 
-bool UTF8Serializer::Parse(LocalUser* user, const std::string& line, ClientProtocol::ParseOutput& parseoutput)
+bool UTF8Serializer::Parse(LocalUser* user, const std::string_view& line, ClientProtocol::ParseOutput& parseoutput)
 {
 	// Work out how long the message can actually be.
 	auto maxline = ServerInstance->Config->Limits.MaxLine - 2;
-	if (line[0] == '@')
+	if (!line.empty() && line[0] == '@')
 		maxline += MAX_CLIENT_MESSAGE_TAG_LENGTH + 1;
 
 	irc::tokenstream tokens(line, 0, TruncateUTF8(line, maxline));
-	if (!utf8::is_valid(line))
+	if (!utf8::is_valid(line.begin(), line.end()))
 	{
 		failrpl.Send(user, nullptr, "INVALID_UTF8", "Message rejected, your IRC software MUST use UTF-8 encoding on this network");
 		user->CommandFloodPenalty += 2000;
@@ -221,7 +221,7 @@ void UTF8Serializer::SerializeTags(const ClientProtocol::TagMap& tags, const Cli
 		line.push_back(' ');
 }
 
-ClientProtocol::SerializedMessage UTF8Serializer::Serialize(const ClientProtocol::Message& msg, const ClientProtocol::TagSelection& tagwl) const
+std::string UTF8Serializer::Serialize(const ClientProtocol::Message& msg, const ClientProtocol::TagSelection& tagwl) const
 {
 	std::string line;
 	SerializeTags(msg.GetTags(), tagwl, line);
@@ -55,6 +55,14 @@ public:
 		return MOD_RES_PASSTHRU;
 	}
 
+	ModResult OnNamesListVariant(LocalUser* issuer, Channel* chan, std::string& variant) override
+	{
+		if (cap.IsEnabled(issuer))
+			variant.append("multi-prefix;");
+
+		return MOD_RES_PASSTHRU;
+	}
+
 	ModResult OnWhoLine(const Who::Request& request, LocalUser* source, User* user, Membership* memb, Numeric::Numeric& numeric) override
 	{
 		if ((!memb) || (!cap.IsEnabled(source)))
@@ -149,6 +149,17 @@ public:
 		// We don't handle this type, let other mods or the core decide
 		return MOD_RES_PASSTHRU;
 	}
+
+	ModResult OnCheckPasswordAsync(const std::string& password, const std::string& passwordhash, const std::string& value, const PasswordCallback& callback) override
+	{
+		// Key derivation functions are deliberately slow so we check them on a worker thread.
+		HashProvider* hp = ServerInstance->Modules.FindDataService<HashProvider>("hash/" + passwordhash);
+		if (!hp || !hp->IsKDF())
+			return MOD_RES_PASSTHRU;
+
+		ServerInstance->Workers.Submit(new HashCompareJob(hp, value, { password }, callback));
+		return MOD_RES_ALLOW;
+	}
 };
 
 MODULE_INIT(ModulePasswordHash)
@@ -51,11 +51,174 @@ public:
 	}
 };
 
+class GlobPatternSet final
+	: public Regex::PatternSet
+{
+private:
+	/** A state in an Aho-Corasick automaton which finds the literal text in patterns. */
+	struct State final
+	{
+		/** The states which are reached by consuming a case folded character. */
+		insp::flat_map<unsigned char, size_t> next;
+
+		/** The state to fall back to when there is no transition for a character. */
+		size_t fail = 0;
+
+		/** The indices of the patterns whose literal text ends at this state. */
+		std::vector<size_t> outputs;
+	};
+
+	/** The states of the automaton. The first state is the initial state. */
+	std::vector<State> states;
+
+	/** The indices of the patterns which have no literal text and always have to be checked. */
+	std::vector<size_t> always;
+
+	/** The case folding map which the automaton was built with. */
+	const unsigned char* casemap = nullptr;
+
+	/** Whether each pattern has been found to be a candidate in the current match. */
+	std::vector<bool> seen;
+
+	/** The indices of the patterns which are candidates in the current match. */
+	std::vector<size_t> candidates;
+
+	/** Builds the automaton from the longest literal text in each pattern. A text can only match a
+	 * glob pattern if it contains this text so only patterns where it is found need to be checked.
+	 */
+	void Build()
+	{
+		casemap = national_case_insensitive_map;
+		states.assign(1, State());
+		always.clear();
+
+		for (size_t idx = 0; idx < GetPatterns().size(); ++idx)
+		{
+			const std::string& pattern = GetPatterns()[idx]->GetPattern();
+
+			size_t beststart = 0;
+			size_t bestlength = 0;
+			for (size_t start = 0; start < pattern.length(); )
+			{
+				size_t end = pattern.find_first_of("*?", start);
+				if (end == std::string::npos)
+					end = pattern.length();
+
+				if (end - start > bestlength)
+				{
+					beststart = start;
+					bestlength = end - start;
+				}
+				start = end + 1;
+			}
+
+			if (!bestlength)
+			{
+				always.push_back(idx);
+				continue;
+			}
+
+			size_t state = 0;
+			for (const auto chr : insp::iterator_range(pattern.begin() + beststart, pattern.begin() + beststart + bestlength))
+			{
+				const unsigned char folded = casemap[static_cast<unsigned char>(chr)];
+				auto it = states[state].next.find(folded);
+				if (it != states[state].next.end())
+				{
+					state = it->second;
+					continue;
+				}
+
+				// This may reallocate the states so the iterator can not be used after it.
+				states[state].next.emplace(folded, states.size());
+				state = states.size();
+				states.emplace_back();
+			}
+			states[state].outputs.push_back(idx);
+		}
+
+		// Link each state to the longest proper suffix of it which is also a state.
+		std::vector<size_t> queue;
+		for (const auto& [_, child] : states[0].next)
+			queue.push_back(child);
+
+		for (size_t pos = 0; pos < queue.size(); ++pos)
+		{
+			const size_t state = queue[pos];
+			for (const auto& [chr, child] : states[state].next)
+			{
+				size_t fail = states[state].fail;
+				while (fail && !states[fail].next.count(chr))
+					fail = states[fail].fail;
+
+				auto it = states[fail].next.find(chr);
+				states[child].fail = it == states[fail].next.end() ? 0 : it->second;
+
+				const auto& inherited = states[states[child].fail].outputs;
+				states[child].outputs.insert(states[child].outputs.end(), inherited.begin(), inherited.end());
+				queue.push_back(child);
+			}
+		}
+	}
+
+public:
+	GlobPatternSet(const Module* mod, const Regex::PatternList& patterns)
+		: Regex::PatternSet(patterns)
+		, seen(patterns.size())
+	{
+		Build();
+	}
+
+	bool IsMatch(const std::string& text, std::vector<size_t>& matches) override
+	{
+		// The automaton is case folded so it needs to be rebuilt if the casemapping changes.
+		if (casemap != national_case_insensitive_map)
+			Build();
+
+		candidates = always;
+		size_t state = 0;
+		for (const auto chr : text)
+		{
+			const unsigned char folded = casemap[static_cast<unsigned char>(chr)];
+			auto it = states[state].next.find(folded);
+			while (state && it == states[state].next.end())
+			{
+				state = states[state].fail;
+				it = states[state].next.find(folded);
+			}
+
+			if (it == states[state].next.end())
+				continue;
+
+			state = it->second;
+			for (const auto idx : states[state].outputs)
+			{
+				if (!seen[idx])
+				{
+					seen[idx] = true;
+					candidates.push_back(idx);
+				}
+			}
+		}
+
+		matches.clear();
+		for (const auto idx : candidates)
+		{
+			seen[idx] = false;
+			if (GetPatterns()[idx]->IsMatch(text))
+				matches.push_back(idx);
+		}
+
+		std::sort(matches.begin(), matches.end());
+		return !matches.empty();
+	}
+};
+
 class ModuleRegexGlob final
 	: public Module
 {
 private:
-	Regex::SimpleEngine<GlobPattern> regex;
+	Regex::SimpleEngine<GlobPattern, GlobPatternSet> regex;
 
 public:
 	ModuleRegexGlob()
@@ -30,6 +30,7 @@
 
 
 #include "inspircd.h"
+#include "extension.h"
 #include "modules/shun.h"
 #include "modules/stats.h"
 #include "timeutils.h"
@@ -150,13 +151,14 @@ class ModuleShun final
 private:
 	CommandShun cmd;
 	ShunFactory shun;
+	SimpleExtItem<XLineManager::MatchCache> shuncache;
 	bool allowconnect;
 	bool allowtags;
 	TokenList cleanedcommands;
 	TokenList enabledcommands;
 	bool notifyuser;
 
-	bool IsShunned(LocalUser* user) const
+	bool IsShunned(LocalUser* user)
 	{
 		// Exempt the user if they are not fully connected and allowconnect is enabled.
 		if (allowconnect && !user->IsFullyConnected())
@@ -166,8 +168,15 @@ private:
 		if (user->HasPrivPermission("servers/ignore-shun"))
 			return false;
 
-		// Check whether the user is actually shunned.
-		return ServerInstance->XLines->MatchesLine("SHUN", user);
+		// Check whether the user is actually shunned. This is checked for every command so we cache
+		// the result until the shun list or the user changes.
+		XLineManager::MatchCache* cache = shuncache.Get(user);
+		if (!cache)
+		{
+			cache = new XLineManager::MatchCache();
+			shuncache.Set(user, cache);
+		}
+		return ServerInstance->XLines->MatchesLine("SHUN", user, *cache);
 	}
 
 public:
@@ -175,6 +184,7 @@ public:
 		: Module(VF_VENDOR | VF_COMMON, "Adds the /SHUN command which allows server operators to prevent users from executing commands.")
 		, Stats::EventListener(this)
 		, cmd(this)
+		, shuncache(this, "shun-cache", ExtensionType::USER)
 	{
 	}
 
@@ -96,10 +96,20 @@ public:
 	// The mask which is silenced (e.g. *!*@example.com).
 	std::string mask;
 
+	// Whether the mask contains no wildcards and can be compared directly.
+	bool literal;
+
 	SilenceEntry(uint32_t Flags, const std::string& Mask)
 		: flags(Flags)
 		, mask(Mask)
+		, literal(Mask.find_first_of("*?") == std::string::npos)
+	{
+	}
+
+	// Determines whether the specified user mask matches this entry.
+	bool Matches(const std::string& usermask) const
 	{
+		return literal ? irc::equals(usermask, mask) : InspIRCd::Match(usermask, mask);
 	}
 
 	bool operator <(const SilenceEntry& other) const
@@ -205,7 +215,11 @@ class SilenceExtItem final
 	: public SimpleExtItem<SilenceList>
 {
 public:
+	// A map of local users who have a non-empty silence list to the flags of all of their entries.
+	typedef std::unordered_map<LocalUser*, uint32_t> SilencerMap;
+
 	unsigned long maxsilence;
+	SilencerMap silencers;
 
 	SilenceExtItem(Module* Creator)
 		: SimpleExtItem<SilenceList>(Creator, "silence-list", ExtensionType::USER)
@@ -267,6 +281,31 @@ public:
 		// The value was well formed.
 		if (list)
 			Set(user, list, false);
+		Update(user);
+	}
+
+	void Delete(Extensible* container, void* item) override
+	{
+		LocalUser* user = IS_LOCAL(static_cast<User*>(container));
+		if (user)
+			silencers.erase(user);
+		SimpleExtItem<SilenceList>::Delete(container, item);
+	}
+
+	// Updates the silencer index after the silence list of the specified user changes.
+	void Update(LocalUser* user)
+	{
+		SilenceList* list = Get(user);
+		if (!list || list->empty())
+		{
+			silencers.erase(user);
+			return;
+		}
+
+		uint32_t flags = SilenceEntry::SF_NONE;
+		for (const auto& entry : *list)
+			flags |= entry.flags;
+		silencers[user] = flags;
 	}
 
 	std::string ToInternal(const Extensible* container, void* item) const noexcept override
@@ -324,6 +363,7 @@ private:
 			user->WriteNumeric(ERR_SILENCE, mask, SilenceEntry::BitsToFlags(flags), "The SILENCE entry you specified already exists");
 			return CmdResult::FAILURE;
 		}
+		ext.Update(user);
 
 		SilenceMessage msg("+" + mask, SilenceEntry::BitsToFlags(flags));
 		user->Send(msgprov, msg);
@@ -341,6 +381,7 @@ private:
 					continue;
 
 				list->erase(iter);
+				ext.Update(user);
 				SilenceMessage msg("-" + mask, SilenceEntry::BitsToFlags(flags));
 				user->Send(msgprov, msg);
 				return CmdResult::SUCCESS;
@@ -422,16 +463,44 @@ private:
 	bool exemptservice;
 	CommandSilence cmd;
 
+	void BuildChannelExempt(User* source, LocalUser* user, SilenceEntry::SilenceFlags flag, CUList& exemptions, CUList& hides)
+	{
+		uint32_t flags;
+		if (!CanReceiveMessage(source, user, flag, &flags))
+		{
+			exemptions.insert(user);
+			if (user != source && flags & SilenceEntry::SF_HIDE_SILENCER)
+				hides.insert(user);
+		}
+	}
+
 	void BuildChannelExempts(User* source, Channel* channel, SilenceEntry::SilenceFlags flag, CUList& exemptions, CUList& hides)
 	{
-		for (const auto& [user, _] : channel->GetUsers())
+		if (exemptservice && source->server->IsService())
+			return;
+
+		// Only local users who have silenced something can be exempted so walk whichever of the
+		// silencer index and the member list is smaller.
+		const Channel::MemberMap& members = channel->GetUsers();
+		if (cmd.ext.silencers.size() <= members.size())
 		{
-			uint32_t flags;
-			if (!CanReceiveMessage(source, user, flag, &flags))
+			for (const auto& [silencer, silencerflags] : cmd.ext.silencers)
+			{
+				if ((silencerflags & flag) && members.find(silencer) != members.end())
+					BuildChannelExempt(source, silencer, flag, exemptions, hides);
+			}
+		}
+		else
+		{
+			for (const auto& [member, _] : members)
 			{
-				exemptions.insert(user);
-				if (user != source && flags & SilenceEntry::SF_HIDE_SILENCER)
-					hides.insert(user);
+				LocalUser* user = IS_LOCAL(member);
+				if (!user)
+					continue;
+
+				auto iter = cmd.ext.silencers.find(user);
+				if (iter != cmd.ext.silencers.end() && (iter->second & flag))
+					BuildChannelExempt(source, user, flag, exemptions, hides);
 			}
 		}
 	}
@@ -449,12 +518,13 @@ private:
 		if (!list)
 			return true;
 
+		const std::string& sourcemask = source->GetMask();
 		for (const auto& entry : *list)
 		{
 			if (!(entry.flags & flag))
 				continue;
 
-			if (InspIRCd::Match(source->GetMask(), entry.mask))
+			if (entry.Matches(sourcemask))
 			{
 				if (flags)
 					*flags = entry.flags;
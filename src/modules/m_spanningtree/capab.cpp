@@ -24,6 +24,7 @@
 
 #include "inspircd.h"
 #include "dynamic.h"
+#include "modules/compress.h"
 #include "modules/extban.h"
 #include "utility/map.h"
 
@@ -413,6 +414,16 @@ void TreeSocket::SendCapabilities(int phase)
 		capabilities["CHALLENGE"] = GetOurChallenge();
 	}
 
+	// Advertise the algorithms we can decompress so the remote server can compress its side of the link.
+	std::vector<std::string> algorithms;
+	for (const auto& [_, service] : ServerInstance->Modules.DataProviders)
+	{
+		if (service->service == SERVICE_IOHOOK && static_cast<IOHookProvider*>(service)->type == IOHookProvider::IOH_COMPRESS)
+			algorithms.push_back(static_cast<Compress::Provider*>(service)->algorithm);
+	}
+	if (!algorithms.empty())
+		capabilities["COMPRESS"] = insp::join(algorithms, ',');
+
 	std::stringstream capabilitystr;
 	char separator = ':';
 	for (const auto& [capkey, capvalue] : capabilities)
@@ -425,6 +436,42 @@ void TreeSocket::SendCapabilities(int phase)
 	this->WriteLine("CAPAB END");
 }
 
+void TreeSocket::StartCompression(const Link& link)
+{
+	if (link.Compress.empty())
+		return;
+
+	// Only compress if the remote server has told us it can decompress.
+	bool supported = false;
+	auto algorithms = capab->CapKeys.find("COMPRESS");
+	if (algorithms != capab->CapKeys.end())
+	{
+		irc::commasepstream algostream(algorithms->second);
+		for (std::string algorithm; !supported && algostream.GetToken(algorithm); )
+			supported = irc::equals(algorithm, link.Compress);
+	}
+
+	if (!supported)
+	{
+		ServerInstance->SNO.WriteToSnoMask('l', "Not compressing the link to {} as the remote server does not support {} compression",
+			link.Name, link.Compress);
+		return;
+	}
+
+	auto* prov = static_cast<Compress::Provider*>(ServerInstance->Modules.FindService(SERVICE_IOHOOK, "compress/" + link.Compress));
+	if (!prov)
+	{
+		ServerInstance->SNO.WriteToSnoMask('l', "Not compressing the link to {} as {} compression is not available on this server",
+			link.Name, link.Compress);
+		return;
+	}
+
+	// The remote server starts decompressing after this line so it is queued before
+	// the hook is attached which ensures it is sent uncompressed.
+	WriteLine("CAPAB COMPRESS " + prov->algorithm);
+	prov->Attach(this, true, false);
+}
+
 /* Isolate and return the elements that are different between two comma separated lists */
 void TreeSocket::ListDifference(const std::string& one, const std::string& two, char sep,
 		std::string& mleft, std::string& mright)
@@ -594,6 +641,7 @@ bool TreeSocket::Capab(const CommandBase::Params& params)
 			if (!this->GetTheirChallenge().empty() && (this->LinkState == CONNECTING))
 			{
 				this->SendCapabilities(2);
+				StartCompression(*capab->link);
 				this->WriteLine(INSP_FORMAT("SERVER {} {} {}{} :{}",
 					ServerInstance->Config->ServerName,
 					TreeSocket::MakePass(capab->link->SendPass, capab->theirchallenge),
@@ -609,6 +657,7 @@ bool TreeSocket::Capab(const CommandBase::Params& params)
 			if (this->LinkState == CONNECTING)
 			{
 				this->SendCapabilities(2);
+				StartCompression(*capab->link);
 				this->WriteLine(INSP_FORMAT("SERVER {} {} {}{} :{}",
 					ServerInstance->Config->ServerName,
 					capab->link->SendPass,
@@ -641,6 +690,29 @@ bool TreeSocket::Capab(const CommandBase::Params& params)
 	{
 		capab->ExtBans = params[1];
 	}
+	else if (irc::equals(params[0], "COMPRESS") && (params.size() == 2))
+	{
+		// The remote server has started compressing everything it sends after this line.
+		Compress::Hook* hook = Compress::Hook::IsCompressed(this);
+		if (!hook)
+		{
+			auto* prov = static_cast<Compress::Provider*>(ServerInstance->Modules.FindService(SERVICE_IOHOOK, "compress/" + params[1]));
+			if (!prov)
+			{
+				SendError("CAPAB negotiation failed: " + params[1] + " compression is not available on this server");
+				return false;
+			}
+			hook = prov->Attach(this, false, false);
+		}
+		else if (hook->IsDecompressing() || !irc::equals(static_cast<Compress::Provider*>(hook->prov.get())->algorithm, params[1]))
+		{
+			SendError("CAPAB negotiation failed: unable to start " + params[1] + " compression on this link");
+			return false;
+		}
+
+		if (hook->StartDecompression(this, recvq) < 0)
+			return false;
+	}
 	else if (irc::equals(params[0], "CAPABILITIES") && (params.size() == 2))
 	{
 		irc::spacesepstream capabs(params[1]);
@@ -40,6 +40,7 @@ public:
 	std::vector<std::string> AllowMasks;
 	bool HiddenFromStats;
 	std::string Hook;
+	std::string Compress;
 	unsigned long Timeout;
 	std::string Bind;
 	bool Hidden;
@@ -56,6 +56,7 @@ ModuleSpanningTree::ModuleSpanningTree()
 	, messageeventprov(this, "event/server-message")
 	, synceventprov(this, "event/server-sync")
 	, sslapi(this)
+	, batchmanager(this)
 	, servertags(this)
 	, DNS(this)
 	, tagevprov(this)
@@ -629,8 +630,11 @@ void ModuleSpanningTree::OnUserQuit(User* user, const std::string& reason, const
 		}
 	}
 
-	// Regardless, update the UserCount
-	TreeServer::Get(user)->UserCount--;
+	// Regardless, update the UserCount and the user list
+	TreeServer* server = TreeServer::Get(user);
+	server->UserCount--;
+	if (!IS_LOCAL(user))
+		server->RemoveUser(static_cast<SpanningTree::RemoteUser*>(user));
 }
 
 void ModuleSpanningTree::OnUserPostNick(User* user, const std::string& oldnick)
@@ -777,9 +781,10 @@ restart:
 	for (const auto* child : Utils->TreeRoot->GetChildren())
 	{
 		TreeSocket* sock = child->GetSocket();
-		if (sock->GetModHook(mod))
+		IOHook* hook = sock->GetModHook(mod);
+		if (hook)
 		{
-			sock->SendError("TLS module unloaded");
+			sock->SendError(hook->prov->type == IOHookProvider::IOH_COMPRESS ? "Compression module unloaded" : "TLS module unloaded");
 			sock->Close();
 			// XXX: The list we're iterating is modified by TreeServer::SQuit() which is called by Close()
 			goto restart;
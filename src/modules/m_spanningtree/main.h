@@ -34,6 +34,7 @@
 #include "modules/ssl.h"
 #include "modules/stats.h"
 #include "modules/ctctags.h"
+#include "modules/ircv3_batch.h"
 #include "modules/server.h"
 #include "servercommand.h"
 #include "commands.h"
@@ -90,6 +91,9 @@ public:
 	/** API for accessing user client certificates. */
 	UserCertificateAPI sslapi;
 
+	/** API for sending netsplit batches to clients. */
+	IRCv3::Batch::API batchmanager;
+
 	/** Tags for server to server messages. */
 	ServerTags servertags;
 
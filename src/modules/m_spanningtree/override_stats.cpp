@@ -22,10 +22,13 @@
 
 
 #include "inspircd.h"
+#include "modules/compress.h"
 
 #include "main.h"
 #include "utils.h"
 #include "link.h"
+#include "treeserver.h"
+#include "treesocket.h"
 
 ModResult ModuleSpanningTree::OnStats(Stats::Context& stats)
 {
@@ -46,6 +49,31 @@ ModResult ModuleSpanningTree::OnStats(Stats::Context& stats)
 		}
 		return MOD_RES_DENY;
 	}
+	else if (stats.GetSymbol() == 'B')
+	{
+		for (const auto* server : Utils->TreeRoot->GetChildren())
+		{
+			TreeSocket* sock = server->GetSocket();
+			uint64_t wire_in = sock->bytes_in;
+			uint64_t wire_out = sock->bytes_out;
+			std::string compression = "none";
+
+			// Data sent before compression was negotiated went over the wire as-is.
+			const auto* hook = Compress::Hook::IsCompressed(sock);
+			if (hook)
+			{
+				wire_in = wire_in + hook->wire_in - std::min(hook->raw_in, wire_in);
+				wire_out = wire_out + hook->wire_out - std::min(hook->raw_out, wire_out);
+				compression = static_cast<Compress::Provider*>(hook->prov.get())->algorithm;
+			}
+
+			const std::string burst = server->IsBursting() ? "bursting" : ConvToStr(server->BurstTime) + "ms";
+			stats.AddRow(249, INSP_FORMAT("{} burst {} sent {:.2f}K ({:.2f}K on wire) recv {:.2f}K ({:.2f}K on wire) compression {}",
+				server->GetName(), burst, sock->bytes_out / 1024.0, wire_out / 1024.0, sock->bytes_in / 1024.0,
+				wire_in / 1024.0, compression));
+		}
+		return MOD_RES_DENY;
+	}
 	else if (stats.GetSymbol() == 'U')
 	{
 		for (const auto& [_, tag] : ServerInstance->Config->ConfTags("services", ServerInstance->Config->ConfTags("uline")))
@@ -27,6 +27,7 @@ namespace SpanningTree
 
 class SpanningTree::RemoteUser final
 	: public ::RemoteUser
+	, public insp::intrusive_list_node<SpanningTree::RemoteUser>
 {
 public:
 	RemoteUser(const std::string& uid, Server* srv);
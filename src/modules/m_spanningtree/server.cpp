@@ -245,6 +245,7 @@ bool TreeSocket::Inbound_Server(CommandBase::Params& params)
 
 		// Send our details: Our server name and description and hopcount of 0,
 		// along with the sendpass from this block.
+		StartCompression(*x);
 		this->WriteLine(INSP_FORMAT("SERVER {} {} {}{} :{}",
 			ServerInstance->Config->ServerName,
 			TreeSocket::MakePass(x->SendPass, this->GetTheirChallenge()),
@@ -28,4 +28,5 @@ public:
 	ServerTags(Module* Creator);
 	ModResult OnProcessTag(User* user, const std::string& tagname, std::string& tagvalue) override;
 	bool ShouldSendTag(LocalUser* user, const ClientProtocol::MessageTagData& tagdata) override;
+	bool OnlyDependsOnCaps() const override { return true; }
 };
@@ -156,6 +156,7 @@ void TreeServer::FinishBurst()
 	ServerInstance->XLines->ApplyLines();
 	uint64_t ts = ServerInstance->Time() * 1000 + (ServerInstance->Time_ns() / 1000000);
 	unsigned long bursttime = ts - this->StartBurst;
+	BurstTime = bursttime;
 	ServerInstance->SNO.WriteToSnoMask(Parent == Utils->TreeRoot ? 'l' : 'L', "Received end of netburst from \002{}\002 (burst time: {} {})",
 		GetName(), (bursttime > 10000 ? bursttime / 1000 : bursttime), (bursttime > 10000 ? "secs" : "msecs"));
 	Utils->Creator->linkeventprov.Call(&ServerProtocol::LinkEventListener::OnServerBurst, this);
@@ -183,7 +184,7 @@ void TreeServer::SQuitChild(TreeServer* server, const std::string& reason, bool
 	server->SQuitInternal(num_lost_servers, error);
 
 	const std::string quitreason = GetName() + " " + server->GetName();
-	size_t num_lost_users = QuitUsers(quitreason);
+	size_t num_lost_users = server->QuitUsers(quitreason);
 
 	ServerInstance->SNO.WriteToSnoMask(IsRoot() ? 'l' : 'L', "Netsplit complete, lost \002{}\002 user{} on \002{}\002 server{}.",
 		num_lost_users, num_lost_users != 1 ? "s" : "", num_lost_servers, num_lost_servers != 1 ? "s" : "");
@@ -218,20 +219,52 @@ void TreeServer::SQuitInternal(unsigned int& num_lost_servers, bool error)
 
 size_t TreeServer::QuitUsers(const std::string& reason)
 {
-	std::string publicreason = Utils->HideSplits ? "*.net *.split" : reason;
+	// Gather the users on the lost servers from their user lists rather than
+	// walking the entire user map looking for users on dead servers.
+	std::vector<User*> lostusers;
+	std::vector<const TreeServer*> pending = { this };
+	while (!pending.empty())
+	{
+		const TreeServer* server = pending.back();
+		pending.pop_back();
+
+		lostusers.insert(lostusers.end(), server->users.begin(), server->users.end());
+		pending.insert(pending.end(), server->Children.begin(), server->Children.end());
+	}
 
-	const UserMap& users = ServerInstance->Users.GetUsers();
-	size_t original_size = users.size();
-	for (UserMap::const_iterator i = users.begin(); i != users.end(); )
+	if (lostusers.empty())
+		return 0;
+
+	const std::string publicreason = Utils->HideSplits ? "*.net *.split" : reason;
+
+	// If the batch module is loaded then send the quits to capable clients in
+	// a netsplit batch. Clients only receive the batch if they see a quit.
+	IRCv3::Batch::Batch batch("netsplit");
+	UserManager::QuitMessageHandler handler;
+	if (Utils->Creator->batchmanager)
 	{
-		User* user = i->second;
-		// Increment the iterator now because QuitUser() removes the user from the container
-		++i;
-		TreeServer* server = TreeServer::Get(user);
-		if (server->IsDead())
-			ServerInstance->Users.QuitUser(user, publicreason, &reason);
+		Utils->Creator->batchmanager->Start(batch);
+		ClientProtocol::Message& startmsg = batch.GetBatchStartMessage();
+		if (Utils->HideSplits)
+		{
+			startmsg.PushParam("*.net");
+			startmsg.PushParam("*.split");
+		}
+		else
+		{
+			startmsg.PushParam(GetParent()->GetName());
+			startmsg.PushParam(GetName());
+		}
+		handler = [&batch](ClientProtocol::Message& msg) { batch.AddToBatch(msg); };
 	}
-	return original_size - users.size();
+
+	const size_t original_size = ServerInstance->Users.GetUsers().size();
+	ServerInstance->Users.QuitUsers(lostusers, publicreason, &reason, handler);
+
+	if (Utils->Creator->batchmanager)
+		Utils->Creator->batchmanager->End(batch);
+
+	return original_size - ServerInstance->Users.GetUsers().size();
 }
 
 void TreeServer::CheckService()
@@ -28,6 +28,7 @@
 
 #include "treesocket.h"
 #include "pingtimer.h"
+#include "remoteuser.h"
 
 /** Each server in the tree is represented by one class of
  * type TreeServer. A locally connected TreeServer can
@@ -46,6 +47,11 @@
 class TreeServer final
 	: public Server
 {
+public:
+	/** A list of users which are connected to a server. */
+	typedef insp::intrusive_list<SpanningTree::RemoteUser> UserList;
+
+private:
 	TreeServer* Parent = nullptr;		/* Parent entry */
 	TreeServer* Route = nullptr;		/* Route entry */
 	std::vector<TreeServer*> Children;	/* List of child objects */
@@ -62,6 +68,10 @@ class TreeServer final
 	 */
 	bool isdead = false;
 
+	/** The users which are connected to this server. This is always empty for the root server.
+	 */
+	UserList users;
+
 	/** Timer handling PINGing the server and killing it on timeout
 	 */
 	PingTimer pingtimer;
@@ -123,7 +133,24 @@ public:
 		GetParent()->SQuitChild(this, reason, error);
 	}
 
-	static size_t QuitUsers(const std::string& reason);
+	/** Quit all users on this server and all servers behind it in a single netsplit batch.
+	 * @param reason The quit reason to show to opers. Normal users will see "*.net *.split" if hidesplits is enabled.
+	 * @return The number of users which were quit.
+	 */
+	size_t QuitUsers(const std::string& reason);
+
+	/** Adds a newly introduced user to the list of users on this server.
+	 * @param user The user to add.
+	 */
+	void AddUser(SpanningTree::RemoteUser* user) { users.push_front(user); }
+
+	/** Removes a quitting user from the list of users on this server.
+	 * @param user The user to remove.
+	 */
+	void RemoveUser(SpanningTree::RemoteUser* user) { users.erase(user); }
+
+	/** Retrieves the users which are connected to this server. */
+	const UserList& GetUsers() const { return users; }
 
 	/** Get route.
 	 * The 'route' is defined as the locally-
@@ -152,6 +179,9 @@ public:
 	 */
 	uint64_t StartBurst = 0;
 
+	/** How long the most recent burst from this server took in milliseconds. */
+	uint64_t BurstTime = 0;
+
 	/** True if this server is hidden
 	 */
 	bool Hidden = false;
@@ -194,9 +194,21 @@ class TreeSocket final
 	 */
 	void WriteLineInternal(const std::string& line);
 
+	/** Starts compressing data sent to the remote server if the link block asks for it
+	 * and the remote server supports it.
+	 * @param link The link block for the remote server.
+	 */
+	void StartCompression(const Link& link);
+
 public:
 	const time_t age;
 
+	/** The number of bytes of protocol data which have been received from the remote server. */
+	uint64_t bytes_in = 0;
+
+	/** The number of bytes of protocol data which have been sent to the remote server. */
+	uint64_t bytes_out = 0;
+
 	// The protocol version which has been negotiated with the remote server.
 	uint16_t proto_version = PROTO_NEWEST;
 
@@ -204,6 +204,7 @@ void TreeSocket::OnDataReady()
 	std::string line;
 	while (GetNextLine(line))
 	{
+		bytes_in += line.length() + 1;
 		std::string::size_type rline = line.find('\r');
 		if (rline != std::string::npos)
 			line.erase(rline);
@@ -237,6 +238,7 @@ static std::string newline("\n");
 void TreeSocket::WriteLineInternal(const std::string& line)
 {
 	ServerInstance->Logs.RawIO(MODNAME, "S[{}] O {}", GetFd(), line);
+	bytes_out += line.length() + newline.length();
 	this->WriteData(line);
 	this->WriteData(newline);
 }
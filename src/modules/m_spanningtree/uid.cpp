@@ -80,6 +80,7 @@ CmdResult CommandUID::HandleServer(TreeServer* remoteserver, CommandBase::Params
 	 * If the UUID already exists User::User() throws an exception which causes this connection to be closed.
 	 */
 	auto* _new = new SpanningTree::RemoteUser(params[0], remoteserver);
+	remoteserver->AddUser(_new);
 	ServerInstance->Users.clientlist[params[2]] = _new;
 	_new->nick = params[2];
 	_new->ChangeRealHost(params[3], false);
@@ -145,36 +145,55 @@ void SpanningTreeUtilities::GetListOfServersForChannel(const Channel* c, TreeSoc
 			minrank = mh->GetPrefixRank();
 	}
 
-	TreeServer::ChildServers children = TreeRoot->GetChildren();
-	for (const auto& [user, memb] : c->GetUsers())
+	// Work out how many of the remote members on each server are exempt from this message.
+	insp::flat_map<const Server*, size_t> exemptcounts;
+	for (auto* user : exempt_list)
 	{
 		if (IS_LOCAL(user))
 			continue;
 
-		if (minrank && memb->GetRank() < minrank)
-			continue;
+		Membership* memb = c->GetUser(user);
+		if (memb && memb->GetRank() >= minrank)
+			exemptcounts[user->server]++;
+	}
 
-		if (exempt_list.find(user) == exempt_list.end())
+	// The channel keeps a count of its remote members on each server so we only need to visit the
+	// servers that have members rather than every member.
+	for (const auto& [server, rankcounts] : c->GetRemoteUsers())
+	{
+		size_t members = 0;
+		for (const auto& [rank, count] : rankcounts)
 		{
-			TreeServer* best = TreeServer::Get(user);
-			list.insert(best->GetSocket());
-
-			TreeServer::ChildServers::iterator citer = std::find(children.begin(), children.end(), best);
-			if (citer != children.end())
-				children.erase(citer);
+			if (rank < minrank)
+				break; // Ordered by descending rank.
+			members += count;
 		}
+
+		auto exemptcount = exemptcounts.find(server);
+		if (exemptcount != exemptcounts.end())
+			members -= std::min(members, exemptcount->second);
+
+		if (members)
+			list.insert(static_cast<TreeServer*>(server)->GetSocket());
 	}
 
 	// Check whether the servers which do not have users in the channel might need this message. This
 	// is used to keep the chanhistory module synchronised between servers.
+	if (Creator->routeeventprov.GetSubscribers().empty())
+		return;
+
 	for (const auto &[_, server] : Utils->serverlist)
 	{
 		if (!server->GetRoute())
 			continue; // Local server
 
+		TreeSocket* sock = server->GetRoute()->GetSocket();
+		if (list.count(sock))
+			continue; // Already being routed to this server.
+
 		ModResult result = Creator->routeeventprov.FirstResult(&ServerProtocol::RouteEventListener::OnRouteMessage, c, server);
 		if (result == MOD_RES_ALLOW)
-			list.insert(server->GetRoute()->GetSocket());
+			list.insert(sock);
 	}
 }
 
@@ -300,6 +319,7 @@ void SpanningTreeUtilities::ReadConfiguration(ConfigStatus& status)
 		L->HiddenFromStats = tag->getBool("statshidden");
 		L->Timeout = tag->getDuration("timeout", 30);
 		L->Hook = tag->getString("sslprofile");
+		L->Compress = tag->getString("compress");
 		L->Bind = tag->getString("bind");
 		L->Hidden = tag->getBool("hidden");
 
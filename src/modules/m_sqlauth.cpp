@@ -84,19 +84,41 @@ public:
 					return;
 				}
 
+				std::vector<std::string> hashes;
 				SQL::Row row;
 				while (res.GetRow(row))
 				{
-					if (row[colindex].has_value() && hashprov->Compare(user->password, *row[colindex]))
+					if (row[colindex].has_value())
+						hashes.push_back(*row[colindex]);
+				}
+
+				auto callback = [uuid = uid, &ext = pendingExt, verb = verbose](bool valid) {
+					auto* luser = ServerInstance->Users.FindUUID<LocalUser>(uuid);
+					if (!luser)
+						return;
+
+					if (valid)
 					{
-						pendingExt.Set(user, AUTH_STATE_NONE);
+						ext.Set(luser, AUTH_STATE_NONE);
 						return;
 					}
+
+					if (verb)
+						ServerInstance->SNO.WriteGlobalSno('a', "Forbidden connection from {} (password from the SQL query did not match the user provided password)", luser->GetRealMask());
+					ext.Set(luser, AUTH_STATE_FAIL);
+				};
+
+				// Key derivation functions are deliberately slow so we compare them on a worker
+				// thread. The user is held in AUTH_STATE_BUSY until the callback is called.
+				if (hashprov->IsKDF())
+				{
+					ServerInstance->Workers.Submit(new HashCompareJob(hashprov, user->password, hashes, callback));
+					return;
 				}
 
-				if (verbose)
-					ServerInstance->SNO.WriteGlobalSno('a', "Forbidden connection from {} (password from the SQL query did not match the user provided password)", user->GetRealMask());
-				pendingExt.Set(user, AUTH_STATE_FAIL);
+				callback(std::any_of(hashes.begin(), hashes.end(), [&](const std::string& hash) {
+					return hashprov->Compare(user->password, hash);
+				}));
 				return;
 			}
 
@@ -467,6 +467,8 @@ public:
 			text.append(" using TLS cipher '");
 			ssliohook->GetCiphersuite(text);
 			text.push_back('\'');
+			if (ssliohook->IsKernelOffloaded())
+				text.append(" (offloaded to the kernel)");
 			if (cert && !cert->GetFingerprint().empty())
 				text.append(" and your TLS client certificate fingerprint is ").append(cert->GetFingerprint());
 			user->WriteNotice(text);
@@ -521,6 +523,7 @@ public:
 		std::map<std::string, size_t> counts;
 		auto& plaintext = counts["Plain text"];
 		auto& unknown = counts["Unknown"];
+		size_t offloaded = 0;
 		for (auto* user : ServerInstance->Users.GetLocalUsers())
 		{
 			const auto* ssliohook = SSLIOHook::IsSSL(&user->eh);
@@ -530,6 +533,9 @@ public:
 				continue;
 			}
 
+			if (ssliohook->IsKernelOffloaded())
+				offloaded++;
+
 			std::string ciphersuite;
 			ssliohook->GetCiphersuite(ciphersuite);
 			if (ciphersuite.empty())
@@ -552,6 +558,16 @@ public:
 					{ "percent",     INSP_FORMAT("{:3.2f}", percent) },
 				});
 		}
+
+		if (offloaded)
+		{
+			const auto percent = round((offloaded * 100) / total);
+			stats.AddGenericRow(INSP_FORMAT("Kernel TLS offload: {} ({:3.2f}%)", offloaded, percent))
+				.AddTags(stats, {
+					{ "ktls",    ConvToStr(offloaded)            },
+					{ "percent", INSP_FORMAT("{:3.2f}", percent) },
+				});
+		}
 		return MOD_RES_DENY;
 	}
 
@@ -48,6 +48,14 @@ public:
 
 		return MOD_RES_PASSTHRU;
 	}
+
+	ModResult OnNamesListVariant(LocalUser* issuer, Channel* chan, std::string& variant) override
+	{
+		if (cap.IsEnabled(issuer))
+			variant.append("userhost-in-names;");
+
+		return MOD_RES_PASSTHRU;
+	}
 };
 
 MODULE_INIT(ModuleUHNames)
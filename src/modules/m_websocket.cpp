@@ -199,6 +199,10 @@ class WebSocketHook final
 
 	State state = STATE_HTTPREQ;
 	time_t lastpingpong = 0;
+
+	// The position within the recvq of the next frame. Frames are only removed from the recvq once
+	// all of the complete frames in it have been handled.
+	std::string::size_type framepos = 0;
 	WebSocketConfig& config;
 	bool sendastext;
 
@@ -228,23 +232,25 @@ class WebSocketHook final
 		return pos;
 	}
 
-	static StreamSocket::SendQueue::Element PrepareSendQElem(size_t size, OpCode opcode)
+	static std::string PrepareSendQElem(size_t size, OpCode opcode)
 	{
 		unsigned char header[MAXHEADERSIZE];
 		const size_t n = FillHeader(header, size, opcode);
 
-		return StreamSocket::SendQueue::Element(reinterpret_cast<const char*>(header), n);
+		return std::string(reinterpret_cast<const char*>(header), n);
 	}
 
 	int HandleAppData(StreamSocket* sock, std::string& appdataout, bool allowlarge)
 	{
-		std::string& myrecvq = GetRecvQ();
+		const std::string& myrecvq = GetRecvQ();
+		const std::string::size_type available = myrecvq.length() - framepos;
+
 		// Need 1 byte opcode, minimum 1 byte len, 4 bytes masking key
-		if (myrecvq.length() < 6)
+		if (available < 6)
 			return 0;
 
-		const std::string& cmyrecvq = myrecvq;
-		unsigned char len1 = (unsigned char)cmyrecvq[1];
+		const char* frame = myrecvq.data() + framepos;
+		unsigned char len1 = (unsigned char)frame[1];
 		if (!(len1 & WS_MASKBIT))
 		{
 			CloseConnection(sock, CLOSE_PROTOCOL_ERROR, "WebSocket protocol violation: unmasked client frame");
@@ -256,7 +262,7 @@ class WebSocketHook final
 		// Assume the length is a single byte, if not, update values later
 		unsigned int len = len1;
 		unsigned int payloadstartoffset = 6;
-		const unsigned char* maskkey = reinterpret_cast<const unsigned char*>(&cmyrecvq[2]);
+		const unsigned char* maskkey = reinterpret_cast<const unsigned char*>(&frame[2]);
 
 		if (len1 == WS_PAYLOAD_LENGTH_MAGIC_LARGE)
 		{
@@ -269,11 +275,11 @@ class WebSocketHook final
 
 			// Large frame, has 2 bytes len after the magic byte indicating the length
 			// Need 1 byte opcode, 3 bytes len, 4 bytes masking key
-			if (myrecvq.length() < 8)
+			if (available < 8)
 				return 0;
 
-			unsigned char len2 = (unsigned char)cmyrecvq[2];
-			unsigned char len3 = (unsigned char)cmyrecvq[3];
+			unsigned char len2 = (unsigned char)frame[2];
+			unsigned char len3 = (unsigned char)frame[3];
 			len = (len2 << 8) | len3;
 
 			if (len <= WS_MAX_PAYLOAD_LENGTH_SMALL)
@@ -291,19 +297,17 @@ class WebSocketHook final
 			return -1;
 		}
 
-		if (myrecvq.length() < payloadstartoffset + len)
+		if (available < payloadstartoffset + len)
 			return 0;
 
-		unsigned int maskkeypos = 0;
-		const std::string::iterator endit = myrecvq.begin() + payloadstartoffset + len;
-		for (std::string::const_iterator i = myrecvq.begin() + payloadstartoffset; i != endit; ++i)
+		appdataout.reserve(appdataout.length() + len);
+		for (unsigned int i = 0; i < len; ++i)
 		{
-			const unsigned char c = (unsigned char)*i;
-			appdataout.push_back(c ^ maskkey[maskkeypos++]);
-			maskkeypos %= 4;
+			const unsigned char c = (unsigned char)frame[payloadstartoffset + i];
+			appdataout.push_back(c ^ maskkey[i % 4]);
 		}
 
-		myrecvq.erase(myrecvq.begin(), endit);
+		framepos += payloadstartoffset + len;
 		return 1;
 	}
 
@@ -324,9 +328,9 @@ class WebSocketHook final
 
 		if (isping)
 		{
-			StreamSocket::SendQueue::Element elem = PrepareSendQElem(appdata.length(), OP_PONG);
+			std::string elem = PrepareSendQElem(appdata.length(), OP_PONG);
 			elem.append(appdata);
-			GetSendQ().push_back(elem);
+			GetSendQ().push_back(std::move(elem));
 
 			SocketEngine::ChangeEventMask(sock, FD_ADD_TRIAL_WRITE);
 		}
@@ -341,10 +345,10 @@ class WebSocketHook final
 
 	int HandleWS(StreamSocket* sock, std::string& destrecvq)
 	{
-		if (GetRecvQ().empty())
+		if (framepos >= GetRecvQ().length())
 			return 0;
 
-		unsigned char opcode = (unsigned char)GetRecvQ()[0];
+		unsigned char opcode = (unsigned char)GetRecvQ()[framepos];
 		switch (opcode & ~WS_FINBIT)
 		{
 			case OP_CONTINUATION:
@@ -650,8 +654,11 @@ public:
 		{
 			wsret = HandleWS(sock, destrecvq);
 		}
-		while ((!GetRecvQ().empty()) && (wsret > 0));
+		while ((framepos < GetRecvQ().length()) && (wsret > 0));
 
+		// Remove all of the frames we handled at once rather than shifting the recvq for every frame.
+		GetRecvQ().erase(0, framepos);
+		framepos = 0;
 		return wsret;
 	}
 
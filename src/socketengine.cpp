@@ -122,6 +122,9 @@ void SocketEngine::DispatchTrialWrites()
 	working_list.reserve(trials.size());
 	working_list.assign(trials.begin(), trials.end());
 	trials.clear();
+
+	// Writes to plain sockets are collected so the socket engine can perform them all at once.
+	StreamSocket::BeginWriteBatch();
 	for(int fd : working_list)
 	{
 		EventHandler* eh = GetRef(fd);
@@ -135,6 +138,7 @@ void SocketEngine::DispatchTrialWrites()
 		if ((mask & (FD_ADD_TRIAL_WRITE | FD_WRITE_WILL_BLOCK)) == FD_ADD_TRIAL_WRITE)
 			eh->OnEventHandlerWrite();
 	}
+	StreamSocket::EndWriteBatch();
 }
 
 bool SocketEngine::AddFdRef(EventHandler* eh)
@@ -57,6 +57,12 @@ void SocketEngine::RecoverFromFork()
 {
 }
 
+bool SocketEngine::WriteVBatch(WriteRequest* requests, size_t count)
+{
+	// Writes can not be batched with this socket engine.
+	return false;
+}
+
 void SocketEngine::Deinit()
 {
 	Close(EngineHandle);
@@ -161,7 +167,7 @@ void SocketEngine::DelFd(EventHandler* eh)
 
 int SocketEngine::DispatchEvents()
 {
-	int i = epoll_wait(EngineHandle, events.data(), static_cast<int>(events.size()), 1000);
+	int i = epoll_wait(EngineHandle, events.data(), static_cast<int>(events.size()), ServerInstance->Timers.GetWaitTime());
 	ServerInstance->UpdateTime();
 
 	stats.TotalEvents += i;
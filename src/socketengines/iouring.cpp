@@ -0,0 +1,755 @@
+/*
+ * InspIRCd -- Internet Relay Chat Daemon
+ *
+ * This file is part of InspIRCd.  InspIRCd is free software: you can
+ * redistribute it and/or modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation, version 2.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "inspircd.h"
+
+#include <linux/io_uring.h>
+#include <poll.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+
+/** A specialisation of the SocketEngine class, designed to use Linux io_uring.
+ *
+ * Readiness is requested with IORING_OP_POLL_ADD. Edge-triggered interest is
+ * served by multishot polls which stay armed until the interest changes and
+ * level-triggered interest by one-shot polls which are re-armed after every
+ * completion. Interest changes are queued in the submission ring as they
+ * happen and are handed to the kernel by the same io_uring_enter() call that
+ * waits for completions, so a loop iteration costs a single system call no
+ * matter how many sockets changed state.
+ *
+ * Listening sockets are served by multishot accept requests which hand over
+ * new connections directly instead of reporting that accept() would succeed.
+ * Writes which are flushed together by SocketEngine::DispatchTrialWrites are
+ * submitted as non-blocking IORING_OP_SENDMSG requests by one system call.
+ * Reads remain readiness-based as I/O hooks (e.g. TLS) read from the fd
+ * themselves.
+ */
+namespace
+{
+	/** The type of request that a completion was posted for. */
+	enum RequestKind
+		: uint64_t
+	{
+		/** A poll for the socket becoming readable. */
+		RK_READ = 0,
+
+		/** A poll for the socket becoming writable. */
+		RK_WRITE = 1,
+
+		/** A request whose completion is not interesting (e.g. POLL_REMOVE). */
+		RK_INTERNAL = 2,
+
+		/** A multishot accept on a listening socket. */
+		RK_ACCEPT = 3,
+
+		/** A send which is part of a write batch. The fd field holds the index of the write. */
+		RK_SEND = 4,
+	};
+
+	/** How a poll request for one direction of an fd is armed. */
+	enum ArmState
+		: uint8_t
+	{
+		/** No poll request is armed. */
+		ARM_NONE,
+
+		/** A one-shot poll request is armed. */
+		ARM_LEVEL,
+
+		/** A multishot poll request is armed. */
+		ARM_EDGE,
+
+		/** A multishot accept request is armed. */
+		ARM_ACCEPT,
+	};
+
+	/** The state of the poll request for one direction of an fd. */
+	struct PollState final
+	{
+		/** The sequence number of the most recently armed request. Completions
+		 * carrying any other sequence number belong to a removed request.
+		 */
+		uint32_t seq = 0;
+
+		/** How the current request is armed. */
+		ArmState armed = ARM_NONE;
+	};
+
+	/** The state of an fd that is known to the socket engine. */
+	struct FdState final
+	{
+		/** The poll requests for reading and writing. */
+		PollState polls[2];
+
+		/** Whether this fd is queued for having its poll requests synced. */
+		bool dirty = false;
+	};
+
+	/** The number of bits of the sequence number stored in a request. */
+	constexpr uint64_t SEQ_MASK = (UINT64_C(1) << 29) - 1;
+
+	/** The requested size of the submission ring. */
+	constexpr unsigned SQ_ENTRIES = 4096;
+
+	/** The requested size of the completion ring. */
+	constexpr unsigned CQ_ENTRIES = SQ_ENTRIES * 4;
+
+	/** The io_uring instance. */
+	int EngineHandle = -1;
+
+	/** The parameters the io_uring instance was created with. */
+	struct io_uring_params params;
+
+	/** The memory mapped ring buffers. */
+	void* sqring = MAP_FAILED;
+	void* cqring = MAP_FAILED;
+	size_t sqringsize = 0;
+	size_t cqringsize = 0;
+	io_uring_sqe* sqes = static_cast<io_uring_sqe*>(MAP_FAILED);
+
+	/** Pointers into the submission ring. */
+	unsigned* sqhead;
+	unsigned* sqtail;
+	unsigned* sqmask;
+	unsigned* sqarray;
+
+	/** Pointers into the completion ring. */
+	unsigned* cqhead;
+	unsigned* cqtail;
+	unsigned* cqmask;
+	io_uring_cqe* cqes;
+
+	/** The number of requests which have been queued but not submitted. */
+	unsigned pending = 0;
+
+	/** Whether the kernel supports multishot polls. */
+	bool multishot = true;
+
+	/** Whether the kernel supports multishot accepts. */
+	bool multishotaccept = true;
+
+	/** The state of each fd, indexed by fd. */
+	std::vector<FdState> fdstates(16);
+
+	/** The fds which need their poll requests synced before the next wait. */
+	std::vector<int> dirtyfds;
+
+	/** A completion which has been copied out of the completion ring. */
+	struct Completion final
+	{
+		uint64_t user_data;
+		int32_t res;
+		uint32_t flags;
+	};
+
+	/** Holds completions whilst they are being dispatched. */
+	std::vector<Completion> events;
+
+	/** Completions which were reaped whilst waiting for a write batch. */
+	std::vector<Completion> deferred;
+
+	/** The message headers of the sends in the current write batch. */
+	std::vector<msghdr> sendmsgs;
+}
+
+static int io_uring_setup(unsigned entries, struct io_uring_params* p)
+{
+	return static_cast<int>(syscall(__NR_io_uring_setup, entries, p));
+}
+
+static int io_uring_enter(unsigned to_submit, unsigned min_complete, unsigned flags, const void* arg, size_t argsz)
+{
+	return static_cast<int>(syscall(__NR_io_uring_enter, EngineHandle, to_submit, min_complete, flags, arg, argsz));
+}
+
+template <typename T>
+static T* RingPointer(void* ring, uint32_t offset)
+{
+	return reinterpret_cast<T*>(static_cast<char*>(ring) + offset);
+}
+
+static uint64_t MakeUserData(int fd, RequestKind kind, uint32_t seq)
+{
+	return static_cast<uint32_t>(fd) | (kind << 32) | ((seq & SEQ_MASK) << 35);
+}
+
+static RequestKind GetKind(uint64_t user_data)
+{
+	return static_cast<RequestKind>((user_data >> 32) & 7);
+}
+
+static uint32_t GetSeq(uint64_t user_data)
+{
+	return static_cast<uint32_t>(user_data >> 35);
+}
+
+/** Hands any queued requests to the kernel without waiting for completions. */
+static void Submit()
+{
+	int ret = io_uring_enter(pending, 0, 0, nullptr, 0);
+	if (ret < 0)
+	{
+		ServerInstance->Logs.Debug("SOCKET", "io_uring_enter can't submit requests: {}", strerror(errno));
+		return;
+	}
+	pending -= std::min<unsigned>(ret, pending);
+}
+
+/** Retrieves a cleared submission queue entry, flushing the ring if it is full. */
+static io_uring_sqe* GetSQE()
+{
+	unsigned tail = *sqtail;
+	if (tail - __atomic_load_n(sqhead, __ATOMIC_ACQUIRE) >= params.sq_entries)
+	{
+		Submit();
+		if (tail - __atomic_load_n(sqhead, __ATOMIC_ACQUIRE) >= params.sq_entries)
+			return nullptr;
+	}
+
+	io_uring_sqe* sqe = &sqes[tail & *sqmask];
+	memset(sqe, 0, sizeof(*sqe));
+	return sqe;
+}
+
+/** Publishes the entry most recently returned by GetSQE() to the kernel. */
+static void CommitSQE()
+{
+	unsigned tail = *sqtail;
+	sqarray[tail & *sqmask] = tail & *sqmask;
+	__atomic_store_n(sqtail, tail + 1, __ATOMIC_RELEASE);
+	pending++;
+}
+
+static ArmState mask_to_arm(int event_mask, RequestKind kind)
+{
+	if (kind == RK_READ)
+	{
+		if (event_mask & FD_WANT_POLL_READ)
+			return ARM_LEVEL;
+		if (event_mask & (FD_WANT_FAST_READ | FD_WANT_EDGE_READ))
+			return ARM_EDGE;
+	}
+	else
+	{
+		if (event_mask & (FD_WANT_POLL_WRITE | FD_WANT_SINGLE_WRITE))
+			return ARM_LEVEL;
+		if (event_mask & (FD_WANT_FAST_WRITE | FD_WANT_EDGE_WRITE))
+			return ARM_EDGE;
+	}
+	return ARM_NONE;
+}
+
+static void MarkDirty(int fd)
+{
+	if (static_cast<size_t>(fd) >= fdstates.size())
+		fdstates.resize(std::max<size_t>(fd + 1, fdstates.size() * 2));
+
+	FdState& state = fdstates[fd];
+	if (!state.dirty)
+	{
+		state.dirty = true;
+		dirtyfds.push_back(fd);
+	}
+}
+
+static void ArmPoll(int fd, RequestKind kind, ArmState arm)
+{
+	io_uring_sqe* sqe = GetSQE();
+	if (!sqe)
+	{
+		// Try again on the next loop iteration.
+		MarkDirty(fd);
+		return;
+	}
+
+	PollState& poll = fdstates[fd].polls[kind];
+	if (arm == ARM_ACCEPT)
+	{
+		sqe->opcode = IORING_OP_ACCEPT;
+		sqe->fd = fd;
+		sqe->ioprio = IORING_ACCEPT_MULTISHOT;
+		sqe->accept_flags = SOCK_NONBLOCK;
+		sqe->user_data = MakeUserData(fd, RK_ACCEPT, ++poll.seq);
+		CommitSQE();
+
+		poll.armed = arm;
+		return;
+	}
+
+	if (arm == ARM_EDGE && !multishot)
+		arm = ARM_LEVEL;
+
+	uint32_t pollevents = (kind == RK_READ ? POLLIN : POLLOUT);
+#if __BYTE_ORDER == __BIG_ENDIAN
+	pollevents = (pollevents << 16) | (pollevents >> 16);
+#endif
+
+	sqe->opcode = IORING_OP_POLL_ADD;
+	sqe->fd = fd;
+	sqe->poll32_events = pollevents;
+	sqe->len = (arm == ARM_EDGE ? IORING_POLL_ADD_MULTI : 0);
+	sqe->user_data = MakeUserData(fd, kind, ++poll.seq);
+	CommitSQE();
+
+	poll.armed = arm;
+}
+
+static void DisarmPoll(int fd, RequestKind kind)
+{
+	PollState& poll = fdstates[fd].polls[kind];
+	if (poll.armed == ARM_NONE)
+		return;
+
+	io_uring_sqe* sqe = GetSQE();
+	if (sqe)
+	{
+		if (poll.armed == ARM_ACCEPT)
+		{
+			sqe->opcode = IORING_OP_ASYNC_CANCEL;
+			sqe->addr = MakeUserData(fd, RK_ACCEPT, poll.seq);
+		}
+		else
+		{
+			sqe->opcode = IORING_OP_POLL_REMOVE;
+			sqe->addr = MakeUserData(fd, kind, poll.seq);
+		}
+		sqe->fd = -1;
+		sqe->user_data = MakeUserData(fd, RK_INTERNAL, 0);
+		CommitSQE();
+	}
+	else
+	{
+		ServerInstance->Logs.Debug("SOCKET", "Unable to remove io_uring poll for fd: {}", fd);
+	}
+
+	// Any completions which are still in flight for the removed request
+	// will be ignored as they no longer match the sequence number.
+	poll.armed = ARM_NONE;
+	poll.seq++;
+}
+
+/** Copies the completions out of the ring so the kernel can reuse the space. */
+static void ReapCompletions(std::vector<Completion>& out)
+{
+	unsigned head = *cqhead;
+	const unsigned tail = __atomic_load_n(cqtail, __ATOMIC_ACQUIRE);
+	for (; head != tail; ++head)
+	{
+		const io_uring_cqe& cqe = cqes[head & *cqmask];
+		out.push_back({ cqe.user_data, cqe.res, cqe.flags });
+	}
+	__atomic_store_n(cqhead, tail, __ATOMIC_RELEASE);
+}
+
+/** Hands a connection accepted by a multishot accept to its listener. */
+static bool DispatchAccept(int fd, const Completion& cqe)
+{
+	PollState& poll = fdstates[fd].polls[RK_READ];
+	EventHandler* const eh = SocketEngine::GetRef(fd);
+	if (GetSeq(cqe.user_data) != (poll.seq & SEQ_MASK) || !eh)
+	{
+		// The listener has gone away so nothing wants the connection.
+		if (cqe.res >= 0)
+			SocketEngine::Close(cqe.res);
+		return false;
+	}
+
+	if (!(cqe.flags & IORING_CQE_F_MORE))
+	{
+		// The request has finished; it will be re-armed if still wanted.
+		poll.armed = ARM_NONE;
+		MarkDirty(fd);
+	}
+
+	if (cqe.res == -EINVAL)
+	{
+		// Kernels before 5.19 do not support multishot accepts.
+		ServerInstance->Logs.Debug("SOCKET", "io_uring does not support multishot accepts, falling back to polls");
+		multishotaccept = false;
+		return false;
+	}
+
+	if (cqe.res == -ECANCELED)
+		return false;
+
+	irc::sockets::sockaddrs client(false);
+	int incomingfd = cqe.res;
+	if (incomingfd < 0)
+	{
+		errno = -incomingfd;
+	}
+	else
+	{
+		socklen_t length = sizeof(client);
+		if (getpeername(incomingfd, &client.sa, &length))
+		{
+			// The connection was reset before we got to it.
+			const int error = errno;
+			SocketEngine::Close(incomingfd);
+			incomingfd = -1;
+			errno = error;
+		}
+	}
+
+	static_cast<ListenSocket*>(eh)->OnAccept(incomingfd, client);
+	return true;
+}
+
+/** Brings the poll requests of every dirty fd into line with its event mask. */
+static void SyncPolls()
+{
+	// ArmPoll may requeue an fd if the submission ring is full so work on a copy.
+	std::vector<int> working_list;
+	working_list.swap(dirtyfds);
+	for (const auto fd : working_list)
+	{
+		FdState& state = fdstates[fd];
+		state.dirty = false;
+
+		EventHandler* eh = SocketEngine::GetRef(fd);
+		if (!eh)
+			continue;
+
+		for (const auto kind : { RK_READ, RK_WRITE })
+		{
+			ArmState want = mask_to_arm(eh->GetEventMask(), kind);
+			if (want != ARM_NONE && kind == RK_READ && (eh->GetEventMask() & FD_ACCEPTS) && multishotaccept)
+				want = ARM_ACCEPT;
+
+			const ArmState have = state.polls[kind].armed;
+			if (want == have || (want == ARM_EDGE && have == ARM_LEVEL && !multishot))
+				continue;
+
+			DisarmPoll(fd, kind);
+			if (want != ARM_NONE)
+				ArmPoll(fd, kind, want);
+		}
+	}
+}
+
+void SocketEngine::Init()
+{
+	LookupMaxFds();
+
+	memset(&params, 0, sizeof(params));
+	params.flags = IORING_SETUP_CQSIZE;
+	params.cq_entries = CQ_ENTRIES;
+	EngineHandle = io_uring_setup(SQ_ENTRIES, &params);
+	if (EngineHandle == -1)
+		InitError();
+
+	// We rely on IORING_ENTER_EXT_ARG to wait with a timeout (Linux 5.11+).
+	if (!(params.features & IORING_FEAT_EXT_ARG))
+	{
+		errno = ENOSYS;
+		InitError();
+	}
+
+	sqringsize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+	cqringsize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+	if (params.features & IORING_FEAT_SINGLE_MMAP)
+		sqringsize = cqringsize = std::max(sqringsize, cqringsize);
+
+	sqring = mmap(nullptr, sqringsize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, EngineHandle, IORING_OFF_SQ_RING);
+	if (sqring == MAP_FAILED)
+		InitError();
+
+	if (params.features & IORING_FEAT_SINGLE_MMAP)
+		cqring = sqring;
+	else
+	{
+		cqring = mmap(nullptr, cqringsize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, EngineHandle, IORING_OFF_CQ_RING);
+		if (cqring == MAP_FAILED)
+			InitError();
+	}
+
+	void* sqemap = mmap(nullptr, params.sq_entries * sizeof(io_uring_sqe), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, EngineHandle, IORING_OFF_SQES);
+	if (sqemap == MAP_FAILED)
+		InitError();
+	sqes = static_cast<io_uring_sqe*>(sqemap);
+
+	sqhead = RingPointer<unsigned>(sqring, params.sq_off.head);
+	sqtail = RingPointer<unsigned>(sqring, params.sq_off.tail);
+	sqmask = RingPointer<unsigned>(sqring, params.sq_off.ring_mask);
+	sqarray = RingPointer<unsigned>(sqring, params.sq_off.array);
+
+	cqhead = RingPointer<unsigned>(cqring, params.cq_off.head);
+	cqtail = RingPointer<unsigned>(cqring, params.cq_off.tail);
+	cqmask = RingPointer<unsigned>(cqring, params.cq_off.ring_mask);
+	cqes = RingPointer<io_uring_cqe>(cqring, params.cq_off.cqes);
+
+	events.reserve(params.cq_entries);
+}
+
+void SocketEngine::RecoverFromFork()
+{
+}
+
+void SocketEngine::Deinit()
+{
+	if (sqes != MAP_FAILED)
+		munmap(sqes, params.sq_entries * sizeof(io_uring_sqe));
+	if (cqring != MAP_FAILED && cqring != sqring)
+		munmap(cqring, cqringsize);
+	if (sqring != MAP_FAILED)
+		munmap(sqring, sqringsize);
+	Close(EngineHandle);
+}
+
+bool SocketEngine::AddFd(EventHandler* eh, int event_mask)
+{
+	int fd = eh->GetFd();
+	if (!eh->HasFd())
+	{
+		ServerInstance->Logs.Debug("SOCKET", "AddFd out of range: (fd: {})", fd);
+		return false;
+	}
+
+	if (!SocketEngine::AddFdRef(eh))
+	{
+		ServerInstance->Logs.Debug("SOCKET", "Attempt to add duplicate fd: {}", fd);
+		return false;
+	}
+
+	ServerInstance->Logs.Debug("SOCKET", "New file descriptor: {}", fd);
+
+	eh->SetEventMask(event_mask);
+	MarkDirty(fd);
+	return true;
+}
+
+void SocketEngine::OnSetEvent(EventHandler* eh, int old_mask, int new_mask)
+{
+	// Changes to the trial and will-block bits do not affect the kernel.
+	if (mask_to_arm(old_mask, RK_READ) != mask_to_arm(new_mask, RK_READ)
+		|| mask_to_arm(old_mask, RK_WRITE) != mask_to_arm(new_mask, RK_WRITE))
+		MarkDirty(eh->GetFd());
+}
+
+void SocketEngine::DelFd(EventHandler* eh)
+{
+	int fd = eh->GetFd();
+	if (!eh->HasFd())
+	{
+		ServerInstance->Logs.Debug("SOCKET", "DelFd out of range: (fd: {})", fd);
+		return;
+	}
+
+	// A poll or accept request holds a reference to the file so it has to be
+	// removed explicitly; closing the fd would not cancel it.
+	if (static_cast<size_t>(fd) < fdstates.size())
+	{
+		DisarmPoll(fd, RK_READ);
+		DisarmPoll(fd, RK_WRITE);
+	}
+
+	SocketEngine::DelFdRef(eh);
+
+	ServerInstance->Logs.Debug("SOCKET", "Remove file descriptor: {}", fd);
+}
+
+int SocketEngine::DispatchEvents()
+{
+	SyncPolls();
+
+	const int waittime = ServerInstance->Timers.GetWaitTime();
+	struct __kernel_timespec ts;
+	ts.tv_sec = waittime / 1000;
+	ts.tv_nsec = (waittime % 1000) * 1000000L;
+
+	struct io_uring_getevents_arg arg;
+	memset(&arg, 0, sizeof(arg));
+	arg.sigmask_sz = _NSIG / 8;
+	arg.ts = reinterpret_cast<uintptr_t>(&ts);
+
+	// Submits every queued interest change and waits for completions at once.
+	// If completions were left over from a write batch then don't wait.
+	const unsigned min_complete = deferred.empty() ? 1 : 0;
+	int ret = io_uring_enter(pending, min_complete, IORING_ENTER_GETEVENTS | IORING_ENTER_EXT_ARG, &arg, sizeof(arg));
+	if (ret >= 0)
+		pending -= std::min<unsigned>(ret, pending);
+	ServerInstance->UpdateTime();
+
+	// Copy the completions out of the ring so the kernel can reuse the space
+	// whilst handlers are running.
+	events.clear();
+	events.swap(deferred);
+	ReapCompletions(events);
+
+	int processed = 0;
+	for (const auto& cqe : events)
+	{
+		const RequestKind kind = GetKind(cqe.user_data);
+		if (kind == RK_INTERNAL || kind == RK_SEND)
+			continue;
+
+		const int fd = static_cast<int>(cqe.user_data & 0xFFFFFFFF);
+		if (kind == RK_ACCEPT)
+		{
+			if (DispatchAccept(fd, cqe))
+				processed++;
+			continue;
+		}
+
+		PollState& poll = fdstates[fd].polls[kind];
+		if (GetSeq(cqe.user_data) != (poll.seq & SEQ_MASK))
+			continue; // Stale completion from a removed request.
+
+		const ArmState armed = poll.armed;
+		if (!(cqe.flags & IORING_CQE_F_MORE))
+		{
+			// The request has finished; it will be re-armed if still wanted.
+			poll.armed = ARM_NONE;
+			MarkDirty(fd);
+		}
+
+		if (cqe.res == -EINVAL && armed == ARM_EDGE)
+		{
+			// Kernels before 5.13 do not support multishot polls.
+			ServerInstance->Logs.Debug("SOCKET", "io_uring does not support multishot polls, falling back to one-shot polls");
+			multishot = false;
+			continue;
+		}
+
+		EventHandler* const eh = GetRef(fd);
+		if (!eh)
+			continue;
+
+		processed++;
+		if (cqe.res < 0)
+		{
+			if (cqe.res == -ECANCELED)
+				continue;
+
+			stats.ErrorEvents++;
+			eh->OnEventHandlerError(-cqe.res);
+			continue;
+		}
+
+		const unsigned revents = static_cast<unsigned>(cqe.res);
+		if (revents & POLLHUP)
+		{
+			stats.ErrorEvents++;
+			eh->OnEventHandlerError(0);
+			continue;
+		}
+
+		if (revents & POLLERR)
+		{
+			stats.ErrorEvents++;
+			/* Get error number */
+			socklen_t codesize = sizeof(int);
+			int errcode;
+			if (getsockopt(fd, SOL_SOCKET, SO_ERROR, &errcode, &codesize) < 0)
+				errcode = errno;
+			eh->OnEventHandlerError(errcode);
+			continue;
+		}
+
+		int mask = eh->GetEventMask();
+		if (kind == RK_READ)
+		{
+			if (!(revents & POLLIN))
+				continue;
+
+			eh->SetEventMask(mask & ~FD_READ_WILL_BLOCK);
+			eh->OnEventHandlerRead();
+		}
+		else
+		{
+			if (!(revents & POLLOUT))
+				continue;
+
+			mask &= ~FD_WRITE_WILL_BLOCK;
+			if (mask & FD_WANT_SINGLE_WRITE)
+			{
+				int nm = mask & ~FD_WANT_SINGLE_WRITE;
+				OnSetEvent(eh, mask, nm);
+				mask = nm;
+			}
+			eh->SetEventMask(mask);
+			eh->OnEventHandlerWrite();
+		}
+	}
+
+	stats.TotalEvents += processed;
+	return processed;
+}
+
+bool SocketEngine::WriteVBatch(WriteRequest* requests, size_t count)
+{
+	if (sendmsgs.size() < count)
+		sendmsgs.resize(count);
+
+	size_t outstanding = 0;
+	for (size_t i = 0; i < count; ++i)
+	{
+		WriteRequest& request = requests[i];
+		io_uring_sqe* sqe = GetSQE();
+		if (!sqe)
+		{
+			// The submission ring is full so perform this write directly.
+			request.result = WriteV(request.eh, request.iov, request.count);
+			request.error = request.result < 0 ? errno : 0;
+			continue;
+		}
+
+		msghdr& msg = sendmsgs[i];
+		memset(&msg, 0, sizeof(msg));
+		msg.msg_iov = const_cast<iovec*>(request.iov);
+		msg.msg_iovlen = request.count;
+
+		sqe->opcode = IORING_OP_SENDMSG;
+		sqe->fd = request.eh->GetFd();
+		sqe->addr = reinterpret_cast<uintptr_t>(&msg);
+		sqe->len = 1;
+		sqe->msg_flags = MSG_DONTWAIT | MSG_NOSIGNAL;
+		sqe->user_data = MakeUserData(static_cast<int>(i), RK_SEND, 0);
+		CommitSQE();
+		outstanding++;
+	}
+
+	// The sends never block so they have all completed by the time that the
+	// io_uring_enter() which submits them returns.
+	while (outstanding)
+	{
+		int ret = io_uring_enter(pending, 1, IORING_ENTER_GETEVENTS, nullptr, 0);
+		if (ret >= 0)
+			pending -= std::min<unsigned>(ret, pending);
+		else if (errno != EINTR && errno != EAGAIN && errno != EBUSY)
+			ServerInstance->Logs.Debug("SOCKET", "io_uring_enter can't submit sends: {}", strerror(errno));
+
+		// Completions of other requests are dispatched by the next call to DispatchEvents().
+		const size_t first = deferred.size();
+		ReapCompletions(deferred);
+		auto sends = std::remove_if(deferred.begin() + first, deferred.end(), [&](const Completion& cqe)
+		{
+			if (GetKind(cqe.user_data) != RK_SEND)
+				return false;
+
+			WriteRequest& request = requests[cqe.user_data & 0xFFFFFFFF];
+			request.result = cqe.res < 0 ? -1 : cqe.res;
+			request.error = cqe.res < 0 ? -cqe.res : 0;
+			stats.UpdateWriteCounters(request.result);
+			outstanding--;
+			return true;
+		});
+		deferred.erase(sends, deferred.end());
+	}
+	return true;
+}
@@ -81,6 +81,12 @@ void SocketEngine::RecoverFromFork()
 		InitError();
 }
 
+bool SocketEngine::WriteVBatch(WriteRequest* requests, size_t count)
+{
+	// Writes can not be batched with this socket engine.
+	return false;
+}
+
 /** Shutdown the kqueue engine
  */
 void SocketEngine::Deinit()
@@ -163,9 +169,10 @@ void SocketEngine::OnSetEvent(EventHandler* eh, int old_mask, int new_mask)
 
 int SocketEngine::DispatchEvents()
 {
+	const int waittime = ServerInstance->Timers.GetWaitTime();
 	struct timespec ts;
-	ts.tv_nsec = 0;
-	ts.tv_sec = 1;
+	ts.tv_nsec = (waittime % 1000) * 1'000'000L;
+	ts.tv_sec = waittime / 1000;
 
 	int i = kevent(EngineHandle, &changelist.front(), ChangePos, &ke_list.front(), static_cast<int>(ke_list.size()), &ts);
 	ChangePos = 0;
@@ -54,6 +54,12 @@ void SocketEngine::RecoverFromFork()
 {
 }
 
+bool SocketEngine::WriteVBatch(WriteRequest* requests, size_t count)
+{
+	// Writes can not be batched with this socket engine.
+	return false;
+}
+
 static int mask_to_poll(int event_mask)
 {
 	int rv = 0;
@@ -157,7 +163,7 @@ void SocketEngine::DelFd(EventHandler* eh)
 
 int SocketEngine::DispatchEvents()
 {
-	int i = poll(&events[0], static_cast<unsigned int>(CurrentSetSize), 1000);
+	int i = poll(&events[0], static_cast<unsigned int>(CurrentSetSize), ServerInstance->Timers.GetWaitTime());
 	int processed = 0;
 	ServerInstance->UpdateTime();
 
@@ -61,6 +61,12 @@ void SocketEngine::RecoverFromFork()
 {
 }
 
+bool SocketEngine::WriteVBatch(WriteRequest* requests, size_t count)
+{
+	// Writes can not be batched with this socket engine.
+	return false;
+}
+
 bool SocketEngine::AddFd(EventHandler* eh, int event_mask)
 {
 	if (!eh->HasFd())
@@ -126,9 +132,10 @@ void SocketEngine::OnSetEvent(EventHandler* eh, int old_mask, int new_mask)
 
 int SocketEngine::DispatchEvents()
 {
+	const int waittime = ServerInstance->Timers.GetWaitTime();
 	timeval tval;
-	tval.tv_sec = 1;
-	tval.tv_usec = 0;
+	tval.tv_sec = waittime / 1000;
+	tval.tv_usec = (waittime % 1000) * 1000;
 
 	fd_set rfdset = ReadSet, wfdset = WriteSet, errfdset = ErrSet;
 
@@ -41,6 +41,40 @@ static IOHook* GetNextHook(IOHook* hook)
 	return nullptr;
 }
 
+namespace
+{
+	/** A write which has been deferred to the current write batch. */
+	struct PendingWrite final
+	{
+		/** The socket which is being written to. */
+		StreamSocket* sock;
+
+		/** The index of the first buffer of the write in pendingiovecs. */
+		size_t offset;
+
+		/** The number of buffers in the write. */
+		int count;
+
+		/** The number of bytes in the write. */
+		size_t bytes;
+	};
+
+	/** Whether writes are currently being collected into a batch. */
+	bool batchingwrites = false;
+
+	/** The sockets which have joined the current write batch. */
+	std::vector<StreamSocket*> writebatch;
+
+	/** The writes which are pending in the current write batch. */
+	std::vector<PendingWrite> pendingwrites;
+
+	/** The buffers of the writes which are pending in the current write batch. */
+	std::vector<SocketEngine::IOVector> pendingiovecs;
+
+	/** The requests which are passed to the socket engine when submitting the batch. */
+	std::vector<SocketEngine::WriteRequest> writerequests;
+}
+
 BufferedSocket::BufferedSocket()
 	: state(I_ERROR)
 {
@@ -105,6 +139,16 @@ void StreamSocket::Close()
 		return;
 
 	closing = true;
+	if (inwritebatch)
+	{
+		// The pending write has to happen before the fd is closed.
+		if (writepending)
+			SubmitWriteBatch();
+
+		std::replace(writebatch.begin(), writebatch.end(), this, static_cast<StreamSocket*>(nullptr));
+		inwritebatch = false;
+	}
+
 	if (HasFd())
 	{
 		// final chance, dump as much of the sendq as we can
@@ -215,7 +259,7 @@ ssize_t StreamSocket::ReadToRecvQ(std::string& rq)
 /* Don't try to prepare huge blobs of data to send to a blocked socket */
 static constexpr size_t MYIOV_MAX = std::min<size_t>(IOV_MAX, 128);
 
-void StreamSocket::DoWrite()
+void StreamSocket::WriteSendQ(bool batch)
 {
 	if (GetSendQSize() == 0)
 	{
@@ -258,105 +302,188 @@ void StreamSocket::DoWrite()
 	}
 
 	if (psendq)
-		FlushSendQ(*psendq);
+		FlushSendQ(*psendq, batch);
 
 	if (GetSendQSize() == 0 && closeonempty)
 		Close();
 }
 
-void StreamSocket::FlushSendQ(SendQueue& sq)
+void StreamSocket::FlushSendQ(SendQueue& sq, bool batch)
 {
-		// don't even try if we are known to be blocking
-		if (GetEventMask() & FD_WRITE_WILL_BLOCK)
-			return;
-		// start out optimistic - we won't need to write any more
-		int eventChange = FD_WANT_EDGE_WRITE;
-		while (error.empty() && !sq.empty() && eventChange == FD_WANT_EDGE_WRITE)
+	// Data which is already in the batch has to be written first.
+	if (writepending)
+		SubmitWriteBatch();
+
+	// don't even try if we are known to be blocking
+	if (GetEventMask() & FD_WRITE_WILL_BLOCK)
+		return;
+
+	if (batch && batchingwrites && !inwritebatch && &sq == &sendq && !GetIOHook())
+	{
+		// Defer the write until the batch is submitted.
+		PendingWrite pw = { this, pendingiovecs.size(), static_cast<int>(std::min<size_t>(sq.size(), MYIOV_MAX)), 0 };
+		for (SendQueue::const_iterator i = sq.begin(), end = i + pw.count; i != end; ++i)
 		{
-			// Prepare a writev() call to write all buffers efficiently.
-			int bufcount = static_cast<int>(std::min<size_t>(sq.size(), MYIOV_MAX));
+			SocketEngine::IOVector iov;
+			iov.iov_base = const_cast<char*>(i->data());
+			iov.iov_len = i->length();
+			pendingiovecs.push_back(iov);
+			pw.bytes += i->length();
+		}
+		pendingwrites.push_back(pw);
+		writebatch.push_back(this);
+		inwritebatch = writepending = true;
+		return;
+	}
 
-			int rv_max = 0;
-			ssize_t rv;
-			{
-				SocketEngine::IOVector iovecs[MYIOV_MAX];
-				size_t j = 0;
-				for (SendQueue::const_iterator i = sq.begin(), end = i+bufcount; i != end; ++i, j++)
-				{
-					const SendQueue::Element& elem = *i;
-					iovecs[j].iov_base = const_cast<char*>(elem.data());
-					iovecs[j].iov_len = elem.length();
-					rv_max += iovecs[j].iov_len;
-				}
-				rv = SocketEngine::WriteV(this, iovecs, bufcount);
-			}
+	// start out optimistic - we won't need to write any more
+	int eventChange = FD_WANT_EDGE_WRITE;
+	while (error.empty() && !sq.empty() && eventChange == FD_WANT_EDGE_WRITE)
+	{
+		// Prepare a writev() call to write all buffers efficiently.
+		int bufcount = static_cast<int>(std::min<size_t>(sq.size(), MYIOV_MAX));
 
-			if (rv == static_cast<int>(sq.bytes()))
-			{
-				// it's our lucky day, everything got written out. Fast cleanup.
-				// This won't ever happen if the number of buffers got capped.
-				sq.clear();
-			}
-			else if (rv > 0)
-			{
-				// Partial write. Clean out strings from the sendq
-				if (rv < rv_max)
-				{
-					// it's going to block now
-					eventChange = FD_WANT_FAST_WRITE | FD_WRITE_WILL_BLOCK;
-				}
-				while (rv > 0 && !sq.empty())
-				{
-					const SendQueue::Element& front = sq.front();
-					if (front.length() <= static_cast<size_t>(rv))
-					{
-						// this string got fully written out
-						rv -= front.length();
-						sq.pop_front();
-					}
-					else
-					{
-						// stopped in the middle of this string
-						sq.erase_front(rv);
-						rv = 0;
-					}
-				}
-			}
-			else if (rv == 0)
-			{
-				error = "Connection closed";
-			}
-			else if (SocketEngine::IgnoreError())
+		size_t rv_max = 0;
+		ssize_t rv;
+		{
+			SocketEngine::IOVector iovecs[MYIOV_MAX];
+			size_t j = 0;
+			for (SendQueue::const_iterator i = sq.begin(), end = i+bufcount; i != end; ++i, j++)
 			{
-				eventChange = FD_WANT_FAST_WRITE | FD_WRITE_WILL_BLOCK;
+				const SendQueue::Element& elem = *i;
+				iovecs[j].iov_base = const_cast<char*>(elem.data());
+				iovecs[j].iov_len = elem.length();
+				rv_max += iovecs[j].iov_len;
 			}
-			else if (errno == EINTR)
+			rv = SocketEngine::WriteV(this, iovecs, bufcount);
+		}
+		eventChange = OnSendQWritten(sq, rv, rv_max);
+	}
+
+	if (!error.empty())
+	{
+		// error - kill all events
+		SocketEngine::ChangeEventMask(this, FD_WANT_NO_READ | FD_WANT_NO_WRITE);
+	}
+	else
+	{
+		SocketEngine::ChangeEventMask(this, eventChange);
+	}
+}
+
+int StreamSocket::OnSendQWritten(SendQueue& sq, ssize_t rv, size_t rv_max)
+{
+	// start out optimistic - we won't need to write any more
+	int eventChange = FD_WANT_EDGE_WRITE;
+	if (rv == static_cast<ssize_t>(sq.bytes()))
+	{
+		// it's our lucky day, everything got written out. Fast cleanup.
+		// This won't ever happen if the number of buffers got capped.
+		sq.clear();
+	}
+	else if (rv > 0)
+	{
+		// Partial write. Clean out strings from the sendq
+		if (static_cast<size_t>(rv) < rv_max)
+		{
+			// it's going to block now
+			eventChange = FD_WANT_FAST_WRITE | FD_WRITE_WILL_BLOCK;
+		}
+		while (rv > 0 && !sq.empty())
+		{
+			const SendQueue::Element& front = sq.front();
+			if (front.length() <= static_cast<size_t>(rv))
 			{
-				// restart interrupted syscall
-				errno = 0;
+				// this string got fully written out
+				rv -= front.length();
+				sq.pop_front();
 			}
 			else
 			{
-				error = SocketEngine::LastError();
+				// stopped in the middle of this string
+				sq.erase_front(rv);
+				rv = 0;
 			}
 		}
-		if (!error.empty())
-		{
-			// error - kill all events
-			SocketEngine::ChangeEventMask(this, FD_WANT_NO_READ | FD_WANT_NO_WRITE);
-		}
+	}
+	else if (rv == 0)
+	{
+		error = "Connection closed";
+	}
+	else if (SocketEngine::IgnoreError())
+	{
+		eventChange = FD_WANT_FAST_WRITE | FD_WRITE_WILL_BLOCK;
+	}
+	else if (errno == EINTR)
+	{
+		// restart interrupted syscall
+		errno = 0;
+	}
+	else
+	{
+		error = SocketEngine::LastError();
+	}
+	return eventChange;
+}
+
+void StreamSocket::SubmitWriteBatch()
+{
+	writerequests.clear();
+	for (const auto& pw : pendingwrites)
+		writerequests.push_back({ pw.sock, &pendingiovecs[pw.offset], pw.count, 0, 0 });
+	SocketEngine::WriteVBatch(writerequests.data(), writerequests.size());
+
+	for (size_t i = 0; i < writerequests.size(); ++i)
+	{
+		StreamSocket* sock = pendingwrites[i].sock;
+		sock->writepending = false;
+
+		errno = writerequests[i].error;
+		const int eventChange = sock->OnSendQWritten(sock->sendq, writerequests[i].result, pendingwrites[i].bytes);
+		if (!sock->error.empty())
+			SocketEngine::ChangeEventMask(sock, FD_WANT_NO_READ | FD_WANT_NO_WRITE);
 		else
-		{
-			SocketEngine::ChangeEventMask(this, eventChange);
-		}
+			SocketEngine::ChangeEventMask(sock, eventChange);
+	}
+	pendingwrites.clear();
+	pendingiovecs.clear();
 }
 
-void StreamSocket::WriteData(const std::string& data)
+void StreamSocket::BeginWriteBatch()
+{
+	batchingwrites = SocketEngine::WriteVBatch(nullptr, 0);
+}
+
+void StreamSocket::EndWriteBatch()
+{
+	if (!batchingwrites)
+		return;
+
+	SubmitWriteBatch();
+	batchingwrites = false;
+
+	// Finish up like OnEventHandlerWrite() would have. Sockets which get closed
+	// whilst doing this are removed from the batch by Close().
+	for (size_t i = 0; i < writebatch.size(); ++i)
+	{
+		StreamSocket* sock = writebatch[i];
+		if (!sock)
+			continue;
+
+		sock->inwritebatch = false;
+		if (sock->error.empty())
+			sock->DoWrite(); // Writes anything which did not fit into the batch.
+		sock->CheckError(I_ERR_OTHER);
+	}
+	writebatch.clear();
+}
+
+void StreamSocket::WriteData(const SendQueue::Element& data)
 {
 	if (!HasFd())
 	{
 		ServerInstance->Logs.Debug("SOCKET", "Attempt to write data to dead socket: {}",
-			data);
+			data.view());
 		return;
 	}
 
@@ -472,8 +599,9 @@ void StreamSocket::OnEventHandlerWrite()
 	if (!error.empty())
 		return;
 
-	DoWrite();
-	CheckError(I_ERR_OTHER);
+	WriteSendQ(true);
+	if (!inwritebatch)
+		CheckError(I_ERR_OTHER);
 }
 
 void StreamSocket::CheckError(BufferedSocketError errcode)
@@ -508,6 +636,9 @@ IOHook* StreamSocket::GetLastHook() const
 
 void StreamSocket::AddIOHook(IOHook* newhook)
 {
+	if (writepending)
+		SubmitWriteBatch();
+
 	IOHook* curr = GetIOHook();
 	if (!curr)
 	{
@@ -527,6 +658,16 @@ void StreamSocket::AddIOHook(IOHook* newhook)
 	lasthook->SetNextHook(newhook);
 }
 
+void StreamSocket::AddIOHookFront(IOHookMiddle* newhook)
+{
+	if (writepending)
+		SubmitWriteBatch();
+
+	newhook->SetNextHook(GetIOHook());
+	newhook->GetSendQ().moveall(sendq);
+	iohook = newhook;
+}
+
 size_t StreamSocket::GetSendQSize() const
 {
 	size_t ret = sendq.bytes();
@@ -0,0 +1,163 @@
+/*
+ * InspIRCd -- Internet Relay Chat Daemon
+ *
+ * This file is part of InspIRCd.  InspIRCd is free software: you can
+ * redistribute it and/or modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation, version 2.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "inspircd.h"
+#include "threadsocket.h"
+
+class ThreadPool::Worker final
+	: public SocketThread
+{
+private:
+	/** Jobs which are waiting to be run. MUST HOLD MUTEX. */
+	std::deque<Job*> queue;
+
+	/** Jobs which have been run but not finished yet. MUST HOLD MUTEX. */
+	std::vector<Job*> done;
+
+	/** Whether this worker should exit once its queue is empty. MUST HOLD MUTEX. */
+	bool exiting = false;
+
+protected:
+	void OnStart() override
+	{
+		LockQueue();
+		while (!queue.empty() || !exiting)
+		{
+			if (queue.empty())
+			{
+				WaitForQueue();
+				continue;
+			}
+
+			Job* job = queue.front();
+			queue.pop_front();
+			UnlockQueue();
+
+			job->Run();
+
+			LockQueue();
+			done.push_back(job);
+			NotifyParent();
+
+			// Wake up the main thread if it is waiting in Wait().
+			UnlockQueueWakeup();
+			LockQueue();
+		}
+		UnlockQueue();
+	}
+
+	void OnStop() override
+	{
+		// We can't rely on IsStopping() here as it is only set after this returns.
+		LockQueue();
+		exiting = true;
+		UnlockQueueWakeup();
+	}
+
+public:
+	/** The number of jobs which have been submitted to this worker but not finished yet. This is
+	 * only accessed from the main thread.
+	 */
+	size_t pending = 0;
+
+	void OnNotify() override
+	{
+		std::vector<Job*> finished;
+		LockQueue();
+		std::swap(finished, done);
+		UnlockQueue();
+
+		for (auto* job : finished)
+		{
+			pending--;
+			job->Finish();
+			delete job;
+		}
+	}
+
+	void Submit(Job* job)
+	{
+		pending++;
+		LockQueue();
+		queue.push_back(job);
+		UnlockQueueWakeup();
+	}
+
+	void Wait()
+	{
+		LockQueue();
+		while (done.size() < pending)
+			WaitForQueue();
+		UnlockQueue();
+	}
+};
+
+ThreadPool::~ThreadPool()
+{
+	Stop();
+}
+
+void ThreadPool::Flush()
+{
+	// Finishing a job may submit another one so we need to keep going until all workers are idle.
+	for (bool busy = true; busy; )
+	{
+		busy = false;
+		for (auto* worker : workers)
+		{
+			if (!worker->pending)
+				continue;
+
+			busy = true;
+			worker->Wait();
+			worker->OnNotify();
+		}
+	}
+}
+
+void ThreadPool::Stop()
+{
+	Flush();
+	for (auto* worker : workers)
+	{
+		worker->Stop();
+		delete worker;
+	}
+	workers.clear();
+}
+
+void ThreadPool::Submit(Job* job)
+{
+	Worker* target = nullptr;
+	for (auto* worker : workers)
+	{
+		if (!target || worker->pending < target->pending)
+			target = worker;
+	}
+
+	// Workers are only started when they are needed so servers which never submit jobs don't have
+	// idle threads. If the worker count is reduced on rehash the existing workers are kept.
+	if (!target || (target->pending && workers.size() < ServerInstance->Config->WorkerThreads))
+	{
+		auto worker = std::make_unique<Worker>();
+		worker->Start();
+		target = worker.release();
+		workers.push_back(target);
+	}
+
+	target->Submit(job);
+}
@@ -27,69 +27,182 @@
 
 #include "inspircd.h"
 
-void Timer::SetInterval(unsigned long newinterval, bool restart)
+void Timer::SetInterval(std::chrono::milliseconds newinterval, bool restart)
 {
-	secs = newinterval;
+	interval = newinterval;
 	if (!restart)
 		return;
 
 	ServerInstance->Timers.DelTimer(this);
-	SetTrigger(ServerInstance->Time() + newinterval);
 	ServerInstance->Timers.AddTimer(this);
 }
 
 Timer::Timer(unsigned long secs_from_now, bool repeating)
-	: secs(secs_from_now)
+	: interval(std::chrono::seconds(secs_from_now))
+	, repeat(repeating)
+{
+}
+
+Timer::Timer(std::chrono::milliseconds time_from_now, bool repeating)
+	: interval(time_from_now)
 	, repeat(repeating)
 {
 }
 
 Timer::~Timer()
 {
-	if (GetTrigger())
+	if (trigger)
 		ServerInstance->Timers.DelTimer(this);
 }
 
+void TimerManager::Insert(Timer* t)
+{
+	// Timers which are already due are ticked on the next millisecond that is checked.
+	const uint64_t trigger = std::max(t->trigger, base);
+
+	// Find the lowest level which can represent the trigger time. Timers which are too far in the
+	// future for the wheel are put in the last slot of the last level and moved down the wheel
+	// when they get closer.
+	static constexpr uint64_t max_delta = (uint64_t(1) << (WHEEL_BITS * WHEEL_LEVELS)) - 1;
+	const uint64_t slottime = base + std::min(trigger - base, max_delta);
+
+	size_t level = 0;
+	while (level < WHEEL_LEVELS - 1 && (slottime - base) >> (WHEEL_BITS * (level + 1)))
+		level++;
+
+	t->wheellevel = static_cast<uint8_t>(level);
+	t->wheelslot = static_cast<uint8_t>((slottime >> (WHEEL_BITS * level)) & (WHEEL_SIZE - 1));
+	wheel[level][t->wheelslot].push_back(t);
+	levelsize[level]++;
+}
+
+size_t TimerManager::Cascade(size_t level)
+{
+	const size_t slot = (base >> (WHEEL_BITS * level)) & (WHEEL_SIZE - 1);
+
+	// The timers in this slot are all due within the range of the lower levels now.
+	TimerList timers;
+	std::swap(timers, wheel[level][slot]);
+	levelsize[level] -= timers.size();
+
+	while (!timers.empty())
+	{
+		Timer* t = timers.front();
+		timers.pop_front();
+		Insert(t);
+	}
+	return slot;
+}
+
 void TimerManager::TickTimers()
 {
-	const time_t now = ServerInstance->Time();
-	for (TimerMap::iterator i = Timers.begin(); i != Timers.end(); )
+	const uint64_t now = ServerInstance->Time_ms();
+	if (!base)
+		base = now; // First tick.
+
+	while (base <= now)
 	{
-		Timer* t = i->second;
-		if (t->GetTrigger() > now)
-			break;
+		// If the lowest level has wrapped around then move the timers for the next part of the
+		// wheel down.
+		for (size_t level = 1; level < WHEEL_LEVELS; ++level)
+		{
+			if (base & ((uint64_t(1) << (WHEEL_BITS * level)) - 1))
+				break;
+
+			if (Cascade(level))
+				break;
+		}
 
-		Timers.erase(i++);
+		// If nothing is in the lower levels then skip ahead to the next time that timers could be
+		// moved down the wheel.
+		size_t emptylevels = 0;
+		while (emptylevels < WHEEL_LEVELS && !levelsize[emptylevels])
+			emptylevels++;
 
-		if (!t->Tick())
+		if (emptylevels)
+		{
+			const uint64_t skipmask = emptylevels < WHEEL_LEVELS ? (uint64_t(1) << (WHEEL_BITS * emptylevels)) - 1 : UINT64_MAX >> 1;
+			base = std::min((base | skipmask) + 1, now + 1);
 			continue;
+		}
+
+		std::swap(due, wheel[0][base & (WHEEL_SIZE - 1)]);
+		levelsize[0] -= due.size();
+		base++;
 
-		if (t->GetRepeat())
+		for (Timer* t : due)
+			t->wheellevel = DUE_LEVEL;
+
+		while (!due.empty())
 		{
-			t->SetTrigger(now + t->GetInterval());
-			AddTimer(t);
+			Timer* t = due.front();
+			due.pop_front();
+			t->trigger = 0;
+
+			if (!t->Tick())
+				continue;
+
+			if (t->GetRepeat())
+				AddTimer(t);
 		}
 	}
 }
 
 void TimerManager::DelTimer(Timer* t)
 {
-	std::pair<TimerMap::iterator, TimerMap::iterator> itpair = Timers.equal_range(t->GetTrigger());
+	if (!t->trigger)
+		return; // Not active.
 
-	for (TimerMap::iterator i = itpair.first; i != itpair.second; ++i)
+	if (t->wheellevel == DUE_LEVEL)
 	{
-		if (i->second == t)
-		{
-			t->SetTrigger(0);
-			Timers.erase(i);
-			break;
-		}
+		due.erase(t);
+	}
+	else
+	{
+		wheel[t->wheellevel][t->wheelslot].erase(t);
+		levelsize[t->wheellevel]--;
 	}
+	t->trigger = 0;
 }
 
 void TimerManager::AddTimer(Timer* t)
 {
-	time_t trigger = ServerInstance->Time() + t->GetInterval();
-	t->SetTrigger(trigger);
-	Timers.emplace(trigger, t);
+	DelTimer(t);
+
+	const uint64_t now = ServerInstance->Time_ms();
+	if (!base)
+		base = now; // First timer.
+
+	// Timers always have a non-zero trigger so that they can be told apart from inactive timers.
+	t->trigger = std::max<uint64_t>(now + t->GetPreciseInterval().count(), 1);
+	Insert(t);
+}
+
+int TimerManager::GetWaitTime() const
+{
+	const uint64_t now = ServerInstance->Time_ms();
+	uint64_t next = now + 1000;
+	if (base)
+	{
+		for (size_t level = 0; level < WHEEL_LEVELS; ++level)
+		{
+			if (!levelsize[level])
+				continue;
+
+			// Find the earliest slot in this level which has timers in. The timers in the lowest
+			// level are due at the time of their slot and the timers in the other levels are due
+			// no earlier than the time that their slot gets moved down the wheel.
+			const unsigned int shift = WHEEL_BITS * level;
+			const uint64_t current = base >> shift;
+			for (size_t offset = level ? 1 : 0; offset <= WHEEL_SIZE; ++offset)
+			{
+				if (!wheel[level][(current + offset) & (WHEEL_SIZE - 1)].empty())
+				{
+					next = std::min(next, (current + offset) << shift);
+					break;
+				}
+			}
+		}
+	}
+	return next > now ? static_cast<int>(next - now) : 0;
 }
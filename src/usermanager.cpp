@@ -32,30 +32,135 @@
 
 namespace
 {
-	class WriteCommonQuit final
-		: public User::ForEachNeighborHandler
+	class QuitMessages final
 	{
+	private:
+		// The QUIT messages reference their reasons so these must outlive them.
+		const std::string reason;
+		const std::string operreason;
 		ClientProtocol::Messages::Quit quitmsg;
 		ClientProtocol::Event quitevent;
 		ClientProtocol::Messages::Quit operquitmsg;
 		ClientProtocol::Event operquitevent;
 
+	public:
+		User* const user;
+
+		QuitMessages(User* u, const std::string& msg, const std::string& opermsg, const UserManager::QuitMessageHandler* handler)
+			: reason(msg)
+			, operreason(opermsg)
+			, quitmsg(u, reason)
+			, quitevent(ServerInstance->GetRFCEvents().quit, quitmsg)
+			, operquitmsg(u, operreason)
+			, operquitevent(ServerInstance->GetRFCEvents().quit, operquitmsg)
+			, user(u)
+		{
+			if (handler)
+			{
+				(*handler)(quitmsg);
+				(*handler)(operquitmsg);
+			}
+		}
+
+		void Send(LocalUser* neighbor)
+		{
+			neighbor->Send(neighbor->IsOper() ? operquitevent : quitevent);
+		}
+	};
+
+	class WriteCommonQuit final
+		: public User::ForEachNeighborHandler
+	{
+		QuitMessages messages;
+
 		void Execute(LocalUser* user) override
 		{
-			user->Send(user->IsOper() ? operquitevent : quitevent);
+			messages.Send(user);
 		}
 
 	public:
 		WriteCommonQuit(User* user, const std::string& msg, const std::string& opermsg)
-			: quitmsg(user, msg)
-			, quitevent(ServerInstance->GetRFCEvents().quit, quitmsg)
-			, operquitmsg(user, opermsg)
-			, operquitevent(ServerInstance->GetRFCEvents().quit, operquitmsg)
+			: messages(user, msg, opermsg, nullptr)
 		{
 			user->ForEachNeighbor(*this, false);
 		}
 	};
 
+	void WriteCommonQuits(const std::vector<std::unique_ptr<QuitMessages>>& quits)
+	{
+		// This is User::ForEachNeighbor for many users at once. A single already sent id is used for
+		// all of the quitting users so each neighbor is only gathered once and then receives all of
+		// its QUIT messages together. The neighbors of each quitting user are visited contiguously so
+		// a neighbor that shares more than one channel with a quitting user only needs to be checked
+		// against the last message it was given.
+		const uint64_t newid = ServerInstance->Users.NextAlreadySentId();
+		std::vector<std::pair<LocalUser*, std::vector<QuitMessages*>>> neighbors;
+		std::unordered_map<LocalUser*, size_t> neighborpos;
+		auto addneighbor = [&](LocalUser* neighbor, QuitMessages* quit)
+		{
+			size_t pos;
+			if (neighbor->already_sent != newid)
+			{
+				neighbor->already_sent = newid;
+				pos = neighbors.size();
+				neighborpos.emplace(neighbor, pos);
+				neighbors.emplace_back(neighbor, std::vector<QuitMessages*>());
+			}
+			else
+				pos = neighborpos[neighbor];
+
+			std::vector<QuitMessages*>& messages = neighbors[pos].second;
+			if (messages.empty() || messages.back() != quit)
+				messages.push_back(quit);
+		};
+
+		std::vector<LocalUser*> excluded;
+		for (const auto& quit : quits)
+		{
+			User* const user = quit->user;
+			User::NeighborList include_chans(user->chans.begin(), user->chans.end());
+			User::NeighborExceptions exceptions;
+			exceptions[user] = false;
+			FOREACH_MOD(OnBuildNeighborList, (user, include_chans, exceptions));
+
+			// Users that are quitting (including the other users in this batch) never receive a
+			// QUIT message.
+			excluded.clear();
+			for (const auto& [exception, include] : exceptions)
+			{
+				LocalUser* curr = IS_LOCAL(exception);
+				if (!curr || curr->quitting)
+					continue;
+
+				if (include)
+					addneighbor(curr, quit.get());
+				else
+					excluded.push_back(curr);
+			}
+
+			for (const auto* memb : include_chans)
+			{
+				for (const auto& lm : memb->chan->GetLocalUsers())
+				{
+					LocalUser* curr = lm.GetUser();
+					if (curr->quitting)
+						continue;
+
+					if (!excluded.empty() && std::find(excluded.begin(), excluded.end(), curr) != excluded.end())
+						continue;
+
+					addneighbor(curr, quit.get());
+				}
+			}
+		}
+
+		for (const auto& [neighbor, messages] : neighbors)
+		{
+			for (auto* quit : messages)
+				quit->Send(neighbor);
+		}
+	}
+
 	void CheckPingTimeout(LocalUser* user)
 	{
 		// Check if it is time to ping the user yet.
@@ -119,6 +224,52 @@ namespace
 	}
 }
 
+bool UserTimeoutTimer::Tick()
+{
+	if (user->quitting)
+		return false;
+
+	switch (user->connected)
+	{
+		case User::CONN_FULL:
+			CheckPingTimeout(user);
+			break;
+
+		case User::CONN_NICKUSER:
+			CheckModulesReady(user);
+			break;
+
+		default:
+			CheckConnectionTimeout(user);
+			break;
+	}
+
+	if (user->quitting)
+		return false;
+
+	// Connecting users are checked every second but connected users only need to be checked when
+	// they are next due to be pinged. This might have been pushed back by them sending commands.
+	if (user->IsFullyConnected())
+		SetInterval(static_cast<unsigned long>(std::max<time_t>(user->nextping - ServerInstance->Time(), 1)), false);
+	return true;
+}
+
+bool UserPenaltyTimer::Tick()
+{
+	if (user->quitting)
+		return false;
+
+	unsigned long rate = user->GetClass()->commandrate;
+	if (user->CommandFloodPenalty > rate)
+		user->CommandFloodPenalty -= rate;
+	else
+		user->CommandFloodPenalty = 0;
+
+	// This will reschedule the timer if the user still has a penalty.
+	user->eh.OnDataReady();
+	return !user->quitting;
+}
+
 UserManager::UserManager()
 {
 	// We need to define a constructor here to work around a Clang bug.
@@ -142,6 +293,7 @@ void UserManager::AddUser(int socket, ListenSocket* via, const irc::sockets::soc
 	this->clientlist[New->nick] = New;
 	this->AddClone(New);
 	this->local_users.push_front(New);
+	ServerInstance->Timers.AddTimer(&New->timeouttimer);
 	FOREACH_MOD(OnUserInit, (New));
 
 	if (!SocketEngine::AddFd(eh, FD_WANT_FAST_READ | FD_WANT_EDGE_WRITE))
@@ -239,21 +391,92 @@ void UserManager::AddUser(int socket, ListenSocket* via, const irc::sockets::soc
 }
 
 void UserManager::QuitUser(User* user, const std::string& quitmessage, const std::string* operquitmessage)
+{
+	std::string quitmsg;
+	std::string operquitmsg;
+	if (!BeginQuit(user, quitmessage, operquitmessage, quitmsg, operquitmsg))
+		return;
+
+	if (user->IsFullyConnected())
+	{
+		FOREACH_MOD(OnUserQuit, (user, quitmsg, operquitmsg));
+		WriteCommonQuit(user, quitmsg, operquitmsg);
+	}
+	else
+		unknown_count--;
+
+	FinishQuit(user, operquitmsg);
+	user->PurgeEmptyChannels();
+	user->OperLogout();
+}
+
+void UserManager::QuitUsers(const std::vector<User*>& users, const std::string& quitmessage, const std::string* operquitmessage, const QuitMessageHandler& handler)
+{
+	std::vector<std::pair<User*, std::string>> quitting;
+	std::vector<std::unique_ptr<QuitMessages>> quits;
+	for (auto* user : users)
+	{
+		if (user->quitting)
+			continue;
+
+		std::string quitmsg;
+		std::string operquitmsg;
+		if (!BeginQuit(user, quitmessage, operquitmessage, quitmsg, operquitmsg))
+			continue;
+
+		if (user->IsFullyConnected())
+		{
+			FOREACH_MOD(OnUserQuit, (user, quitmsg, operquitmsg));
+			quits.push_back(std::make_unique<QuitMessages>(user, quitmsg, operquitmsg, handler ? &handler : nullptr));
+		}
+		else
+			unknown_count--;
+
+		quitting.emplace_back(user, std::move(operquitmsg));
+	}
+
+	// All of the users are still on their channels at this point so their neighbors can be visited
+	// together before any of them are removed.
+	WriteCommonQuits(quits);
+
+	// Group the memberships of the quitting users by channel so each channel is only checked for
+	// destruction once rather than once for each quitting user that was on it.
+	std::vector<std::pair<Channel*, std::vector<User*>>> chanusers;
+	std::unordered_map<Channel*, size_t> chanpos;
+	for (const auto& [user, operquitmsg] : quitting)
+	{
+		FinishQuit(user, operquitmsg);
+		for (const auto* memb : user->chans)
+		{
+			auto [it, inserted] = chanpos.emplace(memb->chan, chanusers.size());
+			if (inserted)
+				chanusers.emplace_back(memb->chan, std::vector<User*>());
+			chanusers[it->second].second.push_back(user);
+		}
+	}
+
+	for (const auto& [chan, chanmembers] : chanusers)
+		chan->DelUsers(chanmembers);
+
+	for (const auto& [user, operquitmsg] : quitting)
+		user->OperLogout();
+}
+
+bool UserManager::BeginQuit(User* user, const std::string& quitmessage, const std::string* operquitmessage, std::string& quitmsg, std::string& operquitmsg)
 {
 	if (user->quitting)
 	{
 		ServerInstance->Logs.Debug("USERS", "BUG: Tried to quit quitting user: {}", user->nick);
-		return;
+		return false;
 	}
 
 	if (IS_SERVER(user))
 	{
 		ServerInstance->Logs.Debug("USERS", "BUG: Tried to quit server user: {}", user->nick);
-		return;
+		return false;
 	}
 
-	std::string quitmsg(quitmessage);
-	std::string operquitmsg;
+	quitmsg.assign(quitmessage);
 	if (operquitmessage)
 		operquitmsg.assign(*operquitmessage);
 
@@ -263,7 +486,7 @@ void UserManager::QuitUser(User* user, const std::string& quitmessage, const std
 		ModResult modres;
 		FIRST_MOD_RESULT(OnUserPreQuit, modres, (localuser, quitmsg, operquitmsg));
 		if (modres == MOD_RES_DENY)
-			return;
+			return false;
 	}
 
 	if (quitmsg.length() > ServerInstance->Config->Limits.MaxQuit)
@@ -283,15 +506,11 @@ void UserManager::QuitUser(User* user, const std::string& quitmessage, const std
 	}
 
 	ServerInstance->GlobalCulls.AddItem(user);
+	return true;
+}
 
-	if (user->IsFullyConnected())
-	{
-		FOREACH_MOD(OnUserQuit, (user, quitmsg, operquitmsg));
-		WriteCommonQuit(user, quitmsg, operquitmsg);
-	}
-	else
-		unknown_count--;
-
+void UserManager::FinishQuit(User* user, const std::string& operquitmsg)
+{
 	if (IS_LOCAL(user))
 	{
 		LocalUser* lu = IS_LOCAL(user);
@@ -312,13 +531,11 @@ void UserManager::QuitUser(User* user, const std::string& quitmessage, const std
 		ServerInstance->Logs.Debug("USERS", "BUG: Nick not found in clientlist, cannot remove: {}", user->nick);
 
 	uuidlist.erase(user->uuid);
-	user->PurgeEmptyChannels();
-	user->OperLogout();
 }
 
 void UserManager::AddClone(User* user)
 {
-	CloneCounts& counts = clonemap[user->GetCIDRMask()];
+	CloneCounts& counts = clonemap[user->client_sa];
 	counts.global++;
 	if (IS_LOCAL(user))
 		counts.local++;
@@ -326,29 +543,35 @@ void UserManager::AddClone(User* user)
 
 void UserManager::RemoveCloneCounts(User* user)
 {
-	CloneMap::iterator it = clonemap.find(user->GetCIDRMask());
-	if (it != clonemap.end())
+	CloneCounts* counts = clonemap.find(user->client_sa);
+	if (counts)
 	{
-		CloneCounts& counts = it->second;
-		counts.global--;
-		if (counts.global == 0)
+		counts->global--;
+		if (counts->global == 0)
 		{
 			// No more users from this IP, remove entry from the map
-			clonemap.erase(it);
+			clonemap.erase(user->client_sa);
 			return;
 		}
 
 		if (IS_LOCAL(user))
-			counts.local--;
+			counts->local--;
 	}
 }
 
 void UserManager::RehashCloneCounts()
 {
-	clonemap.clear();
+	// Ranges which got wider are merged in place so we only need to count users
+	// again if the range for their address family got narrower.
+	const auto stale = clonemap.set_ranges(ServerInstance->Config->IPv4Range, ServerInstance->Config->IPv6Range);
+	if (stale.empty())
+		return;
 
 	for (const auto& [_, u] : ServerInstance->Users.GetUsers())
-		AddClone(u);
+	{
+		if (stdalgo::isin(stale, u->client_sa.family()))
+			AddClone(u);
+	}
 }
 
 void UserManager::RehashServices()
@@ -364,11 +587,8 @@ void UserManager::RehashServices()
 
 const UserManager::CloneCounts& UserManager::GetCloneCounts(User* user) const
 {
-	CloneMap::const_iterator it = clonemap.find(user->GetCIDRMask());
-	if (it != clonemap.end())
-		return it->second;
-	else
-		return zeroclonecounts;
+	const CloneCounts* counts = clonemap.find(user->client_sa);
+	return counts ? *counts : zeroclonecounts;
 }
 
 /**
@@ -376,41 +596,6 @@ const UserManager::CloneCounts& UserManager::GetCloneCounts(User* user) const
  * It is intended to do background checking on all the users, e.g. do
  * ping checks, connection timeouts, etc.
  */
-void UserManager::DoBackgroundUserStuff()
-{
-	for (LocalList::iterator i = local_users.begin(); i != local_users.end(); )
-	{
-		// It's possible that we quit the user below due to ping timeout etc. and QuitUser() removes it from the list
-		LocalUser* curr = *i;
-		++i;
-
-		if (curr->CommandFloodPenalty || curr->eh.GetSendQSize())
-		{
-			unsigned long rate = curr->GetClass()->commandrate;
-			if (curr->CommandFloodPenalty > rate)
-				curr->CommandFloodPenalty -= rate;
-			else
-				curr->CommandFloodPenalty = 0;
-			curr->eh.OnDataReady();
-		}
-
-		switch (curr->connected)
-		{
-			case User::CONN_FULL:
-				CheckPingTimeout(curr);
-				break;
-
-			case User::CONN_NICKUSER:
-				CheckModulesReady(curr);
-				break;
-
-			default:
-				CheckConnectionTimeout(curr);
-				break;
-		}
-	}
-}
-
 uint64_t UserManager::NextAlreadySentId()
 {
 	if (++already_sent_id == 0)
@@ -169,6 +169,8 @@ const std::string& User::GetRealMask()
 LocalUser::LocalUser(int myfd, const irc::sockets::sockaddrs& clientsa, const irc::sockets::sockaddrs& serversa)
 	: User(ServerInstance->UIDGen.GetUID(), ServerInstance->FakeClient->server, User::TYPE_LOCAL)
 	, eh(this)
+	, timeouttimer(this)
+	, penaltytimer(this)
 	, server_sa(serversa)
 	, quitting_sendq(false)
 	, lastping(true)
@@ -226,64 +228,69 @@ void UserIOHandler::OnDataReady()
 	if (!user->HasPrivPermission("users/flood/no-fakelag"))
 		penaltymax = user->GetClass()->penaltythreshold * 1000;
 
-	// The cleaned message sent by the user or empty if not found yet.
-	std::string line;
-
-	// The position of the most \n character or npos if not found yet.
-	std::string::size_type eolpos;
+	// The position within the recvq of the start of the current line.
+	std::string::size_type linestart = 0;
 
-	// The position within the recvq of the current character.
-	std::string::size_type qpos;
+	// A copy of the current line if it had to be cleaned up out of place.
+	std::string line;
 
-	while (user->CommandFloodPenalty < penaltymax && GetSendQSize() < sendqmax)
+	while (user->CommandFloodPenalty < penaltymax && GetSendQSize() < sendqmax && !user->suspended)
 	{
 		// Check the newly received data for an EOL.
-		eolpos = recvq.find('\n', checked_until);
+		const std::string::size_type eolpos = recvq.find('\n', std::max(linestart, checked_until));
 		if (eolpos == std::string::npos)
 		{
 			checked_until = recvq.length();
-			return;
+			break;
 		}
 
-		// We've found a line! Clean it up and move it to the line buffer.
-		line.reserve(eolpos);
-		for (qpos = 0; qpos < eolpos; ++qpos)
-		{
-			char c = recvq[qpos];
-			switch (c)
-			{
-				case '\0':
-					c = ' ';
-					break;
-				case '\r':
-					continue;
-			}
+		// We've found a line! Clean it up in place so it can be parsed without copying it.
+		const std::string::size_type linelength = eolpos - linestart;
+		char* linedata = recvq.data() + linestart;
+		std::replace(linedata, linedata + linelength, '\0', ' ');
+
+		std::string_view lineview(linedata, linelength);
+		if (!lineview.empty() && lineview.back() == '\r')
+			lineview.remove_suffix(1);
 
-			line.push_back(c);
+		if (lineview.find('\r') != std::string_view::npos)
+		{
+			// Removing a CR from the middle of the line requires a copy but this is very rare.
+			line.assign(lineview);
+			line.erase(std::remove(line.begin(), line.end(), '\r'), line.end());
+			lineview = line;
 		}
 
-		// just found a newline. Terminate the string, and pull it out of recvq
-		recvq.erase(0, eolpos + 1);
-		checked_until = 0;
+		// The line is only removed from the recvq once we have finished processing.
+		linestart = eolpos + 1;
 
 		// TODO should this be moved to when it was inserted in recvq?
-		ServerInstance->Stats.Recv += qpos;
-		user->bytes_in += qpos;
+		ServerInstance->Stats.Recv += linelength;
+		user->bytes_in += linelength;
 		user->cmds_in++;
 
-		ServerInstance->Parser.ProcessBuffer(user, line);
+		ServerInstance->Parser.ProcessBuffer(user, lineview);
 		if (user->quitting)
 			return;
-
-		// clear() does not reclaim memory associated with the string, so our .reserve() call is safe
-		line.clear();
 	}
 
+	// Remove all of the processed lines at once rather than shifting the recvq for every line.
+	recvq.erase(0, linestart);
+	checked_until = checked_until > linestart ? checked_until - linestart : 0;
+
 	if (user->CommandFloodPenalty >= penaltymax && !user->GetClass()->fakelag)
+	{
 		ServerInstance->Users.QuitUser(user, "Excess Flood");
+		return;
+	}
+
+	// If the user has a penalty or we stopped processing their commands because their sendq is
+	// full then we need to check them again later.
+	if ((user->CommandFloodPenalty || GetSendQSize() >= sendqmax) && !user->penaltytimer.GetTrigger())
+		ServerInstance->Timers.AddTimer(&user->penaltytimer);
 }
 
-void UserIOHandler::AddWriteBuf(const std::string& data)
+void UserIOHandler::AddWriteBuf(const SendQueue::Element& data)
 {
 	if (user->quitting_sendq)
 		return;
@@ -498,6 +505,9 @@ void User::InvalidateCache()
 	cached_realuserhost.clear();
 	cached_mask.clear();
 	cached_realmask.clear();
+
+	// The user may now match different bans.
+	banserial = ServerInstance->Channels.NextBanSerial();
 }
 
 bool User::ChangeNick(const std::string& newnick, time_t newts)
@@ -699,6 +709,8 @@ void LocalUser::ChangeConnectClass(const std::shared_ptr<ConnectClass>& klass, b
 
 	// Update the core user data that depends on connect class.
 	nextping = ServerInstance->Time() + klass->pingtime;
+	if (IsFullyConnected() && timeouttimer.GetTrigger() > nextping)
+		timeouttimer.SetInterval(klass->pingtime);
 	uniqueusername = klass->uniqueusername;
 
 	// Let modules know the class has been changed.
@@ -712,11 +724,8 @@ void LocalUser::Write(const ClientProtocol::SerializedMessage& text)
 
 	if (ServerInstance->Config->RawLog)
 	{
-		std::string::size_type nlpos = text.find_first_of("\r\n", 0, 2);
-		if (nlpos == std::string::npos)
-			nlpos = text.length();
-
-		ServerInstance->Logs.RawIO("USEROUTPUT", "C[{}] O {}", uuid, std::string_view(text.c_str(), nlpos));
+		const std::string_view textview = text;
+		ServerInstance->Logs.RawIO("USEROUTPUT", "C[{}] O {}", uuid, textview.substr(0, textview.find_first_of("\r\n")));
 	}
 
 	eh.AddWriteBuf(text);
@@ -817,6 +826,32 @@ void LocalUser::WriteRemoteNotice(const std::string& text)
 	WriteNotice(text);
 }
 
+namespace
+{
+	struct ResumeAction final
+		: public ActionBase
+	{
+		const std::string uuid;
+		ResumeAction(const std::string& uid)
+			: uuid(uid)
+		{
+		}
+		void Call() override
+		{
+			auto* user = ServerInstance->Users.FindUUID<LocalUser>(uuid);
+			if (user && !user->suspended)
+				user->eh.OnDataReady();
+			ServerInstance->GlobalCulls.AddItem(this);
+		}
+	};
+}
+
+void LocalUser::Resume()
+{
+	if (suspended && !--suspended)
+		ServerInstance->AtomicActions.AddAction(new ResumeAction(uuid));
+}
+
 namespace
 {
 	class WriteCommonRawHandler final
@@ -880,11 +915,11 @@ uint64_t User::ForEachNeighbor(ForEachNeighborHandler& handler, bool include_sel
 	// Now consider the real neighbors
 	for (const auto* memb : include_chans)
 	{
-		for (const auto& [user, _] : memb->chan->GetUsers())
+		for (const auto& lm : memb->chan->GetLocalUsers())
 		{
-			LocalUser* curr = IS_LOCAL(user);
+			LocalUser* curr = lm.GetUser();
 			// User not yet visited?
-			if ((curr) && (curr->already_sent != newid))
+			if (curr->already_sent != newid)
 			{
 				// Mark as visited and execute function
 				curr->already_sent = newid;
@@ -1368,3 +1403,13 @@ bool OperAccount::CheckPassword(const std::string& pw) const
 
 	return !password.empty() && InspIRCd::CheckPassword(password, passwordhash, pw);
 }
+
+void OperAccount::CheckPassword(const std::string& pw, const PasswordCallback& callback) const
+{
+	if (nopassword)
+		callback(true); // <oper nopassword="yes">
+	else if (password.empty())
+		callback(false);
+	else
+		InspIRCd::CheckPassword(password, passwordhash, pw, callback);
+}
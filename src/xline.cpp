@@ -31,6 +31,8 @@
 #include "timeutils.h"
 #include "xline.h"
 
+#include <unordered_set>
+
 /** An XLineFactory specialized to generate GLine* pointers
  */
 class GLineFactory final
@@ -181,6 +183,9 @@ void XLineManager::CheckELines()
 	if (ELines.empty())
 		return;
 
+	// Users may now be exempt from different lines.
+	serial++;
+
 	for (auto* u :  ServerInstance->Users.GetLocalUsers())
 	{
 		u->exempt = false;
@@ -325,6 +330,8 @@ bool XLineManager::AddLine(XLine* line, User* user)
 		pending_lines.push_back(line);
 
 	lookup_lines[line->type][line->Displayable()] = line;
+	IndexLine(line);
+	serial++;
 	line->OnAdd();
 
 	FOREACH_MOD(OnAddLine, (user, line));
@@ -359,8 +366,10 @@ bool XLineManager::DelLine(const std::string& hostmask, const std::string& type,
 
 	stdalgo::erase(pending_lines, y->second);
 
+	UnindexLine(y->second);
 	delete y->second;
 	x->second.erase(y);
+	serial++;
 
 	return true;
 }
@@ -370,75 +379,185 @@ void ELine::Unset()
 	ServerInstance->XLines->CheckELines();
 }
 
-// returns a pointer to the reason if a nickname matches a Q-line, NULL if it didn't match
-
-XLine* XLineManager::MatchesLine(const std::string& type, User* user)
+void XLineManager::IndexLine(XLine* line)
 {
-	ContainerIter x = lookup_lines.find(type);
+	LineIndex& index = line_index[line->type];
 
-	if (x == lookup_lines.end())
-		return nullptr;
+	irc::sockets::cidr_mask range;
+	if (!line->GetAddressRange(range))
+		index.other[line->Displayable()] = line;
+	else if (range.type == AF_INET)
+		index.ipv4.insert(range.bits, range.length, line);
+	else
+		index.ipv6.insert(range.bits, range.length, line);
+}
 
-	const time_t current = ServerInstance->Time();
+void XLineManager::UnindexLine(XLine* line)
+{
+	auto iter = line_index.find(line->type);
+	if (iter == line_index.end())
+		return;
 
-	LookupIter safei;
+	LineIndex& index = iter->second;
+	irc::sockets::cidr_mask range;
+	if (!line->GetAddressRange(range))
+		index.other.erase(line->Displayable());
+	else if (range.type == AF_INET)
+		index.ipv4.erase(range.bits, range.length, line);
+	else
+		index.ipv6.erase(range.bits, range.length, line);
+}
 
-	for (LookupIter i = x->second.begin(); i != x->second.end(); )
+void XLineManager::FindAddressLines(const LineIndex& index, const irc::sockets::sockaddrs& sa, std::vector<XLine*>& lines)
+{
+	const auto collect = [&lines](XLine* line) {
+		lines.push_back(line);
+		return false;
+	};
+
+	switch (sa.family())
 	{
-		safei = i;
-		safei++;
+		case AF_INET:
+			index.ipv4.find(reinterpret_cast<const unsigned char*>(&sa.in4.sin_addr), 32, collect);
+			break;
 
-		if (i->second->duration && current > i->second->expiry)
+		case AF_INET6:
+			index.ipv6.find(reinterpret_cast<const unsigned char*>(&sa.in6.sin6_addr), 128, collect);
+			break;
+	}
+}
+
+template <typename Matcher>
+XLine* XLineManager::MatchesIndex(ContainerIter container, LineIndex& index, const std::vector<XLine*>& candidates, Matcher&& matches)
+{
+	const time_t current = ServerInstance->Time();
+
+	// Check the lines which are in an address range that the user is in first.
+	for (auto* candidate : candidates)
+	{
+		if (candidate->duration && current > candidate->expiry)
 		{
 			/* Expire the line, proceed to next one */
-			ExpireLine(x, i);
-			i = safei;
+			ExpireLine(container, container->second.find(candidate->Displayable()));
 			continue;
 		}
 
-		if (i->second->Matches(user))
+		if (matches(candidate))
+			return candidate;
+	}
+
+	// Check the lines which could not be indexed.
+	for (LookupIter i = index.other.begin(); i != index.other.end(); )
+	{
+		XLine* line = i->second;
+		i++;
+
+		if (line->duration && current > line->expiry)
 		{
-			return i->second;
+			/* Expire the line, proceed to next one */
+			ExpireLine(container, container->second.find(line->Displayable()));
+			continue;
 		}
 
-		i = safei;
+		if (matches(line))
+			return line;
 	}
 	return nullptr;
 }
 
-XLine* XLineManager::MatchesLine(const std::string& type, const std::string& pattern)
+// returns a pointer to the reason if a nickname matches a Q-line, NULL if it didn't match
+
+XLine* XLineManager::MatchesLine(const std::string& type, User* user)
 {
 	ContainerIter x = lookup_lines.find(type);
 
 	if (x == lookup_lines.end())
 		return nullptr;
 
-	const time_t current = ServerInstance->Time();
+	LineIndex& index = line_index[type];
+	std::vector<XLine*> candidates;
+	if (!index.ipv4.empty() || !index.ipv6.empty())
+	{
+		FindAddressLines(index, user->client_sa, candidates);
 
-	LookupIter safei;
+		// Lines with an address range can also match a real hostname which is an IP address.
+		irc::sockets::sockaddrs hostsa(false);
+		if (user->GetRealHost() != user->GetAddress() && hostsa.from_ip(user->GetRealHost()) && hostsa != user->client_sa)
+		{
+			std::vector<XLine*> hostcandidates;
+			FindAddressLines(index, hostsa, hostcandidates);
 
-	for (LookupIter i = x->second.begin(); i != x->second.end(); )
-	{
-		safei = i;
-		safei++;
+			// Skip lines which also cover the address without disturbing the most specific first order.
+			std::unordered_set<XLine*> seen(candidates.begin(), candidates.end());
+			for (auto* candidate : hostcandidates)
+			{
+				if (seen.insert(candidate).second)
+					candidates.push_back(candidate);
+			}
+		}
+	}
+
+	return MatchesIndex(x, index, candidates, [user](XLine* line) {
+		return line->Matches(user);
+	});
+}
 
-		if (i->second->Matches(pattern))
+XLine* XLineManager::MatchesLine(const std::string& type, const std::string& pattern)
+{
+	ContainerIter x = lookup_lines.find(type);
+
+	if (x == lookup_lines.end())
+		return nullptr;
+
+	LineIndex& index = line_index[type];
+	std::vector<XLine*> candidates;
+	if (!index.ipv4.empty() || !index.ipv6.empty())
+	{
+		// Lines with an address range can only match patterns where the host is an IP address.
+		irc::sockets::sockaddrs sa(false);
+		std::string::size_type at = pattern.rfind('@');
+		if (!sa.from_ip(at == std::string::npos ? pattern : pattern.substr(at + 1)))
 		{
-			if (i->second->duration && current > i->second->expiry)
+			// This is not something we can look up so fall back to checking every line.
+			const time_t current = ServerInstance->Time();
+			for (LookupIter i = x->second.begin(); i != x->second.end(); )
 			{
+				LookupIter safei = i++;
+				if (!safei->second->Matches(pattern))
+					continue;
+
+				if (!safei->second->duration || current <= safei->second->expiry)
+					return safei->second;
+
 				/* Expire the line, return nothing */
-				ExpireLine(x, i);
-				/* See above */
-				i = safei;
-				continue;
+				ExpireLine(x, safei);
 			}
-			else
-				return i->second;
+			return nullptr;
 		}
+		FindAddressLines(index, sa, candidates);
+	}
 
-		i = safei;
+	return MatchesIndex(x, index, candidates, [&pattern](XLine* line) {
+		return line->Matches(pattern);
+	});
+}
+
+XLine* XLineManager::MatchesLine(const std::string& type, User* user, MatchCache& cache)
+{
+	// If neither the lines nor the user have changed then the user still matches the same line
+	// unless it has expired since we last checked it.
+	if (cache.lineserial == serial && cache.userserial == user->GetBanSerial())
+	{
+		XLine* line = cache.line;
+		if (!line || !line->duration || ServerInstance->Time() <= line->expiry)
+			return line;
 	}
-	return nullptr;
+
+	// Matching can expire lines so the serial is only read afterwards.
+	cache.line = MatchesLine(type, user);
+	cache.lineserial = serial;
+	cache.userserial = user->GetBanSerial();
+	return cache.line;
 }
 
 // removes lines that have expired
@@ -458,8 +577,10 @@ void XLineManager::ExpireLine(ContainerIter container, LookupIter item, bool sil
 	 */
 	stdalgo::erase(pending_lines, item->second);
 
+	UnindexLine(item->second);
 	delete item->second;
 	container->second.erase(item);
+	serial++;
 }
 
 // applies lines, removing clients and changing nicks etc as applicable
@@ -584,6 +705,24 @@ void XLine::DefaultApply(User* u, bool bancache)
 	}
 }
 
+bool XLine::ParseAddressRange(const std::string& mask, irc::sockets::cidr_mask& range)
+{
+	// This mirrors the validation done by irc::sockets::MatchCIDR.
+	if (mask.find_first_not_of("0123456789abcdefABCDEF.:/") != std::string::npos)
+		return false;
+
+	const std::string::size_type per_pos = mask.rfind('/');
+	if (per_pos != std::string::npos && (per_pos == mask.length() - 1
+		|| mask.find_first_not_of("0123456789", per_pos + 1) != std::string::npos
+		|| mask.find('/') != per_pos))
+	{
+		return false;
+	}
+
+	range = irc::sockets::cidr_mask(mask);
+	return range.type == AF_INET || range.type == AF_INET6;
+}
+
 bool KLine::Matches(User* u) const
 {
 	LocalUser* lu = IS_LOCAL(u);
@@ -732,6 +871,26 @@ const std::string& ZLine::Displayable() const
 	return ipaddr;
 }
 
+bool ELine::GetAddressRange(irc::sockets::cidr_mask& range) const
+{
+	return ParseAddressRange(hostmask, range);
+}
+
+bool KLine::GetAddressRange(irc::sockets::cidr_mask& range) const
+{
+	return ParseAddressRange(hostmask, range);
+}
+
+bool GLine::GetAddressRange(irc::sockets::cidr_mask& range) const
+{
+	return ParseAddressRange(hostmask, range);
+}
+
+bool ZLine::GetAddressRange(irc::sockets::cidr_mask& range) const
+{
+	return ParseAddressRange(ipaddr, range);
+}
+
 const std::string& QLine::Displayable() const
 {
 	return nick;
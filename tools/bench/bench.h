@@ -0,0 +1,210 @@
+/*
+ * InspIRCd -- Internet Relay Chat Daemon
+ *
+ * This file is part of InspIRCd.  InspIRCd is free software: you can
+ * redistribute it and/or modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation, version 2.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#pragma once
+
+#include <filesystem>
+#include <fstream>
+
+#include <fcntl.h>
+#include <sys/socket.h>
+
+#include "inspircd.h"
+
+/** Creates an instance of the module which has been linked into the benchmark, if any. */
+extern "C" Module* MODULE_SYM_INIT();
+
+namespace Bench
+{
+	/** The result of each benchmark is accumulated here so the compiler can not discard it. */
+	inline volatile size_t sink;
+
+	/** Times a benchmark and prints the result.
+	 * @param name The name of the benchmark.
+	 * @param iterations The number of times to call the benchmark function.
+	 * @param batch The number of iterations to run between calls to the flush function.
+	 * @param function The benchmark function. This is called with the iteration number and returns a value to discard.
+	 * @param flush A function which is called outside of the timed section after every batch of iterations.
+	 */
+	template <typename Function, typename Flush>
+	void Run(const char* name, size_t iterations, size_t batch, Function&& function, Flush&& flush)
+	{
+		size_t result = 0;
+		double elapsed = 0;
+		for (size_t done = 0; done < iterations; )
+		{
+			const size_t end = std::min(iterations, done + batch);
+			const auto start = std::chrono::steady_clock::now();
+			for (; done < end; ++done)
+				result += function(done);
+			elapsed += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+			flush();
+		}
+
+		sink = sink + result;
+		printf("%-36s %10zu iterations in %.3fs, %8.1f ns/iteration\n", name, iterations, elapsed, elapsed * 1e9 / iterations);
+	}
+
+	/** Times a benchmark and prints the result.
+	 * @param name The name of the benchmark.
+	 * @param iterations The number of times to call the benchmark function.
+	 * @param function The benchmark function. This is called with the iteration number and returns a value to discard.
+	 */
+	template <typename Function>
+	void Run(const char* name, size_t iterations, Function&& function)
+	{
+		Run(name, iterations, iterations, function, [] { });
+	}
+
+	/** A minimal server which is used by benchmarks that need the server instance. It has no
+	 * listeners, does not load any modules from disk, and is never run.
+	 */
+	class Server final
+	{
+	private:
+		/** The directory containing the config file for the server. */
+		std::filesystem::path directory;
+
+		/** The fake local users and the other ends of their sockets. */
+		std::vector<std::pair<LocalUser*, int>> users;
+
+	public:
+		Server()
+			: directory(std::filesystem::temp_directory_path() / INSP_FORMAT("inspircd-bench-{}", getpid()))
+		{
+			// The server will only load core modules from the module directory so we give it an
+			// empty one. Benchmarks which need a module link it in and load it with LoadModule.
+			std::filesystem::create_directories(directory / "modules");
+			const std::string config = (directory / "inspircd.conf").string();
+			std::ofstream(config)
+				<< "<server name=\"bench.example.com\" description=\"Benchmark\" id=\"0AA\" network=\"Bench\">\n"
+				<< "<path moduledir=\"" << (directory / "modules").string() << "\" datadir=\"" << directory.string()
+				<< "\" logdir=\"" << directory.string() << "\" runtimedir=\"" << directory.string() << "\">\n";
+
+			// Keep the startup banner out of the benchmark output.
+			fflush(stdout);
+			const int oldstdout = dup(STDOUT_FILENO);
+			const int devnull = open("/dev/null", O_WRONLY);
+			dup2(devnull, STDOUT_FILENO);
+			close(devnull);
+
+			const char* argv[] = { "bench", "--config", config.c_str(), "--nofork", "--nolog", "--nopid", "--runasroot", nullptr };
+			new InspIRCd(7, const_cast<char**>(argv));
+
+			fflush(stdout);
+			dup2(oldstdout, STDOUT_FILENO);
+			close(oldstdout);
+		}
+
+		~Server()
+		{
+			for (const auto& [_, peer] : users)
+				close(peer);
+
+			std::error_code ec;
+			std::filesystem::remove_all(directory, ec);
+		}
+
+		/** Initializes a module which has been linked into the benchmark using the $LinkModules
+		 * directive in the same way as the module manager would initialize it after loading it.
+		 * @param name The file name of the module.
+		 * @return The module which has been loaded.
+		 */
+		static Module* LoadModule(const std::string& name)
+		{
+			ModuleManager::ServiceList services;
+			ServerInstance->Modules.NewServices = &services;
+			Module* mod = MODULE_SYM_INIT();
+			ServerInstance->Modules.NewServices = nullptr;
+
+			mod->ModuleFile = name;
+			ServerInstance->Modules.AttachAll(mod);
+			ServerInstance->Modules.AddServices(services);
+
+			ConfigStatus confstatus;
+			mod->init();
+			mod->ReadConfig(confstatus);
+			return mod;
+		}
+
+		/** Creates a fully connected local user which is connected to one end of a socket pair.
+		 * @param nick The nickname of the user.
+		 * @param ip The IP address of the user.
+		 * @return The new user.
+		 */
+		LocalUser* AddLocalUser(const std::string& nick, const std::string& ip)
+		{
+			int fds[2];
+			if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds))
+				throw CoreException(INSP_FORMAT("Unable to create a socket pair: {}", strerror(errno)));
+
+			SocketEngine::NonBlocking(fds[0]);
+			SocketEngine::NonBlocking(fds[1]);
+
+			irc::sockets::sockaddrs client(false);
+			client.from_ip_port(ip, 50000);
+			irc::sockets::sockaddrs server(false);
+			server.from_ip_port("192.0.2.1", 6667);
+
+			auto* user = new LocalUser(fds[0], client, server);
+			SocketEngine::AddFd(&user->eh, FD_WANT_NO_READ | FD_WANT_NO_WRITE);
+			FOREACH_MOD(OnUserInit, (user));
+
+			user->nick = nick;
+			user->ChangeRealUser("bench", true);
+			user->connected = User::CONN_FULL;
+			ServerInstance->Users.clientlist[nick] = user;
+			users.emplace_back(user, fds[1]);
+			return user;
+		}
+
+		/** Adds a user to a channel without sending a JOIN message.
+		 * @param chan The channel to add the user to.
+		 * @param user The user to add.
+		 */
+		static void AddMember(Channel* chan, User* user)
+		{
+			Membership* memb = chan->AddUser(user);
+			if (memb)
+				user->chans.push_front(memb);
+		}
+
+		/** Writes the send queues of all local users to their sockets and discards the data. */
+		void Flush()
+		{
+			SocketEngine::DispatchTrialWrites();
+			for (;;)
+			{
+				bool pending = false;
+				char buffer[65536];
+				for (const auto& [user, peer] : users)
+				{
+					while (read(peer, buffer, sizeof(buffer)) > 0)
+						;
+					pending |= user->eh.GetSendQSize() != 0;
+				}
+
+				if (!pending)
+					break;
+
+				// Some of the sockets blocked so let the socket engine write to them now that
+				// they have been drained.
+				SocketEngine::DispatchEvents();
+			}
+		}
+	};
+}
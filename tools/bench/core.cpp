@@ -0,0 +1,179 @@
+/*
+ * InspIRCd -- Internet Relay Chat Daemon
+ *
+ * This file is part of InspIRCd.  InspIRCd is free software: you can
+ * redistribute it and/or modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation, version 2.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/// $LinkModules: core_serialize_rfc
+
+/* Benchmarks the routines in the core which are run for every message or every connection. The
+ * string handling routines are called directly. Everything else is run against a server instance
+ * which has been created with a minimal config but never started, with the RFC serializer linked
+ * in and loaded, and with fake local users which are connected to one end of a socket pair. The
+ * output written to these users is drained outside of the timed sections. The address index used
+ * for X-line lookups is also benchmarked on its own by xline_index.
+ *
+ * To build and run this benchmark:
+ *
+ *   make bench
+ *   ./build/<compiler>/bench/core [iterations]
+ */
+
+
+#include "bench.h"
+#include "clientprotocolmsg.h"
+#include "xline.h"
+
+int main(int argc, char** argv)
+{
+	using Bench::Run;
+	const size_t iterations = argc > 1 ? strtoul(argv[1], nullptr, 10) : 1000000;
+	Bench::Server server;
+	Bench::Server::LoadModule("core_serialize_rfc.so");
+
+	// Masks of the sort that are used in bans, X-lines, and connect classes.
+	const std::vector<std::string> hosts = {
+		"nick!user@host.example.com",
+		"someone!~ident@192-0-2-1.dynamic.isp.example.net",
+		"a-much-longer-nickname!username@very.long.reverse.dns.hostname.of.some.cloud.provider.example.org",
+		"guest12345!webchat@gateway/web/irccloud.com/x-abcdefghijklmnop",
+	};
+	const std::vector<std::string> masks = {
+		"*!*@*.example.com",
+		"*!~*@*.dynamic.isp.example.net",
+		"*bot*!*@*",
+		"guest*!*@gateway/web/*",
+		"nick!user@host.example.com",
+		"*!*@*.cloud.provider.*.org",
+	};
+	Run("Match (hit)", iterations, [&](size_t i) {
+		return InspIRCd::Match(hosts[i % hosts.size()], "*!*@*.example.*");
+	});
+	Run("Match (mixed)", iterations, [&](size_t i) {
+		return InspIRCd::Match(hosts[i % hosts.size()], masks[i % masks.size()]);
+	});
+	Run("Match (ascii)", iterations, [&](size_t i) {
+		return InspIRCd::Match(hosts[i % hosts.size()], masks[i % masks.size()], ascii_case_insensitive_map);
+	});
+
+	const std::vector<std::string> addresses = {
+		"192.0.2.1",
+		"198.51.100.254",
+		"2001:db8::1",
+		"2001:db8:85a3::8a2e:370:7334",
+	};
+	const std::vector<std::string> cidrs = {
+		"192.0.2.0/24",
+		"198.51.0.0/16",
+		"2001:db8::/32",
+		"2001:db8:85a3::/48",
+		"10.0.0.0/8",
+	};
+	Run("MatchCIDR", iterations, [&](size_t i) {
+		return irc::sockets::MatchCIDR(addresses[i % addresses.size()], cidrs[i % cidrs.size()], false);
+	});
+	Run("MatchCIDR (user@)", iterations, [&](size_t i) {
+		return irc::sockets::MatchCIDR("user@" + addresses[i % addresses.size()], "*@" + cidrs[i % cidrs.size()], true);
+	});
+	Run("MatchMask", iterations, [&](size_t i) {
+		return InspIRCd::MatchMask("*.example.org 10.0.0.0/8 192.0.2.0/24", "host.example.com", addresses[i % addresses.size()]);
+	});
+
+	// Lines of the sort that are received from clients.
+	const std::vector<std::string> lines = {
+		"PRIVMSG #channel :Hello, world! This is a typical message sent to a channel.",
+		"@+draft/reply=abc123;+typing=active :nick!user@host TAGMSG #channel",
+		"MODE #channel +ov-b nick1 nick2 *!*@banned.example.com",
+		"JOIN #one,#two,#three,#four key1,key2",
+		"PING :irc.example.com",
+	};
+
+	// The generic tokenizers which are used when parsing config values, mode changes, and lists
+	// of targets. These are not used by the serializer.
+	Run("tokenstream", iterations, [&](size_t i) {
+		irc::tokenstream tokens(lines[i % lines.size()]);
+		std::string token;
+		size_t count = 0;
+		while (tokens.GetTrailing(token))
+			count += token.length();
+		return count;
+	});
+	Run("sepstream", iterations, [&](size_t i) {
+		irc::commasepstream targets(i % 2 ? "#one,#two,#three,#four" : "nick1,nick2,#channel");
+		std::string token;
+		size_t count = 0;
+		while (targets.GetToken(token))
+			count += token.length();
+		return count;
+	});
+
+	// Parsing lines received from a client and serializing messages sent to a client.
+	LocalUser* source = server.AddLocalUser("source", "192.0.2.1");
+	ClientProtocol::Serializer* serializer = source->serializer;
+	Run("RFCSerializer::Parse", iterations, [&](size_t i) {
+		ClientProtocol::ParseOutput parseoutput;
+		serializer->Parse(source, lines[i % lines.size()], parseoutput);
+		return parseoutput.params.size();
+	});
+
+	ClientProtocol::Messages::Privmsg privmsg(source, "#channel", "Hello, world! This is a typical message sent to a channel.");
+	ClientProtocol::Message tagmsg("TAGMSG", source);
+	tagmsg.PushParam("#channel");
+	tagmsg.AddTag("+draft/reply", nullptr, "abc123");
+	tagmsg.AddTag("+typing", nullptr, "active");
+	tagmsg.AddTag("msgid", nullptr, "Wa1RyE5pCTPBP7y3DH0tbw");
+	tagmsg.AddTag("time", nullptr, "2020-01-01T00:00:00.000Z");
+	ClientProtocol::TagSelection alltags;
+	for (auto it = tagmsg.GetTags().begin(); it != tagmsg.GetTags().end(); ++it)
+		alltags.Select(tagmsg.GetTags(), it);
+	Run("RFCSerializer::Serialize", iterations, [&](size_t i) {
+		return i % 2 ? serializer->Serialize(privmsg, ClientProtocol::TagSelection()).length() : serializer->Serialize(tagmsg, alltags).length();
+	});
+
+	// Sending a message to every local user in a channel. Each batch is written to the sockets of
+	// the users outside of the timed section so that the send queues do not keep growing.
+	auto* chan = new Channel("#channel", ServerInstance->Time());
+	for (size_t i = 0; i < 250; ++i)
+		Bench::Server::AddMember(chan, server.AddLocalUser(INSP_FORMAT("user{}", i), INSP_FORMAT("198.51.100.{}", i)));
+	Bench::Server::AddMember(chan, source);
+	ClientProtocol::Messages::Privmsg chanmsg(source, chan, "Hello, world! This is a typical message sent to a channel.");
+	ClientProtocol::Event chanevent(ServerInstance->GetRFCEvents().privmsg, chanmsg);
+	const CUList except = { source };
+	Run("Channel::Write (250 users)", iterations / 100, 16, [&](size_t) {
+		chan->Write(chanevent, 0, except);
+		return chan->GetUsers().size();
+	}, [&] { server.Flush(); });
+
+	// Checking a user against the X-lines when they connect. Most lines on a busy network are
+	// host masks and IP ranges so the user is checked against a mixture of both.
+	for (size_t i = 0; i < 5000; ++i)
+	{
+		ServerInstance->XLines->AddLine(new GLine(ServerInstance->Time(), 0, "bench", "Bench", "*", INSP_FORMAT("*.host{}.example.net", i)), nullptr);
+		ServerInstance->XLines->AddLine(new GLine(ServerInstance->Time(), 0, "bench", "Bench", "*", INSP_FORMAT("10.{}.{}.0/24", i / 256, i % 256)), nullptr);
+		ServerInstance->XLines->AddLine(new ZLine(ServerInstance->Time(), 0, "bench", "Bench", INSP_FORMAT("172.{}.{}.0/24", 16 + i / 256, i % 256)), nullptr);
+	}
+	LocalUser* banned = server.AddLocalUser("banned", "10.4.4.4");
+	LocalUser* allowed = server.AddLocalUser("allowed", "203.0.113.1");
+	Run("XLineManager::MatchesLine (hit)", iterations / 10, [&](size_t) {
+		return !!ServerInstance->XLines->MatchesLine("G", banned);
+	});
+	// A user who does not match has to be checked against every host mask so this is much slower.
+	Run("XLineManager::MatchesLine (miss)", iterations / 1000, [&](size_t) {
+		return !!ServerInstance->XLines->MatchesLine("G", allowed);
+	});
+	Run("XLineManager::MatchesLine (ip)", iterations / 10, [&](size_t i) {
+		return !!ServerInstance->XLines->MatchesLine("Z", i % 2 ? "172.20.4.4" : "203.0.113.1");
+	});
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,679 @@
+/*
+ * InspIRCd -- Internet Relay Chat Daemon
+ *
+ * This file is part of InspIRCd.  InspIRCd is free software: you can
+ * redistribute it and/or modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation, version 2.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* Generates synthetic load against a running IRC server. This opens a large number of client
+ * connections, joins them to a set of channels, and then sends a mix of messages between them
+ * whilst reporting the message throughput, the time taken for messages to be delivered, and the
+ * memory used by the server.
+ *
+ * The clients are connected from several loopback addresses (127.0.x.y) when --sources is set so
+ * that per-address connection limits are not hit. The server being tested will usually need its
+ * connect class limits and the connectban module adjusting for the number of clients used.
+ *
+ * To build and run this load generator:
+ *
+ *   make bench
+ *   ./build/<compiler>/bench/loadgen --clients 5000 --sources 50 --channels 500 --pid <server pid>
+ */
+
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <lyra/lyra.hpp>
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace
+{
+	typedef std::chrono::steady_clock Clock;
+
+	/** The kinds of message which can be sent by clients. */
+	enum class MessageType
+	{
+		CHANNEL,
+		NOTICE,
+		PRIVATE,
+	};
+
+	/** The state of a client connection. */
+	enum class State
+	{
+		CONNECTING,
+		REGISTERING,
+		JOINING,
+		READY,
+		CLOSED,
+	};
+
+	struct Client final
+	{
+		/** The file descriptor of the client socket. */
+		int fd = -1;
+
+		/** The nickname of the client. */
+		std::string nick;
+
+		/** The channels that the client is joining. */
+		std::vector<size_t> channels;
+
+		/** The number of channels that the client has finished joining. */
+		size_t joined = 0;
+
+		/** Data which has been received but not processed yet. */
+		std::string recvq;
+
+		/** Data which is waiting to be sent. */
+		std::string sendq;
+
+		/** The state of the connection. */
+		State state = State::CONNECTING;
+	};
+
+	struct Options final
+	{
+		std::string server = "127.0.0.1";
+		unsigned int port = 6667;
+		size_t clients = 1000;
+		size_t sources = 1;
+		size_t channels = 100;
+		size_t joins = 3;
+		std::string topology = "uniform";
+		size_t rate = 1000;
+		size_t connectrate = 500;
+		unsigned long duration = 30;
+		std::string mix = "channel=80,private=15,notice=5";
+		std::string prefix = "lg";
+		long pid = 0;
+	};
+
+	/** Delivery times which were observed during an interval in microseconds. */
+	struct Samples final
+	{
+		std::vector<uint32_t> latencies;
+		size_t received = 0;
+		size_t sent = 0;
+
+		void Clear()
+		{
+			latencies.clear();
+			received = 0;
+			sent = 0;
+		}
+
+		uint32_t Percentile(double percentile)
+		{
+			if (latencies.empty())
+				return 0;
+
+			const size_t idx = std::min(latencies.size() - 1, static_cast<size_t>(latencies.size() * percentile / 100.0));
+			std::nth_element(latencies.begin(), latencies.begin() + idx, latencies.end());
+			return latencies[idx];
+		}
+	};
+
+	uint64_t Microseconds()
+	{
+		return std::chrono::duration_cast<std::chrono::microseconds>(Clock::now().time_since_epoch()).count();
+	}
+
+	/** Retrieves the resident set size of a process in kilobytes or 0 if it is not available. */
+	size_t GetRSS(long pid)
+	{
+		if (!pid)
+			return 0;
+
+		std::ifstream status("/proc/" + std::to_string(pid) + "/status");
+		std::string line;
+		while (std::getline(status, line))
+		{
+			if (!line.compare(0, 6, "VmRSS:"))
+				return strtoul(line.c_str() + 6, nullptr, 10);
+		}
+		return 0;
+	}
+
+	/** Parses a message mix in the format "type=weight,type=weight". */
+	bool ParseMix(const std::string& mix, std::vector<std::pair<MessageType, unsigned int>>& weights)
+	{
+		static const std::map<std::string, MessageType> types = {
+			{ "channel", MessageType::CHANNEL },
+			{ "notice",  MessageType::NOTICE  },
+			{ "private", MessageType::PRIVATE },
+		};
+
+		size_t start = 0;
+		while (start < mix.length())
+		{
+			size_t end = mix.find(',', start);
+			if (end == std::string::npos)
+				end = mix.length();
+
+			const std::string entry = mix.substr(start, end - start);
+			const size_t eq = entry.find('=');
+			const auto type = types.find(entry.substr(0, eq));
+			if (eq == std::string::npos || type == types.end())
+				return false;
+
+			weights.emplace_back(type->second, strtoul(entry.c_str() + eq + 1, nullptr, 10));
+			start = end + 1;
+		}
+		return !weights.empty();
+	}
+
+	class LoadGenerator final
+	{
+	private:
+		std::vector<Client> clients;
+		std::vector<pollfd> pollfds;
+		const Options& options;
+		std::mt19937_64 rng;
+		std::vector<std::pair<MessageType, unsigned int>> weights;
+		unsigned int totalweight = 0;
+		sockaddr_in target = { };
+
+		/** Statistics for the current reporting interval. */
+		Samples interval;
+
+		/** Statistics for the whole load phase. */
+		Samples total;
+
+		/** Whether messages are currently being measured. */
+		bool measuring = false;
+
+		size_t failed = 0;
+
+		void Close(Client& client)
+		{
+			if (client.state == State::CLOSED)
+				return;
+
+			close(client.fd);
+			client.fd = -1;
+			client.state = State::CLOSED;
+			failed++;
+		}
+
+		void Connect(size_t idx)
+		{
+			Client& client = clients[idx];
+			client.fd = socket(AF_INET, SOCK_STREAM, 0);
+			if (client.fd < 0)
+			{
+				perror("socket");
+				client.state = State::CLOSED;
+				failed++;
+				return;
+			}
+
+			fcntl(client.fd, F_SETFL, fcntl(client.fd, F_GETFL) | O_NONBLOCK);
+			int one = 1;
+			setsockopt(client.fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+			if (options.sources > 1)
+			{
+				const size_t source = idx % options.sources;
+				sockaddr_in local = { };
+				local.sin_family = AF_INET;
+				local.sin_addr.s_addr = htonl(0x7F000000 | ((1 + source / 254) << 8) | (1 + source % 254));
+				if (bind(client.fd, reinterpret_cast<sockaddr*>(&local), sizeof(local)) < 0)
+					perror("bind");
+			}
+
+			if (connect(client.fd, reinterpret_cast<sockaddr*>(&target), sizeof(target)) < 0 && errno != EINPROGRESS)
+			{
+				perror("connect");
+				Close(client);
+				return;
+			}
+
+			client.sendq.append("NICK ").append(client.nick).append("\r\nUSER loadgen 0 * :InspIRCd load generator\r\n");
+		}
+
+		void OnLine(Client& client, const std::string& line)
+		{
+			// Split the line into the prefix, command, and parameters.
+			size_t pos = 0;
+			if (line[0] == ':')
+				pos = line.find(' ') + 1;
+			if (!pos && line[0] == ':')
+				return;
+
+			const size_t cmdend = line.find(' ', pos);
+			const std::string command = line.substr(pos, cmdend - pos);
+			if (command == "PING")
+			{
+				client.sendq.append("PONG").append(cmdend == std::string::npos ? "" : line.substr(cmdend)).append("\r\n");
+			}
+			else if (command == "001")
+			{
+				client.state = client.channels.empty() ? State::READY : State::JOINING;
+				if (client.channels.empty())
+					return;
+
+				std::string join = "JOIN ";
+				for (const auto chan : client.channels)
+					join.append("#").append(options.prefix).append(std::to_string(chan)).push_back(',');
+				join.back() = '\r';
+				client.sendq.append(join).append("\n");
+			}
+			else if (command == "366")
+			{
+				if (++client.joined >= client.channels.size())
+					client.state = State::READY;
+			}
+			else if (command == "433" && client.state == State::REGISTERING)
+			{
+				client.nick.push_back('_');
+				client.sendq.append("NICK ").append(client.nick).append("\r\n");
+			}
+			else if (command == "ERROR")
+			{
+				fprintf(stderr, "%s: %s\n", client.nick.c_str(), line.c_str());
+				Close(client);
+			}
+			else if (measuring && (command == "PRIVMSG" || command == "NOTICE"))
+			{
+				// Messages from the load generator have a trailing parameter of "lg <timestamp>".
+				const size_t trailing = line.find(" :lg ", cmdend);
+				if (trailing == std::string::npos)
+					return;
+
+				const uint64_t sent = strtoull(line.c_str() + trailing + 5, nullptr, 10);
+				const uint64_t latency = Microseconds() - sent;
+				interval.latencies.push_back(static_cast<uint32_t>(std::min<uint64_t>(latency, UINT32_MAX)));
+				interval.received++;
+			}
+		}
+
+		void OnRead(Client& client)
+		{
+			char buffer[16384];
+			for (;;)
+			{
+				const ssize_t len = recv(client.fd, buffer, sizeof(buffer), 0);
+				if (len > 0)
+				{
+					client.recvq.append(buffer, len);
+					continue;
+				}
+
+				if (len == 0 || (errno != EAGAIN && errno != EWOULDBLOCK))
+					Close(client);
+				break;
+			}
+
+			size_t start = 0;
+			for (size_t eol; client.state != State::CLOSED && (eol = client.recvq.find('\n', start)) != std::string::npos; start = eol + 1)
+			{
+				size_t end = eol;
+				if (end > start && client.recvq[end - 1] == '\r')
+					end--;
+				if (end > start)
+					OnLine(client, client.recvq.substr(start, end - start));
+			}
+			client.recvq.erase(0, start);
+		}
+
+		void OnWrite(Client& client)
+		{
+			if (client.state == State::CONNECTING)
+				client.state = State::REGISTERING;
+
+			while (!client.sendq.empty())
+			{
+				const ssize_t len = send(client.fd, client.sendq.data(), client.sendq.length(), MSG_NOSIGNAL);
+				if (len > 0)
+				{
+					client.sendq.erase(0, len);
+					continue;
+				}
+
+				if (len < 0 && errno != EAGAIN && errno != EWOULDBLOCK)
+					Close(client);
+				break;
+			}
+		}
+
+		/** Waits for socket events and handles them. */
+		void Poll(int timeout)
+		{
+			pollfds.clear();
+			for (const auto& client : clients)
+			{
+				if (client.fd < 0)
+					continue;
+
+				short events = POLLIN;
+				if (client.state == State::CONNECTING || !client.sendq.empty())
+					events |= POLLOUT;
+				pollfds.push_back({ client.fd, events, 0 });
+			}
+
+			if (poll(pollfds.data(), pollfds.size(), timeout) <= 0)
+				return;
+
+			// The pollfds are in the same order as the clients which have a socket.
+			size_t idx = 0;
+			for (auto& client : clients)
+			{
+				if (client.fd < 0)
+					continue;
+
+				const short revents = pollfds[idx++].revents;
+				if (revents & POLLOUT)
+					OnWrite(client);
+				if (client.state != State::CLOSED && (revents & (POLLIN | POLLHUP | POLLERR)))
+					OnRead(client);
+			}
+		}
+
+		size_t Count(State state) const
+		{
+			return std::count_if(clients.begin(), clients.end(), [state](const Client& client) {
+				return client.state == state;
+			});
+		}
+
+		/** Picks the channels that a client should join. */
+		std::vector<size_t> PickChannels(size_t idx)
+		{
+			std::vector<size_t> chans;
+			const size_t joins = std::min(options.joins, options.channels);
+			if (options.topology == "zipf")
+			{
+				// A few channels are very large and the rest are small as on real networks.
+				std::vector<double> probabilities(options.channels);
+				for (size_t chan = 0; chan < options.channels; ++chan)
+					probabilities[chan] = 1.0 / (chan + 1);
+				std::discrete_distribution<size_t> dist(probabilities.begin(), probabilities.end());
+				while (chans.size() < joins)
+				{
+					const size_t chan = dist(rng);
+					if (std::find(chans.begin(), chans.end(), chan) == chans.end())
+						chans.push_back(chan);
+				}
+			}
+			else
+			{
+				// Every channel has roughly the same number of members.
+				for (size_t join = 0; join < joins; ++join)
+					chans.push_back((idx * joins + join) % options.channels);
+			}
+			return chans;
+		}
+
+		/** Sends a message from a random client. */
+		void SendMessage()
+		{
+			Client& client = clients[rng() % clients.size()];
+			if (client.state != State::READY)
+				return;
+
+			unsigned int pick = rng() % totalweight;
+			MessageType type = weights.front().first;
+			for (const auto& [wtype, weight] : weights)
+			{
+				if (pick < weight)
+				{
+					type = wtype;
+					break;
+				}
+				pick -= weight;
+			}
+
+			const std::string payload = " :lg " + std::to_string(Microseconds()) + "\r\n";
+			const std::string chan = "#" + options.prefix + std::to_string(client.channels[rng() % client.channels.size()]);
+			switch (type)
+			{
+				case MessageType::CHANNEL:
+					client.sendq.append("PRIVMSG ").append(chan).append(payload);
+					break;
+
+				case MessageType::NOTICE:
+					client.sendq.append("NOTICE ").append(chan).append(payload);
+					break;
+
+				case MessageType::PRIVATE:
+					client.sendq.append("PRIVMSG ").append(clients[rng() % clients.size()].nick).append(payload);
+					break;
+			}
+			interval.sent++;
+		}
+
+		void Report(double elapsed, const char* label)
+		{
+			const size_t rss = GetRSS(options.pid);
+			printf("%-8s sent %8.0f/s  delivered %9.0f/s  p50 %7uus  p99 %7uus  max %7uus",
+				label, interval.sent / elapsed, interval.received / elapsed,
+				interval.Percentile(50), interval.Percentile(99), interval.Percentile(100));
+			if (rss)
+				printf("  rss %zuK", rss);
+			printf("\n");
+			fflush(stdout);
+		}
+
+	public:
+		LoadGenerator(const Options& opts)
+			: options(opts)
+			, rng(0x1259)
+		{
+		}
+
+		int Run()
+		{
+			if (!ParseMix(options.mix, weights))
+			{
+				fprintf(stderr, "invalid message mix: %s\n", options.mix.c_str());
+				return EXIT_FAILURE;
+			}
+			for (const auto& [_, weight] : weights)
+				totalweight += weight;
+			if (!totalweight || !options.clients || !options.channels)
+			{
+				fprintf(stderr, "the message mix, clients, and channels must not be empty\n");
+				return EXIT_FAILURE;
+			}
+
+			target.sin_family = AF_INET;
+			target.sin_port = htons(options.port);
+			if (inet_pton(AF_INET, options.server.c_str(), &target.sin_addr) != 1)
+			{
+				fprintf(stderr, "invalid server address: %s\n", options.server.c_str());
+				return EXIT_FAILURE;
+			}
+
+			clients.resize(options.clients);
+			for (size_t idx = 0; idx < clients.size(); ++idx)
+			{
+				clients[idx].nick = options.prefix + std::to_string(idx);
+				clients[idx].channels = PickChannels(idx);
+			}
+
+			// Connect the clients at the requested rate and wait for them to join their channels.
+			const size_t startrss = GetRSS(options.pid);
+			auto start = Clock::now();
+			size_t connected = 0;
+			auto lastreport = start;
+			auto lastprogress = start;
+			size_t lastready = 0;
+			while (Count(State::READY) + Count(State::CLOSED) < clients.size())
+			{
+				// Give up on clients which are stuck (e.g. because they hit a channel limit).
+				const size_t ready = Count(State::READY);
+				if (ready != lastready || connected < clients.size())
+				{
+					lastready = ready;
+					lastprogress = Clock::now();
+				}
+				else if (Clock::now() - lastprogress > std::chrono::seconds(10))
+				{
+					fprintf(stderr, "gave up waiting for %zu clients to finish connecting\n", clients.size() - ready - Count(State::CLOSED));
+					break;
+				}
+
+				const double elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+				for (const size_t due = std::min<size_t>(clients.size(), elapsed * options.connectrate + 1); connected < due; ++connected)
+					Connect(connected);
+
+				Poll(10);
+				if (Clock::now() - lastreport >= std::chrono::seconds(1))
+				{
+					lastreport = Clock::now();
+					printf("connect  %zu/%zu ready, %zu failed\n", Count(State::READY), clients.size(), failed);
+					fflush(stdout);
+				}
+			}
+
+			const double connecttime = std::chrono::duration<double>(Clock::now() - start).count();
+			const size_t readyrss = GetRSS(options.pid);
+			printf("connect  %zu clients ready in %.3fs (%zu failed)", Count(State::READY), connecttime, failed);
+			if (readyrss)
+				printf(", server rss %zuK -> %zuK (%.1fK per client)", startrss, readyrss, double(readyrss - startrss) / clients.size());
+			printf("\n");
+
+			// Send messages at the requested rate and report the results every second.
+			measuring = true;
+			start = Clock::now();
+			lastreport = start;
+			size_t messages = 0;
+			while (Clock::now() - start < std::chrono::seconds(options.duration))
+			{
+				const double elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+				for (const size_t due = elapsed * options.rate; messages < due; ++messages)
+					SendMessage();
+
+				Poll(1);
+				if (Clock::now() - lastreport >= std::chrono::seconds(1))
+				{
+					const double period = std::chrono::duration<double>(Clock::now() - lastreport).count();
+					lastreport = Clock::now();
+					Report(period, "load");
+					total.latencies.insert(total.latencies.end(), interval.latencies.begin(), interval.latencies.end());
+					total.received += interval.received;
+					total.sent += interval.sent;
+					interval.Clear();
+				}
+			}
+
+			// Give any messages which are still in flight a chance to be delivered.
+			const double loadtime = std::chrono::duration<double>(Clock::now() - start).count();
+			for (auto drain = Clock::now(); Clock::now() - drain < std::chrono::seconds(1); )
+				Poll(10);
+			total.latencies.insert(total.latencies.end(), interval.latencies.begin(), interval.latencies.end());
+			total.received += interval.received;
+			total.sent += interval.sent;
+			std::swap(interval, total);
+			Report(loadtime, "total");
+
+			for (auto& client : clients)
+			{
+				if (client.state != State::CLOSED)
+				{
+					client.sendq.append("QUIT :Load generator finished\r\n");
+					OnWrite(client);
+					close(client.fd);
+				}
+			}
+			return EXIT_SUCCESS;
+		}
+	};
+}
+
+int main(int argc, char** argv)
+{
+	Options options;
+	bool help = false;
+	auto cli = lyra::cli()
+		| lyra::opt(options.server, "ADDRESS")
+			["-s"]["--server"]
+			("The IPv4 address of the server to connect to.")
+		| lyra::opt(options.port, "PORT")
+			["-p"]["--port"]
+			("The port of the server to connect to.")
+		| lyra::opt(options.clients, "COUNT")
+			["-c"]["--clients"]
+			("The number of clients to connect.")
+		| lyra::opt(options.sources, "COUNT")
+			["--sources"]
+			("The number of loopback addresses to spread the clients over.")
+		| lyra::opt(options.channels, "COUNT")
+			["--channels"]
+			("The number of channels to create.")
+		| lyra::opt(options.joins, "COUNT")
+			["--joins"]
+			("The number of channels that each client joins.")
+		| lyra::opt(options.topology, "uniform|zipf")
+			["--topology"]
+			("How clients are distributed between channels.")
+		| lyra::opt(options.rate, "COUNT")
+			["-r"]["--rate"]
+			("The number of messages to send per second.")
+		| lyra::opt(options.connectrate, "COUNT")
+			["--connect-rate"]
+			("The number of clients to connect per second.")
+		| lyra::opt(options.duration, "SECONDS")
+			["-d"]["--duration"]
+			("The number of seconds to send messages for.")
+		| lyra::opt(options.mix, "MIX")
+			["-m"]["--mix"]
+			("The weights of each message type (channel, private, notice).")
+		| lyra::opt(options.prefix, "PREFIX")
+			["--prefix"]
+			("The prefix of client nicknames and channel names.")
+		| lyra::opt(options.pid, "PID")
+			["--pid"]
+			("The process id of the server to report the memory usage of.")
+		| lyra::help(help);
+
+	auto result = cli.parse({ argc, argv });
+	if (!result)
+	{
+		fprintf(stderr, "Error: %s\n", result.message().c_str());
+		return EXIT_FAILURE;
+	}
+
+	if (help)
+	{
+		std::cout << cli << std::endl;
+		return EXIT_SUCCESS;
+	}
+
+	if (options.topology != "uniform" && options.topology != "zipf")
+	{
+		fprintf(stderr, "invalid topology: %s\n", options.topology.c_str());
+		return EXIT_FAILURE;
+	}
+
+	LoadGenerator generator(options);
+	return generator.Run();
+}
@@ -0,0 +1,116 @@
+/*
+ * InspIRCd -- Internet Relay Chat Daemon
+ *
+ * This file is part of InspIRCd.  InspIRCd is free software: you can
+ * redistribute it and/or modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation, version 2.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/// $LinkModules: m_spanningtree
+
+/* Benchmarks the routing decisions which the spanning tree module makes for every message that it
+ * sends to or receives from another server. These are run against a synthetic network of servers
+ * and remote users which has been created in the same way as the module would create it when
+ * receiving a netburst. The servers are not really linked so the routes to them are placeholders
+ * which are never written to, and writing the routed messages to the server sockets is not part
+ * of this benchmark.
+ *
+ * To build and run this benchmark:
+ *
+ *   make bench
+ *   ./build/<compiler>/bench/spanningtree [iterations]
+ */
+
+
+#include "bench.h"
+
+#include "../../src/modules/m_spanningtree/main.h"
+#include "../../src/modules/m_spanningtree/commandbuilder.h"
+#include "../../src/modules/m_spanningtree/remoteuser.h"
+#include "../../src/modules/m_spanningtree/treeserver.h"
+#include "../../src/modules/m_spanningtree/utils.h"
+
+int main(int argc, char** argv)
+{
+	using Bench::Run;
+	const size_t iterations = argc > 1 ? strtoul(argv[1], nullptr, 10) : 1000000;
+	Bench::Server server;
+	Bench::Server::LoadModule("m_spanningtree.so");
+
+	// A network of eight hubs which are linked to the local server, each of which has fifteen leaf
+	// servers linked to it. Every server has ten users which are all in one large channel and the
+	// users on the first two leaves of the first hub are also in a small channel.
+	static constexpr size_t HUBS = 8;
+	static constexpr size_t LEAVES = 15;
+	static constexpr size_t USERS = 10;
+	std::vector<char> routes(HUBS);
+	std::vector<TreeServer*> servers;
+	std::vector<User*> users;
+	auto* bigchan = new Channel("#big", ServerInstance->Time());
+	auto* smallchan = new Channel("#small", ServerInstance->Time());
+	for (size_t hub = 0; hub < HUBS; ++hub)
+	{
+		auto* route = reinterpret_cast<TreeSocket*>(&routes[hub]);
+		for (size_t leaf = 0; leaf <= LEAVES; ++leaf)
+		{
+			TreeServer* parent = leaf ? servers[hub * (LEAVES + 1)] : Utils->TreeRoot;
+			const std::string sid = INSP_FORMAT("{}{:02}", 1 + servers.size() / 100, servers.size() % 100);
+			auto* ts = new TreeServer(INSP_FORMAT("server{}.example.com", servers.size()), "Benchmark", sid, parent, route, false);
+			servers.push_back(ts);
+
+			for (size_t i = 0; i < USERS; ++i)
+			{
+				auto* user = new SpanningTree::RemoteUser(INSP_FORMAT("{}AAAAA{}", sid, i), ts);
+				user->nick = INSP_FORMAT("user{}", users.size());
+				ServerInstance->Users.clientlist[user->nick] = user;
+				users.push_back(user);
+
+				Bench::Server::AddMember(bigchan, user);
+				if (hub == 0 && leaf && leaf <= 2)
+					Bench::Server::AddMember(smallchan, user);
+			}
+		}
+	}
+
+	// Finding the server which a message to a server or user needs to be routed to.
+	Run("FindRouteTarget (server)", iterations, [&](size_t i) {
+		return !!Utils->FindRouteTarget(servers[i % servers.size()]->GetName());
+	});
+	Run("FindRouteTarget (nick)", iterations, [&](size_t i) {
+		return !!Utils->FindRouteTarget(users[i % users.size()]->nick);
+	});
+	Run("FindRouteTarget (uuid)", iterations, [&](size_t i) {
+		return !!Utils->FindRouteTarget(users[i % users.size()]->uuid);
+	});
+
+	// Finding the servers which a message to a channel needs to be routed to.
+	const CUList except = { users.front() };
+	Run("GetListOfServersForChannel (big)", iterations / 10, [&](size_t) {
+		SpanningTreeUtilities::TreeSocketSet list;
+		Utils->GetListOfServersForChannel(bigchan, list, 0, except);
+		return list.size();
+	});
+	Run("GetListOfServersForChannel (small)", iterations, [&](size_t) {
+		SpanningTreeUtilities::TreeSocketSet list;
+		Utils->GetListOfServersForChannel(smallchan, list, 0, except);
+		return list.size();
+	});
+
+	// Building the message which is sent to the other servers.
+	const std::string text = "Hello, world! This is a typical message sent to a channel.";
+	Run("CmdBuilder", iterations, [&](size_t i) {
+		CmdBuilder params(users[i % users.size()], "PRIVMSG");
+		params.push(bigchan->name).push_last(text);
+		return params.str().length();
+	});
+
+	return EXIT_SUCCESS;
+}
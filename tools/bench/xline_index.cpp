@@ -0,0 +1,168 @@
+/*
+ * InspIRCd -- Internet Relay Chat Daemon
+ *
+ * This file is part of InspIRCd.  InspIRCd is free software: you can
+ * redistribute it and/or modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation, version 2.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* Benchmarks the address index used by the X-line manager against a linear scan of the same
+ * address ranges. By default this indexes one million ranges which is roughly the size of the
+ * largest public blocklists.
+ *
+ * To build and run this benchmark:
+ *
+ *   make bench
+ *   ./build/<compiler>/bench/xline_index [ranges] [lookups]
+ */
+
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <random>
+#include <vector>
+
+#include "utility/cidr_tree.h"
+
+namespace
+{
+	struct Range final
+	{
+		unsigned char bits[16] = { };
+		unsigned char length;
+		size_t id;
+	};
+
+	bool InRange(const Range& range, const unsigned char* addr)
+	{
+		const size_t bytes = range.length / 8;
+		if (memcmp(range.bits, addr, bytes))
+			return false;
+
+		const unsigned char mask = 0xFF00 >> (range.length % 8);
+		return !(range.length % 8) || (addr[bytes] & mask) == range.bits[bytes];
+	}
+
+	Range RandomRange(std::mt19937_64& rng, bool ipv6, size_t id)
+	{
+		// Most blocklist entries are single addresses with a tail of smaller ranges.
+		Range range;
+		range.id = id;
+		if (ipv6)
+			range.length = rng() % 4 ? 128 : 48 + rng() % 81;
+		else
+			range.length = rng() % 4 ? 32 : 16 + rng() % 17;
+
+		for (size_t i = 0; i <= range.length / 8u && i < 16; ++i)
+			range.bits[i] = static_cast<unsigned char>(rng());
+
+		const size_t bytes = range.length / 8;
+		if (bytes < 16)
+		{
+			range.bits[bytes] &= 0xFF00 >> (range.length % 8);
+			std::fill(range.bits + bytes + 1, range.bits + 16, 0);
+		}
+		return range;
+	}
+
+	double Seconds(std::chrono::steady_clock::time_point start)
+	{
+		return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	}
+}
+
+int main(int argc, char** argv)
+{
+	const size_t count = argc > 1 ? strtoul(argv[1], nullptr, 10) : 1000000;
+	const size_t lookups = argc > 2 ? strtoul(argv[2], nullptr, 10) : 1000000;
+
+	std::mt19937_64 rng(0x1259);
+	std::vector<Range> ranges;
+	ranges.reserve(count);
+	for (size_t i = 0; i < count; ++i)
+		ranges.push_back(RandomRange(rng, i % 10 == 0, i));
+
+	// Half of the addresses are taken from the indexed ranges so that lookups actually hit.
+	std::vector<std::pair<bool, std::array<unsigned char, 16>>> addrs(lookups);
+	for (size_t i = 0; i < lookups; ++i)
+	{
+		auto& [ipv6, bits] = addrs[i];
+		for (auto& byte : bits)
+			byte = static_cast<unsigned char>(rng());
+
+		ipv6 = i % 10 == 0;
+		if (i % 2)
+		{
+			const Range& range = ranges[rng() % ranges.size()];
+			const size_t bytes = range.length / 8;
+			const unsigned char mask = 0xFF00 >> (range.length % 8);
+			ipv6 = range.id % 10 == 0;
+			memcpy(bits.data(), range.bits, bytes);
+			if (bytes < 16)
+				bits[bytes] = (range.bits[bytes] & mask) | (bits[bytes] & ~mask);
+		}
+	}
+
+	auto start = std::chrono::steady_clock::now();
+	insp::cidr_tree<size_t> ipv4;
+	insp::cidr_tree<size_t> ipv6;
+	for (const auto& range : ranges)
+		(range.id % 10 == 0 ? ipv6 : ipv4).insert(range.bits, range.length, range.id);
+	printf("insert: %zu ranges in %.3fs\n", count, Seconds(start));
+
+	size_t hits = 0;
+	start = std::chrono::steady_clock::now();
+	for (const auto& [isv6, bits] : addrs)
+	{
+		const auto& tree = isv6 ? ipv6 : ipv4;
+		hits += tree.find(bits.data(), isv6 ? 128 : 32, [](size_t) { return true; });
+	}
+	double elapsed = Seconds(start);
+	printf("index: %zu lookups (%zu hits) in %.3fs, %.0f ns/lookup\n", lookups, hits, elapsed, elapsed * 1e9 / lookups);
+
+	// A linear scan is much slower so only a sample of the lookups is used for it.
+	const size_t linearlookups = std::min<size_t>(lookups, 200);
+	size_t linearhits = 0;
+	start = std::chrono::steady_clock::now();
+	for (size_t i = 0; i < linearlookups; ++i)
+	{
+		const auto& [isv6, bits] = addrs[i];
+		const bool found = std::any_of(ranges.begin(), ranges.end(), [&](const Range& range) {
+			return (range.id % 10 == 0) == isv6 && InRange(range, bits.data());
+		});
+		const bool indexed = (isv6 ? ipv6 : ipv4).find(bits.data(), isv6 ? 128 : 32, [](size_t) { return true; });
+		if (found != indexed)
+		{
+			fprintf(stderr, "mismatch between the index and linear scan for lookup %zu\n", i);
+			return EXIT_FAILURE;
+		}
+		linearhits += found;
+	}
+	elapsed = Seconds(start);
+	printf("linear: %zu lookups (%zu hits) in %.3fs, %.0f ns/lookup\n", linearlookups, linearhits, elapsed, elapsed * 1e9 / linearlookups);
+
+	start = std::chrono::steady_clock::now();
+	for (const auto& range : ranges)
+	{
+		if (!(range.id % 10 == 0 ? ipv6 : ipv4).erase(range.bits, range.length, range.id))
+		{
+			fprintf(stderr, "range %zu was missing from the index\n", range.id);
+			return EXIT_FAILURE;
+		}
+	}
+	printf("erase: %zu ranges in %.3fs (%zu left)\n", count, Seconds(start), ipv4.size() + ipv6.size());
+	return EXIT_SUCCESS;
+}